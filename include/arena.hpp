@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+
+
+// Memory for boards. Every block is 64 byte aligned, so rows laid out on cache lines (BitBoard strides) are on cache lines in memory
+// and vector loads never split, and blocks of a huge page or more are aligned to one and advised for transparent huge pages, which
+// spares large boards most of their TLB misses. Freed blocks are kept, up to max_cached bytes in all, and handed out again to the next
+// allocation of the same size: engines rebuilt on the same board, spare boards and back buffers reuse pages that are already mapped.
+namespace arena {
+
+
+inline constexpr std::size_t alignment = 64;
+inline constexpr std::size_t huge_page = std::size_t{2} << 20;
+
+// Smaller blocks are not worth keeping.
+inline constexpr std::size_t min_cached = std::size_t{64} << 10;
+inline constexpr std::size_t max_cached = std::size_t{256} << 20;
+
+
+// Throws std::bad_alloc like operator new.
+void* allocate(std::size_t bytes);
+void deallocate(void*, std::size_t bytes) noexcept;
+
+// Gives the blocks kept for reuse back to the system.
+void trim();
+std::size_t get_cached_bytes();
+
+
+template<typename T>
+class Allocator {
+  public:
+    using value_type = T;
+
+
+    Allocator() = default;
+
+    template<typename U>
+    Allocator(const Allocator<U>&) noexcept {}
+
+
+    T* allocate(std::size_t count) {
+        if (count > static_cast<std::size_t>(-1) / sizeof(T)) {
+            throw std::bad_array_new_length{};
+        }
+
+        return static_cast<T*>(arena::allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T* pointer, std::size_t count) noexcept { arena::deallocate(pointer, count * sizeof(T)); }
+
+
+    template<typename U>
+    bool operator==(const Allocator<U>&) const noexcept {
+        return true;
+    }
+};
+
+
+template<typename T>
+using Vector = std::vector<T, Allocator<T>>;
+
+
+} // namespace arena
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "arena.hpp"
+#include "engine.hpp"
+#include "topology.hpp"
+
+
+
+// One bit per cell, 64 cells per word, least significant bit first.
+//
+// Every row carries a ghost cell on each side (bit 0 is column -1, bit res.x + 1 is column res.x) and there is a ghost row above and
+// below the board, so stepping kernels never have to special case the edges. Rows are preceded by pad_words zero words which also
+// serve as the zero tail of the previous row: reading one word past either end of a row is always valid and reads 0.
+class BitBoard {
+  public:
+    static constexpr std::size_t pad_words = 8;
+
+
+    explicit BitBoard(Resolution);
+
+
+    Resolution get_resolution() const { return res; }
+
+    std::size_t get_words_per_row() const { return words_per_row; }
+    std::size_t get_stride() const { return stride; }
+
+    std::size_t get_memory_bytes() const { return words.size() * sizeof(std::uint64_t); }
+
+    // Rows are indexed with the ghost rows included, the board itself spans rows 1 to res.y.
+    std::uint64_t* row(std::size_t y) { return &words[y * stride + pad_words]; }
+    const std::uint64_t* row(std::size_t y) const { return &words[y * stride + pad_words]; }
+
+    // Masks that clear the ghost columns (and the unused tail) from the first and last word of a row.
+    std::uint64_t get_first_mask() const { return first_mask; }
+    std::uint64_t get_last_mask() const { return last_mask; }
+
+
+    bool get(unsigned int x, unsigned int y) const;
+    void set(unsigned int x, unsigned int y, bool alive);
+
+    void clear();
+
+
+    // Ghost cells, x and y may be -1 or res.x / res.y.
+    bool get_ghost(std::int64_t x, std::int64_t y) const;
+    void set_ghost(std::int64_t x, std::int64_t y, bool alive);
+
+    // Clears the ghost cells, which is all a dead border needs.
+    void clear_halo();
+
+    // Fills the ghost cells around the board for the given topology: ghost columns first, then the ghost rows as copies of whole rows.
+    void fill_halo(Topology);
+
+    // Copies a row with its ghost cells, optionally mirrored left to right. Both boards must have the same width.
+    static void copy_row(const BitBoard& from, std::size_t from_row, BitBoard& to, std::size_t to_row, bool mirrored);
+
+    // Copies the `size` cells at (from_x, from_y) of `from` to (to_x, to_y), a word at a time. Both rectangles must lie within their
+    // boards, the cells around the target are left as they were.
+    void copy_from(const BitBoard& from, unsigned int from_x, unsigned int from_y, unsigned int to_x, unsigned int to_y, Resolution size);
+
+
+    // Gives `board` a board nobody else holds, for engines that share theirs with snapshots (see Engine::get_bands): a held board is
+    // parked in `spares` and swapped for a spare that has been let go since, or for a new one.
+    static void make_unshared(std::shared_ptr<BitBoard>& board, std::vector<std::shared_ptr<BitBoard>>& spares);
+
+
+    // Hash of the board as rows [first_row, first_row + res.y) of a board as wide, ghost cells left out. It is the sum of hash_word() over
+    // the words of the board, so the hashes of bands add up to the hash of the board they make up.
+    std::uint64_t hash(std::uint64_t first_row = 0) const;
+
+    // Mixes a word of cells with its position. Empty words hash to 0, so only the live cells of a board count towards its hash.
+    static std::uint64_t hash_word(std::uint64_t word, std::uint64_t position) {
+        std::uint64_t mixed = (word ^ (position * 0x9e3779b97f4a7c15ULL)) * 0xbf58476d1ce4e5b9ULL;
+        mixed = (mixed ^ (mixed >> 31)) * 0x94d049bb133111ebULL;
+
+        return word != 0 ? mixed ^ (mixed >> 29) : 0;
+    }
+
+
+    // Conversion from and to the one byte per cell layout of Engine, any non zero byte is alive.
+    void load_cells(std::span<const std::uint8_t>);
+    void store_cells(std::span<std::uint8_t>) const;
+
+
+  private:
+    Resolution res;
+
+    std::size_t words_per_row;
+    std::size_t stride;
+
+    std::uint64_t first_mask;
+    std::uint64_t last_mask;
+
+    arena::Vector<std::uint64_t> words;
+};
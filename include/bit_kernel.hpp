@@ -0,0 +1,176 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+#include "bit_board.hpp"
+#include "rule.hpp"
+
+
+
+namespace bit_kernel {
+
+enum class Isa { Scalar, Avx2, Avx512 };
+
+
+// Best instruction set supported by the running CPU.
+Isa detect();
+
+// Computes rows [begin, end) of `out` (ghost rows excluded, so 1 <= begin <= end <= res.y + 1) from `in`. Ghost columns of the
+// output are cleared, the ghost cells of `in` are read as they are.
+using Kernel = void (*)(const BitBoard& in, BitBoard& out, std::size_t begin, std::size_t end, const Rule&);
+
+// Life-like rules only. The kernel compiled for `rule` if it is one of named_rules, else one that reads the rule from its argument
+// once per call and jumps to the two three input functions it needs once per word.
+Kernel select(const Rule&, Isa = detect());
+bool is_specialised(const Rule&);
+
+inline void step_rows(const BitBoard& in, BitBoard& out, std::size_t begin, std::size_t end, const Rule& rule = {}, Isa isa = detect()) {
+    select(rule, isa)(in, out, begin, end, rule);
+}
+
+
+// Steps `lanes` independent boards 64 cells wide with dead borders, one word per row (bit x is column x), side by side: word
+// y * lanes + l is row y of board l, so a vector holds the same row of several boards. Computes rows [1, rows] of `out`, rows 0 and
+// rows + 1 are ghost rows that must be 0 in `in`.
+using LaneKernel = void (*)(const std::uint64_t* in, std::uint64_t* out, std::size_t lanes, std::size_t rows, const Rule&);
+
+// Life-like rules only, B3/S23 gets its own kernel.
+LaneKernel select_lanes(const Rule&, Isa = detect());
+
+
+// Kernels on bit-sliced words: every bit of the arguments is one cell, `_w` and `_e` are the rows shifted to line up with the west and
+// east neighbours. The neighbour count is summed with full adders, a row at a time first (RowSums) so that kernels walking down a column
+// sum each row once instead of once for each of the three cells it neighbours.
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+// Count of a row's cells around each cell as two bits, `lo` and `hi`, with the cell itself when the row is above or below (0-3), and
+// `side_lo`, `side_hi` without it when it is the cell's own row (0-2).
+template<typename V>
+struct RowSums {
+    V cell;
+
+    V lo;
+    V hi;
+
+    V side_lo;
+    V side_hi;
+};
+
+template<typename V>
+[[gnu::always_inline]] inline RowSums<V> sum_row(V w, V cell, V e) {
+    const V side_lo = w ^ e;
+    const V side_hi = w & e;
+
+    return {.cell = cell, .lo = side_lo ^ cell, .hi = side_hi | (side_lo & cell), .side_lo = side_lo, .side_hi = side_hi};
+}
+
+
+// B3/S23.
+template<typename V>
+[[gnu::always_inline]] inline V next_state(const RowSums<V>& a, const RowSums<V>& b, const RowSums<V>& c) {
+    // Count bit 0 and its carry into bit 1.
+    const V lo_x = a.lo ^ b.side_lo;
+    const V s0 = lo_x ^ c.lo;
+    const V carry = (a.lo & b.side_lo) | (lo_x & c.lo);
+
+    // Four weight 2 terms give bits 1 and up.
+    const V hi_x = a.hi ^ b.side_hi;
+    const V hi_y = c.hi ^ carry;
+    const V s1 = hi_x ^ hi_y;
+    const V s2_or_more = (a.hi & b.side_hi) | (c.hi & carry) | (hi_x & hi_y);
+
+    // A count of 3, or 2 if already alive.
+    return s1 & ~s2_or_more & (s0 | b.cell);
+}
+
+template<typename V>
+[[gnu::always_inline]] inline V next_state(V a_w, V a, V a_e, V b_w, V b, V b_e, V c_w, V c, V c_e) {
+    return next_state<V>(sum_row(a_w, a, a_e), sum_row(b_w, b, b_e), sum_row(c_w, c, c_e));
+}
+
+
+// Any rule. Entry n of `birth` (`survival`) is all ones when a dead (live) cell with n neighbours comes alive, with a rule known at
+// compile time the lookups below fold down to the terms it needs.
+template<typename V>
+struct RuleTable {
+    std::array<V, 9> birth;
+    std::array<V, 9> survival;
+};
+
+template<typename V>
+[[gnu::always_inline]] inline RuleTable<V> make_table(const Rule& rule) {
+    RuleTable<V> table;
+
+    for (unsigned int count = 0; count < 9; ++count) {
+        table.birth[count] = (rule.birth >> count & 1) != 0 ? ~V{} : V{};
+        table.survival[count] = (rule.survival >> count & 1) != 0 ? ~V{} : V{};
+    }
+
+    return table;
+}
+
+// Entry `count` of `entries` for every cell, with the count given as bits s0-s3 (8 only sets s3).
+template<typename V>
+[[gnu::always_inline]] inline V lookup(const std::array<V, 9>& entries, V s0, V s1, V s2, V s3) {
+    auto pick = [](V select, V one, V zero) { return zero ^ (select & (one ^ zero)); };
+
+    const V low = pick(s1, pick(s0, entries[3], entries[2]), pick(s0, entries[1], entries[0]));
+    const V high = pick(s1, pick(s0, entries[7], entries[6]), pick(s0, entries[5], entries[4]));
+
+    return pick(s3, entries[8], pick(s2, high, low));
+}
+
+template<typename V>
+[[gnu::always_inline]] inline V next_state(const RuleTable<V>& table, const RowSums<V>& a, const RowSums<V>& b, const RowSums<V>& c) {
+    const V lo_x = a.lo ^ b.side_lo;
+    const V s0 = lo_x ^ c.lo;
+    const V carry = (a.lo & b.side_lo) | (lo_x & c.lo);
+
+    // Unlike B3/S23 every count matters: the weight 2 terms carry at most twice into bit 2, both only for a count of 8.
+    const V hi_x = a.hi ^ b.side_hi;
+    const V hi_y = c.hi ^ carry;
+    const V s1 = hi_x ^ hi_y;
+
+    const V carry_x = a.hi & b.side_hi;
+    const V carry_y = c.hi & carry;
+    const V s2 = carry_x ^ carry_y ^ (hi_x & hi_y);
+    const V s3 = carry_x & carry_y;
+
+    // Birth or survival for each count first, so a single lookup follows.
+    std::array<V, 9> next;
+
+    for (unsigned int count = 0; count < 9; ++count) {
+        next[count] = table.birth[count] ^ (b.cell & (table.survival[count] ^ table.birth[count]));
+    }
+
+    return lookup(next, s0, s1, s2, s3);
+}
+
+template<typename V>
+[[gnu::always_inline]] inline V next_state(const RuleTable<V>& table, V a_w, V a, V a_e, V b_w, V b, V b_e, V c_w, V c, V c_e) {
+    return next_state<V>(table, sum_row(a_w, a, a_e), sum_row(b_w, b, b_e), sum_row(c_w, c, c_e));
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic pop
+#endif
+
+} // namespace bit_kernel
+
+
+constexpr std::string_view get_name(bit_kernel::Isa isa) {
+    switch (isa) {
+        case bit_kernel::Isa::Scalar: return "scalar";
+        case bit_kernel::Isa::Avx2: return "AVX2";
+        case bit_kernel::Isa::Avx512: return "AVX-512";
+    }
+
+    std::unreachable();
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bit_board.hpp"
+#include "engine.hpp"
+#include "rule.hpp"
+#include "simulation.hpp"
+#include "topology.hpp"
+
+
+
+// Binary checkpoints of a simulation: rule, topology, generation and the board, bit-packed.
+//
+// The file is a fixed size header, then an index of tile offsets, then the tiles. Tiles are tile_rows rows of tile_words words (the
+// last row and column of tiles may be smaller), 64 cells per word least significant bit first, and start on a word boundary, so a
+// mapped file is read in place. Compressed checkpoints leave out the tiles without a live cell, their offset is 0. Everything is little
+// endian.
+//
+// Bands count the dying cells of Generations rules as alive, so snapshots of those also keep the state of every cell, and their files
+// end with it: a byte per cell row-major after the tiles, found through one more index entry. Compressed checkpoints leave it out when
+// no cell is dying.
+//
+// Snapshots share the board with engines that keep it bit-packed, taking one costs no copy and Writer turns it into a file on another
+// thread, so checkpointing does not hold up stepping however large the board. Loading maps the file and decodes the tiles straight into
+// the board the engine is given. Malformed files throw std::invalid_argument, files that cannot be opened or written std::runtime_error.
+namespace checkpoint {
+
+
+inline constexpr std::uint32_t tile_rows = 64;
+inline constexpr std::uint32_t tile_words = 16;
+
+
+struct Snapshot {
+    Resolution res;
+    Rule rule;
+    Topology topology = Topology::DeadBorder;
+    std::uint64_t generation = 0;
+
+    std::vector<Engine::Band> bands;
+
+    // A byte per cell row-major (see Engine::get_cells()) when the rule has more than two states, empty otherwise.
+    std::vector<std::uint8_t> states;
+};
+
+struct Checkpoint {
+    Rule rule;
+    Topology topology = Topology::DeadBorder;
+    std::uint64_t generation = 0;
+
+    std::shared_ptr<BitBoard> board;
+
+    // As in Snapshot, only when a cell is dying.
+    std::vector<std::uint8_t> states;
+};
+
+
+Snapshot take(const Simulation&);
+
+void write(const std::filesystem::path&, const Snapshot&, bool compress = true);
+Checkpoint load(const std::filesystem::path&);
+
+// Loads the checkpoint into the simulation, which must have the same resolution. Nothing changes if it cannot be loaded.
+void restore(Simulation&, const std::filesystem::path&);
+
+
+// Writes snapshots on a background thread, in the order they are queued. Pending snapshots are still written on destruction.
+class Writer {
+  public:
+    Writer();
+    ~Writer();
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+
+    void write(std::filesystem::path, Snapshot, bool compress = true);
+
+    // Blocks until every queued snapshot is written.
+    void wait();
+
+    bool is_busy() const;
+
+    // The error of the last write that failed since the previous call, if any.
+    std::optional<std::string> take_error();
+
+
+  private:
+    struct Job {
+        std::filesystem::path path;
+        Snapshot snapshot;
+        bool compress;
+    };
+
+
+    void work();
+
+
+    std::deque<Job> jobs;
+    bool writing = false;
+    bool stopping = false;
+    std::optional<std::string> error;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    std::jthread thread;
+};
+
+
+} // namespace checkpoint
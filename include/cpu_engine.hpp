@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "arena.hpp"
+#include "engine.hpp"
+#include "rule.hpp"
+#include "topology.hpp"
+
+
+
+// Reference implementation of shaders/shader.comp.glsl, cell for cell, for every rule. Neighbour counts come from sliding window sums
+// over the rows and columns, so a Larger than Life cell costs the same as a Life one whatever the range.
+class CpuEngine final : public Engine {
+  public:
+    explicit CpuEngine(Resolution, Topology = Topology::DeadBorder, const Rule& = {});
+
+
+    void step(std::uint64_t generations) override;
+
+    void get_cells(std::span<std::uint8_t>) const override;
+    void set_cells(std::span<const std::uint8_t>) override;
+
+    std::uint64_t get_hash() const override;
+    std::uint64_t get_memory_bytes() const override;
+
+
+  private:
+    void fill_halo();
+    void add_row(std::size_t y, int sign);
+
+
+    Topology topology;
+    Rule rule;
+
+    // Ghost cells around the board, as many as the rule's range.
+    std::size_t border;
+    std::size_t stride;
+
+    // (res.x + 2 border) * (res.y + 2 border) cells, with a dead border the ghost cells stay 0 like an out of bounds imageLoad().
+    arena::Vector<std::uint8_t> front;
+    arena::Vector<std::uint8_t> back;
+
+    // Live cells of each padded column within the range of the row being stepped.
+    std::vector<std::uint32_t> column_counts;
+};
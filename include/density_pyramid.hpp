@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+
+#include "engine.hpp"
+#include "glu.hpp"
+
+
+
+// Live cells per texel of a board, in the mip levels of an r8 texture the viewer samples, so drawing a frame costs the same whatever
+// the size of the board: level m holds the density of squares 2^(m + 1) cells on a side. Needs a current OpenGL context.
+//
+// The levels are reduced by shaders/density.comp.glsl five at a time, from blocks of 32x32 cells then of 32x32 texels of the level
+// below, and only where a flag says something changed: the first pass reads the tile flags of GlEngine::get_dirty_texture(), each pass
+// after it the flags the one before set for the blocks it reduced. There are levels until the top one is at most top_size texels on a
+// side, and the board is padded with dead cells to a whole number of top level texels so every level is exactly half the one below.
+class DensityPyramid {
+  public:
+    static constexpr unsigned int top_size = 256;
+
+
+    explicit DensityPyramid(Resolution);
+
+
+    // The board as GlEngine keeps it, with a ghost border `border` cells wide. Only the tiles flagged in `dirty` are reduced, and their
+    // flags cleared. The first update after construction reduces every tile.
+    void update(const glu::Texture& board, unsigned int border, const glu::Texture& dirty);
+
+    // Reduces every tile, for boards uploaded whole.
+    void update(const glu::Texture& board, unsigned int border);
+
+
+    const glu::Texture& get_texture() const { return texture; }
+
+    Resolution get_resolution() const { return res; }
+
+    // Cells level 0 covers, the board and its padding.
+    Resolution get_padded_size() const { return padded; }
+
+
+  private:
+    void reduce(const glu::Texture& board, unsigned int border, const glu::Texture& dirty, bool everything);
+
+
+    Resolution res;
+    Resolution padded;
+
+    glu::Shader board_cs;
+    glu::Shader level_cs;
+    glu::Pipeline board_pipeline;
+    glu::Pipeline level_pipeline;
+
+    glu::Texture texture;
+
+    // Flags of the blocks of each pass, those of the first only for boards without their own.
+    std::vector<glu::Texture> flags;
+
+    bool stale = true;
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "bit_board.hpp"
+#include "bit_kernel.hpp"
+#include "engine.hpp"
+#include "halo_channel.hpp"
+#include "rule.hpp"
+#include "topology.hpp"
+
+
+
+// Bit-packed stepping split across worker processes. The board is cut into full width strips, one per worker, each with a ghost row
+// above and below. Every generation a worker sends its first and last rows to the workers of the strips around it and receives theirs
+// into its ghost rows, then steps its strip: neighbours only ever wait on each other, never on the engine.
+//
+// Rows go through HaloChannels, here rings in shared memory. The engine itself only hands out commands (load the board, step, store
+// it) through the same shared memory and waits for every worker to be done, so the stepping loop stays the one PackedEngine runs.
+// Workers are forked by the constructor with everything they need already allocated, and exit with the engine.
+//
+// The projective plane is not supported: crossing a side edge mirrors y, which would need halo columns from every other worker.
+class DistributedEngine final : public Engine {
+  public:
+    // Rows in flight on a channel, a worker is never more than a generation ahead of its neighbours.
+    static constexpr std::size_t ring_slots = 4;
+
+
+    // 0 processes starts one per hardware thread, there are never more than rows. Throws std::invalid_argument for rules or topologies
+    // it cannot run, and std::runtime_error if it cannot start the workers.
+    explicit DistributedEngine(Resolution, unsigned int processes = 0, Topology = Topology::DeadBorder, const Rule& = {},
+          bit_kernel::Isa = bit_kernel::detect());
+    ~DistributedEngine() override;
+
+
+    // Throw std::runtime_error if a worker has died, the engine is of no use after that.
+    void step(std::uint64_t generations) override;
+
+    void get_cells(std::span<std::uint8_t>) const override;
+    void set_cells(std::span<const std::uint8_t>) override;
+
+    std::vector<Band> get_bands() const override;
+    void set_board(std::shared_ptr<BitBoard>) override;
+
+    // The shared memory and the strips every worker steps.
+    std::uint64_t get_memory_bytes() const override;
+
+
+    // Since the engine started, per worker and averaged over the workers. Exchanging includes waiting for a neighbour's rows, so it is
+    // the latency a generation pays for being distributed.
+    struct HaloStatistics {
+        std::uint64_t generations = 0;
+
+        double exchange_seconds = 0;
+        double step_seconds = 0;
+    };
+
+    HaloStatistics get_halo_statistics() const;
+
+    unsigned int get_process_count() const { return static_cast<unsigned int>(strips.size()); }
+
+
+  private:
+    enum class Command : std::uint64_t { Load, Store, Step, Exit };
+
+    struct Control;
+    struct WorkerState;
+    struct Layout;
+
+    struct Strip {
+        unsigned int y;
+        unsigned int height;
+    };
+
+
+    static Layout get_layout(Resolution, std::size_t processes, std::size_t boundaries);
+
+    void start_workers(const bit_kernel::Kernel&);
+    [[noreturn]] void work(std::size_t index, BitBoard& front, BitBoard& back, BitBoard& scratch, const bit_kernel::Kernel&) const;
+
+    // Runs a command on every worker and waits for all of them.
+    void run(Command, std::uint64_t generations = 0) const;
+
+    // Waits for the workers to exit, killing them first if one has failed.
+    void stop_workers() noexcept;
+
+    // Rows of the board in shared memory, ghost cells clear.
+    std::uint64_t* get_row(std::size_t y) const;
+
+    ShmRing get_ring(std::size_t boundary, bool forward) const;
+
+
+    Topology topology;
+    Rule rule;
+
+    std::size_t words_per_row;
+    std::vector<Strip> strips;
+
+    // Between strips b and b + 1, and between the last and the first on wrapping topologies.
+    std::size_t boundaries;
+
+    SharedMemory memory;
+
+    Control* control;
+    WorkerState* states;
+    std::uint64_t* board;
+    std::byte* rings;
+
+    std::vector<pid_t> workers;
+
+    // Of the boards workers step their strips in.
+    std::uint64_t worker_bytes = 0;
+
+    mutable std::uint64_t sequence = 0;
+    mutable bool failed = false;
+};
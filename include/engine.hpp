@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+
+
+struct Resolution {
+    unsigned int x;
+    unsigned int y;
+};
+
+
+// Inclusive, in board coordinates. Unbounded engines may report cells outside of the board.
+struct BoundingBox {
+    std::int64_t x_min;
+    std::int64_t y_min;
+    std::int64_t x_max;
+    std::int64_t y_max;
+};
+
+
+
+class BitBoard;
+
+
+
+// A stepping backend. Cells are exchanged row-major, one byte per cell (res.x * res.y entries), the same layout as the R8ui textures.
+// A cell holds its state: 0 dead, 1 alive, and above that the dying states of Generations rules.
+class Engine {
+  public:
+    explicit Engine(Resolution res): res{res} {}
+    virtual ~Engine() = default;
+
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
+
+
+    virtual void step(std::uint64_t generations) = 0;
+
+    // Blocks until the generations stepped so far are computed. Engines that step asynchronously (on the GPU) may return from step()
+    // before, the others are always done.
+    virtual void finish() const {}
+
+    virtual void get_cells(std::span<std::uint8_t>) const = 0;
+    virtual void set_cells(std::span<const std::uint8_t>) = 0;
+
+    // Replaces the board with a random one, the same for a seed and density on every engine (see randomizer.hpp). The default fills a
+    // BitBoard on every hardware thread and hands it to set_board(). Throws std::invalid_argument unless 0 <= density <= 1.
+    virtual void randomize(std::uint64_t seed, float density);
+
+
+    // Live cells, and the box around every cell that is not dead. The defaults read the whole board back, engines that can do better
+    // override them.
+    virtual std::uint64_t get_population() const;
+    virtual std::optional<BoundingBox> get_bounding_box() const;
+
+    struct Statistics {
+        struct Changes {
+            std::uint64_t births;
+            std::uint64_t deaths;
+        };
+
+        std::uint64_t population = 0;
+        std::optional<BoundingBox> bounding_box;
+
+        // Over the last generation stepped, from engines that still hold the one before it.
+        std::optional<Changes> changes;
+    };
+
+    // All of the above at once, the default asks for each and has no changes.
+    virtual Statistics get_statistics() const;
+
+
+    // Rows [y, y + board->get_resolution().y) of the board.
+    struct Band {
+        unsigned int y;
+        std::shared_ptr<const BitBoard> board;
+    };
+
+    // The board bit-packed, for checkpoints. Engines that keep their board packed share it instead of copying it: they step into other
+    // boards while a band is held, so taking one costs nothing however large the board. Likewise set_board() may take the board over.
+    // The defaults go through get_cells() and set_cells().
+    virtual std::vector<Band> get_bands() const;
+    virtual void set_board(std::shared_ptr<BitBoard>);
+
+
+    // 64-bit hash of the board, equal for equal boards on the same engine. The default hashes get_bands() (BitBoard::hash()), engines
+    // that can keep it up to date as they step override it. Bands count dying cells as alive, so engines running Generations rules
+    // hash their cells instead (hash_cells()).
+    virtual std::uint64_t get_hash() const;
+
+
+    // Bytes the engine holds for the board and for stepping it, counted from what it allocated rather than what the process grew by.
+    virtual std::uint64_t get_memory_bytes() const = 0;
+
+
+    Resolution get_resolution() const { return res; }
+
+
+  protected:
+    // The hash of get_bands() plus the dying states: equal to it for boards without dying cells, and different from it for boards
+    // that only differ in how far along their dying cells are.
+    std::uint64_t hash_cells() const;
+
+
+    Resolution res;
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include "engine.hpp"
+#include "glu.hpp"
+#include "rule.hpp"
+#include "topology.hpp"
+
+
+
+// Steps the board with shaders/shader.comp.glsl, specialised for the rule, needs a current OpenGL context. Textures carry a ghost
+// border as wide as the rule's range, filled by shaders/halo.comp.glsl before every generation unless the border is dead. Larger than
+// Life rules count their neighbours from a summed-area table built by shaders/sat.comp.glsl.
+//
+// Life-like rules run shaders/blocked.comp.glsl instead, which advances bit-packed blocks of cells in shared memory several generations
+// per dispatch. 0 block generations keeps them on the one generation per dispatch path too.
+//
+// Statistics are reduced on the GPU by shaders/stats.comp.glsl, only the few bytes of the result are read back. Births and deaths
+// compare with the texture the last dispatch read, so they are there when it advanced a single generation. get_statistics() waits
+// for the reduction, the viewer requests one every frame instead and polls for those that landed through a glu::ReadbackRing.
+// Random boards are drawn in place by shaders/random.comp.glsl.
+//
+// Both stepping shaders flag the tiles of dirty_tile_size cells square in which a cell changed, for the viewer to redraw only those
+// (see DensityPyramid).
+class GlEngine final : public Engine {
+  public:
+    // Side of the blocks in shaders/blocked.comp.glsl.
+    static constexpr unsigned int block_size = 128;
+    static constexpr unsigned int default_block_generations = 8;
+
+    // The workgroups of shaders/shader.comp.glsl.
+    static constexpr unsigned int dirty_tile_size = 32;
+
+    // Requested statistics being read back at once.
+    static constexpr std::size_t statistics_slots = 3;
+
+
+    explicit GlEngine(
+          Resolution, Topology = Topology::DeadBorder, const Rule& = {}, unsigned int block_generations = default_block_generations);
+
+
+    void step(std::uint64_t generations) override;
+    void finish() const override;
+
+    void get_cells(std::span<std::uint8_t>) const override;
+    void set_cells(std::span<const std::uint8_t>) override;
+
+    void randomize(std::uint64_t seed, float density) override;
+
+    std::uint64_t get_population() const override;
+    std::optional<BoundingBox> get_bounding_box() const override;
+    Statistics get_statistics() const override;
+
+    std::uint64_t get_hash() const override;
+
+    // Of the textures, in GPU memory.
+    std::uint64_t get_memory_bytes() const override;
+
+    // Of the board as it was when requested, tagged e.g. with its generation.
+    struct TaggedStatistics {
+        std::uint64_t tag;
+        Statistics statistics;
+    };
+
+    // Starts reducing the board as it is now and returns without waiting for the result. False, starting nothing, while
+    // statistics_slots reductions are still being read back.
+    bool request_statistics(std::uint64_t tag) const;
+
+    // The latest requested statistics to have landed since the last poll, usually a frame or two after they were requested.
+    std::optional<TaggedStatistics> poll_statistics() const;
+
+
+    const glu::Texture& get_texture() const { return input_texture; }
+    unsigned int get_border() const { return border; }
+
+    // A texel per tile, 1 where a cell of the tile changed since the flag was last cleared by whoever reads them. Every tile starts out
+    // changed, and changes with set_cells() and randomize().
+    const glu::Texture& get_dirty_texture() const { return dirty_texture; }
+    unsigned int get_block_generations() const { return block_generations; }
+
+
+  private:
+    // Texels of the row shaders/stats.comp.glsl reduces into.
+    static constexpr unsigned int statistics_texels = 11;
+
+    // Entries shaders/sat.comp.glsl scans at once along a row or column, and rows or columns per workgroup. The run totals of a line
+    // are scanned by a single workgroup, boards are at most table_run_size^2 cells wide or high.
+    static constexpr unsigned int table_run_size = 256;
+    static constexpr unsigned int table_lines = 16;
+
+
+    void step_once();
+
+    // Into stats_texture, for get_statistics() or the ring to read back.
+    void reduce_statistics() const;
+    static Statistics decode_statistics(std::span<const std::uint32_t> texels);
+
+
+    Topology topology;
+    unsigned int states;
+    unsigned int border;
+    unsigned int block_generations;
+
+    glu::Shader cs;
+    glu::Pipeline pipeline;
+
+    glu::Shader halo_cs;
+    glu::Pipeline halo_pipeline;
+
+    glu::Shader table_cs;
+    glu::Pipeline table_pipeline;
+
+    glu::Shader blocked_cs;
+    glu::Pipeline blocked_pipeline;
+
+    glu::Shader random_cs;
+    glu::Pipeline random_pipeline;
+
+    glu::Shader stats_cs;
+    glu::Pipeline stats_pipeline;
+    mutable glu::Texture stats_texture;
+    mutable glu::ReadbackRing stats_ring;
+
+    glu::Texture input_texture;
+    glu::Texture output_texture;
+    glu::Texture dirty_texture;
+
+    std::optional<glu::Texture> table;
+
+    // Of the runs of table_run_size entries shaders/sat.comp.glsl scans at once, along each row or column.
+    std::optional<glu::Texture> table_totals;
+
+    // Generations the last dispatch advanced, output_texture holds the board from before it.
+    unsigned int last_dispatch_generations = 0;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "glu.hpp"
+#include "soup_search.hpp"
+
+
+
+namespace soup {
+
+
+// Boards in the layers of an r8ui array texture, stepped by shaders/soup.comp.glsl a workgroup per board, needs a current OpenGL
+// context. A dispatch runs every generation of a step() in shared memory, only set_board() and get_boards() move cells over the bus.
+class GlSoupBatch final : public Batch {
+  public:
+    static constexpr unsigned int default_layers = 1024;
+
+
+    explicit GlSoupBatch(const Rule&, unsigned int layers = default_layers);
+
+
+    std::size_t get_size() const override { return boards.get_layers(); }
+
+    void set_board(std::size_t index, const Board&) override;
+    void get_boards(std::span<Board>) const override;
+
+    void step(std::uint64_t generations) override;
+
+
+  private:
+    glu::Shader cs;
+    glu::Pipeline pipeline;
+
+    glu::TextureArray boards;
+
+    // Cells of every layer as read back.
+    mutable std::vector<std::uint8_t> cells;
+};
+
+
+} // namespace soup
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+#include "trace.hpp"
+
+
+
+namespace trace {
+
+
+inline constexpr std::size_t max_pending_gpu = 1024;
+
+
+// Times the GL commands issued from construction to destruction, on gpu_track, needs a current OpenGL context. A pair of GL_TIMESTAMP
+// queries rather than GL_TIME_ELAPSED brackets the commands, so spans nest. Nothing waits for the queries: collect_gpu() records the
+// spans that have landed, usually a frame or two later. Spans beyond max_pending_gpu in flight are dropped.
+class GpuSpan {
+  public:
+    explicit GpuSpan(std::string_view name);
+    ~GpuSpan();
+
+    GpuSpan(const GpuSpan&) = delete;
+    GpuSpan& operator=(const GpuSpan&) = delete;
+
+
+  private:
+    std::string_view name;
+
+    // 0 when the span is not timed.
+    unsigned int begin = 0;
+};
+
+
+// Records the GPU spans whose queries have landed, in the order they were issued, and never waits. Called once a frame from the
+// context's thread. GPU timestamps are mapped onto now() by reading both clocks at each call.
+void collect_gpu();
+
+
+} // namespace trace
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+
+
+// One direction of a halo exchange between two workers that step neighbouring strips of a board: the edge row of one strip, sent every
+// generation to become a ghost row of the other, in generation order. DistributedEngine only exchanges rows through this interface, so
+// workers on other hosts need a socket channel and nothing else.
+class HaloChannel {
+  public:
+    virtual ~HaloChannel() = default;
+
+    // Blocks while the receiver is a full buffer of rows behind.
+    virtual void send(std::span<const std::uint64_t> row) = 0;
+
+    // Blocks until the next row has arrived.
+    virtual void receive(std::span<std::uint64_t> row) = 0;
+};
+
+
+// A POSIX shared memory object mapped for the life of the object. It is unlinked as soon as it is mapped, so it never outlives the
+// processes that map it: workers forked afterwards inherit the mapping. Throws std::runtime_error if it cannot be created or mapped.
+class SharedMemory {
+  public:
+    explicit SharedMemory(std::size_t bytes);
+    ~SharedMemory();
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+
+    std::byte* get_data() const { return data; }
+    std::size_t get_size() const { return size; }
+
+
+  private:
+    std::byte* data = nullptr;
+    std::size_t size = 0;
+};
+
+
+// A single producer, single consumer ring of rows in memory shared by two processes. It is lock-free: the producer publishes a row by
+// advancing the head, and the consumer frees its slot by advancing the tail. A side that has to wait spins, then yields, then naps.
+class ShmRing final : public HaloChannel {
+  public:
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+
+    // Bytes of shared memory for a ring, a multiple of a cache line.
+    static std::size_t get_bytes(std::size_t row_words, std::size_t slots);
+
+    // Sets up an empty ring in `memory`, before either side uses it.
+    static void create(std::byte* memory, std::size_t row_words, std::size_t slots);
+
+    // Either side of the ring create() set up in `memory`.
+    ShmRing(std::byte* memory, std::size_t row_words, std::size_t slots);
+
+
+    void send(std::span<const std::uint64_t> row) override;
+    void receive(std::span<std::uint64_t> row) override;
+
+
+  private:
+    struct Header;
+
+
+    Header* header;
+    std::uint64_t* rows;
+
+    std::size_t row_words;
+    std::size_t slots;
+};
+
+
+// One more attempt at something another process has not done yet: the first ones spin, then the thread yields, then it naps, longer
+// once the wait has gone on a while, so an idle worker does not burn a core.
+void relax(unsigned int attempt);
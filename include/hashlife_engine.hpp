@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "engine.hpp"
+#include "rule.hpp"
+
+
+
+// Gosper's HashLife on an unbounded plane. The board only places the initial pattern (its top left corner at the origin) and is the
+// window get_cells() reads, patterns leaving it keep evolving.
+//
+// Nodes are hash-consed quadtrees with 8x8 bitmap leaves. Each node memoizes its RESULT, the centre half advanced by
+// 2^min(step, level - 2) generations, and unreferenced nodes are collected between steps once the arena grows past its limit.
+//
+// Runs Life-like rules without B0, which would fill the whole plane.
+class HashLifeEngine final : public Engine {
+  public:
+    static constexpr std::size_t default_node_limit = std::size_t{1} << 22;
+
+
+    explicit HashLifeEngine(Resolution, const Rule& = {}, std::size_t node_limit = default_node_limit);
+    ~HashLifeEngine() override;
+
+
+    void step(std::uint64_t generations) override;
+
+    // Advances 2^exponent generations in one jump.
+    void step_pow2(unsigned int exponent);
+
+    void get_cells(std::span<std::uint8_t>) const override;
+    void set_cells(std::span<const std::uint8_t>) override;
+
+
+    std::uint64_t get_population() const override;
+    std::optional<BoundingBox> get_bounding_box() const override;
+
+    // The node arena whether or not nodes are in use, and the hash table.
+    std::uint64_t get_memory_bytes() const override;
+
+
+    std::size_t get_node_count() const { return node_count; }
+
+
+  private:
+    struct Node;
+
+    enum class Side { West, East, North, South };
+
+
+    Node* leaf(std::uint64_t bits);
+    Node* join(Node* nw, Node* ne, Node* sw, Node* se);
+    Node* empty(unsigned int level);
+
+    Node* centre(Node*);
+    Node* expand(Node*);
+    Node* advance(Node*);
+    Node* advance_leaves(Node*);
+
+    Node* build(std::span<const std::uint8_t> cells, unsigned int level, std::int64_t x, std::int64_t y);
+    void draw(const Node*, std::int64_t x, std::int64_t y, std::span<std::uint8_t> cells) const;
+    std::int64_t distance(const Node*, Side, std::unordered_map<const Node*, std::int64_t>& memo) const;
+
+    bool is_centred(const Node*) const;
+    std::int64_t get_origin() const;
+
+    Node* allocate();
+    Node* insert(Node*, std::size_t hash);
+    void rehash();
+    void collect();
+
+
+    Rule rule;
+
+    std::size_t node_limit;
+    unsigned int step_exponent = 0;
+
+    Node* root = nullptr;
+
+    std::vector<Node*> buckets;
+    std::size_t node_count = 0;
+
+    std::vector<std::unique_ptr<Node[]>> blocks;
+    Node* free_list = nullptr;
+
+    std::vector<Node*> empties;
+};
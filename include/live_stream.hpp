@@ -0,0 +1,199 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "engine.hpp"
+
+
+
+// Streams a running simulation over TCP to any number of viewers.
+//
+// Every frame is a fixed size Header and a payload. The board is bit-packed the way checkpoints are (rows of (width + 63) / 64 words,
+// 64 cells per word least significant bit first, no ghost cells) and a keyframe sends it whole, a delta XORed with the frame before it.
+// Either is run-length encoded (encode()): boards that change little between frames XOR to words that are mostly zero, and so do the
+// dead regions of a keyframe. Everything is little endian.
+//
+// That board holds the live cells. Generations rules have dying cells too, their frames carry more bit planes after it, each a board of
+// the same size: plane p holds bit p of state - 1 for the dying cells, so a cell is dying where any of them is set (see get_planes()).
+//
+// Viewers joining get a keyframe first, then deltas, with a keyframe every keyframe_interval frames for good measure. The server
+// never holds up the simulation: publish() only hands the bands of a snapshot over to the server thread, which packs, encodes and
+// sends them. A frame published before the thread took the one before replaces it, and a viewer that still has max_queued_frames
+// frames to read skips frames until it catches up, then gets a keyframe. Malformed frames throw std::invalid_argument, sockets that
+// cannot be set up std::runtime_error.
+namespace live {
+
+
+inline constexpr std::array<char, 8> magic{'S', 'L', 'I', 'M', 'E', 'F', 'R', 'M'};
+
+enum class FrameType : std::uint32_t { Keyframe, Delta };
+
+struct Header {
+    std::array<char, 8> magic;
+    FrameType type;
+
+    std::uint32_t width;
+    std::uint32_t height;
+
+    // Of the rule, see Rule::states.
+    std::uint32_t states;
+    std::uint64_t generation;
+
+    std::uint64_t payload_bytes;
+};
+
+static_assert(sizeof(Header) == 40);
+
+
+// Boards in the frames of a rule with that many states, the live cells and the planes of the dying states.
+constexpr std::size_t get_planes(std::uint32_t states) {
+    return states > 2 ? 1 + std::bit_width(states - 2) : 1;
+}
+
+
+// A run of words is the count of zero words before it, the count of words that follow as they are, both as LEB128 varints, then those
+// words.
+std::vector<std::uint8_t> encode(std::span<const std::uint64_t> words);
+
+// Decodes exactly out.size() words.
+void decode(std::span<const std::uint8_t> bytes, std::span<std::uint64_t> out);
+
+
+class Server {
+  public:
+    struct Options {
+        // Numeric IPv4 or IPv6, 0.0.0.0 to take viewers from other hosts.
+        std::string address = "127.0.0.1";
+
+        // 0 picks a free port, see get_port().
+        std::uint16_t port = 0;
+
+        std::uint64_t keyframe_interval = 256;
+        std::size_t max_queued_frames = 4;
+    };
+
+    struct Statistics {
+        std::size_t viewers = 0;
+
+        std::uint64_t frames_published = 0;
+
+        // Counted once for every viewer it went to.
+        std::uint64_t frames_sent = 0;
+
+        // Published frames replaced before they were sent, and frames viewers skipped for being behind.
+        std::uint64_t frames_replaced = 0;
+        std::uint64_t frames_skipped = 0;
+
+        // Encoded, once however many viewers they went to.
+        std::uint64_t keyframe_bytes = 0;
+        std::uint64_t delta_bytes = 0;
+    };
+
+
+    explicit Server(Options);
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+
+    std::uint16_t get_port() const { return port; }
+
+    // Whether anyone is watching, so callers can spare taking snapshots otherwise.
+    bool has_viewers() const;
+
+    void publish(checkpoint::Snapshot);
+
+    Statistics get_statistics() const;
+
+
+  private:
+    struct Viewer;
+
+
+    void work();
+    void accept_viewers();
+    void send_frame();
+    void flush(Viewer&);
+
+
+    Options options;
+    std::uint16_t port = 0;
+
+    int listener = -1;
+
+    // Written to wake the server thread up.
+    std::array<int, 2> wake{-1, -1};
+
+    std::vector<Viewer> viewers;
+    std::uint64_t frames = 0;
+
+    // Of the last frame sent, packed.
+    Resolution res{0, 0};
+    std::uint32_t states = 0;
+    std::vector<std::uint64_t> previous;
+    std::vector<std::uint64_t> current;
+
+    mutable std::mutex mutex;
+    std::optional<checkpoint::Snapshot> pending;
+    bool stopping = false;
+    Statistics statistics;
+
+    std::jthread thread;
+};
+
+
+// Receives a stream and keeps the board it describes. Blocking, for tools and tests.
+class Client {
+  public:
+    // Throws std::runtime_error if it cannot connect.
+    Client(const std::string& host, std::uint16_t port);
+    ~Client();
+
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+
+
+    // Waits for the next frame and applies it. Returns false once the server has closed the stream.
+    bool receive();
+
+
+    const Header& get_header() const { return header; }
+
+    Resolution get_resolution() const { return {header.width, header.height}; }
+    std::uint64_t get_generation() const { return header.generation; }
+
+    // The live cells as packed in frames.
+    std::span<const std::uint64_t> get_words() const;
+
+    std::uint64_t get_population() const;
+
+    // The state of every cell row-major, like Engine::get_cells(). Throws std::invalid_argument if the buffer does not match the
+    // resolution.
+    void get_cells(std::span<std::uint8_t>) const;
+
+
+  private:
+    bool read(void* data, std::size_t bytes);
+
+
+    int connection = -1;
+
+    Header header{};
+    std::vector<std::uint8_t> payload;
+    std::vector<std::uint64_t> words;
+    std::vector<std::uint64_t> delta;
+};
+
+
+} // namespace live
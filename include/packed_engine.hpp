@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "bit_board.hpp"
+#include "bit_kernel.hpp"
+#include "engine.hpp"
+#include "rule.hpp"
+#include "topology.hpp"
+
+
+
+// Single threaded stepping of a bit-packed board with the widest kernel the CPU supports.
+class PackedEngine final : public Engine {
+  public:
+    explicit PackedEngine(Resolution, Topology = Topology::DeadBorder, const Rule& = {}, bit_kernel::Isa = bit_kernel::detect());
+
+
+    void step(std::uint64_t generations) override;
+
+    void get_cells(std::span<std::uint8_t>) const override;
+    void set_cells(std::span<const std::uint8_t>) override;
+
+    std::vector<Band> get_bands() const override;
+    void set_board(std::shared_ptr<BitBoard>) override;
+
+    // Spares held by snapshots are counted while the engine keeps them.
+    std::uint64_t get_memory_bytes() const override;
+
+
+    bit_kernel::Isa get_isa() const { return isa; }
+
+
+  private:
+    Topology topology;
+    Rule rule;
+    bit_kernel::Isa isa;
+    bit_kernel::Kernel kernel;
+
+    // The halo of front is filled as soon as the board changes rather than before stepping it, so a board shared with a snapshot is
+    // never written again.
+    std::shared_ptr<BitBoard> front;
+    std::shared_ptr<BitBoard> back;
+    std::vector<std::shared_ptr<BitBoard>> spares;
+};
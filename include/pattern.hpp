@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+
+#include "bit_board.hpp"
+#include "rule.hpp"
+
+
+
+// Reading and writing the usual pattern files. Readers stream the input in fixed size chunks and decode it straight into the words of a
+// BitBoard, the memory they need is the board itself, whatever the size of the file.
+//
+// Patterns are two state: the dying cells of Generations RLE files ("B" and above) read as dead. Malformed files throw
+// std::invalid_argument, files that cannot be opened std::runtime_error.
+namespace pattern {
+
+
+enum class Format { Rle, Life106, Plaintext, Macrocell };
+
+inline constexpr std::array formats{Format::Rle, Format::Life106, Format::Plaintext, Format::Macrocell};
+
+
+// The live cells of a pattern in a board the size of its bounding box (or of the RLE header), and the rule the file names, if any.
+struct Pattern {
+    BitBoard cells;
+    std::optional<Rule> rule;
+};
+
+
+// From the file extension: .rle, .lif / .life, .cells and .mc.
+std::optional<Format> get_format(const std::filesystem::path&);
+
+
+Pattern read(std::istream&, Format);
+void write(std::ostream&, const BitBoard&, Format, const Rule& = {});
+
+Pattern load(const std::filesystem::path&);
+void save(const std::filesystem::path&, const BitBoard&, const Rule& = {});
+
+
+// Centres the pattern on a board in the one byte per cell layout of Engine, clipping what does not fit. The rest of the board is cleared.
+void place(const BitBoard&, std::span<std::uint8_t> cells, Resolution);
+
+
+} // namespace pattern
+
+
+constexpr std::string_view get_name(pattern::Format format) {
+    switch (format) {
+        case pattern::Format::Rle: return "RLE";
+        case pattern::Format::Life106: return "Life 1.06";
+        case pattern::Format::Plaintext: return "Plaintext";
+        case pattern::Format::Macrocell: return "Macrocell";
+    }
+
+    std::unreachable();
+}
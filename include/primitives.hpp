@@ -1,7 +1,9 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <span>
+#include <utility>
 
 #include <glad/gl.h>
 
@@ -29,6 +31,17 @@ class Buffer {
         // size = data.size();
     }
 
+    template<typename T>
+    void get_data(std::span<T> data) const {
+        glGetNamedBufferSubData(id, 0, data.size_bytes(), data.data());
+    }
+
+    void bind_to_storage(unsigned int binding) const { glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, id); }
+
+    // Immutable storage the GPU writes and the CPU reads through a mapping that stays valid for the buffer's lifetime. The mapping is
+    // coherent: once a Fence placed after a write has signalled, the data is visible.
+    std::span<const std::byte> allocate_mapped(std::size_t size);
+
 
   private:
     unsigned int id = 0;
@@ -37,6 +50,35 @@ class Buffer {
 
 
 
+// A GLsync, for finding out without blocking whether the GPU is done with the commands issued before it.
+class Fence {
+  public:
+    Fence() = default;
+    ~Fence();
+
+    Fence(const Fence&) = delete;
+    Fence& operator=(const Fence&) = delete;
+
+    Fence(Fence&& other) noexcept: sync{std::exchange(other.sync, nullptr)} {}
+    Fence& operator=(Fence&& other) noexcept;
+
+
+    // Fences the commands issued so far, replacing any previous fence.
+    void insert();
+    void reset();
+
+    bool is_set() const { return sync != nullptr; }
+
+    // Never waits, but flushes the commands so the fence is eventually reached.
+    bool is_signaled() const;
+
+
+  private:
+    GLsync sync = nullptr;
+};
+
+
+
 class VAO {
 
   public:
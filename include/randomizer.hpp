@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "bit_board.hpp"
+#include "bit_kernel.hpp"
+
+
+
+// Seeded random boards that come out the same on every backend. Cells are drawn from Philox4x32-10, a counter-based generator: the
+// block at counter (x / 4, y) keyed by the seed gives the draws of cells x to x + 3 of row y, so any part of a board can be drawn on its
+// own, in any order, on any thread or on the GPU (shaders/random.comp.glsl). A cell is alive when its draw, cut to threshold_bits bits,
+// is below the density scaled as much.
+namespace randomizer {
+
+
+// As many as a float density has.
+inline constexpr unsigned int threshold_bits = 24;
+
+
+// Throws std::invalid_argument unless 0 <= density <= 1.
+std::uint32_t get_threshold(float density);
+
+
+constexpr std::array<std::uint32_t, 4> philox(std::array<std::uint32_t, 4> counter, std::uint64_t key) {
+    constexpr std::uint64_t m0 = 0xd2511f53;
+    constexpr std::uint64_t m1 = 0xcd9e8d57;
+
+    auto k0 = static_cast<std::uint32_t>(key);
+    auto k1 = static_cast<std::uint32_t>(key >> 32);
+
+    for (int round = 0; round < 10; ++round) {
+        const std::uint64_t p0 = m0 * counter[0];
+        const std::uint64_t p1 = m1 * counter[2];
+
+        counter = {static_cast<std::uint32_t>(p1 >> 32) ^ counter[1] ^ k0, static_cast<std::uint32_t>(p1),
+              static_cast<std::uint32_t>(p0 >> 32) ^ counter[3] ^ k1, static_cast<std::uint32_t>(p0)};
+
+        k0 += 0x9e3779b9;
+        k1 += 0xbb67ae85;
+    }
+
+    return counter;
+}
+
+constexpr bool is_alive(std::uint64_t seed, std::uint32_t threshold, unsigned int x, unsigned int y) {
+    const auto draws = philox({x / 4, y, 0, 0}, seed);
+    return draws[x % 4] >> (32 - threshold_bits) < threshold;
+}
+
+
+// Fills the board in bands of rows across `threads` workers (0 uses every hardware thread), clearing its ghost cells.
+void fill(BitBoard&, std::uint64_t seed, float density, unsigned int threads = 0, bit_kernel::Isa = bit_kernel::detect());
+
+// Fills the board with rows [first_row, first_row + height) of a taller board drawn from the seed, for boards drawn a band at a time.
+void fill_band(BitBoard&, std::uint32_t first_row, std::uint64_t seed, float density, unsigned int threads = 0,
+      bit_kernel::Isa = bit_kernel::detect());
+
+
+} // namespace randomizer
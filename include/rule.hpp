@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+
+
+// Outer totalistic rule on the Moore neighbourhood. Bit n of `birth` (`survival`) is set when a dead (live) cell with n live neighbours
+// is alive in the next generation. Defaults to Conway's B3/S23.
+//
+// Generations rules have more than 2 states: a live cell that does not survive decays through states - 2 dying states, which are not
+// live neighbours and cannot be born into, before it is dead. Cells hold their state, 0 dead and 1 alive.
+//
+// Larger than Life rules have a range above 1: the neighbours are the (2 range + 1)^2 box around the cell, itself included when
+// `include_centre`, and the counts are intervals instead of the masks, which are 0.
+//
+// Also a structural type, kernels take it as a template argument to specialise on the rule.
+struct Rule {
+    struct Interval {
+        std::uint32_t min = 0;
+        std::uint32_t max = 0;
+
+        constexpr bool contains(std::uint32_t count) const { return count >= min && count <= max; }
+
+        bool operator==(const Interval&) const = default;
+    };
+
+
+    std::uint16_t birth = 1 << 3;
+    std::uint16_t survival = 1 << 2 | 1 << 3;
+
+    std::uint16_t states = 2;
+
+    std::uint16_t range = 1;
+    bool include_centre = false;
+
+    Interval birth_counts{};
+    Interval survival_counts{};
+
+
+    // B/S notation ("B36/S23", either order, any case) or the older S/B one ("23/36"), both with an optional "/C<states>" or "/<states>"
+    // for Generations, or Golly's Larger than Life notation ("R5,C0,M1,S34..58,B34..45,NM", Moore neighbourhoods only). Throws
+    // std::invalid_argument.
+    static Rule parse(std::string_view);
+
+    // Throws std::invalid_argument, with the message parse() would give, unless the rule is within the limits parse() keeps to: 2 to 256
+    // states, ranges 1 to 500, counts 0 to 8 in the masks and intervals that do not end below their start. For rules read back from
+    // elsewhere (checkpoints).
+    void validate() const;
+
+    // The notation parse() reads, B/S for range 1.
+    std::string to_string() const;
+
+
+    // Two state range 1 rules, the only ones the bit-packed and unbounded engines run.
+    constexpr bool is_life_like() const { return states == 2 && range == 1; }
+
+    constexpr bool is_born(std::uint32_t count) const { return range == 1 ? (birth >> count & 1) != 0 : birth_counts.contains(count); }
+    constexpr bool survives(std::uint32_t count) const {
+        return range == 1 ? (survival >> count & 1) != 0 : survival_counts.contains(count);
+    }
+
+    // `count` is the number of live cells in the neighbourhood, as defined above. Mirrored by updateCell() in shaders/shader.comp.glsl.
+    constexpr std::uint8_t next_state(std::uint8_t state, std::uint32_t count) const {
+        if (state == 0) {
+            return is_born(count) ? 1 : 0;
+        }
+
+        if (state == 1) {
+            return survives(count) ? 1 : states > 2 ? 2 : 0;
+        }
+
+        return state + 1 < states ? static_cast<std::uint8_t>(state + 1) : 0;
+    }
+
+
+    bool operator==(const Rule&) const = default;
+};
+
+
+struct NamedRule {
+    std::string_view name;
+    Rule rule;
+};
+
+// Well known rules, the CPU kernels are compiled for each of the Life-like ones.
+inline constexpr std::array named_rules{
+      NamedRule{"Life", {1 << 3, 1 << 2 | 1 << 3}},
+      NamedRule{"HighLife", {1 << 3 | 1 << 6, 1 << 2 | 1 << 3}},
+      NamedRule{"Seeds", {1 << 2, 0}},
+      NamedRule{"Day & Night", {1 << 3 | 1 << 6 | 1 << 7 | 1 << 8, 1 << 3 | 1 << 4 | 1 << 6 | 1 << 7 | 1 << 8}},
+      NamedRule{"Life without death", {1 << 3, 0x1ff}},
+      NamedRule{"Maze", {1 << 3, 1 << 1 | 1 << 2 | 1 << 3 | 1 << 4 | 1 << 5}},
+      NamedRule{"2x2", {1 << 3 | 1 << 6, 1 << 1 | 1 << 2 | 1 << 5}},
+      NamedRule{"Replicator", {1 << 1 | 1 << 3 | 1 << 5 | 1 << 7, 1 << 1 | 1 << 3 | 1 << 5 | 1 << 7}},
+      NamedRule{"Morley", {1 << 3 | 1 << 6 | 1 << 8, 1 << 2 | 1 << 4 | 1 << 5}},
+      NamedRule{"Diamoeba", {1 << 3 | 1 << 5 | 1 << 6 | 1 << 7 | 1 << 8, 1 << 5 | 1 << 6 | 1 << 7 | 1 << 8}},
+      NamedRule{"Anneal", {1 << 4 | 1 << 6 | 1 << 7 | 1 << 8, 1 << 3 | 1 << 5 | 1 << 6 | 1 << 7 | 1 << 8}},
+      NamedRule{"Brian's Brain", {.birth = 1 << 2, .survival = 0, .states = 3}},
+      NamedRule{"Star Wars", {.birth = 1 << 2, .survival = 1 << 3 | 1 << 4 | 1 << 5, .states = 4}},
+      NamedRule{"Bosco",
+            {.birth = 0, .survival = 0, .range = 5, .include_centre = true, .birth_counts = {34, 45}, .survival_counts = {34, 58}}},
+      NamedRule{"Majority",
+            {.birth = 0, .survival = 0, .range = 4, .include_centre = true, .birth_counts = {41, 81}, .survival_counts = {41, 81}}},
+};
+
+
+namespace rules {
+
+inline constexpr Rule life = named_rules[0].rule;
+
+} // namespace rules
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+#include "simulation.hpp"
+
+
+
+// Decides how many generations to step each frame, independently of the frame rate.
+//
+// FixedRate accumulates the time frames take and steps one generation per period of it, carrying the remainder over to the next frame
+// so the rate holds on average whatever the frame rate. MaxThroughput steps as many generations as fit in the budget every frame.
+//
+// Either way a frame never steps more than the generations the budget allows, estimated from how long the previous batches took. When a
+// fixed rate needs more, the backlog is dropped and the scheduler reports falling behind rather than spending ever longer frames catching
+// up. Batches are stepped with a single Simulation::step() and waited for, so what is drawn after update() is the latest generation.
+class Scheduler {
+  public:
+    enum class Mode { FixedRate, MaxThroughput };
+
+    static constexpr std::array modes{Mode::FixedRate, Mode::MaxThroughput};
+
+    using clock_t = std::chrono::steady_clock;
+
+    static constexpr double max_rate = 1e9;
+    static constexpr std::uint64_t max_batch = std::uint64_t{1} << 40;
+
+
+    explicit Scheduler(Mode = Mode::FixedRate, double rate = 60, clock_t::duration budget = std::chrono::milliseconds{12});
+
+
+    // Steps the generations due after `elapsed`, the time since the previous call, and returns how many it stepped.
+    std::uint64_t update(Simulation&, clock_t::duration elapsed);
+
+    // Forgets the time accumulated so far, e.g. after a pause or when the board is replaced.
+    void reset();
+
+
+    void set_mode(Mode);
+    void set_rate(double generations_per_second);
+    void set_budget(clock_t::duration);
+
+    Mode get_mode() const { return mode; }
+    double get_rate() const { return rate; }
+    clock_t::duration get_budget() const { return budget; }
+
+    // Generations a frame may step at most, as last estimated.
+    std::uint64_t get_batch_limit() const { return batch_limit; }
+
+    // Generations stepped per second, measured over the last half second or so.
+    double get_measured_rate() const { return measured_rate; }
+
+    // Whether the last frame dropped generations a fixed rate asked for.
+    bool is_behind() const { return behind; }
+
+
+  private:
+    void record_batch(std::uint64_t generations, std::chrono::duration<double> took);
+
+
+    Mode mode;
+    double rate;
+    clock_t::duration budget;
+
+    // Simulated time not stepped yet.
+    std::chrono::duration<double> accumulated{0};
+
+    std::uint64_t batch_limit = 1;
+    bool behind = false;
+
+    std::chrono::duration<double> window{0};
+    std::uint64_t window_generations = 0;
+    double measured_rate = 0;
+};
+
+
+constexpr std::string_view get_name(Scheduler::Mode mode) {
+    switch (mode) {
+        case Scheduler::Mode::FixedRate: return "Fixed rate";
+        case Scheduler::Mode::MaxThroughput: return "Max throughput";
+    }
+
+    std::unreachable();
+}
@@ -1,18 +1,34 @@
 #pragma once
 
 #include <filesystem>
+#include <string>
 #include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
 
 #include <glm/glm.hpp>
 
 
 namespace glu {
 
+// A separable program of a single stage, compiled from a GLSL file. Sources that cannot be read or do not compile throw
+// std::runtime_error, with the compiler's log in the message.
+//
+// Programs are cached on disk as binaries once a cache directory is set, keyed on the source with its preamble and on the driver
+// (vendor, renderer and version), and loaded from there rather than compiled when they can be. The cache is best effort: files it
+// cannot read, write or that the driver rejects are compiled again.
+//
+// reload_changed() compiles the shaders whose file changed again, in place: the program keeps its name, so pipelines it is attached
+// to run the new code, and the uniforms set on it are set again. Like every GL call, shaders are only used from the context's thread.
 class Shader {
   public:
     enum class Type { Vertex, Fragment, Geometry, Compute };
 
     Shader(Type, const std::filesystem::path&);
+
+    // Lines inserted right after the #version line, e.g. #defines specialising the source.
+    Shader(Type, const std::filesystem::path&, std::string_view preamble);
     ~Shader();
 
     Shader(const Shader&) = delete;
@@ -26,6 +42,19 @@ class Shader {
 
     Type get_type() const { return type; }
 
+    const std::filesystem::path& get_path() const { return path; }
+
+
+    // Compiles the source again, even unchanged. A source that does not compile throws and leaves the program as it was.
+    void reload();
+
+    // Reloads every shader whose file was modified since it was last read, and returns the errors of those that failed. Each change
+    // is tried once.
+    static std::vector<std::string> reload_changed();
+
+    // Where program binaries are cached, created if need be. Empty, the default, turns the cache off.
+    static void set_cache_directory(std::filesystem::path);
+
 
     void set_uniform(std::string_view name, bool) const;
     void set_uniform(std::string_view name, int) const;
@@ -37,8 +66,25 @@ class Shader {
 
 
   private:
+    using Value = std::variant<bool, int, unsigned int, float, glm::vec2, glm::vec3, glm::mat4>;
+
+
+    // Reads the file and builds it into the program, from the cache if there.
+    void load();
+
+    void set(std::string_view name, const Value&) const;
+    void apply(const std::string& name, const Value&) const;
+
+
     Type type;
     unsigned int id = 0;
+
+    std::filesystem::path path;
+    std::string preamble;
+    std::filesystem::file_time_type modified{};
+
+    // The last value of every uniform set, set again after a reload.
+    mutable std::vector<std::pair<std::string, Value>> uniforms;
 };
 
 
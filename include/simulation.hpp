@@ -1,19 +1,118 @@
 #pragma once
 
-#include "glu.hpp"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
 
+#include "bit_board.hpp"
+#include "engine.hpp"
+#include "rule.hpp"
+#include "topology.hpp"
 
-using namespace glu;
 
 
 class Simulation {
   public:
+    enum class Backend { Cpu, Packed, Tiled, Distributed, HashLife, Sparse, Gl };
+
+    static constexpr std::array backends{
+          Backend::Cpu, Backend::Packed, Backend::Tiled, Backend::Distributed, Backend::HashLife, Backend::Sparse, Backend::Gl};
+
     struct Parameters {
-        int iterations_per_second = 1;
         float randomize_density = 0.5;
+
+        Backend backend = Backend::Cpu;
+        Topology topology = Topology::DeadBorder;
+        Rule rule = rules::life;
+
+        // Worker threads of the multithreaded backends, or processes of the multiprocess one, 0 uses every hardware thread.
+        unsigned int threads = 0;
     };
 
+    using EngineFactory = std::function<std::unique_ptr<Engine>(Resolution, const Parameters&)>;
+
+
+    Simulation(Resolution, Parameters);
+
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+
+    // The CPU backend is always available, others (e.g. Gl, which needs a context) are registered by whoever can create them.
+    static void register_backend(Backend, EngineFactory);
+    static bool has_backend(Backend);
+
+    // Replace the engine, carrying the current board over. Throw std::invalid_argument, leaving the simulation as it was, if the backend
+    // cannot run with these parameters.
+    void set_backend(Backend);
+    void set_threads(unsigned int);
+    void set_topology(Topology);
+    void set_rule(const Rule&);
+
+
+    // Changes the size of the board, keeping the cells that fit with the old and new boards centred on each other. Throws
+    // std::invalid_argument, leaving the simulation as it was, if the backend cannot run a board that size.
+    void resize(Resolution);
+
+    // Replace the board with the rule and topology it runs under and its generation at once, e.g. from a checkpoint. The states of the
+    // cells, when given, replace the board, which counts the dying cells of Generations rules as alive. Throws like set_rule(), or if
+    // the board or the states do not match the resolution.
+    void set_state(std::shared_ptr<BitBoard>, const Rule&, Topology, std::uint64_t generation, std::span<const std::uint8_t> states = {});
+
+
+    void step(std::uint64_t generations = 1);
+    void finish() const { engine->finish(); }
+
+    void get_cells(std::span<std::uint8_t>) const;
+    void set_cells(std::span<const std::uint8_t>);
+
+    // See Engine::randomize(), the generation carries on like with set_cells().
+    void randomize(std::uint64_t seed, float density) { engine->randomize(seed, density); }
+
+    std::vector<Engine::Band> get_bands() const { return engine->get_bands(); }
+
+
+    std::uint64_t get_population() const { return engine->get_population(); }
+    std::optional<BoundingBox> get_bounding_box() const { return engine->get_bounding_box(); }
+    Engine::Statistics get_statistics() const { return engine->get_statistics(); }
+    std::uint64_t get_hash() const { return engine->get_hash(); }
+
+    Resolution get_resolution() const { return res; }
+    std::uint64_t get_generation() const { return generation; }
+
+    const Engine& get_engine() const { return *engine; }
+
+
     Parameters params;
 
   private:
-};
\ No newline at end of file
+    // Carries the current board over unless given one, or the states of its cells.
+    void replace_engine(const Parameters&, std::shared_ptr<BitBoard> board = nullptr, std::span<const std::uint8_t> cells = {});
+
+
+    Resolution res;
+
+    std::unique_ptr<Engine> engine;
+    std::uint64_t generation = 0;
+};
+
+
+constexpr std::string_view get_name(Simulation::Backend backend) {
+    switch (backend) {
+        case Simulation::Backend::Cpu: return "CPU";
+        case Simulation::Backend::Packed: return "CPU (bit-packed)";
+        case Simulation::Backend::Tiled: return "CPU (multithreaded)";
+        case Simulation::Backend::Distributed: return "CPU (multiprocess)";
+        case Simulation::Backend::HashLife: return "HashLife";
+        case Simulation::Backend::Sparse: return "Sparse tiles";
+        case Simulation::Backend::Gl: return "OpenGL";
+    }
+
+    std::unreachable();
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "bit_kernel.hpp"
+#include "rule.hpp"
+
+
+
+// Census of a rule: runs many small random soups until they settle and counts the objects they leave behind.
+//
+// Soups are soup_size square and 50% dense, the same for a seed and index everywhere, centred on a board_size square board with a dead
+// border. Boards run in batches that step many of them at once: LaneBatch keeps each in its own lane of the kernel's vectors,
+// GlSoupBatch in its own layer of an array image. Every settle_period generations the boards are read back. Spaceships that reached the
+// margin are counted and removed before they hit the border. Boards equal to the board settle_period generations before have settled:
+// their objects are told apart, named by apgcode (xs4_33 is a block, xp2_7 a blinker, xq4_153 a glider) and the next soup takes the
+// board over.
+namespace soup {
+
+
+inline constexpr unsigned int board_size = 64;
+inline constexpr unsigned int soup_size = 16;
+inline constexpr unsigned int margin = 16;
+
+// A multiple of the periods that count as settled: 1, 2, 3, 4, 5, 6, 10, 12, 15, 20 and 30.
+inline constexpr std::uint64_t settle_period = 60;
+
+
+// Row y is word y, bit x is column x.
+using Board = std::array<std::uint64_t, board_size>;
+
+
+// The soup is drawn from a splitmix64 stream keyed by the seed and index.
+Board make_soup(std::uint64_t seed, std::uint64_t index);
+
+// Apgcode of a single object, if it repeats within settle_period generations.
+std::optional<std::string> identify(const Board&, const Rule&);
+
+// Apgcodes of the objects on a settled board. What does not repeat on its own even with its neighbours is "zz_BORDER" if it touches the
+// border, which may have cut it short, "zz_UNKNOWN" otherwise.
+std::vector<std::string> classify(const Board&, const Rule&);
+
+
+// Boards stepped together.
+class Batch {
+  public:
+    // Throws std::invalid_argument unless the rule is Life-like without B0, which would not leave a dead border dead.
+    explicit Batch(const Rule&);
+    virtual ~Batch() = default;
+
+    Batch(const Batch&) = delete;
+    Batch& operator=(const Batch&) = delete;
+
+
+    virtual std::size_t get_size() const = 0;
+
+    virtual void set_board(std::size_t index, const Board&) = 0;
+    virtual void get_boards(std::span<Board>) const = 0;
+
+    virtual void step(std::uint64_t generations) = 0;
+
+
+    const Rule& get_rule() const { return rule; }
+
+
+  protected:
+    Rule rule;
+};
+
+
+// Boards in the lanes of bit_kernel::LaneKernel, 64 of them fill eight AVX-512 vectors a row.
+class LaneBatch final : public Batch {
+  public:
+    static constexpr std::size_t default_lanes = 64;
+
+
+    explicit LaneBatch(const Rule&, std::size_t lanes = default_lanes, bit_kernel::Isa = bit_kernel::detect());
+
+
+    std::size_t get_size() const override { return lanes; }
+
+    void set_board(std::size_t index, const Board&) override;
+    void get_boards(std::span<Board>) const override;
+
+    void step(std::uint64_t generations) override;
+
+
+  private:
+    std::size_t lanes;
+    bit_kernel::LaneKernel kernel;
+
+    // board_size rows and a ghost row above and below, of `lanes` words each.
+    std::vector<std::uint64_t> front;
+    std::vector<std::uint64_t> back;
+};
+
+
+struct Census {
+    std::uint64_t soups = 0;
+
+    // Soups that had not settled after max_generations, their objects are not counted.
+    std::uint64_t unsettled = 0;
+
+    std::uint64_t generations = 0;
+
+    std::map<std::string, std::uint64_t> objects;
+
+
+    void merge(const Census&);
+};
+
+
+struct Options {
+    std::uint64_t seed = 0;
+
+    // Soups [first, first + count) of the seed.
+    std::uint64_t first = 0;
+    std::uint64_t count = 1000;
+
+    std::uint64_t max_generations = 6000;
+
+    // Worker threads for search() on the CPU, 0 uses every hardware thread.
+    unsigned int threads = 0;
+};
+
+
+Census search(Batch&, const Options&);
+
+// On a LaneBatch per worker thread.
+Census search(const Rule&, const Options&);
+
+
+} // namespace soup
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "engine.hpp"
+#include "rule.hpp"
+
+
+
+// Unbounded plane stored as a hash map of 64x64 tiles. A tile is only recomputed when it or one of its eight neighbours changed in the
+// previous generation, and tiles that are empty and stable go back to a pool. Like HashLife, the board is just the window the pattern
+// is placed in and read from. Runs Life-like rules without B0, which would fill the whole plane.
+//
+// Tiles keep their hash until they change, so get_hash() only rehashes the tiles that changed since it was last called.
+class SparseEngine final : public Engine {
+  public:
+    static constexpr int tile_size = 64;
+
+
+    explicit SparseEngine(Resolution, const Rule& = {});
+
+
+    void step(std::uint64_t generations) override;
+
+    void get_cells(std::span<std::uint8_t>) const override;
+    void set_cells(std::span<const std::uint8_t>) override;
+
+
+    std::uint64_t get_population() const override;
+    std::optional<BoundingBox> get_bounding_box() const override;
+
+    std::uint64_t get_hash() const override;
+
+    // Tiles allocated, pooled ones included, and the map and lists that index them.
+    std::uint64_t get_memory_bytes() const override;
+
+
+    std::size_t get_tile_count() const { return tiles.size(); }
+    std::size_t get_active_tile_count() const { return active.size(); }
+
+
+  private:
+    struct Tile {
+        std::int32_t x;
+        std::int32_t y;
+
+        // One word per row, bit x is column x.
+        std::array<std::uint64_t, tile_size> cells;
+        std::array<std::uint64_t, tile_size> next;
+
+        std::uint64_t population;
+
+        // Of cells, valid while hashed is set.
+        std::uint64_t hash;
+
+        bool active;
+        bool hashed;
+    };
+
+
+    static std::uint64_t key(std::int32_t x, std::int32_t y);
+
+    Tile* find(std::int32_t x, std::int32_t y) const;
+    Tile* create(std::int32_t x, std::int32_t y);
+    void release(Tile*);
+
+    void step_once();
+    void activate(Tile*);
+    void compute(Tile&) const;
+
+
+    Rule rule;
+
+    std::unordered_map<std::uint64_t, Tile*> tiles;
+
+    std::vector<std::unique_ptr<Tile>> storage;
+    std::vector<Tile*> pool;
+
+    // Tiles that changed in the last generation, or were set since.
+    std::vector<Tile*> changed;
+    std::vector<Tile*> active;
+};
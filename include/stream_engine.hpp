@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+
+#include "bit_board.hpp"
+#include "bit_kernel.hpp"
+#include "engine.hpp"
+#include "rule.hpp"
+#include "thread_pool.hpp"
+
+
+
+// Boards larger than memory, stepped out of core: the board stays in a file and is streamed through memory a stripe of rows at a time.
+//
+// The file is a header, then from data_offset on the rows of the board top to bottom, ceil(width / 64) words each, 64 cells per word least
+// significant bit first (the layout of checkpoint tiles), little endian. A pass reads the stripes in order on an I/O thread, prefetch
+// stripes ahead of the one being stepped, and pushes every row through `depth` generations in a sliding window: generation g of a row is
+// computed as soon as generation g - 1 of the row below it is, so each generation trails the one before by a row and the window only
+// holds a stripe and two carried rows per generation. Rows are written back in place once their last generation is done, `depth` rows
+// behind the last row read, so a pass steps `depth` generations for a single read and write of the file (temporal blocking) and nothing
+// is computed twice. Memory is about 2 * (stripe_rows + depth) rows for the window and 2 * prefetch * stripe_rows for the I/O buffers.
+//
+// The border is dead, and only Life-like rules run (with the kernels of bit_kernel), B3/S23 by default as in shader.comp.glsl. Files that
+// cannot be opened, read or written throw std::runtime_error, malformed ones std::invalid_argument. A pass that fails leaves the board
+// partly stepped.
+class StreamEngine {
+  public:
+    // Rows start on a page boundary.
+    static constexpr std::uint64_t data_offset = 4096;
+
+
+    struct Options {
+        Rule rule;
+
+        // Rows read or written at once.
+        std::uint32_t stripe_rows = 256;
+
+        // Generations stepped per pass over the file.
+        std::uint32_t depth = 16;
+
+        // Stripes read ahead of the one being stepped, as many are written behind it.
+        std::uint32_t prefetch = 2;
+
+        // 0 uses every hardware thread.
+        unsigned int threads = 0;
+
+        bit_kernel::Isa isa = bit_kernel::detect();
+    };
+
+    // Since the engine was opened. Busy time is spent in reads and writes on the I/O thread, waiting time stepping waited for them, and
+    // seconds is the wall time of the passes: bytes over seconds is the bandwidth achieved, over busy seconds what the disk gave.
+    struct IoStatistics {
+        std::uint64_t bytes_read = 0;
+        std::uint64_t bytes_written = 0;
+
+        double busy_seconds = 0;
+        double waiting_seconds = 0;
+        double seconds = 0;
+    };
+
+
+    // Writes a new board file, random (see randomizer.hpp, the same board as any engine draws for the seed) or a copy of the board.
+    static void create(const std::filesystem::path&, Resolution, std::uint64_t seed, float density, unsigned int threads = 0);
+    static void create(const std::filesystem::path&, const BitBoard&);
+
+
+    StreamEngine(const std::filesystem::path&, Options);
+    explicit StreamEngine(const std::filesystem::path& path): StreamEngine{path, Options{}} {}
+    ~StreamEngine();
+
+    StreamEngine(const StreamEngine&) = delete;
+    StreamEngine& operator=(const StreamEngine&) = delete;
+
+
+    // In passes of `depth` generations, the last one shorter.
+    void step(std::uint64_t generations);
+
+    // Reads rows [first_row, first_row + height) of the board into one as wide.
+    void read_band(std::uint32_t first_row, BitBoard&) const;
+
+
+    Resolution get_resolution() const { return res; }
+    std::uint64_t get_generation() const { return generation; }
+
+    // Counted as the board is written.
+    std::uint64_t get_population() const { return population; }
+
+    IoStatistics get_io_statistics() const;
+
+
+  private:
+    class Io;
+
+
+    // Writes the file a stripe at a time, `draw` fills the band of rows starting at its first argument.
+    static void write_board(const std::filesystem::path&, Resolution, const std::function<void(std::uint32_t, BitBoard&)>& draw);
+
+    void pass(std::uint32_t generations);
+
+
+    Options options;
+    bit_kernel::Kernel kernel;
+    ThreadPool pool;
+
+    int fd = -1;
+
+    Resolution res{};
+    std::uint64_t generation = 0;
+    std::uint64_t population = 0;
+
+    double seconds = 0;
+    double waiting_seconds = 0;
+
+    std::unique_ptr<Io> io;
+};
@@ -1,12 +1,18 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <optional>
 #include <span>
 #include <utility>
+#include <vector>
 
 
 #include <glad/gl.h>
 #include <glm/glm.hpp>
 
+#include "primitives.hpp"
+
 
 namespace glu {
 
@@ -19,50 +25,185 @@ class Texture {
         unsigned int y;
     };
 
-    enum class InternalFormat { RGBA32f, R8ui };
-    enum class AccessType { Read, Write };
+    // R8 is normalised, read as a float in [0, 1].
+    enum class InternalFormat { RGBA32f, R8, R8ui, R32ui };
+    enum class AccessType { Read, Write, ReadWrite };
 
 
 
-    Texture(Resolution, InternalFormat);
+    // Immutable storage: a board of another size gets a new texture. Each of `levels` mip levels is half the size of the one below
+    // (rounded down), and filtered between levels when there are several.
+    Texture(Resolution, InternalFormat, unsigned int levels = 1);
 
     ~Texture();
 
     Texture(const Texture&) = delete;
     Texture& operator=(const Texture&) = delete;
 
-    Texture(Texture&& other) noexcept: id{std::exchange(other.id, 0)}, internal_format{other.internal_format} {}
+    Texture(Texture&& other) noexcept:
+          id{std::exchange(other.id, 0)}, res{other.res}, levels{other.levels}, internal_format{other.internal_format} {}
 
+    // The texture replaced is deleted with `other`.
     Texture& operator=(Texture&& other) noexcept {
-        id = std::exchange(other.id, 0);
-        internal_format = other.internal_format;
+        std::swap(id, other.id);
+        std::swap(res, other.res);
+        std::swap(levels, other.levels);
+        std::swap(internal_format, other.internal_format);
 
         return *this;
     }
 
 
     unsigned int get_id() const { return id; }
+    Resolution get_resolution() const { return res; }
+    unsigned int get_levels() const { return levels; }
 
 
-    void bind_to_image_unit(unsigned int unit, AccessType) const;
+    void bind_to_image_unit(unsigned int unit, AccessType, unsigned int level = 0) const;
     void bind_to_texture_unit(unsigned int unit) const;
 
 
     template<typename T>
-    void set_image(std::span<const T> data, Resolution res, InternalFormat format);
+    void get_image(std::span<T> data) const;
+
+    // Tightly packed rows of size.x texels.
+    template<typename T>
+    void set_sub_image(std::span<const T> data, int x, int y, Resolution size);
+
+    template<typename T>
+    void get_sub_image(std::span<T> data, int x, int y, Resolution size) const;
+
+    // Starts copying a region into the buffer at `offset`, tightly packed like get_sub_image(), and returns without waiting for it.
+    void copy_to_buffer(const Buffer&, std::size_t offset, int x, int y, Resolution size) const;
+
+    void clear();
+
+    // Sets every texel of every level to `value`, given as the texel type of the format.
+    template<typename T>
+    void fill(T value);
+
+    InternalFormat get_internal_format() const { return internal_format; }
 
 
   private:
     unsigned int id;
 
+    Resolution res;
+    unsigned int levels;
     InternalFormat internal_format;
 };
 
+// Layers of the same size and format in immutable storage, bound as a whole as an image2DArray.
+class TextureArray {
+  public:
+    TextureArray(Texture::Resolution, unsigned int layers, Texture::InternalFormat);
+
+    ~TextureArray();
+
+    TextureArray(const TextureArray&) = delete;
+    TextureArray& operator=(const TextureArray&) = delete;
+
+    TextureArray(TextureArray&& other) noexcept:
+          id{std::exchange(other.id, 0)}, res{other.res}, layers{other.layers}, internal_format{other.internal_format} {}
+
+    TextureArray& operator=(TextureArray&& other) noexcept {
+        std::swap(id, other.id);
+        res = other.res;
+        layers = other.layers;
+        internal_format = other.internal_format;
+
+        return *this;
+    }
+
+
+    unsigned int get_id() const { return id; }
+
+    Texture::Resolution get_resolution() const { return res; }
+    unsigned int get_layers() const { return layers; }
+
+
+    void bind_to_image_unit(unsigned int unit, Texture::AccessType) const;
+
+
+    // Tightly packed rows of a whole layer.
+    template<typename T>
+    void set_layer(std::span<const T> data, unsigned int layer);
+
+    // Every layer, one after the other.
+    template<typename T>
+    void get_image(std::span<T> data) const;
+
+    void clear();
+
+
+  private:
+    unsigned int id;
+
+    Texture::Resolution res;
+    unsigned int layers;
+    Texture::InternalFormat internal_format;
+};
+
+
+// Reads a region of a texture back without stalling the pipeline: each copy goes to its own slot of a persistently mapped pixel buffer
+// with a fence behind it, and poll() hands it over once the fence has signalled, usually a few frames later. When every slot is still
+// in flight request() drops the copy rather than wait.
+class ReadbackRing {
+  public:
+    struct Frame {
+        // As given to request(), e.g. the generation.
+        std::uint64_t tag;
+
+        // Valid until the next request().
+        std::span<const std::byte> data;
+    };
+
+
+    ReadbackRing(Texture::Resolution size, Texture::InternalFormat, std::size_t slots = 3);
+
+    ReadbackRing(const ReadbackRing&) = delete;
+    ReadbackRing& operator=(const ReadbackRing&) = delete;
+
+
+    // Copies the region at (x, y) of the texture, which must have the ring's format. False if no slot was free.
+    bool request(const Texture&, int x, int y, std::uint64_t tag);
+
+    // The oldest copy that has landed, if any.
+    std::optional<Frame> poll();
+
+    std::size_t get_pending() const { return pending; }
+
+
+  private:
+    struct Slot {
+        Fence fence;
+        std::uint64_t tag = 0;
+    };
+
+
+    Texture::Resolution size;
+    Texture::InternalFormat format;
+    std::size_t slot_bytes;
+
+    Buffer buffer;
+    std::span<const std::byte> mapping;
+
+    std::vector<Slot> slots;
+
+    // The slot the next copy goes to, the oldest in flight is `pending` slots before it.
+    std::size_t next = 0;
+    std::size_t pending = 0;
+};
+
+
+
 constexpr auto get_flag(Texture::InternalFormat format) {
 
     switch (format) {
         case Texture::InternalFormat::RGBA32f: return GL_RGBA;
+        case Texture::InternalFormat::R8: return GL_RED;
         case Texture::InternalFormat::R8ui: return GL_RED_INTEGER;
+        case Texture::InternalFormat::R32ui: return GL_RED_INTEGER;
     }
 }
 
@@ -70,6 +211,7 @@ constexpr auto get_flag(Texture::AccessType type) {
     switch (type) {
         case Texture::AccessType::Read: return GL_READ_ONLY;
         case Texture::AccessType::Write: return GL_WRITE_ONLY;
+        case Texture::AccessType::ReadWrite: return GL_READ_WRITE;
     }
 }
 
@@ -77,7 +219,19 @@ constexpr auto get_internal_flag(Texture::InternalFormat format) {
 
     switch (format) {
         case Texture::InternalFormat::RGBA32f: return GL_RGBA32F;
+        case Texture::InternalFormat::R8: return GL_R8;
         case Texture::InternalFormat::R8ui: return GL_R8UI;
+        case Texture::InternalFormat::R32ui: return GL_R32UI;
+    }
+}
+
+
+constexpr std::size_t get_texel_size(Texture::InternalFormat format) {
+    switch (format) {
+        case Texture::InternalFormat::RGBA32f: return 16;
+        case Texture::InternalFormat::R8: return 1;
+        case Texture::InternalFormat::R8ui: return 1;
+        case Texture::InternalFormat::R32ui: return 4;
     }
 }
 
@@ -86,22 +240,53 @@ constexpr auto get_data_type(Texture::InternalFormat format) {
 
     switch (format) {
         case Texture::InternalFormat::RGBA32f: return GL_FLOAT;
+        case Texture::InternalFormat::R8: return GL_UNSIGNED_BYTE;
         case Texture::InternalFormat::R8ui: return GL_UNSIGNED_BYTE;
+        case Texture::InternalFormat::R32ui: return GL_UNSIGNED_INT;
     }
 }
 
 
 
 template<typename T>
-void Texture::set_image(std::span<const T> data, Resolution res, InternalFormat format) {
-    internal_format = format;
+void Texture::get_image(std::span<T> data) const {
+    glGetTextureImage(id, 0, get_flag(internal_format), get_data_type(internal_format), data.size_bytes(), data.data());
+}
+
+
+template<typename T>
+void Texture::set_sub_image(std::span<const T> data, int x, int y, Resolution size) {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTextureSubImage2D(id, 0, x, y, size.x, size.y, get_flag(internal_format), get_data_type(internal_format), data.data());
+}
+
+template<typename T>
+void Texture::get_sub_image(std::span<T> data, int x, int y, Resolution size) const {
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTextureSubImage(
+          id, 0, x, y, 0, size.x, size.y, 1, get_flag(internal_format), get_data_type(internal_format), data.size_bytes(), data.data());
+}
+
+template<typename T>
+void Texture::fill(T value) {
+    for (unsigned int level = 0; level < levels; ++level) {
+        glClearTexImage(id, static_cast<int>(level), get_flag(internal_format), get_data_type(internal_format), &value);
+    }
+}
 
-    glBindTexture(GL_TEXTURE_2D, id);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, get_internal_flag(format), res.x, res.y, 0, get_flag(format), get_data_type(format), data.data());
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+template<typename T>
+void TextureArray::set_layer(std::span<const T> data, unsigned int layer) {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTextureSubImage3D(id, 0, 0, 0, static_cast<int>(layer), res.x, res.y, 1, get_flag(internal_format), get_data_type(internal_format),
+          data.data());
 }
 
+template<typename T>
+void TextureArray::get_image(std::span<T> data) const {
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTextureImage(id, 0, get_flag(internal_format), get_data_type(internal_format), data.size_bytes(), data.data());
+}
 
 } // namespace glu
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+
+// Persistent workers for data parallel loops. Every worker (the calling thread being worker 0) starts with a contiguous share of the
+// indices, so the same worker keeps getting the same part of the data, and steals half of another worker's remaining range once it runs
+// dry.
+class ThreadPool {
+  public:
+    // 0 picks std::thread::hardware_concurrency().
+    explicit ThreadPool(unsigned int threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+
+    unsigned int get_thread_count() const { return static_cast<unsigned int>(queues.size()); }
+
+    // Calls task(i) for every i in [0, count) and returns once all of them are done. Not reentrant.
+    void parallel_for(std::size_t count, const std::function<void(std::size_t)>& task);
+
+
+  private:
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+    };
+
+
+    bool pop(std::size_t worker, std::size_t& index);
+    bool steal(std::size_t worker, std::size_t& index);
+
+    void drain(std::size_t worker);
+    void work(std::size_t worker);
+
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::jthread> threads;
+
+    const std::function<void(std::size_t)>* job = nullptr;
+    std::atomic<std::size_t> remaining = 0;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::uint64_t epoch = 0;
+    bool stopping = false;
+};
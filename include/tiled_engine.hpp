@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "bit_board.hpp"
+#include "bit_kernel.hpp"
+#include "engine.hpp"
+#include "rule.hpp"
+#include "thread_pool.hpp"
+#include "topology.hpp"
+
+
+
+// Multithreaded bit-packed stepping. The board is cut into full width strips sized to stay in cache, each owning its rows plus a ghost
+// row above and below. Every generation the strips step themselves, then copy the edge rows of their neighbours into their ghost rows.
+// Filling the halo after stepping rather than before means a strip shared with a snapshot is never written again.
+//
+// Wrapping topologies need the ghost columns filled first, from the first and last cell of rows that may belong to another strip.
+// Those cells are recorded by their owner right after stepping, so no strip ever reads a word another one is writing.
+//
+// Strips are hashed on demand: get_hash() only hashes the strips stepped or loaded since it last ran, and adds the strip hashes up.
+class TiledEngine final : public Engine {
+  public:
+    static constexpr std::size_t tile_bytes = 256 * 1024;
+
+
+    // 0 threads picks one per hardware thread.
+    explicit TiledEngine(
+          Resolution, unsigned int threads = 0, Topology = Topology::DeadBorder, const Rule& = {}, bit_kernel::Isa = bit_kernel::detect());
+
+
+    void step(std::uint64_t generations) override;
+
+    void get_cells(std::span<std::uint8_t>) const override;
+    void set_cells(std::span<const std::uint8_t>) override;
+
+    std::vector<Band> get_bands() const override;
+    void set_board(std::shared_ptr<BitBoard>) override;
+
+    std::uint64_t get_hash() const override;
+    std::uint64_t get_memory_bytes() const override;
+
+
+    std::size_t get_tile_count() const { return tiles.size(); }
+    unsigned int get_thread_count() const { return pool.get_thread_count(); }
+
+
+  private:
+    struct Tile {
+        unsigned int y;
+
+        std::shared_ptr<BitBoard> front;
+        std::shared_ptr<BitBoard> back;
+        std::vector<std::shared_ptr<BitBoard>> spares;
+
+        // Of front, see BitBoard::hash(), valid while hashed is set.
+        mutable std::uint64_t hash;
+        mutable bool hashed;
+    };
+
+
+    void step_tile(std::size_t index);
+
+    void fill_halo();
+    void fill_ghost_columns(std::size_t index);
+    void fill_ghost_rows(std::size_t index);
+
+    void record_edges(const Tile&, const BitBoard&, std::vector<std::uint8_t>& into) const;
+    std::pair<const BitBoard*, std::size_t> find_row(std::int64_t y) const;
+
+
+    Topology topology;
+    Rule rule;
+    bit_kernel::Isa isa;
+    bit_kernel::Kernel kernel;
+
+    std::vector<Tile> tiles;
+
+    // First and last cell of every row, for this generation and the next.
+    std::vector<std::uint8_t> edges;
+    std::vector<std::uint8_t> next_edges;
+
+    ThreadPool pool;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "engine.hpp"
+
+
+
+// How the edges of a bounded board are glued together.
+//
+//   DeadBorder       everything outside the board is dead
+//   Torus            left/right and top/bottom edges wrap around
+//   KleinBottle      left/right wrap, crossing the top/bottom edge mirrors x
+//   ProjectivePlane  crossing the top/bottom edge mirrors x, crossing the left/right edge mirrors y
+//
+// Engines never wrap per cell, they fill a ring of ghost cells around the board once per generation instead.
+enum class Topology { DeadBorder, Torus, KleinBottle, ProjectivePlane };
+
+inline constexpr std::array topologies{Topology::DeadBorder, Topology::Torus, Topology::KleinBottle, Topology::ProjectivePlane};
+
+
+// The board cell that the cell at (x, y), less than a board size outside of it, stands for. The vertical edge is crossed first, so
+// corners come out the same as copying whole ghost rows (ghost columns included) would. std::nullopt when the cell is dead.
+// Mirrored by wrap() in shaders/halo.comp.glsl.
+constexpr std::optional<std::pair<std::int64_t, std::int64_t>> wrap(Topology topology, Resolution res, std::int64_t x, std::int64_t y) {
+    if (topology == Topology::DeadBorder) {
+        return std::nullopt;
+    }
+
+    const std::int64_t width = res.x;
+    const std::int64_t height = res.y;
+
+    const bool mirror_x = topology == Topology::KleinBottle || topology == Topology::ProjectivePlane;
+    const bool mirror_y = topology == Topology::ProjectivePlane;
+
+    if (y < 0 || y >= height) {
+        y += y < 0 ? height : -height;
+        x = mirror_x ? width - 1 - x : x;
+    }
+
+    if (x < 0 || x >= width) {
+        x += x < 0 ? width : -width;
+        y = mirror_y ? height - 1 - y : y;
+    }
+
+    return std::pair{x, y};
+}
+
+// Whether the ghost rows are mirrored copies of the rows they stand for.
+constexpr bool mirrors_rows(Topology topology) {
+    return topology == Topology::KleinBottle || topology == Topology::ProjectivePlane;
+}
+
+
+constexpr std::string_view get_name(Topology topology) {
+    switch (topology) {
+        case Topology::DeadBorder: return "Dead border";
+        case Topology::Torus: return "Torus";
+        case Topology::KleinBottle: return "Klein bottle";
+        case Topology::ProjectivePlane: return "Projective plane";
+    }
+
+    std::unreachable();
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <vector>
+
+
+
+// Spans of time, recorded into a ring buffer of the last `capacity` events and exported as Chrome trace JSON (chrome://tracing,
+// Perfetto). Tracing is off until set_enabled(true); a Span then costs two clock reads and an uncontended lock, off a relaxed atomic
+// load.
+//
+// Each thread records on its own track, numbered in the order threads first record. GPU times come in on gpu_track, see gpu_trace.hpp.
+// Times are in nanoseconds of the steady clock since the program started. Names are not copied and must outlive the trace, e.g.
+// string literals.
+namespace trace {
+
+
+inline constexpr std::size_t capacity = std::size_t{1} << 16;
+
+inline constexpr std::uint32_t gpu_track = 0xffffffff;
+
+
+struct Event {
+    std::string_view name;
+
+    std::uint64_t begin = 0;
+    std::uint64_t duration = 0;
+
+    std::uint32_t track = 0;
+};
+
+
+void set_enabled(bool);
+bool is_enabled();
+
+std::uint64_t now();
+
+// The track of the calling thread.
+std::uint32_t get_track();
+
+// Events that do not come from a Span, e.g. measured elsewhere. Dropped while tracing is off.
+void record(const Event&);
+
+// The last `count` events recorded at most, oldest first. Events are recorded as they end, GPU ones when they are collected.
+std::vector<Event> get_events(std::size_t count = capacity);
+
+void clear();
+
+// Complete ("X") events with the tracks named, times in microseconds.
+void write_chrome_trace(const std::filesystem::path&, std::span<const Event>);
+
+
+// Records the time from construction to destruction on the thread's track.
+class Span {
+  public:
+    explicit Span(std::string_view name): name{name}, recording{is_enabled()}, begin{recording ? now() : 0} {}
+    ~Span();
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+
+  private:
+    std::string_view name;
+
+    // Whether tracing was on at construction.
+    bool recording;
+    std::uint64_t begin;
+};
+
+
+} // namespace trace
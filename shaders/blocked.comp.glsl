@@ -0,0 +1,193 @@
+#version 460 core
+
+// Life-like rules only. Each workgroup loads a 128x128 block of cells into shared memory, one bit per cell and one word per invocation,
+// and advances it several generations at once. Missing neighbours outside the block make errors creep in one cell per generation, so
+// after `generations` steps only the block minus a border that wide is stored. Neighbouring workgroups overlap by twice that border.
+layout(local_size_x = 4, local_size_y = 128) in;
+
+// The rule as masks, see include/rule.hpp. GlEngine defines these, defaults to B3/S23.
+#ifndef BIRTH_MASK
+    #define BIRTH_MASK 8u
+    #define SURVIVAL_MASK 12u
+#endif
+
+const int words = int(gl_WorkGroupSize.x);
+const int rows = int(gl_WorkGroupSize.y);
+
+// Boards carry a ghost border `border` cells wide, board cell (x, y) lives at pixel (x + border, y + border). The ghost cells are not
+// read, cells beyond the board come from wrap() instead: every topology but the projective plane stays exact over several generations
+// that way, GlEngine only ever runs one per dispatch for the projective plane.
+layout(r8ui, binding = 0) uniform readonly uimage2D values_in;
+layout(r8ui, binding = 1) uniform writeonly uimage2D values_out;
+
+// A texel per 32x32 tile of the board, set when a cell of the tile changed (see GlEngine::get_dirty_texture()).
+layout(r8ui, binding = 2) uniform writeonly uimage2D dirty;
+
+uniform int border;
+uniform int topology;
+uniform int generations;
+
+shared uint cells[2][rows][words];
+
+
+// Same as wrap() in include/topology.hpp.
+ivec2 wrap(ivec2 cell, ivec2 size) {
+    bool mirror_x = topology == 2 || topology == 3;
+    bool mirror_y = topology == 3;
+
+    if (cell.y < 0 || cell.y >= size.y) {
+        cell.y += cell.y < 0 ? size.y : -size.y;
+        cell.x = mirror_x ? size.x - 1 - cell.x : cell.x;
+    }
+
+    if (cell.x < 0 || cell.x >= size.x) {
+        cell.x += cell.x < 0 ? size.x : -size.x;
+        cell.y = mirror_y ? size.y - 1 - cell.y : cell.y;
+    }
+
+    return cell;
+}
+
+
+// Same as bit_kernel::lookup(), all ones where the count given by bits s0-s3 is set in `mask`.
+uint entry(uint mask, uint count) {
+    return (mask >> count & 1u) != 0u ? ~0u : 0u;
+}
+
+uint pick(uint select, uint one, uint zero) {
+    return zero ^ (select & (one ^ zero));
+}
+
+uint lookup(uint mask, uint s0, uint s1, uint s2, uint s3) {
+    uint low = pick(s1, pick(s0, entry(mask, 3u), entry(mask, 2u)), pick(s0, entry(mask, 1u), entry(mask, 0u)));
+    uint high = pick(s1, pick(s0, entry(mask, 7u), entry(mask, 6u)), pick(s0, entry(mask, 5u), entry(mask, 4u)));
+
+    return pick(s3, entry(mask, 8u), pick(s2, high, low));
+}
+
+
+// Same as bit_kernel::next_state() for any rule.
+uint nextState(uint a_w, uint a, uint a_e, uint b_w, uint b, uint b_e, uint c_w, uint c, uint c_e) {
+    uint a_x = a_w ^ a_e;
+    uint a_lo = a_x ^ a;
+    uint a_hi = (a_w & a_e) | (a_x & a);
+
+    uint b_lo = b_w ^ b_e;
+    uint b_hi = b_w & b_e;
+
+    uint c_x = c_w ^ c_e;
+    uint c_lo = c_x ^ c;
+    uint c_hi = (c_w & c_e) | (c_x & c);
+
+    uint lo_x = a_lo ^ b_lo;
+    uint s0 = lo_x ^ c_lo;
+    uint carry = (a_lo & b_lo) | (lo_x & c_lo);
+
+    uint hi_x = a_hi ^ b_hi;
+    uint hi_y = c_hi ^ carry;
+    uint s1 = hi_x ^ hi_y;
+
+    uint carry_x = a_hi & b_hi;
+    uint carry_y = c_hi & carry;
+    uint s2 = carry_x ^ carry_y ^ (hi_x & hi_y);
+    uint s3 = carry_x & carry_y;
+
+    uint born = lookup(BIRTH_MASK, s0, s1, s2, s3);
+    uint survives = lookup(SURVIVAL_MASK, s0, s1, s2, s3);
+
+    return born ^ (b & (survives ^ born));
+}
+
+
+uint west(uint row[3]) {
+    return (row[1] << 1) | (row[0] >> 31);
+}
+
+uint east(uint row[3]) {
+    return (row[1] >> 1) | (row[2] << 31);
+}
+
+// The word left of, at and right of `word` in a row of the block, zero outside of it.
+uint[3] neighbourhood(int side, int row, int word) {
+    if (row < 0 || row >= rows) {
+        return uint[3](0u, 0u, 0u);
+    }
+
+    uint left = word > 0 ? cells[side][row][word - 1] : 0u;
+    uint right = word + 1 < words ? cells[side][row][word + 1] : 0u;
+
+    return uint[3](left, cells[side][row][word], right);
+}
+
+
+void main() {
+    ivec2 size = imageSize(values_in) - 2 * border;
+    ivec2 tile = ivec2(32 * words, rows) - 2 * generations;
+
+    int word = int(gl_LocalInvocationID.x);
+    int row = int(gl_LocalInvocationID.y);
+
+    ivec2 first = ivec2(gl_WorkGroupID.xy) * tile - generations + ivec2(32 * word, row);
+
+    // Cells of the word, and which of them are on the board.
+    uint bits = 0u;
+    uint inside = 0u;
+
+    for (int i = 0; i < 32; ++i) {
+        ivec2 cell = first + ivec2(i, 0);
+        bool on_board = all(greaterThanEqual(cell, ivec2(0))) && all(lessThan(cell, size));
+
+        inside |= uint(on_board) << i;
+
+        if (on_board || topology != 0) {
+            cell = on_board ? cell : wrap(cell, size);
+            bits |= uint(imageLoad(values_in, cell + border).x == 1u) << i;
+        }
+    }
+
+    // With a dead border cells off the board must stay dead.
+    uint keep = topology == 0 ? inside : ~0u;
+
+    cells[0][row][word] = bits;
+
+    uint initial = bits;
+
+    for (int g = 0; g < generations; ++g) {
+        int current = g & 1;
+
+        memoryBarrierShared();
+        barrier();
+
+        uint above[3] = neighbourhood(current, row - 1, word);
+        uint middle[3] = neighbourhood(current, row, word);
+        uint below[3] = neighbourhood(current, row + 1, word);
+
+        bits = nextState(west(above), above[1], east(above), west(middle), middle[1], east(middle), west(below), below[1], east(below));
+        bits &= keep;
+
+        cells[1 - current][row][word] = bits;
+    }
+
+    if (row < generations || row >= rows - generations) {
+        return;
+    }
+
+    uint stored = 0u;
+
+    for (int i = 0; i < 32; ++i) {
+        int x = 32 * word + i;
+
+        if (x >= generations && x < 32 * words - generations && (inside >> i & 1u) != 0u) {
+            imageStore(values_out, first + ivec2(i, 0) + border, uvec4(bits >> i & 1u));
+            stored |= 1u << i;
+        }
+    }
+
+    // The 32 cells of a word span at most two tiles, those of its first and last changed cell.
+    uint changed = (bits ^ initial) & stored;
+
+    if (changed != 0u) {
+        imageStore(dirty, (first + ivec2(findLSB(changed), 0)) / 32, uvec4(1u));
+        imageStore(dirty, (first + ivec2(findMSB(changed), 0)) / 32, uvec4(1u));
+    }
+}
@@ -0,0 +1,92 @@
+#version 460 core
+
+// Five levels of the density pyramid at a time, see include/density_pyramid.hpp. Each workgroup reduces a 32x32 block of its source to
+// the 16x16, 8x8, 4x4, 2x2 and 1x1 texels above it, if the flag of the block is set: it clears the flag and sets the one of the block
+// around it in the next pass. DensityPyramid defines FROM_BOARD for the first pass.
+layout(local_size_x = 32, local_size_y = 32) in;
+
+#ifdef FROM_BOARD
+// The board with its ghost border `border` cells wide, see shader.comp.glsl. Only state 1 counts as alive.
+layout(r8ui, binding = 0) uniform readonly uimage2D board;
+
+uniform int border;
+#else
+// The last level of the pass before, zero past its edges.
+layout(r8, binding = 0) uniform readonly image2D source;
+#endif
+
+layout(r8ui, binding = 1) uniform uimage2D flags;
+layout(r8ui, binding = 2) uniform writeonly uimage2D parent_flags;
+
+// Bound to units 3 to 7, only the first `levels` of them are written. Stores past the edges of a level are dropped.
+layout(r8, binding = 3) uniform writeonly image2D targets[5];
+
+uniform int levels;
+uniform bool has_parent;
+
+// Reduces every block, flagged or not.
+uniform bool everything;
+
+shared float densities[32][32];
+shared bool flagged;
+
+
+void main() {
+    ivec2 block = ivec2(gl_WorkGroupID.xy);
+    ivec2 local = ivec2(gl_LocalInvocationID.xy);
+
+    if (gl_LocalInvocationIndex == 0u) {
+        flagged = everything || imageLoad(flags, block).x != 0u;
+    }
+
+    memoryBarrierShared();
+    barrier();
+
+    // The same for the whole workgroup.
+    if (!flagged) {
+        return;
+    }
+
+    ivec2 texel = block * 32 + local;
+
+#ifdef FROM_BOARD
+    ivec2 size = imageSize(board) - 2 * border;
+    bool alive = all(lessThan(texel, size)) && imageLoad(board, texel + border).x == 1u;
+
+    densities[local.y][local.x] = float(alive);
+#else
+    densities[local.y][local.x] = imageLoad(source, texel).x;
+#endif
+
+    for (int level = 0; level < levels; ++level) {
+        int side = 16 >> level;
+        bool reducing = all(lessThan(local, ivec2(side)));
+        float density = 0.0;
+
+        memoryBarrierShared();
+        barrier();
+
+        if (reducing) {
+            ivec2 corner = 2 * local;
+
+            density = 0.25 * (densities[corner.y][corner.x] + densities[corner.y][corner.x + 1] + densities[corner.y + 1][corner.x]
+                                    + densities[corner.y + 1][corner.x + 1]);
+        }
+
+        memoryBarrierShared();
+        barrier();
+
+        if (reducing) {
+            densities[local.y][local.x] = density;
+            imageStore(targets[level], block * side + local, vec4(density));
+        }
+    }
+
+    if (gl_LocalInvocationIndex == 0u) {
+        imageStore(flags, block, uvec4(0u));
+
+        if (has_parent) {
+            imageStore(parent_flags, block / 32, uvec4(1u));
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#version 460 core
+
+layout(local_size_x = 64) in;
+
+// The board with a ghost border `border` cells wide, board cell (x, y) lives at pixel (x + border, y + border).
+layout(r8ui, binding = 0) uniform uimage2D values;
+
+// Topology in include/topology.hpp: 0 dead border, 1 torus, 2 Klein bottle, 3 projective plane.
+uniform int topology;
+uniform int border;
+
+
+// Same as wrap() in include/topology.hpp.
+ivec2 wrap(ivec2 cell, ivec2 size) {
+    bool mirror_x = topology == 2 || topology == 3;
+    bool mirror_y = topology == 3;
+
+    if (cell.y < 0 || cell.y >= size.y) {
+        cell.y += cell.y < 0 ? size.y : -size.y;
+        cell.x = mirror_x ? size.x - 1 - cell.x : cell.x;
+    }
+
+    if (cell.x < 0 || cell.x >= size.x) {
+        cell.x += cell.x < 0 ? size.x : -size.x;
+        cell.y = mirror_y ? size.y - 1 - cell.y : cell.y;
+    }
+
+    return cell;
+}
+
+
+void main() {
+    ivec2 size = imageSize(values) - 2 * border;
+
+    // One invocation per ghost cell: the rows above and below corners included, then the columns left and right of the board.
+    int i = int(gl_GlobalInvocationID.x);
+    int row = size.x + 2 * border;
+
+    ivec2 ghost;
+
+    if (i < 2 * border * row) {
+        int band = i / row;
+        ghost = ivec2(i % row - border, band < border ? band - border : size.y + band - border);
+    } else if (i < 2 * border * (row + size.y)) {
+        i -= 2 * border * row;
+
+        int band = i / size.y;
+        ghost = ivec2(band < border ? band - border : size.x + band - border, i % size.y);
+    } else {
+        return;
+    }
+
+    uint status = topology == 0 ? 0 : imageLoad(values, wrap(ghost, size) + border).x;
+
+    imageStore(values, ghost + border, uvec4(status));
+}
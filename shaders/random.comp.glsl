@@ -0,0 +1,54 @@
+#version 460 core
+
+// Random board drawn on the GPU, the same cells as randomizer::fill() (see include/randomizer.hpp). An invocation draws one Philox4x32-10
+// block, the four cells from column 4 * x of row y.
+layout(local_size_x = 16, local_size_y = 16) in;
+
+// The board with a ghost border `border` cells wide, board cell (x, y) lives at pixel (x + border, y + border).
+layout(r8ui, binding = 0) uniform writeonly uimage2D values;
+
+uniform int border;
+uniform int width;
+uniform int height;
+
+// Words of the seed, and the density scaled to 24 bits.
+uniform uint seed_low;
+uniform uint seed_high;
+uniform uint threshold;
+
+
+uvec4 philox(uvec4 counter, uvec2 key) {
+    for (int round = 0; round < 10; ++round) {
+        uint hi0;
+        uint lo0;
+        uint hi1;
+        uint lo1;
+
+        umulExtended(0xd2511f53u, counter.x, hi0, lo0);
+        umulExtended(0xcd9e8d57u, counter.z, hi1, lo1);
+
+        counter = uvec4(hi1 ^ counter.y ^ key.x, lo1, hi0 ^ counter.w ^ key.y, lo0);
+        key += uvec2(0x9e3779b9u, 0xbb67ae85u);
+    }
+
+    return counter;
+}
+
+
+void main() {
+    uvec2 block = gl_GlobalInvocationID.xy;
+
+    if (int(block.y) >= height || int(block.x) * 4 >= width) {
+        return;
+    }
+
+    uvec4 draws = philox(uvec4(block, 0u, 0u), uvec2(seed_low, seed_high));
+
+    for (int i = 0; i < 4; ++i) {
+        ivec2 cell = ivec2(block.x * 4u + uint(i), block.y);
+
+        if (cell.x < width) {
+            imageStore(values, cell + border, uvec4(uint(draws[i] >> 8 < threshold)));
+        }
+    }
+}
@@ -0,0 +1,151 @@
+#version 460 core
+
+// A workgroup scans runs of run_size entries along `lines` neighbouring rows or columns, with `lanes` invocations per line that each
+// take per_invocation consecutive entries.
+const uint lanes = 16u;
+const uint lines = 16u;
+const uint per_invocation = 16u;
+const uint run_size = lanes * per_invocation;
+
+layout(local_size_x = 16, local_size_y = 16) in;
+
+// Summed-area table of the live cells of a padded board for Larger than Life counts: entry (x, y) is the number of live cells in
+// [0, x] x [0, y]. Built from prefix sums along the rows, then down the columns of those row sums in place, each in three dispatches:
+// workgroups scan runs of their lines in shared memory and keep the total of each run, then scan those totals, then every run after
+// the first adds the total of the runs before it.
+//
+// Invocations next to each other along x always read cells next to each other: along the rows they are the lanes of a line, down the
+// columns the lines. Each scans its per_invocation entries one after the other, only the totals of the lanes go through the barrier
+// heavy parallel scan.
+layout(r8ui, binding = 0) uniform readonly uimage2D values;
+layout(r32ui, binding = 1) uniform uimage2D table;
+
+// Totals of the runs of each line, at (run, line).
+layout(r32ui, binding = 2) uniform uimage2D totals;
+
+// 0 along the rows, 1 down the columns.
+uniform int axis;
+
+// 0 scans the runs, 1 the run totals, 2 adds them to the runs.
+uniform int pass;
+
+
+shared uint entries[lines][run_size];
+shared uint sums[lines][lanes];
+
+
+// Inclusive prefix sum over the lanes of a line, Hillis-Steele: log2(lanes) steps of adding the value `offset` lanes before.
+uint scan(uint line, uint lane, uint value) {
+    sums[line][lane] = value;
+
+    for (uint offset = 1u; offset < lanes; offset *= 2u) {
+        barrier();
+        uint before = lane >= offset ? sums[line][lane - offset] : 0u;
+
+        barrier();
+        sums[line][lane] += before;
+    }
+
+    barrier();
+    return sums[line][lane];
+}
+
+// Inclusive prefix sum of the entries of a line in place.
+void scan_entries(uint line, uint lane) {
+    uint first = lane * per_invocation;
+    uint total = 0u;
+
+    barrier();
+
+    for (uint k = 0u; k < per_invocation; ++k) {
+        total += entries[line][first + k];
+        entries[line][first + k] = total;
+    }
+
+    uint before = scan(line, lane, total) - total;
+
+    for (uint k = 0u; k < per_invocation; ++k) {
+        entries[line][first + k] += before;
+    }
+
+    barrier();
+}
+
+
+ivec2 get_entry(uint position, uint line) {
+    return axis == 0 ? ivec2(position, line) : ivec2(line, position);
+}
+
+
+void main() {
+    ivec2 size = imageSize(table);
+    uint length = uint(axis == 0 ? size.x : size.y);
+    uint line_count = uint(axis == 0 ? size.y : size.x);
+
+    uint lane = axis == 0 ? gl_LocalInvocationID.x : gl_LocalInvocationID.y;
+    uint line = axis == 0 ? gl_LocalInvocationID.y : gl_LocalInvocationID.x;
+
+    uint run = gl_WorkGroupID.x;
+    uint board_line = gl_WorkGroupID.y * lines + line;
+
+    // Invocations past the last line or entry still take part in the scans, with 0.
+    bool inside = board_line < line_count;
+
+    if (pass == 0) {
+        for (uint k = 0u; k < per_invocation; ++k) {
+            uint position = run * run_size + k * lanes + lane;
+            ivec2 entry = get_entry(position, board_line);
+
+            uint value = 0u;
+
+            if (inside && position < length) {
+                value = axis == 0 ? uint(imageLoad(values, entry).x == 1u) : imageLoad(table, entry).x;
+            }
+
+            entries[line][k * lanes + lane] = value;
+        }
+
+        scan_entries(line, lane);
+
+        for (uint k = 0u; k < per_invocation; ++k) {
+            uint position = run * run_size + k * lanes + lane;
+
+            if (inside && position < length) {
+                imageStore(table, get_entry(position, board_line), uvec4(entries[line][k * lanes + lane]));
+            }
+        }
+
+        if (inside && lane == 0u) {
+            imageStore(totals, ivec2(run, board_line), uvec4(entries[line][run_size - 1u]));
+        }
+    } else if (pass == 1) {
+        uint runs = (length + run_size - 1u) / run_size;
+
+        for (uint k = 0u; k < per_invocation; ++k) {
+            uint index = k * lanes + lane;
+            entries[line][index] = inside && index < runs ? imageLoad(totals, ivec2(index, board_line)).x : 0u;
+        }
+
+        scan_entries(line, lane);
+
+        for (uint k = 0u; k < per_invocation; ++k) {
+            uint index = k * lanes + lane;
+
+            if (inside && index < runs) {
+                imageStore(totals, ivec2(index, board_line), uvec4(entries[line][index]));
+            }
+        }
+    } else if (inside) {
+        // Dispatched for the runs after the first.
+        uint carry = imageLoad(totals, ivec2(run, board_line)).x;
+
+        for (uint k = 0u; k < per_invocation; ++k) {
+            uint position = (run + 1u) * run_size + k * lanes + lane;
+            ivec2 entry = get_entry(position, board_line);
+
+            if (position < length) {
+                imageStore(table, entry, imageLoad(table, entry) + carry);
+            }
+        }
+    }
+}
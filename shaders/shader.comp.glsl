@@ -2,32 +2,99 @@
 
 layout(local_size_x = 32, local_size_y = 32) in;
 
+// The rule, defined by GlEngine from a Rule (see include/rule.hpp). Defaults to B3/S23.
+#ifndef BORN
+    #define BORN(n) ((n) == 3u)
+    #define SURVIVES(n) ((n) >= 2u && (n) <= 3u)
+#endif
+
+#ifndef STATES
+    #define STATES 2u
+#endif
+
+// Larger than Life rules also define INCLUDE_CENTRE.
+#ifndef RANGE
+    #define RANGE 1
+#endif
+
+// Boards carry a ghost border RANGE cells wide filled by halo.comp.glsl, board cell (x, y) lives at pixel (x + RANGE, y + RANGE).
 layout(r8ui, binding = 0) uniform uimage2D values_in;
 layout(r8ui, binding = 1) uniform uimage2D values_out;
 
+// A texel per workgroup, set when a cell of the workgroup changed (see GlEngine::get_dirty_texture()).
+layout(r8ui, binding = 3) uniform writeonly uimage2D dirty;
+
+#if RANGE > 1
+// Live cells in [0, x] x [0, y] of values_in, from sat.comp.glsl.
+layout(r32ui, binding = 2) uniform readonly uimage2D table;
+
+uint tableAt(ivec2 ix) {
+    return ix.x < 0 || ix.y < 0 ? 0u : imageLoad(table, ix).x;
+}
+#endif
+
+
+uint isAlive(ivec2 ix) {
+    return uint(imageLoad(values_in, ix).x == 1u);
+}
+
+uint countNeighbours(ivec2 ix) {
+#if RANGE > 1
+    // Larger than Life: the box around the cell from four corners of the summed-area table.
+    ivec2 lo = ix - RANGE - 1;
+    ivec2 hi = ix + RANGE;
+
+    uint alive = tableAt(hi) - tableAt(ivec2(lo.x, hi.y)) - tableAt(ivec2(hi.x, lo.y)) + tableAt(lo);
+
+    return INCLUDE_CENTRE ? alive : alive - isAlive(ix);
+#else
+    uint alive = 0;
+    alive += isAlive(ix + ivec2(-1, -1));
+    alive += isAlive(ix + ivec2(-1, 0));
+    alive += isAlive(ix + ivec2(-1, 1));
+    alive += isAlive(ix + ivec2(0, -1));
+    alive += isAlive(ix + ivec2(0, 1));
+    alive += isAlive(ix + ivec2(1, -1));
+    alive += isAlive(ix + ivec2(1, 0));
+    alive += isAlive(ix + ivec2(1, 1));
+
+    return alive;
+#endif
+}
+
+
 uint updateCell(ivec2 ix) {
 
     uint status = imageLoad(values_in, ix).x;
+    uint alive = countNeighbours(ix);
 
-    uint alive = 0;
-    alive += imageLoad(values_in, ix + ivec2(-1, -1)).x;
-    alive += imageLoad(values_in, ix + ivec2(-1, 0)).x;
-    alive += imageLoad(values_in, ix + ivec2(-1, 1)).x;
-    alive += imageLoad(values_in, ix + ivec2(0, -1)).x;
-    alive += imageLoad(values_in, ix + ivec2(0, 1)).x;
-    alive += imageLoad(values_in, ix + ivec2(1, -1)).x;
-    alive += imageLoad(values_in, ix + ivec2(1, 0)).x;
-    alive += imageLoad(values_in, ix + ivec2(1, 1)).x;
+    // Live cells that do not survive start dying, dying cells decay to dead, see Rule::next_state().
+    if (status == 0u) {
+        return uint(BORN(alive));
+    }
 
+    if (status == 1u) {
+        return SURVIVES(alive) ? 1u : 2u % STATES;
+    }
 
-    return uint(status == 0 && alive == 3) + uint(status == 1 && alive > 1 && alive < 4);
+    return (status + 1u) % STATES;
 }
 
 
 void main() {
-    ivec2 gidx = ivec2(gl_GlobalInvocationID.xy);
+    // The last workgroups hang over the edges of boards that are not a multiple of 32 cells.
+    if (any(greaterThanEqual(ivec2(gl_GlobalInvocationID.xy), imageSize(values_in) - 2 * RANGE))) {
+        return;
+    }
+
+    ivec2 gidx = ivec2(gl_GlobalInvocationID.xy) + RANGE;
 
     uint status = updateCell(gidx);
 
     imageStore(values_out, gidx, uvec4(status));
+
+    // Racing invocations all store the same value.
+    if (status != imageLoad(values_in, gidx).x) {
+        imageStore(dirty, ivec2(gl_WorkGroupID.xy), uvec4(1u));
+    }
 }
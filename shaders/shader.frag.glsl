@@ -1,20 +1,47 @@
 #version 460 core
 
+// With its ghost border `border` cells wide, see shader.comp.glsl.
 layout(r8ui, binding = 0) uniform uimage2D values;
 
+// Live cells per texel, see include/density_pyramid.hpp: level m covers squares of 2^(m + 1) cells, `padded_size` cells in all.
+layout(binding = 0) uniform sampler2D density;
+
+uniform int border;
+uniform uint states;
+
 uniform int iteration;
 
-in vec2 texCoords;
+// The cell at the bottom left corner of the window, and how many cells wide a pixel is.
+uniform vec2 origin;
+uniform float cells_per_pixel;
+
+uniform vec2 padded_size;
+uniform float max_lod;
 
 out vec4 fragColor;
 
 void main() {
-    ivec2 size = imageSize(values);
-    vec2 uv = (2.0 * gl_FragCoord.xy - size) / size;
+    ivec2 size = imageSize(values) - 2 * border;
+    vec2 cell = origin + gl_FragCoord.xy * cells_per_pixel;
+
+    if (any(lessThan(cell, vec2(0))) || any(greaterThanEqual(cell, vec2(size)))) {
+        fragColor = vec4(0, 0, 0, 1);
+        return;
+    }
+
+    vec2 uv = cell / vec2(size);
+    float brightness;
 
-    ivec2 idx = ivec2(texCoords * size);
-    uint status = imageLoad(values, idx).x;
+    // Zoomed in far enough the cells themselves, further out the level of the pyramid as coarse as a pixel, so a frame reads as many
+    // texels whatever the size of the board.
+    if (cells_per_pixel < 2.0) {
+        uint status = imageLoad(values, ivec2(cell) + border).x;
 
+        // Dying cells of Generations rules fade out.
+        brightness = status <= 1u ? float(status) : 1.0 - float(status - 1u) / float(states - 1u);
+    } else {
+        brightness = textureLod(density, cell / padded_size, min(log2(cells_per_pixel) - 1.0, max_lod)).x;
+    }
 
-    fragColor = vec4(status * vec3(texCoords.x * texCoords.y, 1.0 - texCoords.xy), 1);
+    fragColor = vec4(brightness * vec3(uv.x * uv.y, 1.0 - uv), 1);
 }
@@ -0,0 +1,103 @@
+#version 460 core
+
+// Boards of a soup search (see include/soup_search.hpp), one per layer of `boards` and one workgroup each. The board is read into shared
+// memory as bits, stepped `generations` times there and written back, an invocation per row. Cells past the edges are dead.
+layout(local_size_x = 64) in;
+
+layout(r8ui, binding = 0) uniform uimage2DArray boards;
+
+// Bit n is set when n live neighbours give birth or let a cell survive, as in Rule.
+uniform uint birth_mask;
+uniform uint survival_mask;
+
+uniform int generations;
+
+
+const int size = 64;
+
+// Two buffers of the board's rows and a dead row above and below, bit x of row y is column x: low word first.
+shared uvec2 rows[2][size + 2];
+
+
+// Bit x of the result is bit x - 1 of the row, or x + 1.
+uvec2 shiftLeft(uvec2 row) {
+    return uvec2(row.x << 1, (row.y << 1) | (row.x >> 31));
+}
+
+uvec2 shiftRight(uvec2 row) {
+    return uvec2((row.x >> 1) | (row.y << 31), row.y >> 1);
+}
+
+
+// Adds a bit per cell to the counts held as four bit planes.
+void add(inout uvec2 count[4], uvec2 bits) {
+    for (int plane = 0; plane < 4; ++plane) {
+        uvec2 carry = count[plane] & bits;
+        count[plane] ^= bits;
+        bits = carry;
+    }
+}
+
+uvec2 nextRow(uvec2 above, uvec2 row, uvec2 below) {
+    uvec2 count[4] = uvec2[4](uvec2(0u), uvec2(0u), uvec2(0u), uvec2(0u));
+
+    add(count, shiftLeft(above));
+    add(count, above);
+    add(count, shiftRight(above));
+    add(count, shiftLeft(row));
+    add(count, shiftRight(row));
+    add(count, shiftLeft(below));
+    add(count, below);
+    add(count, shiftRight(below));
+
+    uvec2 next = uvec2(0u);
+
+    for (uint n = 0u; n <= 8u; ++n) {
+        uvec2 equal = uvec2(~0u);
+
+        for (int plane = 0; plane < 4; ++plane) {
+            equal &= (n >> plane & 1u) != 0u ? count[plane] : ~count[plane];
+        }
+
+        next |= (birth_mask >> n & 1u) != 0u ? equal & ~row : uvec2(0u);
+        next |= (survival_mask >> n & 1u) != 0u ? equal & row : uvec2(0u);
+    }
+
+    return next;
+}
+
+
+void main() {
+    int y = int(gl_LocalInvocationID.x);
+    int layer = int(gl_WorkGroupID.x);
+
+    uvec2 row = uvec2(0u);
+
+    for (int x = 0; x < size; ++x) {
+        uint alive = uint(imageLoad(boards, ivec3(x, y, layer)).x == 1u);
+        row[x / 32] |= alive << (x % 32);
+    }
+
+    rows[0][y + 1] = row;
+
+    if (y < 2) {
+        rows[0][y * (size + 1)] = uvec2(0u);
+        rows[1][y * (size + 1)] = uvec2(0u);
+    }
+
+    barrier();
+
+    int front = 0;
+
+    for (int generation = 0; generation < generations; ++generation) {
+        row = nextRow(rows[front][y], rows[front][y + 1], rows[front][y + 2]);
+        rows[1 - front][y + 1] = row;
+
+        front = 1 - front;
+        barrier();
+    }
+
+    for (int x = 0; x < size; ++x) {
+        imageStore(boards, ivec3(x, y, layer), uvec4(row[x / 32] >> (x % 32) & 1u));
+    }
+}
@@ -0,0 +1,141 @@
+#version 460 core
+
+#extension GL_KHR_shader_subgroup_basic : enable
+#extension GL_KHR_shader_subgroup_arithmetic : enable
+
+layout(local_size_x = 16, local_size_y = 16) in;
+
+// Cells each invocation reads, along a row.
+const int cells_per_invocation = 64;
+
+// Population, births, deaths and bounding box of the board. Subgroups reduce their invocations' partials then add them into
+// `statistics` with one atomic per value. Without subgroup operations (llvmpipe has none) workgroups reduce through shared memory
+// instead.
+layout(r8ui, binding = 0) uniform readonly uimage2D current;
+layout(r8ui, binding = 1) uniform readonly uimage2D previous;
+
+// A row of texels, set by the caller: the population, births and deaths as the low then the high half of 64-bit counts (0), x_min and
+// y_min (0xffffffff), x_end and y_end (one past the maximum, 0), then whether births and deaths are counted, which is left alone. The
+// caller reads it back, through a ring of pixel buffers when it cannot wait.
+layout(r32ui, binding = 2) uniform coherent uimage2D statistics;
+
+const int population_index = 0;
+const int births_index = 2;
+const int deaths_index = 4;
+const int x_min_index = 6;
+const int y_min_index = 7;
+const int x_end_index = 8;
+const int y_end_index = 9;
+
+uniform int border;
+
+// Whether `previous` holds the generation before `current`, births and deaths are left alone otherwise.
+uniform bool changes;
+
+
+struct Partial {
+    uint population;
+    uint births;
+    uint deaths;
+    uint x_min;
+    uint y_min;
+    uint x_end;
+    uint y_end;
+};
+
+Partial combine(Partial a, Partial b) {
+    return Partial(a.population + b.population, a.births + b.births, a.deaths + b.deaths, min(a.x_min, b.x_min), min(a.y_min, b.y_min),
+          max(a.x_end, b.x_end), max(a.y_end, b.y_end));
+}
+
+
+// Adds a workgroup's count, far below 2^32, to a 64-bit one: the high half takes the carry of the low one.
+void add(int index, uint value) {
+    if (value == 0u) {
+        return;
+    }
+
+    uint before = imageAtomicAdd(statistics, ivec2(index, 0), value);
+
+    if (before + value < before) {
+        imageAtomicAdd(statistics, ivec2(index + 1, 0), 1u);
+    }
+}
+
+
+#if defined(GL_KHR_shader_subgroup_arithmetic) && !defined(NO_SUBGROUPS)
+#define USE_SUBGROUPS
+#else
+const uint invocations = gl_WorkGroupSize.x * gl_WorkGroupSize.y;
+
+shared Partial partials[invocations];
+#endif
+
+
+void main() {
+    ivec2 size = imageSize(current) - 2 * border;
+
+    // Workgroups cover cells_per_invocation runs of gl_WorkGroupSize.x cells per row, the invocations of a row read neighbouring cells.
+    int width = int(gl_WorkGroupSize.x);
+    ivec2 first = ivec2(int(gl_WorkGroupID.x) * width * cells_per_invocation + int(gl_LocalInvocationID.x), gl_GlobalInvocationID.y);
+
+    Partial partial = Partial(0u, 0u, 0u, 0xffffffffu, 0xffffffffu, 0u, 0u);
+
+    // Out of bounds invocations still take part, barriers and subgroup operations need them.
+    if (first.y < size.y) {
+        for (int i = 0; i < cells_per_invocation && first.x + i * width < size.x; ++i) {
+            ivec2 cell = first + ivec2(i * width, 0);
+
+            uint state = imageLoad(current, cell + border).x;
+            uint before = changes ? imageLoad(previous, cell + border).x : 0u;
+
+            partial.population += uint(state == 1u);
+            partial.births += uint(state == 1u && before == 0u);
+            partial.deaths += uint(state != 1u && before == 1u);
+
+            if (state != 0u) {
+                partial.x_min = min(partial.x_min, uint(cell.x));
+                partial.x_end = uint(cell.x) + 1u;
+            }
+        }
+
+        if (partial.x_end != 0u) {
+            partial.y_min = uint(first.y);
+            partial.y_end = uint(first.y) + 1u;
+        }
+    }
+
+#ifdef USE_SUBGROUPS
+    partial = Partial(subgroupAdd(partial.population), subgroupAdd(partial.births), subgroupAdd(partial.deaths), subgroupMin(partial.x_min),
+          subgroupMin(partial.y_min), subgroupMax(partial.x_end), subgroupMax(partial.y_end));
+
+    if (subgroupElect()) {
+#else
+    uint index = gl_LocalInvocationIndex;
+    partials[index] = partial;
+
+    for (uint stride = invocations / 2u; stride > 0u; stride /= 2u) {
+        barrier();
+
+        if (index < stride) {
+            partials[index] = combine(partials[index], partials[index + stride]);
+        }
+    }
+
+    barrier();
+    partial = partials[0];
+
+    if (index == 0u) {
+#endif
+        add(population_index, partial.population);
+        add(births_index, partial.births);
+        add(deaths_index, partial.deaths);
+
+        if (partial.x_end != 0u) {
+            imageAtomicMin(statistics, ivec2(x_min_index, 0), partial.x_min);
+            imageAtomicMin(statistics, ivec2(y_min_index, 0), partial.y_min);
+            imageAtomicMax(statistics, ivec2(x_end_index, 0), partial.x_end);
+            imageAtomicMax(statistics, ivec2(y_end_index, 0), partial.y_end);
+        }
+    }
+}
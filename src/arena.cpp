@@ -0,0 +1,112 @@
+#include "arena.hpp"
+
+#include <map>
+#include <mutex>
+
+#if defined(__linux__)
+    #include <sys/mman.h>
+#endif
+
+
+
+namespace arena {
+
+
+namespace {
+
+struct Cache {
+    std::mutex mutex;
+
+    // Free blocks by size.
+    std::multimap<std::size_t, void*> blocks;
+    std::size_t bytes = 0;
+};
+
+// Never destroyed, boards with static storage may be freed after it would be.
+Cache& get_cache() {
+    static auto* cache = new Cache;
+    return *cache;
+}
+
+
+std::size_t get_alignment(std::size_t bytes) {
+    return bytes >= huge_page ? huge_page : alignment;
+}
+
+} // namespace
+
+
+
+void* allocate(std::size_t bytes) {
+    if (bytes >= min_cached) {
+        auto& cache = get_cache();
+        std::scoped_lock lock{cache.mutex};
+
+        if (const auto found = cache.blocks.find(bytes); found != cache.blocks.end()) {
+            void* block = found->second;
+
+            cache.blocks.erase(found);
+            cache.bytes -= bytes;
+
+            return block;
+        }
+    }
+
+    void* block = ::operator new(bytes, std::align_val_t{get_alignment(bytes)});
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (bytes >= huge_page) {
+        // Only advice, the kernel may not do it.
+        madvise(block, bytes / huge_page * huge_page, MADV_HUGEPAGE);
+    }
+#endif
+
+    return block;
+}
+
+void deallocate(void* block, std::size_t bytes) noexcept {
+    if (block == nullptr) {
+        return;
+    }
+
+    if (bytes >= min_cached) {
+        auto& cache = get_cache();
+        std::scoped_lock lock{cache.mutex};
+
+        try {
+            if (cache.bytes + bytes <= max_cached) {
+                cache.blocks.emplace(bytes, block);
+                cache.bytes += bytes;
+
+                return;
+            }
+        } catch (const std::bad_alloc&) {
+            // No room to remember it, it goes back to the system instead.
+        }
+    }
+
+    ::operator delete(block, std::align_val_t{get_alignment(bytes)});
+}
+
+
+void trim() {
+    auto& cache = get_cache();
+    std::scoped_lock lock{cache.mutex};
+
+    for (const auto& [bytes, block]: cache.blocks) {
+        ::operator delete(block, std::align_val_t{get_alignment(bytes)});
+    }
+
+    cache.blocks.clear();
+    cache.bytes = 0;
+}
+
+std::size_t get_cached_bytes() {
+    auto& cache = get_cache();
+    std::scoped_lock lock{cache.mutex};
+
+    return cache.bytes;
+}
+
+
+} // namespace arena
@@ -0,0 +1,773 @@
+// Headless benchmark of the CPU backends: steps seeded random soups of every backend, size, rule, density and thread count asked for and
+// prints the results as JSON, so runs can be diffed between releases. Progress goes to stderr.
+//
+//   slime_bench [--backend cpu|packed|tiled|distributed|hashlife|sparse]... [--size N]... [--rule R]... [--density D]...
+//               [--threads N]... [--processes N]... [--seed S] [--min-time SECONDS] [--output FILE] [--quick] [--soups N]
+//               [--out-of-core FILE [--depth N]... [--stripe-rows N] [--generations N]]
+//
+// Every option but the last four may be repeated, each adds to the matrix. Rules are names from named_rules or anything Rule::parse()
+// reads. --threads only applies to the multithreaded backend and --processes to the multiprocess one, both double from 1 up to the
+// hardware threads by default. The multiprocess backend also reports the time its workers spend exchanging halo rows per generation, and
+// its speedup over 1 process when that was run too. Memory is what the engine
+// reports holding (Engine::get_memory_bytes()). Backends with edges must agree with the CPU backend on the population and hash of the
+// board at population_generation, the others run on an unbounded plane: results say whether they matched, and a mismatch fails the run.
+// HashLife is timed differently, its memo makes the cost of a generation depend on all that ran before, so it has no rate per generation
+// or per cell: it reports the seconds per jump of 2^hashlife_exponent generations, each jump from a fresh soup.
+// Bit-packed backends also say whether the rule has a kernel of its own (bit_kernel::is_specialised()), the default rules pair HighLife
+// with B36/S235, which runs the generic kernel, to compare the two.
+//
+// --soups N runs a soup search of N soups instead (see include/soup_search.hpp) for every rule and thread count, and prints soups per
+// second, per thread and the census of objects found.
+//
+// --out-of-core FILE steps boards kept in FILE instead (see include/stream_engine.hpp), one per size, rule and depth (generations per
+// pass over the file), and prints the cell updates per second and the disk bandwidth achieved. FILE is a scratch file, removed after
+// each run, a side of 10^6 makes a board of 10^12 cells and a 125 GB file. Boards are drawn by randomizer::fill() from the seed.
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "rule.hpp"
+#include "bit_kernel.hpp"
+#include "distributed_engine.hpp"
+#include "simulation.hpp"
+#include "soup_search.hpp"
+#include "stream_engine.hpp"
+
+
+
+namespace {
+
+constexpr std::uint64_t check_generation = 8;
+
+// HashLife results time jumps of 2^hashlife_exponent generations.
+constexpr unsigned int hashlife_exponent = 10;
+
+
+struct BackendId {
+    std::string_view id;
+    Simulation::Backend backend;
+};
+
+constexpr std::array backend_ids{
+      BackendId{"cpu", Simulation::Backend::Cpu},
+      BackendId{"packed", Simulation::Backend::Packed},
+      BackendId{"tiled", Simulation::Backend::Tiled},
+      BackendId{"distributed", Simulation::Backend::Distributed},
+      BackendId{"hashlife", Simulation::Backend::HashLife},
+      BackendId{"sparse", Simulation::Backend::Sparse},
+};
+
+
+struct Options {
+    std::vector<Simulation::Backend> backends;
+    std::vector<unsigned int> sizes;
+    std::vector<Rule> rules;
+    std::vector<float> densities;
+    std::vector<unsigned int> threads;
+    std::vector<unsigned int> processes;
+
+    std::uint64_t seed = 1;
+    double min_time = 1;
+    std::string output;
+
+    // Soups to search instead of stepping boards, 0 for none.
+    std::uint64_t soups = 0;
+
+    // Board file to step out of core instead, none if empty.
+    std::string out_of_core;
+    std::vector<std::uint32_t> depths;
+    std::uint32_t stripe_rows = StreamEngine::Options{}.stripe_rows;
+    std::uint64_t generations = 64;
+};
+
+
+struct Workload {
+    Simulation::Backend backend;
+    unsigned int size;
+    Rule rule;
+    float density;
+
+    // Threads of the multithreaded backend or processes of the multiprocess one, 0 for the others.
+    unsigned int threads;
+};
+
+struct Result {
+    Workload workload;
+
+    std::uint64_t generations = 0;
+    double seconds = 0;
+    std::uint64_t memory_bytes = 0;
+
+    // At check_generation, and whether it agrees with the CPU backend. The CPU and unbounded backends are not checked.
+    std::uint64_t population = 0;
+    std::optional<bool> matches_cpu = std::nullopt;
+
+    // Of the timed generations, multiprocess backend only.
+    std::optional<double> halo_seconds = std::nullopt;
+
+    // Timed jumps of 2^hashlife_exponent generations, HashLife only.
+    std::optional<std::uint64_t> jumps = std::nullopt;
+};
+
+struct Skipped {
+    Workload workload;
+    std::string reason;
+};
+
+struct SoupResult {
+    Rule rule;
+    unsigned int threads;
+
+    double seconds = 0;
+    soup::Census census;
+};
+
+struct OutOfCoreResult {
+    unsigned int size;
+    Rule rule;
+    std::uint32_t depth;
+
+    std::uint64_t generations = 0;
+    std::uint64_t population = 0;
+    StreamEngine::IoStatistics io;
+};
+
+
+constexpr std::string_view usage =
+      "usage: slime_bench [--backend cpu|packed|tiled|distributed|hashlife|sparse]... [--size N]... [--rule R]... [--density D]...\n"
+      "                   [--threads N]... [--processes N]... [--seed S] [--min-time SECONDS] [--output FILE] [--quick] [--soups N]\n"
+      "                   [--out-of-core FILE [--depth N]... [--stripe-rows N] [--generations N]]\n";
+
+
+std::string_view get_id(Simulation::Backend backend) {
+    const auto id = std::find_if(backend_ids.begin(), backend_ids.end(), [&](const auto& entry) { return entry.backend == backend; });
+    return id != backend_ids.end() ? id->id : "gl";
+}
+
+
+template<typename T>
+T parse_number(std::string_view text) {
+    T value{};
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+
+    if (error != std::errc{} || end != text.data() + text.size()) {
+        throw std::invalid_argument("Invalid number: " + std::string{text});
+    }
+
+    return value;
+}
+
+Rule parse_rule(std::string_view text) {
+    const auto named = std::find_if(named_rules.begin(), named_rules.end(), [&](const auto& rule) { return rule.name == text; });
+    return named != named_rules.end() ? named->rule : Rule::parse(text);
+}
+
+
+Options parse_options(std::span<char*> args) {
+    Options options;
+    bool quick = false;
+
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        const std::string_view option = args[i];
+
+        if (option == "--quick") {
+            quick = true;
+            continue;
+        }
+
+        if (i + 1 == args.size()) {
+            throw std::invalid_argument("Missing value for " + std::string{option});
+        }
+
+        const std::string_view value = args[++i];
+
+        if (option == "--backend") {
+            const auto id = std::find_if(backend_ids.begin(), backend_ids.end(), [&](const auto& entry) { return entry.id == value; });
+
+            if (id == backend_ids.end()) {
+                throw std::invalid_argument("Unknown backend: " + std::string{value});
+            }
+
+            options.backends.push_back(id->backend);
+        } else if (option == "--size") {
+            options.sizes.push_back(parse_number<unsigned int>(value));
+        } else if (option == "--rule") {
+            options.rules.push_back(parse_rule(value));
+        } else if (option == "--density") {
+            options.densities.push_back(parse_number<float>(value));
+        } else if (option == "--threads") {
+            options.threads.push_back(parse_number<unsigned int>(value));
+        } else if (option == "--processes") {
+            options.processes.push_back(parse_number<unsigned int>(value));
+        } else if (option == "--seed") {
+            options.seed = parse_number<std::uint64_t>(value);
+        } else if (option == "--min-time") {
+            options.min_time = parse_number<double>(value);
+        } else if (option == "--output") {
+            options.output = value;
+        } else if (option == "--soups") {
+            options.soups = parse_number<std::uint64_t>(value);
+        } else if (option == "--out-of-core") {
+            options.out_of_core = value;
+        } else if (option == "--depth") {
+            options.depths.push_back(parse_number<std::uint32_t>(value));
+        } else if (option == "--stripe-rows") {
+            options.stripe_rows = parse_number<std::uint32_t>(value);
+        } else if (option == "--generations") {
+            options.generations = parse_number<std::uint64_t>(value);
+        } else {
+            throw std::invalid_argument("Unknown option: " + std::string{option});
+        }
+    }
+
+    if (options.backends.empty()) {
+        for (const auto& id: backend_ids) {
+            options.backends.push_back(id.backend);
+        }
+    }
+
+    if (options.sizes.empty() && !options.out_of_core.empty()) {
+        options.sizes = {quick ? 1024u : 16384u};
+    }
+
+    if (options.depths.empty()) {
+        options.depths = {1, 16};
+    }
+
+    if (options.sizes.empty()) {
+        options.sizes = quick ? std::vector<unsigned int>{256} : std::vector<unsigned int>{256, 1024, 4096};
+    }
+
+    if (options.rules.empty()) {
+        options.rules = {rules::life};
+
+        if (!quick && options.soups == 0 && options.out_of_core.empty()) {
+            options.rules.push_back(parse_rule("Brian's Brain"));
+            options.rules.push_back(parse_rule("Bosco"));
+            options.rules.push_back(parse_rule("HighLife"));
+            options.rules.push_back(parse_rule("B36/S235"));
+        }
+    }
+
+    if (options.densities.empty()) {
+        options.densities = {0.5f};
+    }
+
+    for (auto* counts: {&options.threads, &options.processes}) {
+        if (counts->empty()) {
+            const unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+
+            for (unsigned int count = 1; count < hardware; count *= 2) {
+                counts->push_back(count);
+            }
+
+            counts->push_back(hardware);
+        }
+    }
+
+    if (quick) {
+        options.min_time = std::min(options.min_time, 0.1);
+    }
+
+    for (const auto size: options.sizes) {
+        if (size == 0) {
+            throw std::invalid_argument("Board sizes must be positive.");
+        }
+    }
+
+    return options;
+}
+
+
+// Same soup for a seed on every backend and platform: mt19937_64 is fully specified, unlike the standard distributions.
+std::vector<std::uint8_t> make_soup(unsigned int size, float density, std::uint64_t seed) {
+    std::mt19937_64 generator{seed};
+    std::vector<std::uint8_t> cells(std::size_t{size} * size);
+
+    for (auto& cell: cells) {
+        cell = static_cast<double>(generator() >> 11) * 0x1.0p-53 < density ? 1 : 0;
+    }
+
+    return cells;
+}
+
+
+bool is_bounded(Simulation::Backend backend) {
+    return backend != Simulation::Backend::HashLife && backend != Simulation::Backend::Sparse;
+}
+
+bool is_bit_packed(Simulation::Backend backend) {
+    return backend == Simulation::Backend::Packed || backend == Simulation::Backend::Tiled || backend == Simulation::Backend::Distributed;
+}
+
+
+// The board of the CPU backend at check_generation, which the others must agree with.
+struct Reference {
+    unsigned int size;
+    Rule rule;
+    float density;
+
+    std::uint64_t population;
+    std::uint64_t hash;
+};
+
+const Reference& get_reference(const Workload& workload, const Options& options, std::vector<Reference>& references) {
+    const auto found = std::find_if(references.begin(), references.end(), [&](const Reference& reference) {
+        return reference.size == workload.size && reference.rule == workload.rule && reference.density == workload.density;
+    });
+
+    if (found != references.end()) {
+        return *found;
+    }
+
+    Simulation simulation{{workload.size, workload.size}, {.backend = Simulation::Backend::Cpu, .rule = workload.rule}};
+
+    simulation.set_cells(make_soup(workload.size, workload.density, options.seed));
+    simulation.step(check_generation);
+
+    return references.emplace_back(workload.size, workload.rule, workload.density, simulation.get_population(), simulation.get_hash());
+}
+
+
+// Jumps of 2^hashlife_exponent generations, each from the soup in a new simulation so none finds the memo of the one before, until
+// they add up to min_time. Only the jumps are timed.
+void time_jumps(Result& result, const Options& options) {
+    using clock_t = std::chrono::steady_clock;
+
+    const Workload& workload = result.workload;
+    const auto soup = make_soup(workload.size, workload.density, options.seed);
+
+    result.jumps = 0;
+
+    while (result.seconds < options.min_time) {
+        Simulation simulation{{workload.size, workload.size}, {.backend = workload.backend, .rule = workload.rule}};
+        simulation.set_cells(soup);
+
+        const auto begin = clock_t::now();
+        simulation.step(std::uint64_t{1} << hashlife_exponent);
+        const std::chrono::duration<double> elapsed = clock_t::now() - begin;
+
+        result.seconds += elapsed.count();
+        result.generations += std::uint64_t{1} << hashlife_exponent;
+        result.memory_bytes = std::max(result.memory_bytes, simulation.get_engine().get_memory_bytes());
+        ++*result.jumps;
+    }
+}
+
+
+Result run(const Workload& workload, const Options& options, std::vector<Reference>& references) {
+    using clock_t = std::chrono::steady_clock;
+
+    Simulation simulation{
+          {workload.size, workload.size},
+          {.backend = workload.backend, .rule = workload.rule, .threads = workload.threads},
+    };
+
+    simulation.set_cells(make_soup(workload.size, workload.density, options.seed));
+
+    // Warms up caches, thread pools and lazily allocated memory, and gives a population to check backends against.
+    simulation.step(check_generation);
+
+    Result result{.workload = workload, .population = simulation.get_population()};
+
+    if (workload.backend != Simulation::Backend::Cpu && is_bounded(workload.backend)) {
+        const auto& reference = get_reference(workload, options, references);
+        result.matches_cpu = result.population == reference.population && simulation.get_hash() == reference.hash;
+    }
+
+    const auto* distributed = dynamic_cast<const DistributedEngine*>(&simulation.get_engine());
+
+    if (workload.backend == Simulation::Backend::HashLife) {
+        time_jumps(result, options);
+        return result;
+    }
+
+    // Double the batch until a single one runs long enough to time.
+    for (std::uint64_t batch = 1;; batch *= 2) {
+        const double halo_before = distributed != nullptr ? distributed->get_halo_statistics().exchange_seconds : 0;
+
+        const auto begin = clock_t::now();
+        simulation.step(batch);
+        const std::chrono::duration<double> elapsed = clock_t::now() - begin;
+
+        if (elapsed.count() >= options.min_time || batch >= std::uint64_t{1} << 40) {
+            result.generations = batch;
+            result.seconds = elapsed.count();
+
+            if (distributed != nullptr) {
+                result.halo_seconds = distributed->get_halo_statistics().exchange_seconds - halo_before;
+            }
+
+            break;
+        }
+    }
+
+    result.memory_bytes = simulation.get_engine().get_memory_bytes();
+
+    return result;
+}
+
+
+SoupResult run_soups(const Rule& rule, unsigned int threads, const Options& options) {
+    using clock_t = std::chrono::steady_clock;
+
+    const auto begin = clock_t::now();
+    auto census = soup::search(rule, {.seed = options.seed, .count = options.soups, .threads = threads});
+    const std::chrono::duration<double> elapsed = clock_t::now() - begin;
+
+    return {.rule = rule, .threads = threads, .seconds = elapsed.count(), .census = std::move(census)};
+}
+
+
+OutOfCoreResult run_out_of_core(unsigned int size, const Rule& rule, std::uint32_t depth, const Options& options) {
+    const std::filesystem::path path = options.out_of_core;
+
+    StreamEngine::create(path, {size, size}, options.seed, options.densities.front());
+
+    OutOfCoreResult result{.size = size, .rule = rule, .depth = depth, .generations = options.generations, .population = 0, .io = {}};
+
+    try {
+        StreamEngine engine{path, {.rule = rule, .stripe_rows = options.stripe_rows, .depth = depth}};
+        engine.step(options.generations);
+
+        result.population = engine.get_population();
+        result.io = engine.get_io_statistics();
+    } catch (...) {
+        std::filesystem::remove(path);
+        throw;
+    }
+
+    std::filesystem::remove(path);
+    return result;
+}
+
+
+std::vector<Workload> get_workloads(const Options& options) {
+    std::vector<Workload> workloads;
+
+    for (const auto backend: options.backends) {
+        for (const auto size: options.sizes) {
+            for (const auto& rule: options.rules) {
+                for (const auto density: options.densities) {
+                    if (backend != Simulation::Backend::Tiled && backend != Simulation::Backend::Distributed) {
+                        workloads.push_back({backend, size, rule, density, 0});
+                        continue;
+                    }
+
+                    for (const auto threads: backend == Simulation::Backend::Tiled ? options.threads : options.processes) {
+                        workloads.push_back({backend, size, rule, density, threads});
+                    }
+                }
+            }
+        }
+    }
+
+    return workloads;
+}
+
+
+std::string quote(std::string_view text) {
+    std::string quoted = "\"";
+
+    for (const char c: text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+
+        quoted += c;
+    }
+
+    return quoted + '"';
+}
+
+void write_workload(std::ostream& out, const Workload& workload) {
+    out << "\"backend\": " << quote(get_id(workload.backend)) << ", \"size\": " << workload.size
+        << ", \"rule\": " << quote(workload.rule.to_string()) << ", \"density\": " << workload.density
+        << (workload.backend == Simulation::Backend::Distributed ? ", \"processes\": " : ", \"threads\": ") << workload.threads;
+}
+
+// Time per generation of the run with 1 process of the same workload over this one's, multiprocess backend only.
+std::optional<double> get_speedup(const Result& result, const std::vector<Result>& results) {
+    const Workload& workload = result.workload;
+
+    if (workload.backend != Simulation::Backend::Distributed) {
+        return std::nullopt;
+    }
+
+    const auto single = std::find_if(results.begin(), results.end(), [&](const Result& other) {
+        return other.workload.backend == workload.backend && other.workload.size == workload.size && other.workload.rule == workload.rule
+            && other.workload.density == workload.density && other.workload.threads == 1;
+    });
+
+    if (single == results.end()) {
+        return std::nullopt;
+    }
+
+    const auto per_generation = [](const Result& run) { return run.seconds / static_cast<double>(run.generations); };
+    return per_generation(*single) / per_generation(result);
+}
+
+void write_json(std::ostream& out, const Options& options, const std::vector<Result>& results, const std::vector<Skipped>& skipped) {
+    out << "{\n";
+    out << "  \"seed\": " << options.seed << ",\n";
+    out << "  \"min_time\": " << options.min_time << ",\n";
+    out << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    out << "  \"population_generation\": " << check_generation << ",\n";
+    out << "  \"results\": [";
+
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+
+        const double cells = static_cast<double>(result.workload.size) * result.workload.size;
+        const double generations = static_cast<double>(result.generations);
+
+        out << (i == 0 ? "\n" : ",\n") << "    {";
+        write_workload(out, result.workload);
+        out << ", \"generations\": " << result.generations << ", \"seconds\": " << result.seconds;
+
+        if (result.jumps) {
+            out << ", \"jump_generations\": " << (std::uint64_t{1} << hashlife_exponent) << ", \"jumps\": " << *result.jumps
+                << ", \"seconds_per_jump\": " << result.seconds / static_cast<double>(*result.jumps);
+        } else {
+            out << ", \"ns_per_generation\": " << result.seconds * 1e9 / generations
+                << ", \"cell_updates_per_second\": " << cells * generations / result.seconds;
+        }
+
+        out << ", \"memory_bytes\": " << result.memory_bytes << ", \"population\": " << result.population;
+
+        if (result.matches_cpu) {
+            out << ", \"matches_cpu\": " << (*result.matches_cpu ? "true" : "false");
+        }
+
+        if (is_bit_packed(result.workload.backend) && result.workload.rule.is_life_like()) {
+            out << ", \"specialised_kernel\": " << (bit_kernel::is_specialised(result.workload.rule) ? "true" : "false");
+        }
+
+        if (result.halo_seconds) {
+            out << ", \"halo_ns_per_generation\": " << *result.halo_seconds * 1e9 / generations;
+        }
+
+        if (const auto speedup = get_speedup(result, results)) {
+            out << ", \"speedup_over_1_process\": " << *speedup;
+        }
+
+        out << "}";
+    }
+
+    out << (results.empty() ? "],\n" : "\n  ],\n");
+    out << "  \"skipped\": [";
+
+    for (std::size_t i = 0; i < skipped.size(); ++i) {
+        out << (i == 0 ? "\n" : ",\n") << "    {";
+        write_workload(out, skipped[i].workload);
+        out << ", \"reason\": " << quote(skipped[i].reason) << "}";
+    }
+
+    out << (skipped.empty() ? "]\n" : "\n  ]\n");
+    out << "}\n";
+}
+
+void write_soup_json(std::ostream& out, const Options& options, const std::vector<SoupResult>& results) {
+    out << "{\n";
+    out << "  \"seed\": " << options.seed << ",\n";
+    out << "  \"soups\": " << options.soups << ",\n";
+    out << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    out << "  \"soup_searches\": [";
+
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        const auto& census = result.census;
+
+        const double soups_per_second = static_cast<double>(census.soups) / result.seconds;
+
+        // Most common first.
+        std::vector<std::pair<std::uint64_t, std::string_view>> objects;
+
+        for (const auto& [code, count]: census.objects) {
+            objects.emplace_back(count, code);
+        }
+
+        std::stable_sort(objects.begin(), objects.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+        out << (i == 0 ? "\n" : ",\n") << "    {";
+        out << "\"rule\": " << quote(result.rule.to_string()) << ", \"threads\": " << result.threads << ", \"seconds\": " << result.seconds
+            << ", \"soups_per_second\": " << soups_per_second
+            << ", \"soups_per_second_per_thread\": " << soups_per_second / result.threads
+            << ", \"generations_per_soup\": " << static_cast<double>(census.generations) / static_cast<double>(census.soups)
+            << ", \"unsettled\": " << census.unsettled << ", \"objects\": {";
+
+        for (std::size_t j = 0; j < objects.size(); ++j) {
+            out << (j == 0 ? "" : ", ") << quote(objects[j].second) << ": " << objects[j].first;
+        }
+
+        out << "}}";
+    }
+
+    out << (results.empty() ? "]\n" : "\n  ]\n");
+    out << "}\n";
+}
+
+void write_out_of_core_json(std::ostream& out, const Options& options, const std::vector<OutOfCoreResult>& results) {
+    out << "{\n";
+    out << "  \"seed\": " << options.seed << ",\n";
+    out << "  \"density\": " << options.densities.front() << ",\n";
+    out << "  \"stripe_rows\": " << options.stripe_rows << ",\n";
+    out << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    out << "  \"out_of_core\": [";
+
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        const auto& io = result.io;
+
+        const double cells = static_cast<double>(result.size) * result.size;
+        const double bytes = static_cast<double>(io.bytes_read + io.bytes_written);
+
+        out << (i == 0 ? "\n" : ",\n") << "    {";
+        out << "\"size\": " << result.size << ", \"rule\": " << quote(result.rule.to_string()) << ", \"depth\": " << result.depth
+            << ", \"generations\": " << result.generations << ", \"seconds\": " << io.seconds
+            << ", \"cell_updates_per_second\": " << cells * static_cast<double>(result.generations) / io.seconds
+            << ", \"bytes_read\": " << io.bytes_read << ", \"bytes_written\": " << io.bytes_written
+            << ", \"disk_bytes_per_second\": " << bytes / io.seconds << ", \"busy_disk_bytes_per_second\": " << bytes / io.busy_seconds
+            << ", \"io_busy_seconds\": " << io.busy_seconds << ", \"io_waiting_seconds\": " << io.waiting_seconds
+            << ", \"population\": " << result.population << "}";
+    }
+
+    out << (results.empty() ? "]\n" : "\n  ]\n");
+    out << "}\n";
+}
+
+} // namespace
+
+
+
+int main(int argc, char* argv[]) {
+    Options options;
+
+    try {
+        options = parse_options({argv + 1, static_cast<std::size_t>(argc - 1)});
+    } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << '\n' << usage;
+        return 1;
+    }
+
+    std::vector<Result> results;
+    std::vector<Skipped> skipped;
+    std::vector<Reference> references;
+    bool mismatched = false;
+    std::vector<SoupResult> soup_results;
+    std::vector<OutOfCoreResult> out_of_core_results;
+
+    if (!options.out_of_core.empty()) {
+        for (const auto size: options.sizes) {
+            for (const auto& rule: options.rules) {
+                for (const auto depth: options.depths) {
+                    std::cerr << "out of core " << size << 'x' << size << ' ' << rule.to_string() << ", depth " << depth;
+
+                    try {
+                        const auto result = run_out_of_core(size, rule, depth, options);
+                        const double bytes = static_cast<double>(result.io.bytes_read + result.io.bytes_written);
+
+                        std::cerr << ": " << bytes / result.io.seconds / 1e6 << " MB/s\n";
+
+                        out_of_core_results.push_back(result);
+                    } catch (const std::exception& e) {
+                        std::cerr << ": skipped, " << e.what() << '\n';
+                    }
+                }
+            }
+        }
+    } else if (options.soups != 0) {
+        for (const auto& rule: options.rules) {
+            for (const auto threads: options.threads) {
+                std::cerr << "soups " << rule.to_string() << ", " << threads << (threads == 1 ? " thread" : " threads");
+
+                try {
+                    const auto result = run_soups(rule, threads, options);
+                    std::cerr << ": " << static_cast<double>(result.census.soups) / result.seconds << " soups/s\n";
+
+                    soup_results.push_back(result);
+                } catch (const std::invalid_argument& e) {
+                    std::cerr << ": skipped, " << e.what() << '\n';
+                }
+            }
+        }
+    } else {
+        for (const auto& workload: get_workloads(options)) {
+            std::cerr << get_id(workload.backend) << ' ' << workload.size << 'x' << workload.size << ' ' << workload.rule.to_string();
+
+            if (workload.backend == Simulation::Backend::Distributed) {
+                std::cerr << ", " << workload.threads << (workload.threads == 1 ? " process" : " processes");
+            } else if (workload.threads != 0) {
+                std::cerr << ", " << workload.threads << (workload.threads == 1 ? " thread" : " threads");
+            }
+
+            try {
+                const auto result = run(workload, options, references);
+
+                if (result.jumps) {
+                    std::cerr << ": " << result.seconds / static_cast<double>(*result.jumps) << " s per jump of 2^" << hashlife_exponent
+                              << " generations";
+                } else {
+                    std::cerr << ": " << result.seconds * 1e9 / static_cast<double>(result.generations) << " ns/generation";
+                }
+
+                if (result.halo_seconds) {
+                    std::cerr << ", " << *result.halo_seconds * 1e9 / static_cast<double>(result.generations) << " ns in halo exchange";
+                }
+
+                if (result.matches_cpu == false) {
+                    std::cerr << ", DOES NOT MATCH THE CPU BACKEND";
+                    mismatched = true;
+                }
+
+                std::cerr << '\n';
+
+                results.push_back(result);
+            } catch (const std::invalid_argument& e) {
+                std::cerr << ": skipped, " << e.what() << '\n';
+                skipped.push_back({workload, e.what()});
+            }
+        }
+    }
+
+    const auto write = [&](std::ostream& out) {
+        if (!options.out_of_core.empty()) {
+            write_out_of_core_json(out, options, out_of_core_results);
+        } else if (options.soups != 0) {
+            write_soup_json(out, options, soup_results);
+        } else {
+            write_json(out, options, results, skipped);
+        }
+    };
+
+    if (options.output.empty()) {
+        write(std::cout);
+        return mismatched ? 1 : 0;
+    }
+
+    std::ofstream file{options.output};
+    write(file);
+
+    if (!file) {
+        std::cerr << "Could not write " << options.output << '\n';
+        return 1;
+    }
+
+    return mismatched ? 1 : 0;
+}
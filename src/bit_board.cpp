@@ -0,0 +1,228 @@
+#include "bit_board.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+
+
+namespace {
+
+std::uint64_t reverse_bits(std::uint64_t word) {
+    word = ((word >> 1) & 0x5555555555555555ULL) | ((word & 0x5555555555555555ULL) << 1);
+    word = ((word >> 2) & 0x3333333333333333ULL) | ((word & 0x3333333333333333ULL) << 2);
+    word = ((word >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((word & 0x0f0f0f0f0f0f0f0fULL) << 4);
+    word = ((word >> 8) & 0x00ff00ff00ff00ffULL) | ((word & 0x00ff00ff00ff00ffULL) << 8);
+    word = ((word >> 16) & 0x0000ffff0000ffffULL) | ((word & 0x0000ffff0000ffffULL) << 16);
+
+    return (word >> 32) | (word << 32);
+}
+
+} // namespace
+
+
+
+BitBoard::BitBoard(Resolution res):
+      res{res},
+      words_per_row{(res.x + 2 + 63) / 64},
+      stride{pad_words + (words_per_row + pad_words - 1) / pad_words * pad_words},
+      first_mask{~std::uint64_t{1}},
+      last_mask{(std::uint64_t{1} << ((res.x + 1) % 64)) - 1},
+      words(stride * (res.y + 2) + pad_words, 0) {}
+
+
+bool BitBoard::get(unsigned int x, unsigned int y) const {
+    const std::size_t bit = std::size_t{x} + 1;
+
+    return ((row(y + 1)[bit / 64] >> (bit % 64)) & 1) != 0;
+}
+
+void BitBoard::set(unsigned int x, unsigned int y, bool alive) {
+    const std::size_t bit = std::size_t{x} + 1;
+
+    auto& word = row(y + 1)[bit / 64];
+
+    word = (word & ~(std::uint64_t{1} << (bit % 64))) | (std::uint64_t{alive} << (bit % 64));
+}
+
+
+void BitBoard::clear() {
+    std::fill(words.begin(), words.end(), 0);
+}
+
+
+bool BitBoard::get_ghost(std::int64_t x, std::int64_t y) const {
+    const auto bit = static_cast<std::size_t>(x + 1);
+
+    return ((row(static_cast<std::size_t>(y + 1))[bit / 64] >> (bit % 64)) & 1) != 0;
+}
+
+void BitBoard::set_ghost(std::int64_t x, std::int64_t y, bool alive) {
+    const auto bit = static_cast<std::size_t>(x + 1);
+
+    auto& word = row(static_cast<std::size_t>(y + 1))[bit / 64];
+
+    word = (word & ~(std::uint64_t{1} << (bit % 64))) | (std::uint64_t{alive} << (bit % 64));
+}
+
+
+void BitBoard::clear_halo() {
+    std::fill_n(row(0), words_per_row, 0);
+    std::fill_n(row(res.y + 1), words_per_row, 0);
+
+    for (std::size_t y = 1; y <= res.y; ++y) {
+        row(y)[0] &= first_mask;
+        row(y)[words_per_row - 1] &= last_mask;
+    }
+}
+
+
+std::uint64_t BitBoard::hash(std::uint64_t first_row) const {
+    const std::size_t last = words_per_row - 1;
+    std::uint64_t hash = 0;
+
+    for (std::size_t y = 1; y <= res.y; ++y) {
+        const std::uint64_t* words = row(y);
+        const std::uint64_t position = (first_row + y - 1) * words_per_row;
+
+        if (last == 0) {
+            hash += hash_word(words[0] & first_mask & last_mask, position);
+            continue;
+        }
+
+        hash += hash_word(words[0] & first_mask, position);
+
+        for (std::size_t i = 1; i < last; ++i) {
+            hash += hash_word(words[i], position + i);
+        }
+
+        hash += hash_word(words[last] & last_mask, position + last);
+    }
+
+    return hash;
+}
+
+
+void BitBoard::fill_halo(Topology topology) {
+    if (topology == Topology::DeadBorder) {
+        return;
+    }
+
+    for (std::int64_t y = 0; y < res.y; ++y) {
+        for (const std::int64_t x: {std::int64_t{-1}, std::int64_t{res.x}}) {
+            const auto [source_x, source_y] = *wrap(topology, res, x, y);
+            set_ghost(x, y, get_ghost(source_x, source_y));
+        }
+    }
+
+    // wrap() on the first cell of a ghost row tells which row it copies.
+    copy_row(*this, static_cast<std::size_t>(wrap(topology, res, 0, -1)->second + 1), *this, 0, mirrors_rows(topology));
+    copy_row(*this, static_cast<std::size_t>(wrap(topology, res, 0, res.y)->second + 1), *this, res.y + 1, mirrors_rows(topology));
+}
+
+
+void BitBoard::copy_row(const BitBoard& from, std::size_t from_row, BitBoard& to, std::size_t to_row, bool mirrored) {
+    const std::size_t words = from.words_per_row;
+
+    const std::uint64_t* in = from.row(from_row);
+    std::uint64_t* out = to.row(to_row);
+
+    if (!mirrored) {
+        std::copy_n(in, words, out);
+        return;
+    }
+
+    // Reversing all the words moves bit p to words * 64 - 1 - p, mirroring wants it at res.x + 1 - p.
+    const std::size_t shift = words * 64 - 2 - from.res.x;
+
+    for (std::size_t i = 0; i < words; ++i) {
+        const std::uint64_t word = reverse_bits(in[words - 1 - i]);
+        const std::uint64_t next = i + 1 < words ? reverse_bits(in[words - 2 - i]) : 0;
+
+        out[i] = shift == 0 ? word : (word >> shift) | (next << (64 - shift));
+    }
+}
+
+
+void BitBoard::copy_from(const BitBoard& from, unsigned int from_x, unsigned int from_y, unsigned int to_x, unsigned int to_y,
+      Resolution size) {
+
+    if (std::size_t{from_x} + size.x > from.res.x || std::size_t{from_y} + size.y > from.res.y || std::size_t{to_x} + size.x > res.x
+          || std::size_t{to_y} + size.y > res.y) {
+        throw std::invalid_argument("Region does not fit in the boards.");
+    }
+
+    for (std::size_t y = 0; y < size.y; ++y) {
+        const std::uint64_t* in = from.row(from_y + y + 1);
+        std::uint64_t* out = row(to_y + y + 1);
+
+        // The first cell is bit x + 1, past the ghost column.
+        for (std::size_t done = 0; done < size.x;) {
+            const std::size_t to_bit = to_x + 1 + done;
+            const std::size_t from_bit = from_x + 1 + done;
+
+            const std::size_t offset = to_bit % 64;
+            const std::size_t count = std::min(64 - offset, size.x - done);
+
+            // 64 cells from from_bit on, reading one word past the row is fine.
+            const std::size_t shift = from_bit % 64;
+            const std::uint64_t* word = &in[from_bit / 64];
+            const std::uint64_t bits = shift == 0 ? word[0] : (word[0] >> shift) | (word[1] << (64 - shift));
+
+            const std::uint64_t mask = (count == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << count) - 1) << offset;
+            auto& target = out[to_bit / 64];
+
+            target = (target & ~mask) | ((bits << offset) & mask);
+            done += count;
+        }
+    }
+}
+
+
+void BitBoard::make_unshared(std::shared_ptr<BitBoard>& board, std::vector<std::shared_ptr<BitBoard>>& spares) {
+    if (board.use_count() == 1) {
+        return;
+    }
+
+    const auto free = std::find_if(spares.begin(), spares.end(), [](const auto& spare) { return spare.use_count() == 1; });
+
+    if (free != spares.end()) {
+        std::swap(board, *free);
+    } else {
+        auto fresh = std::make_shared<BitBoard>(board->res);
+        spares.push_back(std::exchange(board, std::move(fresh)));
+    }
+}
+
+
+void BitBoard::load_cells(std::span<const std::uint8_t> cells) {
+    if (cells.size() != std::size_t{res.x} * res.y) {
+        throw std::invalid_argument("Cell buffer does not match the board resolution.");
+    }
+
+    for (std::size_t y = 0; y < res.y; ++y) {
+        const auto* in = &cells[y * res.x];
+        auto* out = row(y + 1);
+
+        std::fill_n(out, words_per_row, 0);
+
+        for (std::size_t x = 0; x < res.x; ++x) {
+            out[(x + 1) / 64] |= std::uint64_t{in[x] != 0} << ((x + 1) % 64);
+        }
+    }
+}
+
+void BitBoard::store_cells(std::span<std::uint8_t> cells) const {
+    if (cells.size() != std::size_t{res.x} * res.y) {
+        throw std::invalid_argument("Cell buffer does not match the board resolution.");
+    }
+
+    for (std::size_t y = 0; y < res.y; ++y) {
+        const auto* in = row(y + 1);
+        auto* out = &cells[y * res.x];
+
+        for (std::size_t x = 0; x < res.x; ++x) {
+            out[x] = static_cast<std::uint8_t>((in[(x + 1) / 64] >> ((x + 1) % 64)) & 1);
+        }
+    }
+}
@@ -0,0 +1,435 @@
+#include "bit_kernel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+
+
+#if defined(__x86_64__) || defined(__i386__)
+    #define SLIME_X86 1
+#else
+    #define SLIME_X86 0
+#endif
+
+// The helpers below are always inlined into the target specific functions, their vector arguments never cross an ABI boundary.
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+
+
+namespace bit_kernel {
+
+
+namespace {
+
+#if SLIME_X86
+using u64x4 = std::uint64_t __attribute__((vector_size(32)));
+using u64x8 = std::uint64_t __attribute__((vector_size(64)));
+#endif
+
+
+template<typename V>
+[[gnu::always_inline]] inline V load(const std::uint64_t* words) {
+    V v;
+    std::memcpy(&v, words, sizeof(V));
+    return v;
+}
+
+template<typename V>
+[[gnu::always_inline]] inline void store(std::uint64_t* words, V v) {
+    std::memcpy(words, &v, sizeof(V));
+}
+
+
+// The cells of a row shifted so that each bit lines up with its west and east neighbour.
+template<typename V>
+[[gnu::always_inline]] inline V west(const std::uint64_t* words) {
+    return (load<V>(words) << 1) | (load<V>(words - 1) >> 63);
+}
+
+template<typename V>
+[[gnu::always_inline]] inline V east(const std::uint64_t* words) {
+    return (load<V>(words) >> 1) | (load<V>(words + 1) << 63);
+}
+
+
+// Sums of the row of cells starting at `words`, see RowSums.
+template<typename V>
+[[gnu::always_inline]] inline RowSums<V> sum_words(const std::uint64_t* words) {
+    return sum_row(west<V>(words), load<V>(words), east<V>(words));
+}
+
+
+// Next state of 64 * lanes cells under a rule fixed at compile time, B3/S23 keeps its shorter adder.
+template<Rule rule>
+struct Fixed {
+    template<typename V>
+    [[gnu::always_inline]] V next(const RowSums<V>& above, const RowSums<V>& row, const RowSums<V>& below) const {
+        if constexpr (rule == rules::life) {
+            return next_state<V>(above, row, below);
+        } else {
+            return next_state<V>(make_table<V>(rule), above, row, below);
+        }
+    }
+};
+
+
+// The boolean function of three inputs whose truth table is `table`, bit 4a + 2b + c giving its value for inputs a, b and c. The selects
+// fold down to a single three input instruction where there is one.
+template<std::uint8_t table, typename V>
+[[gnu::always_inline]] inline V ternary(V a, V b, V c) {
+    auto bit = [](unsigned int i) { return (table >> i & 1) != 0 ? ~V{} : V{}; };
+    auto pick = [](V select, V one, V zero) { return zero ^ (select & (one ^ zero)); };
+
+    return pick(a, pick(b, pick(c, bit(7), bit(6)), pick(c, bit(5), bit(4))), pick(b, pick(c, bit(3), bit(2)), pick(c, bit(1), bit(0))));
+}
+
+#if SLIME_X86
+// Which AVX-512 has as a single instruction, though the compiler does not always find it for the selects above. Only ever inlined into
+// the AVX-512 kernels, the rest of this file is built for plain x86-64.
+template<std::uint8_t table>
+[[gnu::always_inline]] inline u64x8 ternary(u64x8 a, u64x8 b, u64x8 c) {
+    asm("vpternlogq %[table], %[c], %[b], %[a]" : [a] "+v"(a) : [b] "v"(b), [c] "v"(c), [table] "i"(table));
+    return a;
+}
+#endif
+
+// The same with the table only known at run time: a switch over all 256 of them, which compiles to a jump table whose target a kernel
+// looks up once, outside its loops.
+template<typename V>
+[[gnu::always_inline]] inline V ternary(std::uint8_t table, V a, V b, V c) {
+#define SLIME_TERNARY_1(i) \
+    case i: return ternary<i>(a, b, c);
+#define SLIME_TERNARY_4(i) SLIME_TERNARY_1(i) SLIME_TERNARY_1(i + 1) SLIME_TERNARY_1(i + 2) SLIME_TERNARY_1(i + 3)
+#define SLIME_TERNARY_16(i) SLIME_TERNARY_4(i) SLIME_TERNARY_4(i + 4) SLIME_TERNARY_4(i + 8) SLIME_TERNARY_4(i + 12)
+#define SLIME_TERNARY_64(i) SLIME_TERNARY_16(i) SLIME_TERNARY_16(i + 16) SLIME_TERNARY_16(i + 32) SLIME_TERNARY_16(i + 48)
+
+    switch (table) {
+        SLIME_TERNARY_64(0)
+        SLIME_TERNARY_64(64)
+        SLIME_TERNARY_64(128)
+        SLIME_TERNARY_64(192)
+    }
+
+#undef SLIME_TERNARY_64
+#undef SLIME_TERNARY_16
+#undef SLIME_TERNARY_4
+#undef SLIME_TERNARY_1
+
+    std::unreachable();
+}
+
+
+// Next state under a rule read at run time. The rule is split into two truth tables over the cell and the two low bits of its
+// neighbour count, one for counts 0 to 3 and one for 4 to 7, so that a word costs two three input functions and a select on the third
+// bit of the count. Count 8 is only looked at when `eight` is set, the rules that treat it like count 0 need nothing more.
+template<bool eight>
+struct Generic {
+    std::uint8_t low = 0;
+    std::uint8_t high = 0;
+
+    // Set where count 8 differs from count 0, for dead cells and for live ones.
+    std::uint64_t birth_eight;
+    std::uint64_t survival_eight;
+
+    explicit Generic(const Rule& rule):
+          birth_eight{((rule.birth ^ rule.birth >> 8) & 1) != 0 ? ~std::uint64_t{} : 0},
+          survival_eight{((rule.survival ^ rule.survival >> 8) & 1) != 0 ? ~std::uint64_t{} : 0} {
+        for (unsigned int i = 0; i < 8; ++i) {
+            const unsigned int mask = (i & 4) != 0 ? rule.survival : rule.birth;
+            const unsigned int count = i & 3;
+
+            low |= static_cast<std::uint8_t>((mask >> count & 1) << i);
+            high |= static_cast<std::uint8_t>((mask >> (count + 4) & 1) << i);
+        }
+    }
+
+    template<typename V>
+    [[gnu::always_inline]] V next(const RowSums<V>& a, const RowSums<V>& b, const RowSums<V>& c) const {
+        const V lo_x = a.lo ^ b.side_lo;
+        const V s0 = lo_x ^ c.lo;
+        const V carry = (a.lo & b.side_lo) | (lo_x & c.lo);
+
+        const V hi_x = a.hi ^ b.side_hi;
+        const V hi_y = c.hi ^ carry;
+        const V s1 = hi_x ^ hi_y;
+
+        const V carry_x = a.hi & b.side_hi;
+        const V carry_y = c.hi & carry;
+        const V s2 = carry_x ^ carry_y ^ (hi_x & hi_y);
+
+        const V l = ternary(low, b.cell, s1, s0);
+        const V h = ternary(high, b.cell, s1, s0);
+        const V result = l ^ (s2 & (h ^ l));
+
+        if constexpr (eight) {
+            const V birth = V{} | birth_eight;
+            const V survival = V{} | survival_eight;
+
+            return result ^ (carry_x & carry_y & (birth ^ (b.cell & (survival ^ birth))));
+        } else {
+            return result;
+        }
+    }
+};
+
+// Whether `rule` needs Generic<true>.
+bool is_eight_apart(const Rule& rule) {
+    return ((rule.birth ^ rule.birth >> 8) & 1) != 0 || ((rule.survival ^ rule.survival >> 8) & 1) != 0;
+}
+
+
+// Rows [begin, end) of the column of words [i, i + lanes), walking down it so each row is summed once and the sums of the two rows
+// above are still in registers.
+template<typename V, typename Next>
+[[gnu::always_inline]] inline void step_column(
+      const BitBoard& in, BitBoard& out, std::size_t begin, std::size_t end, std::size_t i, const Next& next) {
+    const std::size_t in_stride = in.get_stride();
+    const std::size_t out_stride = out.get_stride();
+
+    const std::uint64_t* source = in.row(begin + 1) + i;
+    std::uint64_t* result = out.row(begin) + i;
+
+    RowSums<V> above = sum_words<V>(in.row(begin - 1) + i);
+    RowSums<V> row = sum_words<V>(in.row(begin) + i);
+
+    for (std::size_t y = begin; y < end; ++y, source += in_stride, result += out_stride) {
+        const RowSums<V> below = sum_words<V>(source);
+
+        store(result, next.template next<V>(above, row, below));
+
+        above = row;
+        row = below;
+    }
+}
+
+// Boards are stepped in strips short enough that a strip's rows stay in L1 while its columns are walked down one after the other.
+inline constexpr std::size_t strip_rows = 32;
+
+template<typename V, typename Next>
+[[gnu::always_inline]] inline void step_rows_with(const BitBoard& in, BitBoard& out, std::size_t begin, std::size_t end, const Next& next) {
+    constexpr std::size_t lanes = sizeof(V) / sizeof(std::uint64_t);
+
+    const std::size_t words = in.get_words_per_row();
+
+    for (std::size_t strip = begin; strip < end; strip += strip_rows) {
+        const std::size_t strip_end = std::min(end, strip + strip_rows);
+
+        std::size_t i = 0;
+
+        for (; i + lanes <= words; i += lanes) {
+            step_column<V>(in, out, strip, strip_end, i, next);
+        }
+
+        for (; i < words; ++i) {
+            step_column<std::uint64_t>(in, out, strip, strip_end, i, next);
+        }
+
+        for (std::size_t y = strip; y < strip_end; ++y) {
+            out.row(y)[0] &= out.get_first_mask();
+            out.row(y)[words - 1] &= out.get_last_mask();
+        }
+    }
+}
+
+
+template<typename V>
+[[gnu::always_inline]] inline void step_rows_generic(
+      const BitBoard& in, BitBoard& out, std::size_t begin, std::size_t end, const Rule& rule) {
+    if (is_eight_apart(rule)) {
+        step_rows_with<V>(in, out, begin, end, Generic<true>{rule});
+    } else {
+        step_rows_with<V>(in, out, begin, end, Generic<false>{rule});
+    }
+}
+
+
+template<Rule rule>
+void step_rows_scalar(const BitBoard& in, BitBoard& out, std::size_t begin, std::size_t end, const Rule&) {
+    step_rows_with<std::uint64_t>(in, out, begin, end, Fixed<rule>{});
+}
+
+void step_rows_scalar_generic(const BitBoard& in, BitBoard& out, std::size_t begin, std::size_t end, const Rule& rule) {
+    step_rows_generic<std::uint64_t>(in, out, begin, end, rule);
+}
+
+#if SLIME_X86
+template<Rule rule>
+__attribute__((target("avx2"))) void step_rows_avx2(const BitBoard& in, BitBoard& out, std::size_t begin, std::size_t end, const Rule&) {
+    step_rows_with<u64x4>(in, out, begin, end, Fixed<rule>{});
+}
+
+__attribute__((target("avx2"))) void step_rows_avx2_generic(const BitBoard& in, BitBoard& out, std::size_t begin, std::size_t end,
+      const Rule& rule) {
+    step_rows_generic<u64x4>(in, out, begin, end, rule);
+}
+
+template<Rule rule>
+__attribute__((target("avx512f"))) void step_rows_avx512(
+      const BitBoard& in, BitBoard& out, std::size_t begin, std::size_t end, const Rule&) {
+    step_rows_with<u64x8>(in, out, begin, end, Fixed<rule>{});
+}
+
+__attribute__((target("avx512f"))) void step_rows_avx512_generic(const BitBoard& in, BitBoard& out, std::size_t begin, std::size_t end,
+      const Rule& rule) {
+    step_rows_generic<u64x8>(in, out, begin, end, rule);
+}
+#endif
+
+
+// The same row of several boards, each word a whole row: neighbours are the next bit over in the same word, past either end is dead.
+template<bool life, typename V>
+[[gnu::always_inline]] inline V next_lanes(const RuleTable<V>& table, V above, V row, V below) {
+    if constexpr (life) {
+        return next_state<V>(above << 1, above, above >> 1, row << 1, row, row >> 1, below << 1, below, below >> 1);
+    } else {
+        return next_state<V>(table, above << 1, above, above >> 1, row << 1, row, row >> 1, below << 1, below, below >> 1);
+    }
+}
+
+template<typename V, bool life>
+[[gnu::always_inline]] inline void step_lanes_with(
+      const std::uint64_t* in, std::uint64_t* out, std::size_t lanes, std::size_t rows, const Rule& rule) {
+    constexpr std::size_t width = sizeof(V) / sizeof(std::uint64_t);
+
+    const auto table = make_table<V>(rule);
+    const auto tail_table = make_table<std::uint64_t>(rule);
+
+    for (std::size_t y = 1; y <= rows; ++y) {
+        const std::uint64_t* above = in + (y - 1) * lanes;
+        const std::uint64_t* row = in + y * lanes;
+        const std::uint64_t* below = in + (y + 1) * lanes;
+
+        std::uint64_t* result = out + y * lanes;
+
+        std::size_t l = 0;
+
+        for (; l + width <= lanes; l += width) {
+            store(result + l, next_lanes<life>(table, load<V>(above + l), load<V>(row + l), load<V>(below + l)));
+        }
+
+        for (; l < lanes; ++l) {
+            result[l] = next_lanes<life>(tail_table, above[l], row[l], below[l]);
+        }
+    }
+}
+
+
+template<bool life>
+void step_lanes_scalar(const std::uint64_t* in, std::uint64_t* out, std::size_t lanes, std::size_t rows, const Rule& rule) {
+    step_lanes_with<std::uint64_t, life>(in, out, lanes, rows, rule);
+}
+
+#if SLIME_X86
+template<bool life>
+__attribute__((target("avx2"))) void step_lanes_avx2(
+      const std::uint64_t* in, std::uint64_t* out, std::size_t lanes, std::size_t rows, const Rule& rule) {
+    step_lanes_with<u64x4, life>(in, out, lanes, rows, rule);
+}
+
+template<bool life>
+__attribute__((target("avx512f"))) void step_lanes_avx512(
+      const std::uint64_t* in, std::uint64_t* out, std::size_t lanes, std::size_t rows, const Rule& rule) {
+    step_lanes_with<u64x8, life>(in, out, lanes, rows, rule);
+}
+#endif
+
+
+struct Kernels {
+    Rule rule;
+
+    Kernel scalar;
+    Kernel avx2;
+    Kernel avx512;
+};
+
+// The named rules these kernels can run.
+constexpr auto life_like_rules = [] {
+    constexpr auto count = std::count_if(named_rules.begin(), named_rules.end(), [](const NamedRule& named) {
+        return named.rule.is_life_like();
+    });
+
+    std::array<Rule, count> rules;
+    std::size_t i = 0;
+
+    for (const auto& named: named_rules) {
+        if (named.rule.is_life_like()) {
+            rules[i++] = named.rule;
+        }
+    }
+
+    return rules;
+}();
+
+template<std::size_t... i>
+constexpr auto make_specialised(std::index_sequence<i...>) {
+#if SLIME_X86
+    return std::array{Kernels{life_like_rules[i], &step_rows_scalar<life_like_rules[i]>, &step_rows_avx2<life_like_rules[i]>,
+          &step_rows_avx512<life_like_rules[i]>}...};
+#else
+    return std::array{Kernels{life_like_rules[i], &step_rows_scalar<life_like_rules[i]>, nullptr, nullptr}...};
+#endif
+}
+
+constexpr auto specialised = make_specialised(std::make_index_sequence<life_like_rules.size()>{});
+
+#if SLIME_X86
+constexpr Kernels generic{{}, &step_rows_scalar_generic, &step_rows_avx2_generic, &step_rows_avx512_generic};
+#else
+constexpr Kernels generic{{}, &step_rows_scalar_generic, nullptr, nullptr};
+#endif
+
+} // namespace
+
+
+
+Isa detect() {
+#if SLIME_X86
+    if (__builtin_cpu_supports("avx512f")) {
+        return Isa::Avx512;
+    }
+
+    if (__builtin_cpu_supports("avx2")) {
+        return Isa::Avx2;
+    }
+#endif
+
+    return Isa::Scalar;
+}
+
+
+Kernel select(const Rule& rule, Isa isa) {
+    const auto found = std::find_if(specialised.begin(), specialised.end(), [&](const Kernels& kernels) { return kernels.rule == rule; });
+    const Kernels& kernels = found != specialised.end() ? *found : generic;
+
+    switch (isa) {
+#if SLIME_X86
+        case Isa::Avx512: return kernels.avx512;
+        case Isa::Avx2: return kernels.avx2;
+#endif
+        default: return kernels.scalar;
+    }
+}
+
+LaneKernel select_lanes(const Rule& rule, Isa isa) {
+    const bool life = rule == rules::life;
+
+    switch (isa) {
+#if SLIME_X86
+        case Isa::Avx512: return life ? &step_lanes_avx512<true> : &step_lanes_avx512<false>;
+        case Isa::Avx2: return life ? &step_lanes_avx2<true> : &step_lanes_avx2<false>;
+#endif
+        default: return life ? &step_lanes_scalar<true> : &step_lanes_scalar<false>;
+    }
+}
+
+bool is_specialised(const Rule& rule) {
+    return std::any_of(specialised.begin(), specialised.end(), [&](const Kernels& kernels) { return kernels.rule == rule; });
+}
+
+
+} // namespace bit_kernel
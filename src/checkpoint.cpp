@@ -0,0 +1,595 @@
+#include "checkpoint.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+
+namespace checkpoint {
+
+namespace {
+
+static_assert(std::endian::native == std::endian::little, "Checkpoints are little endian.");
+
+
+constexpr std::array<char, 8> magic{'S', 'L', 'I', 'M', 'E', 'C', 'K', 'P'};
+
+// Version 1 had no states, it is read as a version 2 checkpoint without a dying cell.
+constexpr std::uint32_t version = 2;
+
+
+struct Header {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t topology;
+
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint64_t generation;
+
+    std::uint16_t birth;
+    std::uint16_t survival;
+    std::uint16_t states;
+    std::uint16_t range;
+    std::uint32_t include_centre;
+    std::uint32_t birth_min;
+    std::uint32_t birth_max;
+    std::uint32_t survival_min;
+    std::uint32_t survival_max;
+
+    std::uint32_t tile_rows;
+    std::uint32_t tile_words;
+    std::uint32_t reserved;
+};
+
+static_assert(sizeof(Header) == 72 && sizeof(Header) % sizeof(std::uint64_t) == 0);
+
+
+// Tiles in row major order, and the size of each in rows and words.
+struct Grid {
+    explicit Grid(Resolution res):
+          res{res},
+          words{(std::size_t{res.x} + 63) / 64},
+          columns{(words + tile_words - 1) / tile_words},
+          count{columns * ((std::size_t{res.y} + tile_rows - 1) / tile_rows)} {}
+
+
+    std::size_t get_y(std::size_t tile) const { return tile / columns * tile_rows; }
+    std::size_t get_word(std::size_t tile) const { return tile % columns * tile_words; }
+
+    std::size_t get_rows(std::size_t tile) const { return std::min<std::size_t>(tile_rows, res.y - get_y(tile)); }
+    std::size_t get_words(std::size_t tile) const { return std::min<std::size_t>(tile_words, words - get_word(tile)); }
+
+    // Index entries, the tiles and the states of Generations boards after them.
+    std::size_t get_entries(std::uint16_t states) const { return states > 2 ? count + 1 : count; }
+
+    // Of the states, padded to a whole number of words.
+    std::size_t get_states_bytes() const { return (std::size_t{res.x} * res.y + 7) / 8 * 8; }
+
+
+    Resolution res;
+
+    // Words per row, 64 cells each.
+    std::size_t words;
+
+    std::size_t columns;
+    std::size_t count;
+};
+
+
+// Clears the bits past the last cell of a row from its last word.
+std::uint64_t get_tail_mask(Resolution res) {
+    return res.x % 64 == 0 ? ~std::uint64_t{0} : (std::uint64_t{1} << (res.x % 64)) - 1;
+}
+
+
+Header make_header(const Snapshot& snapshot) {
+    const auto& rule = snapshot.rule;
+
+    return {
+          .magic = magic,
+          .version = version,
+          .topology = static_cast<std::uint32_t>(snapshot.topology),
+          .width = snapshot.res.x,
+          .height = snapshot.res.y,
+          .generation = snapshot.generation,
+          .birth = rule.birth,
+          .survival = rule.survival,
+          .states = rule.states,
+          .range = rule.range,
+          .include_centre = rule.include_centre,
+          .birth_min = rule.birth_counts.min,
+          .birth_max = rule.birth_counts.max,
+          .survival_min = rule.survival_counts.min,
+          .survival_max = rule.survival_counts.max,
+          .tile_rows = tile_rows,
+          .tile_words = tile_words,
+          .reserved = 0,
+    };
+}
+
+
+// Gathers a tile from the bands of a snapshot, shifting out the ghost column BitBoard keeps in front of every row.
+class TileReader {
+  public:
+    TileReader(const Snapshot& snapshot, const Grid& grid): snapshot{snapshot}, grid{grid}, tail_mask{get_tail_mask(snapshot.res)} {}
+
+
+    // Returns whether the tile has a live cell.
+    bool read(std::size_t tile, std::span<std::uint64_t> out) {
+        const std::size_t y = grid.get_y(tile);
+        const std::size_t first = grid.get_word(tile);
+        const std::size_t rows = grid.get_rows(tile);
+        const std::size_t words = grid.get_words(tile);
+        const bool last = first + words == grid.words;
+
+        std::uint64_t any = 0;
+
+        for (std::size_t r = 0; r < rows; ++r) {
+            const std::uint64_t* row = find_row(y + r) + first;
+            std::uint64_t* to = &out[r * words];
+
+            for (std::size_t i = 0; i < words; ++i) {
+                to[i] = row[i] >> 1 | row[i + 1] << 63;
+            }
+
+            if (last) {
+                to[words - 1] &= tail_mask;
+            }
+
+            for (std::size_t i = 0; i < words; ++i) {
+                any |= to[i];
+            }
+        }
+
+        return any != 0;
+    }
+
+
+  private:
+    const std::uint64_t* find_row(std::size_t y) {
+        const auto& bands = snapshot.bands;
+
+        if (band == bands.size() || y < bands[band].y || y >= bands[band].y + bands[band].board->get_resolution().y) {
+            const auto next = std::upper_bound(bands.begin(), bands.end(), y, [](std::size_t row, const auto& b) { return row < b.y; });
+            band = static_cast<std::size_t>(next - bands.begin() - 1);
+        }
+
+        return bands[band].board->row(y - bands[band].y + 1);
+    }
+
+
+    const Snapshot& snapshot;
+    const Grid& grid;
+    std::uint64_t tail_mask;
+
+    std::size_t band = 0;
+};
+
+
+void check_snapshot(const Snapshot& snapshot) {
+    std::size_t y = 0;
+
+    for (const auto& band: snapshot.bands) {
+        const auto band_res = band.board->get_resolution();
+
+        if (band.y != y || band_res.x != snapshot.res.x) {
+            throw std::invalid_argument("Snapshot bands do not cover the board.");
+        }
+
+        y += band_res.y;
+    }
+
+    if (y != snapshot.res.y) {
+        throw std::invalid_argument("Snapshot bands do not cover the board.");
+    }
+
+    const std::size_t states = snapshot.rule.states > 2 ? std::size_t{snapshot.res.x} * snapshot.res.y : 0;
+
+    if (snapshot.states.size() != states) {
+        throw std::invalid_argument("Snapshot states do not match the rule.");
+    }
+}
+
+
+void write_file(const std::filesystem::path& path, const Snapshot& snapshot, bool compress) {
+    const Grid grid{snapshot.res};
+
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+
+    if (!file) {
+        throw std::runtime_error("Could not open the checkpoint file.");
+    }
+
+    const Header header = make_header(snapshot);
+    std::vector<std::uint64_t> index(grid.get_entries(snapshot.rule.states), 0);
+
+    // The index is only known once the tiles are written, leave room for it.
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(std::uint64_t)));
+
+    std::uint64_t offset = sizeof(header) + index.size() * sizeof(std::uint64_t);
+
+    TileReader reader{snapshot, grid};
+    std::vector<std::uint64_t> tile(std::size_t{tile_rows} * tile_words);
+
+    for (std::size_t i = 0; i < grid.count; ++i) {
+        const std::size_t size = grid.get_rows(i) * grid.get_words(i);
+
+        if (!reader.read(i, tile) && compress) {
+            continue;
+        }
+
+        file.write(reinterpret_cast<const char*>(tile.data()), static_cast<std::streamsize>(size * sizeof(std::uint64_t)));
+
+        index[i] = offset;
+        offset += size * sizeof(std::uint64_t);
+    }
+
+    const bool dying = std::ranges::any_of(snapshot.states, [](std::uint8_t state) { return state > 1; });
+
+    if (dying || (!compress && !snapshot.states.empty())) {
+        const std::vector<char> padding(grid.get_states_bytes() - snapshot.states.size(), 0);
+
+        file.write(reinterpret_cast<const char*>(snapshot.states.data()), static_cast<std::streamsize>(snapshot.states.size()));
+        file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+
+        index[grid.count] = offset;
+    }
+
+    file.seekp(sizeof(header));
+    file.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(std::uint64_t)));
+    file.close();
+
+    if (!file) {
+        throw std::runtime_error("Could not write the checkpoint file.");
+    }
+}
+
+
+// A read only mapping of a whole file.
+class Mapping {
+  public:
+    explicit Mapping(const std::filesystem::path& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0) {
+            throw std::runtime_error("Could not open the checkpoint file.");
+        }
+
+        struct stat status{};
+
+        if (::fstat(fd, &status) == 0 && status.st_size > 0) {
+            size = static_cast<std::size_t>(status.st_size);
+            data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+
+        ::close(fd);
+
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("Could not map the checkpoint file.");
+        }
+
+        if (data == nullptr) {
+            throw std::invalid_argument("Checkpoint file is empty.");
+        }
+
+        ::madvise(data, size, MADV_SEQUENTIAL);
+    }
+
+    ~Mapping() {
+        if (data != nullptr && data != MAP_FAILED) {
+            ::munmap(data, size);
+        }
+    }
+
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+
+    std::span<const std::byte> get_bytes() const { return {static_cast<const std::byte*>(data), size}; }
+
+
+  private:
+    void* data = nullptr;
+    std::size_t size = 0;
+};
+
+
+Header read_header(std::span<const std::byte> bytes) {
+    Header header;
+
+    if (bytes.size() < sizeof(header)) {
+        throw std::invalid_argument("Checkpoint file is truncated.");
+    }
+
+    std::memcpy(&header, bytes.data(), sizeof(header));
+
+    if (header.magic != magic) {
+        throw std::invalid_argument("Not a checkpoint file.");
+    }
+
+    if (header.version == 0 || header.version > version) {
+        throw std::invalid_argument("Unsupported checkpoint version.");
+    }
+
+    // BitBoard rows need room for a ghost cell either side.
+    if (header.width == 0 || header.height == 0 || header.width > std::numeric_limits<std::uint32_t>::max() - 2) {
+        throw std::invalid_argument("Checkpoint board size is invalid.");
+    }
+
+    if (header.topology >= topologies.size()) {
+        throw std::invalid_argument("Checkpoint topology is invalid.");
+    }
+
+    if (header.tile_rows != tile_rows || header.tile_words != tile_words) {
+        throw std::invalid_argument("Unsupported checkpoint tile size.");
+    }
+
+    return header;
+}
+
+
+// Checked like a parsed rule, a corrupt range or state count must not reach the engines.
+Rule get_rule(const Header& header) {
+    const Rule rule{
+          .birth = header.birth,
+          .survival = header.survival,
+          .states = header.states,
+          .range = header.range,
+          .include_centre = header.include_centre != 0,
+          .birth_counts = {header.birth_min, header.birth_max},
+          .survival_counts = {header.survival_min, header.survival_max},
+    };
+
+    rule.validate();
+    return rule;
+}
+
+
+// ORs the tile into the board, one bit to the left to make room for the ghost column.
+void draw_tile(BitBoard& board, const Grid& grid, std::size_t tile, const std::uint64_t* words, std::uint64_t tail_mask) {
+    const std::size_t y = grid.get_y(tile);
+    const std::size_t first = grid.get_word(tile);
+    const std::size_t rows = grid.get_rows(tile);
+    const std::size_t count = grid.get_words(tile);
+    const bool last = first + count == grid.words;
+
+    for (std::size_t r = 0; r < rows; ++r) {
+        std::uint64_t* row = board.row(y + r + 1) + first;
+        const std::uint64_t* from = words + r * count;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::uint64_t word = last && i + 1 == count ? from[i] & tail_mask : from[i];
+
+            row[i] |= word << 1;
+            row[i + 1] |= word >> 63;
+        }
+    }
+}
+
+} // namespace
+
+
+
+Snapshot take(const Simulation& simulation) {
+    Snapshot snapshot{
+          .res = simulation.get_resolution(),
+          .rule = simulation.params.rule,
+          .topology = simulation.params.topology,
+          .generation = simulation.get_generation(),
+          .bands = {},
+          .states = {},
+    };
+
+    if (snapshot.rule.states <= 2) {
+        snapshot.bands = simulation.get_bands();
+        return snapshot;
+    }
+
+    // The engines that run these rules read their bands back from the cells anyway, the board is read once.
+    snapshot.states.resize(std::size_t{snapshot.res.x} * snapshot.res.y);
+    simulation.get_cells(snapshot.states);
+
+    auto board = std::make_shared<BitBoard>(snapshot.res);
+    board->load_cells(snapshot.states);
+    snapshot.bands = {{0, std::move(board)}};
+
+    return snapshot;
+}
+
+
+void write(const std::filesystem::path& path, const Snapshot& snapshot, bool compress) {
+    check_snapshot(snapshot);
+
+    // Written aside and renamed over the old file, which survives a write that fails halfway.
+    auto partial = path;
+    partial += ".partial";
+
+    try {
+        write_file(partial, snapshot, compress);
+        std::filesystem::rename(partial, path);
+    } catch (const std::filesystem::filesystem_error&) {
+        std::error_code ignored;
+        std::filesystem::remove(partial, ignored);
+
+        throw std::runtime_error("Could not write the checkpoint file.");
+    } catch (...) {
+        std::error_code ignored;
+        std::filesystem::remove(partial, ignored);
+
+        throw;
+    }
+}
+
+
+Checkpoint load(const std::filesystem::path& path) {
+    const Mapping mapping{path};
+    const auto bytes = mapping.get_bytes();
+
+    const Header header = read_header(bytes);
+    const Grid grid{{header.width, header.height}};
+
+    const std::size_t entries = header.version == 1 ? grid.count : grid.get_entries(header.states);
+    const std::size_t index_end = sizeof(header) + entries * sizeof(std::uint64_t);
+
+    if (bytes.size() < index_end) {
+        throw std::invalid_argument("Checkpoint file is truncated.");
+    }
+
+    // The header is a whole number of words and mappings are page aligned, the index and tiles are read in place.
+    const auto* words = reinterpret_cast<const std::uint64_t*>(bytes.data());
+    const auto* index = words + sizeof(header) / sizeof(std::uint64_t);
+
+    auto board = std::make_shared<BitBoard>(grid.res);
+    const std::uint64_t tail_mask = get_tail_mask(grid.res);
+
+    for (std::size_t i = 0; i < grid.count; ++i) {
+        const std::uint64_t offset = index[i];
+
+        if (offset == 0) {
+            continue;
+        }
+
+        const std::size_t size = grid.get_rows(i) * grid.get_words(i) * sizeof(std::uint64_t);
+
+        if (offset % sizeof(std::uint64_t) != 0 || offset < index_end || offset > bytes.size() || bytes.size() - offset < size) {
+            throw std::invalid_argument("Checkpoint tile is out of bounds.");
+        }
+
+        draw_tile(*board, grid, i, words + offset / sizeof(std::uint64_t), tail_mask);
+    }
+
+    std::vector<std::uint8_t> states;
+
+    if (entries > grid.count && index[grid.count] != 0) {
+        const std::uint64_t offset = index[grid.count];
+
+        if (offset % sizeof(std::uint64_t) != 0 || offset < index_end || offset > bytes.size()
+              || bytes.size() - offset < grid.get_states_bytes()) {
+            throw std::invalid_argument("Checkpoint states are out of bounds.");
+        }
+
+        const auto* from = reinterpret_cast<const std::uint8_t*>(bytes.data() + offset);
+        states.assign(from, from + std::size_t{header.width} * header.height);
+    }
+
+    return {
+          .rule = get_rule(header),
+          .topology = static_cast<Topology>(header.topology),
+          .generation = header.generation,
+          .board = std::move(board),
+          .states = std::move(states),
+    };
+}
+
+
+void restore(Simulation& simulation, const std::filesystem::path& path) {
+    auto checkpoint = load(path);
+
+    const auto res = checkpoint.board->get_resolution();
+    const auto expected = simulation.get_resolution();
+
+    if (res.x != expected.x || res.y != expected.y) {
+        throw std::invalid_argument("Checkpoint does not match the board resolution.");
+    }
+
+    simulation.set_state(
+          std::move(checkpoint.board), checkpoint.rule, checkpoint.topology, checkpoint.generation, checkpoint.states);
+}
+
+
+
+Writer::Writer(): thread{[this] { work(); }} {}
+
+Writer::~Writer() {
+    {
+        std::scoped_lock lock{mutex};
+        stopping = true;
+    }
+
+    wake.notify_all();
+}
+
+
+void Writer::write(std::filesystem::path path, Snapshot snapshot, bool compress) {
+    {
+        std::scoped_lock lock{mutex};
+        jobs.push_back({std::move(path), std::move(snapshot), compress});
+    }
+
+    wake.notify_one();
+}
+
+
+void Writer::wait() {
+    std::unique_lock lock{mutex};
+    done.wait(lock, [this] { return jobs.empty() && !writing; });
+}
+
+bool Writer::is_busy() const {
+    std::scoped_lock lock{mutex};
+    return !jobs.empty() || writing;
+}
+
+std::optional<std::string> Writer::take_error() {
+    std::scoped_lock lock{mutex};
+    return std::exchange(error, std::nullopt);
+}
+
+
+void Writer::work() {
+    std::unique_lock lock{mutex};
+
+    while (true) {
+        wake.wait(lock, [this] { return !jobs.empty() || stopping; });
+
+        if (jobs.empty()) {
+            return;
+        }
+
+        auto job = std::move(jobs.front());
+        jobs.pop_front();
+        writing = true;
+
+        lock.unlock();
+
+        std::optional<std::string> failure;
+
+        try {
+            checkpoint::write(job.path, job.snapshot, job.compress);
+        } catch (const std::exception& e) {
+            failure = e.what();
+        }
+
+        // Let go of the boards before anyone waiting hears about it, so engines can step into them again.
+        job.snapshot.bands.clear();
+        job.snapshot.states = {};
+
+        lock.lock();
+
+        if (failure) {
+            error = std::move(failure);
+        }
+
+        writing = false;
+        done.notify_all();
+    }
+}
+
+
+} // namespace checkpoint
@@ -0,0 +1,133 @@
+#include "cpu_engine.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+
+
+
+CpuEngine::CpuEngine(Resolution res, Topology topology, const Rule& rule):
+      Engine{res},
+      topology{topology},
+      rule{rule},
+      border{rule.range},
+      stride{res.x + 2 * border},
+      front(stride * (res.y + 2 * border), 0),
+      back(stride * (res.y + 2 * border), 0),
+      column_counts(stride, 0) {
+
+    if (topology != Topology::DeadBorder && (border > res.x || border > res.y)) {
+        throw std::invalid_argument("The rule's range does not fit in the board to wrap around.");
+    }
+}
+
+
+void CpuEngine::step(std::uint64_t generations) {
+    const std::size_t window = 2 * border + 1;
+
+    for (std::uint64_t i = 0; i < generations; ++i) {
+        fill_halo();
+
+        std::fill(column_counts.begin(), column_counts.end(), 0);
+
+        for (std::size_t y = 0; y + 1 < window; ++y) {
+            add_row(y, 1);
+        }
+
+        for (std::size_t y = border; y < border + res.y; ++y) {
+            add_row(y + border, 1);
+
+            const std::uint8_t* row = &front[y * stride];
+            std::uint8_t* out = &back[y * stride];
+
+            // Box of the first cell, then slide it right one column at a time.
+            std::uint32_t count = 0;
+
+            for (std::size_t x = 0; x + 1 < window; ++x) {
+                count += column_counts[x];
+            }
+
+            for (std::size_t x = border; x < border + res.x; ++x) {
+                count += column_counts[x + border];
+
+                const std::uint8_t status = row[x];
+                const std::uint32_t centre = rule.include_centre || status != 1 ? 0 : 1;
+
+                out[x] = rule.next_state(status, count - centre);
+
+                count -= column_counts[x - border];
+            }
+
+            add_row(y - border, -1);
+        }
+
+        std::swap(front, back);
+    }
+}
+
+
+void CpuEngine::add_row(std::size_t y, int sign) {
+    const std::uint8_t* row = &front[y * stride];
+
+    for (std::size_t x = 0; x < stride; ++x) {
+        column_counts[x] += static_cast<std::uint32_t>(sign * (row[x] == 1 ? 1 : 0));
+    }
+}
+
+
+void CpuEngine::fill_halo() {
+    if (topology == Topology::DeadBorder) {
+        return;
+    }
+
+    const auto padding = static_cast<std::int64_t>(border);
+
+    auto fill = [&](std::int64_t x, std::int64_t y) {
+        const auto [source_x, source_y] = *wrap(topology, res, x, y);
+        front[(y + padding) * stride + x + padding] = front[(source_y + padding) * stride + source_x + padding];
+    };
+
+    for (std::int64_t d = 1; d <= padding; ++d) {
+        for (std::int64_t x = -padding; x < res.x + padding; ++x) {
+            fill(x, -d);
+            fill(x, res.y - 1 + d);
+        }
+
+        for (std::int64_t y = 0; y < res.y; ++y) {
+            fill(-d, y);
+            fill(res.x - 1 + d, y);
+        }
+    }
+}
+
+
+void CpuEngine::get_cells(std::span<std::uint8_t> cells) const {
+    if (cells.size() != std::size_t{res.x} * res.y) {
+        throw std::invalid_argument("Cell buffer does not match the board resolution.");
+    }
+
+    for (std::size_t y = 0; y < res.y; ++y) {
+        const auto* row = &front[(y + border) * stride + border];
+        std::copy(row, row + res.x, &cells[y * res.x]);
+    }
+}
+
+void CpuEngine::set_cells(std::span<const std::uint8_t> cells) {
+    if (cells.size() != std::size_t{res.x} * res.y) {
+        throw std::invalid_argument("Cell buffer does not match the board resolution.");
+    }
+
+    for (std::size_t y = 0; y < res.y; ++y) {
+        std::copy_n(&cells[y * res.x], res.x, &front[(y + border) * stride + border]);
+    }
+}
+
+
+std::uint64_t CpuEngine::get_hash() const {
+    return rule.states > 2 ? hash_cells() : Engine::get_hash();
+}
+
+std::uint64_t CpuEngine::get_memory_bytes() const {
+    return front.size() + back.size() + column_counts.size() * sizeof(std::uint32_t);
+}
@@ -0,0 +1,110 @@
+#include "cycle_detector.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+
+CycleDetector::CycleDetector(std::size_t capacity): capacity{capacity} {
+    if (capacity == 0) {
+        throw std::invalid_argument("Cycle detectors need room for at least one board.");
+    }
+}
+
+
+std::optional<CycleDetector::Cycle> CycleDetector::observe(const Simulation& simulation) {
+    return observe(simulation.get_generation(), simulation.get_hash());
+}
+
+std::optional<CycleDetector::Cycle> CycleDetector::observe(std::uint64_t generation, std::uint64_t hash) {
+    if (!order.empty()) {
+        const auto [last_hash, last_generation] = order.back();
+
+        // The same board shown twice, e.g. by frames that did not step.
+        if (generation == last_generation && hash == last_hash) {
+            return std::nullopt;
+        }
+
+        if (generation <= last_generation) {
+            clear();
+        }
+    }
+
+    std::optional<Cycle> cycle;
+
+    if (const auto found = seen.find(hash); found != seen.end()) {
+        cycle = Cycle{.since = found->second, .period = generation - found->second};
+    }
+
+    order.emplace_back(hash, generation);
+    seen.insert_or_assign(hash, generation);
+
+    if (order.size() > capacity) {
+        const auto [old_hash, old_generation] = order.front();
+        order.pop_front();
+
+        // Unless the hash was seen again since.
+        if (const auto found = seen.find(old_hash); found->second == old_generation) {
+            seen.erase(found);
+        }
+    }
+
+    return cycle;
+}
+
+
+std::optional<CycleDetector::Cycle> CycleDetector::run(Simulation& simulation, std::uint64_t generations, std::uint64_t interval) {
+    if (interval == 0) {
+        throw std::invalid_argument("Boards must be observed at least every so many generations.");
+    }
+
+    observe(simulation);
+
+    for (std::uint64_t done = 0; done < generations;) {
+        const std::uint64_t batch = std::min(interval, generations - done);
+
+        simulation.step(batch);
+        done += batch;
+
+        if (auto cycle = observe(simulation)) {
+            cycle->period = find_period(simulation, cycle->period);
+            return cycle;
+        }
+    }
+
+    return std::nullopt;
+}
+
+
+std::uint64_t CycleDetector::find_period(Simulation& simulation, std::uint64_t multiple) {
+    if (multiple == 0) {
+        throw std::invalid_argument("Periods are at least one generation.");
+    }
+
+    const std::uint64_t hash = simulation.get_hash();
+    std::uint64_t stepped = 0;
+
+    // The period divides `multiple`, only those generations can bring the board back.
+    for (std::uint64_t period = 1; period < multiple; ++period) {
+        if (multiple % period != 0) {
+            continue;
+        }
+
+        simulation.step(period - stepped);
+        stepped = period;
+
+        if (simulation.get_hash() == hash) {
+            return period;
+        }
+    }
+
+    simulation.step(multiple - stepped);
+
+    return multiple;
+}
+
+
+void CycleDetector::clear() {
+    order.clear();
+    seen.clear();
+}
@@ -0,0 +1,128 @@
+#include "density_pyramid.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <glad/gl.h>
+
+#include "gpu_trace.hpp"
+
+
+
+namespace {
+
+// Levels per pass and side of the blocks of shaders/density.comp.glsl.
+constexpr unsigned int pass_levels = 5;
+constexpr unsigned int block_size = 32;
+
+
+unsigned int get_levels(Resolution res) {
+    const unsigned int side = std::max(res.x, res.y);
+    unsigned int levels = 1;
+
+    while ((side + (1u << levels) - 1) >> levels > DensityPyramid::top_size) {
+        ++levels;
+    }
+
+    return levels;
+}
+
+Resolution pad(Resolution res, unsigned int levels) {
+    const unsigned int top = 1u << levels;
+
+    return {(res.x + top - 1) / top * top, (res.y + top - 1) / top * top};
+}
+
+// Blocks of the pass, each `size` cells on a side.
+glu::Texture::Resolution get_blocks(Resolution res, unsigned long long size) {
+    return {static_cast<unsigned int>((res.x + size - 1) / size), static_cast<unsigned int>((res.y + size - 1) / size)};
+}
+
+} // namespace
+
+
+
+DensityPyramid::DensityPyramid(Resolution res):
+      res{res},
+      padded{pad(res, get_levels(res))},
+      board_cs{glu::Shader::Type::Compute, "shaders/density.comp.glsl", "#define FROM_BOARD\n"},
+      level_cs{glu::Shader::Type::Compute, "shaders/density.comp.glsl"},
+      texture({padded.x / 2, padded.y / 2}, glu::Texture::InternalFormat::R8, get_levels(res)) {
+
+    if (res.x == 0 || res.y == 0) {
+        throw std::invalid_argument("Boards are at least one cell wide and high.");
+    }
+
+    board_pipeline.attach(board_cs);
+    level_pipeline.attach(level_cs);
+
+    const unsigned int passes = (texture.get_levels() + pass_levels - 1) / pass_levels;
+    unsigned long long size = block_size;
+
+    for (unsigned int pass = 0; pass < passes; ++pass, size *= block_size) {
+        flags.emplace_back(get_blocks(res, size), glu::Texture::InternalFormat::R8ui);
+        flags.back().clear();
+    }
+
+    // Blocks never reduced stay empty rather than undefined.
+    texture.clear();
+}
+
+
+void DensityPyramid::update(const glu::Texture& board, unsigned int border, const glu::Texture& dirty) {
+    reduce(board, border, dirty, stale);
+}
+
+void DensityPyramid::update(const glu::Texture& board, unsigned int border) {
+    reduce(board, border, flags.front(), true);
+}
+
+
+void DensityPyramid::reduce(const glu::Texture& board, unsigned int border, const glu::Texture& dirty, bool everything) {
+    const trace::GpuSpan span{"Density pyramid"};
+
+    board_cs.set_uniform("border", static_cast<int>(border));
+
+    const unsigned int levels = texture.get_levels();
+    unsigned long long size = block_size;
+
+    for (unsigned int pass = 0; pass * pass_levels < levels; ++pass, size *= block_size) {
+        const unsigned int first = pass * pass_levels;
+        const unsigned int count = std::min(pass_levels, levels - first);
+        const bool has_parent = first + count < levels;
+
+        const auto& cs = pass == 0 ? board_cs : level_cs;
+        const auto& pipeline = pass == 0 ? board_pipeline : level_pipeline;
+
+        cs.set_uniform("levels", static_cast<int>(count));
+        cs.set_uniform("has_parent", has_parent);
+        cs.set_uniform("everything", everything);
+
+        pipeline.activate();
+
+        if (pass == 0) {
+            board.bind_to_image_unit(0, glu::Texture::AccessType::Read);
+            dirty.bind_to_image_unit(1, glu::Texture::AccessType::ReadWrite);
+        } else {
+            texture.bind_to_image_unit(0, glu::Texture::AccessType::Read, first - 1);
+            flags[pass].bind_to_image_unit(1, glu::Texture::AccessType::ReadWrite);
+        }
+
+        if (has_parent) {
+            flags[pass + 1].bind_to_image_unit(2, glu::Texture::AccessType::Write);
+        }
+
+        for (unsigned int level = 0; level < count; ++level) {
+            texture.bind_to_image_unit(3 + level, glu::Texture::AccessType::Write, first + level);
+        }
+
+        const auto blocks = get_blocks(res, size);
+
+        glDispatchCompute(blocks.x, blocks.y, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        pipeline.deactivate();
+    }
+
+    stale = false;
+}
@@ -0,0 +1,433 @@
+#include "distributed_engine.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+
+// Written by the engine before it publishes the next sequence number, read by the workers after they see it.
+struct DistributedEngine::Control {
+    alignas(64) std::atomic<std::uint64_t> sequence;
+
+    Command command;
+    std::uint64_t generations;
+};
+
+// Written by a worker before it publishes the sequence number of the command it is done with.
+struct DistributedEngine::WorkerState {
+    alignas(64) std::atomic<std::uint64_t> done;
+
+    std::uint64_t generations;
+    std::uint64_t exchange_ns;
+    std::uint64_t step_ns;
+};
+
+
+
+namespace {
+
+unsigned int get_processes(Resolution res, unsigned int processes) {
+    if (processes == 0) {
+        processes = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    return std::clamp(processes, 1u, std::max(1u, res.y));
+}
+
+std::size_t get_words_per_row(Resolution res) {
+    return (std::size_t{res.x} + 2 + 63) / 64;
+}
+
+bool wraps_rows(Topology topology) {
+    return topology == Topology::Torus || topology == Topology::KleinBottle;
+}
+
+
+std::uint64_t get_ns(std::chrono::steady_clock::duration duration) {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
+
+} // namespace
+
+
+
+// Offsets into the shared memory, every part on cache lines of its own.
+struct DistributedEngine::Layout {
+    std::size_t states;
+    std::size_t board;
+    std::size_t rings;
+    std::size_t ring_bytes;
+    std::size_t size;
+};
+
+DistributedEngine::Layout DistributedEngine::get_layout(Resolution res, std::size_t processes, std::size_t boundaries) {
+    const std::size_t words = get_words_per_row(res);
+    const std::size_t board_bytes = std::size_t{res.y} * words * sizeof(std::uint64_t);
+
+    Layout layout{};
+
+    layout.states = sizeof(Control);
+    layout.board = layout.states + processes * sizeof(WorkerState);
+    layout.rings = layout.board + (board_bytes + 63) / 64 * 64;
+    layout.ring_bytes = ShmRing::get_bytes(words, ring_slots);
+    layout.size = layout.rings + 2 * boundaries * layout.ring_bytes;
+
+    return layout;
+}
+
+
+
+DistributedEngine::DistributedEngine(Resolution res, unsigned int processes, Topology topology, const Rule& rule, bit_kernel::Isa isa):
+      Engine{res},
+      topology{topology},
+      rule{rule},
+      words_per_row{get_words_per_row(res)},
+      boundaries{get_processes(res, processes) - (wraps_rows(topology) ? 0 : 1)},
+      memory{get_layout(res, get_processes(res, processes), boundaries).size} {
+
+    if (!rule.is_life_like()) {
+        throw std::invalid_argument("The multiprocess backend only runs two state, range 1 rules.");
+    }
+
+    if (topology == Topology::ProjectivePlane) {
+        throw std::invalid_argument("The multiprocess backend cannot wrap a projective plane.");
+    }
+
+    processes = get_processes(res, processes);
+
+    for (unsigned int i = 0; i < processes; ++i) {
+        const auto y = static_cast<unsigned int>(std::uint64_t{res.y} * i / processes);
+        const auto next = static_cast<unsigned int>(std::uint64_t{res.y} * (i + 1) / processes);
+
+        strips.push_back({y, next - y});
+    }
+
+    const auto layout = get_layout(res, processes, boundaries);
+    std::byte* data = memory.get_data();
+
+    control = new (data) Control{0, Command::Exit, 0};
+    states = reinterpret_cast<WorkerState*>(data + layout.states);
+    board = reinterpret_cast<std::uint64_t*>(data + layout.board);
+    rings = data + layout.rings;
+
+    for (std::size_t i = 0; i < processes; ++i) {
+        new (&states[i]) WorkerState{0, 0, 0, 0};
+    }
+
+    for (std::size_t i = 0; i < 2 * boundaries; ++i) {
+        ShmRing::create(rings + i * layout.ring_bytes, words_per_row, ring_slots);
+    }
+
+    start_workers(bit_kernel::select(rule, isa));
+}
+
+
+DistributedEngine::~DistributedEngine() {
+    if (!failed) {
+        try {
+            run(Command::Exit);
+        } catch (const std::runtime_error&) {
+        }
+    }
+
+    stop_workers();
+}
+
+
+void DistributedEngine::start_workers(const bit_kernel::Kernel& kernel) {
+    // Allocated before forking: a child of a process with other threads may only call async-signal-safe functions, so workers never
+    // allocate. The parent's copies are freed when this returns.
+    std::vector<BitBoard> fronts;
+    std::vector<BitBoard> backs;
+
+    fronts.reserve(strips.size());
+    backs.reserve(strips.size());
+
+    for (const auto& strip: strips) {
+        fronts.emplace_back(Resolution{res.x, strip.height});
+        backs.emplace_back(Resolution{res.x, strip.height});
+    }
+
+    BitBoard scratch{{res.x, 1}};
+    workers.reserve(strips.size());
+
+    for (std::size_t i = 0; i < strips.size(); ++i) {
+        worker_bytes += fronts[i].get_memory_bytes() + backs[i].get_memory_bytes() + scratch.get_memory_bytes();
+    }
+
+    for (std::size_t i = 0; i < strips.size(); ++i) {
+        const pid_t pid = fork();
+
+        if (pid == 0) {
+            work(i, fronts[i], backs[i], scratch, kernel);
+        }
+
+        if (pid < 0) {
+            failed = true;
+            stop_workers();
+
+            throw std::runtime_error("Could not start a worker process.");
+        }
+
+        workers.push_back(pid);
+    }
+}
+
+
+void DistributedEngine::work(std::size_t index, BitBoard& first, BitBoard& second, BitBoard& scratch, const bit_kernel::Kernel& kernel)
+      const {
+
+    using clock_t = std::chrono::steady_clock;
+
+    BitBoard* front = &first;
+    BitBoard* back = &second;
+
+    const auto& strip = strips[index];
+    auto& state = states[index];
+
+    const pid_t parent = getppid();
+
+    const bool wraps = wraps_rows(topology);
+    const bool mirrors = topology == Topology::KleinBottle;
+
+    // The channels to the strips above and below, if any, see get_ring().
+    const bool has_previous = wraps || index > 0;
+    const bool has_next = wraps || index + 1 < strips.size();
+
+    const std::size_t previous = (index + strips.size() - 1) % strips.size();
+
+    auto to_previous = get_ring(previous, false);
+    auto from_previous = get_ring(previous, true);
+    auto to_next = get_ring(index, true);
+    auto from_next = get_ring(index, false);
+
+    // Only the ghost rows wrap between workers, the ghost columns wrap on every worker's own rows.
+    const Topology columns = wraps ? Topology::Torus : Topology::DeadBorder;
+
+    const std::size_t words = words_per_row;
+    const std::size_t height = strip.height;
+
+    const auto receive = [&](HaloChannel& channel, std::size_t row, bool mirrored) {
+        if (!mirrored) {
+            channel.receive({front->row(row), words});
+            return;
+        }
+
+        channel.receive({scratch.row(1), words});
+        BitBoard::copy_row(scratch, 1, *front, row, true);
+    };
+
+    for (std::uint64_t seen = 0;;) {
+        for (unsigned int attempt = 0; control->sequence.load(std::memory_order_acquire) == seen; ++attempt) {
+            // Orphaned workers would otherwise wait forever.
+            if (attempt % 1024 == 1023 && getppid() != parent) {
+                _exit(1);
+            }
+
+            relax(attempt);
+        }
+
+        seen = control->sequence.load(std::memory_order_acquire);
+
+        switch (control->command) {
+            case Command::Load:
+                for (std::size_t y = 0; y < height; ++y) {
+                    std::copy_n(get_row(strip.y + y), words, front->row(y + 1));
+                }
+
+                break;
+
+            case Command::Store:
+                for (std::size_t y = 0; y < height; ++y) {
+                    std::uint64_t* out = get_row(strip.y + y);
+
+                    std::copy_n(front->row(y + 1), words, out);
+                    out[0] &= front->get_first_mask();
+                    out[words - 1] &= front->get_last_mask();
+                }
+
+                break;
+
+            case Command::Step:
+                for (std::uint64_t i = 0; i < control->generations; ++i) {
+                    const auto begin = clock_t::now();
+
+                    front->fill_halo(columns);
+
+                    if (has_previous) {
+                        to_previous.send({front->row(1), words});
+                    }
+
+                    if (has_next) {
+                        to_next.send({front->row(height), words});
+                    }
+
+                    if (has_previous) {
+                        receive(from_previous, 0, mirrors && index == 0);
+                    }
+
+                    if (has_next) {
+                        receive(from_next, height + 1, mirrors && index + 1 == strips.size());
+                    }
+
+                    const auto exchanged = clock_t::now();
+
+                    kernel(*front, *back, 1, height + 1, rule);
+                    std::swap(front, back);
+
+                    state.exchange_ns += get_ns(exchanged - begin);
+                    state.step_ns += get_ns(clock_t::now() - exchanged);
+                    ++state.generations;
+                }
+
+                break;
+
+            case Command::Exit:
+                state.done.store(seen, std::memory_order_release);
+                _exit(0);
+        }
+
+        state.done.store(seen, std::memory_order_release);
+    }
+}
+
+
+void DistributedEngine::run(Command command, std::uint64_t generations) const {
+    if (failed) {
+        throw std::runtime_error("A worker process exited.");
+    }
+
+    control->command = command;
+    control->generations = generations;
+    control->sequence.store(++sequence, std::memory_order_release);
+
+    const auto is_done = [&](std::size_t i) { return states[i].done.load(std::memory_order_acquire) == sequence; };
+
+    // A worker waiting on the rows of one that died would wait forever, so every worker that is not done is checked on. WNOWAIT leaves
+    // them to stop_workers() to reap.
+    const auto has_exited = [&](std::size_t i) {
+        siginfo_t info{};
+        return waitid(P_PID, static_cast<id_t>(workers[i]), &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid != 0 && !is_done(i);
+    };
+
+    for (std::size_t i = 0; i < workers.size(); ++i) {
+        for (unsigned int attempt = 0; !is_done(i); ++attempt) {
+            if (attempt % 64 == 63) {
+                for (std::size_t j = 0; j < workers.size(); ++j) {
+                    if (has_exited(j)) {
+                        failed = true;
+                        throw std::runtime_error("A worker process exited.");
+                    }
+                }
+            }
+
+            relax(attempt);
+        }
+    }
+}
+
+
+void DistributedEngine::stop_workers() noexcept {
+    for (const pid_t worker: workers) {
+        if (failed) {
+            kill(worker, SIGKILL);
+        }
+
+        waitpid(worker, nullptr, 0);
+    }
+
+    workers.clear();
+}
+
+
+std::uint64_t* DistributedEngine::get_row(std::size_t y) const {
+    return board + y * words_per_row;
+}
+
+// Forward rings carry the last row of the strip before the boundary down to the ghost row above the strip after it, backward rings the
+// first row of the strip after it up.
+ShmRing DistributedEngine::get_ring(std::size_t boundary, bool forward) const {
+    const std::size_t bytes = ShmRing::get_bytes(words_per_row, ring_slots);
+    return {rings + (2 * boundary + (forward ? 0 : 1)) * bytes, words_per_row, ring_slots};
+}
+
+
+void DistributedEngine::step(std::uint64_t generations) {
+    if (generations != 0) {
+        run(Command::Step, generations);
+    }
+}
+
+
+void DistributedEngine::get_cells(std::span<std::uint8_t> cells) const {
+    get_bands().front().board->store_cells(cells);
+}
+
+void DistributedEngine::set_cells(std::span<const std::uint8_t> cells) {
+    auto loaded = std::make_shared<BitBoard>(res);
+    loaded->load_cells(cells);
+
+    set_board(std::move(loaded));
+}
+
+
+std::vector<Engine::Band> DistributedEngine::get_bands() const {
+    run(Command::Store);
+
+    auto stored = std::make_shared<BitBoard>(res);
+
+    for (std::size_t y = 0; y < res.y; ++y) {
+        std::copy_n(get_row(y), words_per_row, stored->row(y + 1));
+    }
+
+    return {{0, std::move(stored)}};
+}
+
+void DistributedEngine::set_board(std::shared_ptr<BitBoard> loaded) {
+    const auto board_res = loaded->get_resolution();
+
+    if (board_res.x != res.x || board_res.y != res.y) {
+        throw std::invalid_argument("Board does not match the engine resolution.");
+    }
+
+    for (std::size_t y = 0; y < res.y; ++y) {
+        std::uint64_t* out = get_row(y);
+
+        std::copy_n(loaded->row(y + 1), words_per_row, out);
+        out[0] &= loaded->get_first_mask();
+        out[words_per_row - 1] &= loaded->get_last_mask();
+    }
+
+    run(Command::Load);
+}
+
+
+std::uint64_t DistributedEngine::get_memory_bytes() const {
+    return memory.get_size() + worker_bytes;
+}
+
+
+DistributedEngine::HaloStatistics DistributedEngine::get_halo_statistics() const {
+    HaloStatistics statistics;
+
+    // Read after the last command, which every worker is done with.
+    for (std::size_t i = 0; i < strips.size(); ++i) {
+        statistics.generations = states[i].generations;
+        statistics.exchange_seconds += static_cast<double>(states[i].exchange_ns) * 1e-9;
+        statistics.step_seconds += static_cast<double>(states[i].step_ns) * 1e-9;
+    }
+
+    statistics.exchange_seconds /= static_cast<double>(strips.size());
+    statistics.step_seconds /= static_cast<double>(strips.size());
+
+    return statistics;
+}
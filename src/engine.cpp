@@ -0,0 +1,111 @@
+#include "engine.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "bit_board.hpp"
+#include "randomizer.hpp"
+
+
+
+void Engine::randomize(std::uint64_t seed, float density) {
+    auto board = std::make_shared<BitBoard>(res);
+    randomizer::fill(*board, seed, density);
+
+    set_board(std::move(board));
+}
+
+
+std::uint64_t Engine::get_population() const {
+    std::vector<std::uint8_t> cells(std::size_t{res.x} * res.y);
+    get_cells(cells);
+
+    return static_cast<std::uint64_t>(std::count_if(cells.begin(), cells.end(), [](std::uint8_t cell) { return cell == 1; }));
+}
+
+std::optional<BoundingBox> Engine::get_bounding_box() const {
+    std::vector<std::uint8_t> cells(std::size_t{res.x} * res.y);
+    get_cells(cells);
+
+    std::optional<BoundingBox> box;
+
+    for (std::int64_t y = 0; y < res.y; ++y) {
+        for (std::int64_t x = 0; x < res.x; ++x) {
+            if (cells[y * res.x + x] == 0) {
+                continue;
+            }
+
+            if (!box) {
+                box = BoundingBox{x, y, x, y};
+            }
+
+            box->x_min = std::min(box->x_min, x);
+            box->x_max = std::max(box->x_max, x);
+            box->y_max = y;
+        }
+    }
+
+    return box;
+}
+
+
+Engine::Statistics Engine::get_statistics() const {
+    return {.population = get_population(), .bounding_box = get_bounding_box(), .changes = std::nullopt};
+}
+
+
+std::vector<Engine::Band> Engine::get_bands() const {
+    std::vector<std::uint8_t> cells(std::size_t{res.x} * res.y);
+    get_cells(cells);
+
+    auto board = std::make_shared<BitBoard>(res);
+    board->load_cells(cells);
+
+    return {{0, std::move(board)}};
+}
+
+void Engine::set_board(std::shared_ptr<BitBoard> board) {
+    const auto board_res = board->get_resolution();
+
+    if (board_res.x != res.x || board_res.y != res.y) {
+        throw std::invalid_argument("Board does not match the engine resolution.");
+    }
+
+    std::vector<std::uint8_t> cells(std::size_t{res.x} * res.y);
+    board->store_cells(cells);
+
+    set_cells(cells);
+}
+
+
+std::uint64_t Engine::get_hash() const {
+    std::uint64_t hash = 0;
+
+    for (const auto& band: get_bands()) {
+        hash += band.board->hash(band.y);
+    }
+
+    return hash;
+}
+
+std::uint64_t Engine::hash_cells() const {
+    std::vector<std::uint8_t> cells(std::size_t{res.x} * res.y);
+    get_cells(cells);
+
+    BitBoard board{res};
+    board.load_cells(cells);
+
+    // Positions of words are far below 2^63, the high bit keeps dying states from ever mixing with a word at the same position.
+    std::uint64_t hash = board.hash();
+
+    for (std::size_t i = 0; i < cells.size(); ++i) {
+        if (cells[i] > 1) {
+            hash += BitBoard::hash_word(cells[i], std::uint64_t{1} << 63 | i);
+        }
+    }
+
+    return hash;
+}
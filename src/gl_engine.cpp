@@ -0,0 +1,394 @@
+#include "gl_engine.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <glad/gl.h>
+
+#include "gpu_trace.hpp"
+#include "randomizer.hpp"
+
+
+
+namespace {
+
+// GLSL condition on `n` true for the counts set in `bits`, one range check per run of consecutive counts.
+std::string get_condition(std::uint16_t bits) {
+    std::string condition;
+
+    for (unsigned int count = 0; count <= 8; ++count) {
+        if ((bits >> count & 1) == 0) {
+            continue;
+        }
+
+        unsigned int last = count;
+
+        while (last < 8 && (bits >> (last + 1) & 1) != 0) {
+            ++last;
+        }
+
+        condition += condition.empty() ? "" : " || ";
+        condition += count == last ? "(n) == " + std::to_string(count) + "u"
+                                   : "((n) >= " + std::to_string(count) + "u && (n) <= " + std::to_string(last) + "u)";
+
+        count = last;
+    }
+
+    return condition.empty() ? "false" : condition;
+}
+
+std::string get_condition(const Rule::Interval& counts) {
+    return "(n) >= " + std::to_string(counts.min) + "u && (n) <= " + std::to_string(counts.max) + "u";
+}
+
+std::string get_rule_defines(const Rule& rule) {
+    const auto born = rule.range > 1 ? get_condition(rule.birth_counts) : get_condition(rule.birth);
+    const auto survives = rule.range > 1 ? get_condition(rule.survival_counts) : get_condition(rule.survival);
+
+    std::string defines = "#define BORN(n) (" + born + ")\n#define SURVIVES(n) (" + survives + ")\n";
+
+    defines += "#define BIRTH_MASK " + std::to_string(rule.birth) + "u\n#define SURVIVAL_MASK " + std::to_string(rule.survival) + "u\n";
+    defines += "#define STATES " + std::to_string(rule.states) + "u\n";
+    defines += "#define RANGE " + std::to_string(rule.range) + "\n";
+    defines += rule.include_centre ? "#define INCLUDE_CENTRE true\n" : "#define INCLUDE_CENTRE false\n";
+
+    return defines;
+}
+
+// Size of the board textures, with the ghost border around the board.
+glu::Texture::Resolution get_texture_size(Resolution res, unsigned int border) {
+    int max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+
+    if (std::int64_t{res.x} + 2 * border > max_size || std::int64_t{res.y} + 2 * border > max_size) {
+        throw std::invalid_argument("The board does not fit in a texture.");
+    }
+
+    return {res.x + 2 * border, res.y + 2 * border};
+}
+
+} // namespace
+
+
+GlEngine::GlEngine(Resolution res, Topology topology, const Rule& rule, unsigned int block_generations):
+      Engine{res},
+      topology{topology},
+      states{rule.states},
+      border{rule.range},
+      block_generations{rule.is_life_like() ? block_generations : 0},
+      cs{glu::Shader::Type::Compute, "shaders/shader.comp.glsl", get_rule_defines(rule)},
+      halo_cs{glu::Shader::Type::Compute, "shaders/halo.comp.glsl"},
+      table_cs{glu::Shader::Type::Compute, "shaders/sat.comp.glsl"},
+      blocked_cs{glu::Shader::Type::Compute, "shaders/blocked.comp.glsl", get_rule_defines(rule)},
+      random_cs{glu::Shader::Type::Compute, "shaders/random.comp.glsl"},
+      stats_cs{glu::Shader::Type::Compute, "shaders/stats.comp.glsl"},
+      stats_texture({statistics_texels, 1}, glu::Texture::InternalFormat::R32ui),
+      stats_ring({statistics_texels, 1}, glu::Texture::InternalFormat::R32ui, statistics_slots),
+      input_texture(get_texture_size(res, border), glu::Texture::InternalFormat::R8ui),
+      output_texture(input_texture.get_resolution(), glu::Texture::InternalFormat::R8ui),
+      dirty_texture({(res.x + dirty_tile_size - 1) / dirty_tile_size, (res.y + dirty_tile_size - 1) / dirty_tile_size},
+            glu::Texture::InternalFormat::R8ui) {
+
+    if (topology != Topology::DeadBorder && (border > res.x || border > res.y)) {
+        throw std::invalid_argument("The rule's range does not fit in the board to wrap around.");
+    }
+
+    if (2 * block_generations >= block_size) {
+        throw std::invalid_argument("Blocks cannot advance that many generations per dispatch.");
+    }
+
+    pipeline.attach(cs);
+    halo_pipeline.attach(halo_cs);
+    table_pipeline.attach(table_cs);
+    blocked_pipeline.attach(blocked_cs);
+    random_pipeline.attach(random_cs);
+    stats_pipeline.attach(stats_cs);
+
+    halo_cs.set_uniform("topology", static_cast<int>(topology));
+    halo_cs.set_uniform("border", static_cast<int>(border));
+
+    blocked_cs.set_uniform("topology", static_cast<int>(topology));
+    blocked_cs.set_uniform("border", static_cast<int>(border));
+
+    random_cs.set_uniform("border", static_cast<int>(border));
+    random_cs.set_uniform("width", static_cast<int>(res.x));
+    random_cs.set_uniform("height", static_cast<int>(res.y));
+
+    stats_cs.set_uniform("border", static_cast<int>(border));
+
+    if (border > 1) {
+        const auto size = input_texture.get_resolution();
+        const unsigned int longest = std::max(size.x, size.y);
+
+        if (longest > table_run_size * table_run_size) {
+            throw std::invalid_argument("The board is too large for the summed-area table.");
+        }
+
+        table.emplace(size, glu::Texture::InternalFormat::R32ui);
+        table_totals.emplace(glu::Texture::Resolution{(longest + table_run_size - 1) / table_run_size, longest},
+              glu::Texture::InternalFormat::R32ui);
+    }
+
+    // The ghost border stays zero for a dead border.
+    input_texture.clear();
+    output_texture.clear();
+    dirty_texture.fill<std::uint8_t>(1);
+}
+
+
+void GlEngine::step(std::uint64_t generations) {
+    const trace::GpuSpan span{"Compute"};
+
+    if (block_generations == 0) {
+        for (std::uint64_t i = 0; i < generations; ++i) {
+            step_once();
+        }
+
+        return;
+    }
+
+    // Cells past the board come from wrap() at load time, which only stays exact over several generations when the universe is a
+    // quotient of the plane. The projective plane is not, and a block cannot reach further than a board away.
+    std::uint64_t per_dispatch = topology == Topology::ProjectivePlane ? 1 : block_generations;
+    per_dispatch = std::min<std::uint64_t>({per_dispatch, res.x, res.y});
+
+    blocked_pipeline.activate();
+
+    for (std::uint64_t done = 0; done < generations;) {
+        const auto count = static_cast<unsigned int>(std::min(per_dispatch, generations - done));
+        const unsigned int tile = block_size - 2 * count;
+
+        blocked_cs.set_uniform("generations", static_cast<int>(count));
+
+        input_texture.bind_to_image_unit(0, glu::Texture::AccessType::Read);
+        output_texture.bind_to_image_unit(1, glu::Texture::AccessType::Write);
+        dirty_texture.bind_to_image_unit(2, glu::Texture::AccessType::Write);
+
+        glDispatchCompute((res.x + tile - 1) / tile, (res.y + tile - 1) / tile, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        std::swap(input_texture, output_texture);
+        done += count;
+
+        last_dispatch_generations = count;
+    }
+
+    blocked_pipeline.deactivate();
+}
+
+void GlEngine::finish() const {
+    glFinish();
+}
+
+
+void GlEngine::step_once() {
+    const unsigned int width = res.x + 2 * border;
+    const unsigned int height = res.y + 2 * border;
+    const unsigned int ghost_cells = width * height - res.x * res.y;
+
+    if (topology != Topology::DeadBorder) {
+        halo_pipeline.activate();
+
+        input_texture.bind_to_image_unit(0, glu::Texture::AccessType::ReadWrite);
+        glDispatchCompute((ghost_cells + 63) / 64, 1, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        halo_pipeline.deactivate();
+    }
+
+    if (table) {
+        table_pipeline.activate();
+
+        input_texture.bind_to_image_unit(0, glu::Texture::AccessType::Read);
+        table->bind_to_image_unit(1, glu::Texture::AccessType::ReadWrite);
+
+        table_totals->bind_to_image_unit(2, glu::Texture::AccessType::ReadWrite);
+
+        // Rows, then columns, see shaders/sat.comp.glsl.
+        for (const auto [axis, length, lines]: {std::array{0u, width, height}, std::array{1u, height, width}}) {
+            const unsigned int runs = (length + table_run_size - 1) / table_run_size;
+
+            table_cs.set_uniform("axis", static_cast<int>(axis));
+
+            for (unsigned int pass = 0; pass < (runs > 1 ? 3 : 1); ++pass) {
+                table_cs.set_uniform("pass", static_cast<int>(pass));
+
+                glDispatchCompute(pass == 0 ? runs : pass == 1 ? 1 : runs - 1, (lines + table_lines - 1) / table_lines, 1);
+                glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            }
+        }
+
+        table_pipeline.deactivate();
+
+        table->bind_to_image_unit(2, glu::Texture::AccessType::Read);
+    }
+
+    pipeline.activate();
+
+    input_texture.bind_to_image_unit(0, glu::Texture::AccessType::Read);
+    output_texture.bind_to_image_unit(1, glu::Texture::AccessType::Write);
+    dirty_texture.bind_to_image_unit(3, glu::Texture::AccessType::Write);
+
+    glDispatchCompute((res.x + dirty_tile_size - 1) / dirty_tile_size, (res.y + dirty_tile_size - 1) / dirty_tile_size, 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    pipeline.deactivate();
+
+    // Swap input and output textures...
+    std::swap(input_texture, output_texture);
+
+    last_dispatch_generations = 1;
+}
+
+
+void GlEngine::get_cells(std::span<std::uint8_t> cells) const {
+    if (cells.size() != std::size_t{res.x} * res.y) {
+        throw std::invalid_argument("Cell buffer does not match the board resolution.");
+    }
+
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    input_texture.get_sub_image(cells, static_cast<int>(border), static_cast<int>(border), {res.x, res.y});
+}
+
+void GlEngine::set_cells(std::span<const std::uint8_t> cells) {
+    if (cells.size() != std::size_t{res.x} * res.y) {
+        throw std::invalid_argument("Cell buffer does not match the board resolution.");
+    }
+
+    input_texture.set_sub_image(cells, static_cast<int>(border), static_cast<int>(border), {res.x, res.y});
+    dirty_texture.fill<std::uint8_t>(1);
+
+    last_dispatch_generations = 0;
+}
+
+
+void GlEngine::randomize(std::uint64_t seed, float density) {
+    random_cs.set_uniform("seed_low", static_cast<unsigned int>(seed));
+    random_cs.set_uniform("seed_high", static_cast<unsigned int>(seed >> 32));
+    random_cs.set_uniform("threshold", randomizer::get_threshold(density));
+
+    random_pipeline.activate();
+    input_texture.bind_to_image_unit(0, glu::Texture::AccessType::Write);
+
+    // Workgroups of 16 x 16 invocations drawing 4 cells each along a row.
+    glDispatchCompute((res.x + 63) / 64, (res.y + 15) / 16, 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+    random_pipeline.deactivate();
+
+    dirty_texture.fill<std::uint8_t>(1);
+    last_dispatch_generations = 0;
+}
+
+
+std::uint64_t GlEngine::get_population() const {
+    return get_statistics().population;
+}
+
+std::optional<BoundingBox> GlEngine::get_bounding_box() const {
+    return get_statistics().bounding_box;
+}
+
+
+Engine::Statistics GlEngine::get_statistics() const {
+    reduce_statistics();
+
+    std::array<std::uint32_t, statistics_texels> texels{};
+
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    stats_texture.get_sub_image<std::uint32_t>(texels, 0, 0, {statistics_texels, 1});
+
+    return decode_statistics(texels);
+}
+
+
+bool GlEngine::request_statistics(std::uint64_t tag) const {
+    if (stats_ring.get_pending() == statistics_slots) {
+        return false;
+    }
+
+    reduce_statistics();
+
+    return stats_ring.request(stats_texture, 0, 0, tag);
+}
+
+std::optional<GlEngine::TaggedStatistics> GlEngine::poll_statistics() const {
+    std::optional<TaggedStatistics> latest;
+
+    while (const auto frame = stats_ring.poll()) {
+        std::array<std::uint32_t, statistics_texels> texels;
+        std::memcpy(texels.data(), frame->data.data(), sizeof(texels));
+
+        latest = TaggedStatistics{frame->tag, decode_statistics(texels)};
+    }
+
+    return latest;
+}
+
+
+void GlEngine::reduce_statistics() const {
+    const bool changes = last_dispatch_generations == 1;
+
+    // Population, births and deaths as 64-bit halves, x_min, y_min, x_end, y_end and whether there are changes, see
+    // shaders/stats.comp.glsl.
+    const std::array<std::uint32_t, statistics_texels> texels{0, 0, 0, 0, 0, 0, 0xffffffff, 0xffffffff, 0, 0, changes};
+
+    stats_texture.set_sub_image<std::uint32_t>(texels, 0, 0, {statistics_texels, 1});
+    stats_cs.set_uniform("changes", changes);
+
+    stats_pipeline.activate();
+
+    input_texture.bind_to_image_unit(0, glu::Texture::AccessType::Read);
+    output_texture.bind_to_image_unit(1, glu::Texture::AccessType::Read);
+    stats_texture.bind_to_image_unit(2, glu::Texture::AccessType::ReadWrite);
+
+    // Workgroups of 16 x 16 invocations reading 64 cells each along a row.
+    glDispatchCompute((res.x + 1023) / 1024, (res.y + 15) / 16, 1);
+
+    stats_pipeline.deactivate();
+}
+
+
+Engine::Statistics GlEngine::decode_statistics(std::span<const std::uint32_t> texels) {
+    const auto get_count = [&](std::size_t index) { return std::uint64_t{texels[index + 1]} << 32 | texels[index]; };
+
+    Statistics statistics;
+    statistics.population = get_count(0);
+
+    if (texels[8] != 0) {
+        statistics.bounding_box = BoundingBox{texels[6], texels[7], std::int64_t{texels[8]} - 1, std::int64_t{texels[9]} - 1};
+    }
+
+    if (texels[10] != 0) {
+        statistics.changes = Statistics::Changes{get_count(2), get_count(4)};
+    }
+
+    return statistics;
+}
+
+
+std::uint64_t GlEngine::get_hash() const {
+    return states > 2 ? hash_cells() : Engine::get_hash();
+}
+
+
+std::uint64_t GlEngine::get_memory_bytes() const {
+    const auto get_texels = [](const glu::Texture& texture) {
+        return std::uint64_t{texture.get_resolution().x} * texture.get_resolution().y;
+    };
+
+    // Board and dirty textures are a byte per texel, the summed-area table four.
+    std::uint64_t bytes = get_texels(input_texture) + get_texels(output_texture) + get_texels(dirty_texture);
+
+    if (table) {
+        bytes += 4 * (get_texels(*table) + get_texels(*table_totals));
+    }
+
+    return bytes + statistics_texels * sizeof(std::uint32_t) * (1 + statistics_slots);
+}
@@ -0,0 +1,80 @@
+#include "gl_soup_batch.hpp"
+
+#include <algorithm>
+#include <array>
+
+#include <glad/gl.h>
+
+
+
+namespace soup {
+
+
+GlSoupBatch::GlSoupBatch(const Rule& rule, unsigned int layers):
+      Batch{rule},
+      cs{glu::Shader::Type::Compute, "shaders/soup.comp.glsl"},
+      boards{{board_size, board_size}, layers, glu::Texture::InternalFormat::R8ui},
+      cells(std::size_t{board_size} * board_size * layers) {
+
+    pipeline.attach(cs);
+
+    cs.set_uniform("birth_mask", static_cast<unsigned int>(rule.birth));
+    cs.set_uniform("survival_mask", static_cast<unsigned int>(rule.survival));
+
+    boards.clear();
+}
+
+
+void GlSoupBatch::set_board(std::size_t index, const Board& board) {
+    std::array<std::uint8_t, board_size * board_size> layer;
+
+    for (std::size_t y = 0; y < board_size; ++y) {
+        for (std::size_t x = 0; x < board_size; ++x) {
+            layer[y * board_size + x] = static_cast<std::uint8_t>(board[y] >> x & 1);
+        }
+    }
+
+    boards.set_layer<std::uint8_t>(layer, static_cast<unsigned int>(index));
+}
+
+void GlSoupBatch::get_boards(std::span<Board> out) const {
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    boards.get_image<std::uint8_t>(cells);
+
+    const auto* cell = cells.data();
+
+    for (std::size_t index = 0; index < std::min(get_size(), out.size()); ++index) {
+        for (auto& row: out[index]) {
+            row = 0;
+
+            for (std::size_t x = 0; x < board_size; ++x) {
+                row |= std::uint64_t{*cell++} << x;
+            }
+        }
+    }
+}
+
+
+void GlSoupBatch::step(std::uint64_t generations) {
+    pipeline.activate();
+    boards.bind_to_image_unit(0, glu::Texture::AccessType::ReadWrite);
+
+    // A board only needs its own workgroup, long steps are split so one dispatch cannot hold the GPU for too long.
+    constexpr std::uint64_t per_dispatch = 1024;
+
+    for (std::uint64_t done = 0; done < generations;) {
+        const std::uint64_t count = std::min(per_dispatch, generations - done);
+
+        cs.set_uniform("generations", static_cast<int>(count));
+
+        glDispatchCompute(boards.get_layers(), 1, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        done += count;
+    }
+
+    pipeline.deactivate();
+}
+
+
+} // namespace soup
@@ -0,0 +1,107 @@
+#include "gpu_trace.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <glad/gl.h>
+
+
+
+namespace trace {
+
+
+namespace {
+
+// Queries are created in batches and reused once read.
+constexpr int query_batch = 64;
+
+struct Pending {
+    std::string_view name;
+
+    unsigned int begin;
+    unsigned int end;
+};
+
+std::vector<unsigned int> free_queries;
+std::deque<Pending> pending;
+
+
+unsigned int acquire_query() {
+    if (free_queries.empty()) {
+        free_queries.resize(query_batch);
+        glGenQueries(query_batch, free_queries.data());
+    }
+
+    const unsigned int query = free_queries.back();
+    free_queries.pop_back();
+
+    return query;
+}
+
+std::uint64_t get_result(unsigned int query) {
+    GLuint64 result = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &result);
+
+    return result;
+}
+
+} // namespace
+
+
+
+GpuSpan::GpuSpan(std::string_view name): name{name} {
+    if (is_enabled() && pending.size() < max_pending_gpu) {
+        begin = acquire_query();
+        glQueryCounter(begin, GL_TIMESTAMP);
+    }
+}
+
+GpuSpan::~GpuSpan() {
+    if (begin != 0) {
+        const unsigned int end = acquire_query();
+        glQueryCounter(end, GL_TIMESTAMP);
+
+        pending.push_back({name, begin, end});
+    }
+}
+
+
+void collect_gpu() {
+    if (pending.empty()) {
+        return;
+    }
+
+    GLint64 gpu_now = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+
+    const auto offset = static_cast<std::int64_t>(now()) - gpu_now;
+
+    // Queries land in the order they were issued.
+    while (!pending.empty()) {
+        const auto span = pending.front();
+
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(span.end, GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (available == GL_FALSE) {
+            break;
+        }
+
+        const auto begin = get_result(span.begin);
+        const auto end = get_result(span.end);
+
+        record({.name = span.name,
+              .begin = static_cast<std::uint64_t>(std::max<std::int64_t>(static_cast<std::int64_t>(begin) + offset, 0)),
+              .duration = end - begin,
+              .track = gpu_track});
+
+        free_queries.push_back(span.begin);
+        free_queries.push_back(span.end);
+        pending.pop_front();
+    }
+}
+
+
+} // namespace trace
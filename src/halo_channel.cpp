@@ -0,0 +1,121 @@
+#include "halo_channel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+
+namespace {
+
+constexpr std::size_t cache_line = 64;
+
+
+std::size_t round_up(std::size_t bytes) {
+    return (bytes + cache_line - 1) / cache_line * cache_line;
+}
+
+} // namespace
+
+
+
+void relax(unsigned int attempt) {
+    if (attempt < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    } else if (attempt < 128) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds{attempt < 512 ? 50 : 500});
+    }
+}
+
+
+
+SharedMemory::SharedMemory(std::size_t bytes): size{round_up(std::max<std::size_t>(bytes, 1))} {
+    static std::atomic<unsigned int> next{0};
+
+    const std::string name = "/slime-" + std::to_string(getpid()) + "-" + std::to_string(next.fetch_add(1));
+    const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+
+    if (fd < 0) {
+        throw std::runtime_error("Could not create shared memory.");
+    }
+
+    shm_unlink(name.c_str());
+
+    void* mapped = MAP_FAILED;
+
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+        mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+
+    close(fd);
+
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Could not map shared memory.");
+    }
+
+    data = static_cast<std::byte*>(mapped);
+}
+
+SharedMemory::~SharedMemory() {
+    munmap(data, size);
+}
+
+
+
+// Head and tail count the rows sent and received, on cache lines of their own so the two sides do not contend for one.
+struct ShmRing::Header {
+    alignas(cache_line) std::atomic<std::uint64_t> head;
+    alignas(cache_line) std::atomic<std::uint64_t> tail;
+};
+
+
+std::size_t ShmRing::get_bytes(std::size_t row_words, std::size_t slots) {
+    return sizeof(Header) + round_up(row_words * slots * sizeof(std::uint64_t));
+}
+
+void ShmRing::create(std::byte* memory, std::size_t row_words, std::size_t slots) {
+    new (memory) Header{0, 0};
+    std::fill_n(reinterpret_cast<std::uint64_t*>(memory + sizeof(Header)), row_words * slots, 0);
+}
+
+
+ShmRing::ShmRing(std::byte* memory, std::size_t row_words, std::size_t slots):
+      header{std::launder(reinterpret_cast<Header*>(memory))},
+      rows{reinterpret_cast<std::uint64_t*>(memory + sizeof(Header))},
+      row_words{row_words},
+      slots{slots} {}
+
+
+void ShmRing::send(std::span<const std::uint64_t> row) {
+    // Only this side writes the head.
+    const std::uint64_t head = header->head.load(std::memory_order_relaxed);
+
+    for (unsigned int attempt = 0; head - header->tail.load(std::memory_order_acquire) >= slots; ++attempt) {
+        relax(attempt);
+    }
+
+    std::copy_n(row.begin(), std::min(row.size(), row_words), rows + head % slots * row_words);
+    header->head.store(head + 1, std::memory_order_release);
+}
+
+void ShmRing::receive(std::span<std::uint64_t> row) {
+    const std::uint64_t tail = header->tail.load(std::memory_order_relaxed);
+
+    for (unsigned int attempt = 0; header->head.load(std::memory_order_acquire) == tail; ++attempt) {
+        relax(attempt);
+    }
+
+    std::copy_n(rows + tail % slots * row_words, std::min(row.size(), row_words), row.begin());
+    header->tail.store(tail + 1, std::memory_order_release);
+}
@@ -0,0 +1,580 @@
+#include "hashlife_engine.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "bit_kernel.hpp"
+
+
+
+struct HashLifeEngine::Node {
+    // nw, ne, sw, se, null for leaves
+    std::array<Node*, 4> children;
+
+    Node* result;
+    int result_step;
+
+    // Hash chain while alive, free list once collected.
+    Node* next;
+
+    // 8x8 cells of a leaf, bit y * 8 + x.
+    std::uint64_t bits;
+    std::uint64_t population;
+
+    unsigned int level;
+    bool marked;
+};
+
+
+namespace {
+
+constexpr unsigned int leaf_level = 3;
+constexpr std::size_t block_size = std::size_t{1} << 16;
+
+// Past this the coordinates no longer fit an std::int64_t.
+constexpr unsigned int max_level = 60;
+
+
+std::size_t mix(std::uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+
+    return static_cast<std::size_t>(h);
+}
+
+std::size_t hash_leaf(std::uint64_t bits) {
+    return mix(bits);
+}
+
+std::size_t hash_children(const void* nw, const void* ne, const void* sw, const void* se) {
+    std::uint64_t h = reinterpret_cast<std::uintptr_t>(nw);
+    h = h * 0x9e3779b97f4a7c15ULL + reinterpret_cast<std::uintptr_t>(ne);
+    h = h * 0x9e3779b97f4a7c15ULL + reinterpret_cast<std::uintptr_t>(sw);
+    h = h * 0x9e3779b97f4a7c15ULL + reinterpret_cast<std::uintptr_t>(se);
+
+    return mix(h);
+}
+
+
+std::uint32_t leaf_row(std::uint64_t bits, unsigned int y) {
+    return static_cast<std::uint32_t>((bits >> (8 * y)) & 0xff);
+}
+
+// The 16x16 cells below a level 4 node, one row per element.
+std::array<std::uint32_t, 16> assemble(std::uint64_t nw, std::uint64_t ne, std::uint64_t sw, std::uint64_t se) {
+    std::array<std::uint32_t, 16> rows{};
+
+    for (unsigned int y = 0; y < 8; ++y) {
+        rows[y] = leaf_row(nw, y) | (leaf_row(ne, y) << 8);
+        rows[y + 8] = leaf_row(sw, y) | (leaf_row(se, y) << 8);
+    }
+
+    return rows;
+}
+
+std::uint64_t centre_of(const std::array<std::uint32_t, 16>& rows) {
+    std::uint64_t bits = 0;
+
+    for (unsigned int y = 0; y < 8; ++y) {
+        bits |= std::uint64_t{(rows[y + 4] >> 4) & 0xff} << (8 * y);
+    }
+
+    return bits;
+}
+
+} // namespace
+
+
+
+HashLifeEngine::HashLifeEngine(Resolution res, const Rule& rule, std::size_t node_limit):
+      Engine{res}, rule{rule}, node_limit{node_limit}, buckets(1024, nullptr) {
+
+    if (!rule.is_life_like() || (rule.birth & 1) != 0) {
+        throw std::invalid_argument("HashLife only runs Life-like rules without B0.");
+    }
+
+    const std::vector<std::uint8_t> cells(std::size_t{res.x} * res.y, 0);
+    set_cells(cells);
+}
+
+HashLifeEngine::~HashLifeEngine() = default;
+
+
+void HashLifeEngine::step(std::uint64_t generations) {
+    for (unsigned int exponent = 0; generations != 0; ++exponent, generations >>= 1) {
+        if ((generations & 1) != 0) {
+            step_pow2(exponent);
+        }
+    }
+}
+
+
+void HashLifeEngine::step_pow2(unsigned int exponent) {
+    if (exponent + 3 > max_level) {
+        throw std::invalid_argument("HashLife step is too large.");
+    }
+
+    step_exponent = exponent;
+
+    // Pad until the pattern sits in the centre quarter of a root big enough for the jump, then once more so it cannot outrun the result.
+    while (root->level < exponent + 2 || !is_centred(root)) {
+        root = expand(root);
+    }
+
+    root = advance(expand(root));
+
+    while (root->level > leaf_level + 1 && is_centred(root)) {
+        root = centre(root);
+    }
+
+    if (node_count > node_limit) {
+        collect();
+    }
+}
+
+
+void HashLifeEngine::get_cells(std::span<std::uint8_t> cells) const {
+    if (cells.size() != std::size_t{res.x} * res.y) {
+        throw std::invalid_argument("Cell buffer does not match the board resolution.");
+    }
+
+    std::fill(cells.begin(), cells.end(), 0);
+    draw(root, get_origin(), get_origin(), cells);
+}
+
+void HashLifeEngine::set_cells(std::span<const std::uint8_t> cells) {
+    if (cells.size() != std::size_t{res.x} * res.y) {
+        throw std::invalid_argument("Cell buffer does not match the board resolution.");
+    }
+
+    // The board goes in the south east quadrant, so the root is twice as large as the board.
+    unsigned int level = leaf_level;
+
+    while ((std::int64_t{1} << level) < std::max<std::int64_t>(res.x, res.y)) {
+        ++level;
+    }
+
+    const auto quadrant = empty(level);
+    root = join(quadrant, quadrant, quadrant, build(cells, level, 0, 0));
+
+    collect();
+}
+
+
+std::uint64_t HashLifeEngine::get_population() const {
+    return root->population;
+}
+
+std::optional<BoundingBox> HashLifeEngine::get_bounding_box() const {
+    if (root->population == 0) {
+        return std::nullopt;
+    }
+
+    const std::int64_t origin = get_origin();
+    const std::int64_t last = origin + (std::int64_t{1} << root->level) - 1;
+
+    std::unordered_map<const Node*, std::int64_t> memo;
+
+    const auto west = distance(root, Side::West, memo);
+    memo.clear();
+    const auto east = distance(root, Side::East, memo);
+    memo.clear();
+    const auto north = distance(root, Side::North, memo);
+    memo.clear();
+    const auto south = distance(root, Side::South, memo);
+
+    return BoundingBox{origin + west, origin + north, last - east, last - south};
+}
+
+
+
+HashLifeEngine::Node* HashLifeEngine::leaf(std::uint64_t bits) {
+    const std::size_t hash = hash_leaf(bits);
+
+    for (Node* node = buckets[hash & (buckets.size() - 1)]; node != nullptr; node = node->next) {
+        if (node->level == leaf_level && node->bits == bits) {
+            return node;
+        }
+    }
+
+    Node* node = allocate();
+
+    node->bits = bits;
+    node->population = static_cast<std::uint64_t>(std::popcount(bits));
+    node->level = leaf_level;
+
+    return insert(node, hash);
+}
+
+HashLifeEngine::Node* HashLifeEngine::join(Node* nw, Node* ne, Node* sw, Node* se) {
+    const std::size_t hash = hash_children(nw, ne, sw, se);
+
+    for (Node* node = buckets[hash & (buckets.size() - 1)]; node != nullptr; node = node->next) {
+        if (node->children == std::array{nw, ne, sw, se}) {
+            return node;
+        }
+    }
+
+    Node* node = allocate();
+
+    node->children = {nw, ne, sw, se};
+    node->population = nw->population + ne->population + sw->population + se->population;
+    node->level = nw->level + 1;
+
+    return insert(node, hash);
+}
+
+HashLifeEngine::Node* HashLifeEngine::empty(unsigned int level) {
+    while (empties.size() <= level) {
+        const auto size = static_cast<unsigned int>(empties.size());
+
+        if (size < leaf_level) {
+            empties.push_back(nullptr);
+        } else if (size == leaf_level) {
+            empties.push_back(leaf(0));
+        } else {
+            Node* quadrant = empties.back();
+            empties.push_back(join(quadrant, quadrant, quadrant, quadrant));
+        }
+    }
+
+    return empties[level];
+}
+
+
+HashLifeEngine::Node* HashLifeEngine::centre(Node* node) {
+    const auto& [nw, ne, sw, se] = node->children;
+
+    if (node->level == leaf_level + 1) {
+        return leaf(centre_of(assemble(nw->bits, ne->bits, sw->bits, se->bits)));
+    }
+
+    return join(nw->children[3], ne->children[2], sw->children[1], se->children[0]);
+}
+
+HashLifeEngine::Node* HashLifeEngine::expand(Node* node) {
+    const auto& [nw, ne, sw, se] = node->children;
+
+    Node* border = empty(node->level - 1);
+
+    return join(join(border, border, border, nw), join(border, border, ne, border), join(border, sw, border, border),
+          join(se, border, border, border));
+}
+
+
+HashLifeEngine::Node* HashLifeEngine::advance(Node* node) {
+    if (node->population == 0) {
+        return empty(node->level - 1);
+    }
+
+    const int step = static_cast<int>(std::min(step_exponent, node->level - 2));
+
+    if (node->result != nullptr && node->result_step == step) {
+        return node->result;
+    }
+
+    Node* result = nullptr;
+
+    if (node->level == leaf_level + 1) {
+        result = advance_leaves(node);
+    } else {
+        const auto& [nw, ne, sw, se] = node->children;
+
+        // The nine overlapping subnodes of half the size...
+        std::array<Node*, 9> parts{
+              nw,
+              join(nw->children[1], ne->children[0], nw->children[3], ne->children[2]),
+              ne,
+              join(nw->children[2], nw->children[3], sw->children[0], sw->children[1]),
+              centre(node),
+              join(ne->children[2], ne->children[3], se->children[0], se->children[1]),
+              sw,
+              join(sw->children[1], se->children[0], sw->children[3], se->children[2]),
+              se,
+        };
+
+        // ...advanced by the first half of the step when running at full speed, only re-centred otherwise...
+        const bool full_speed = step == static_cast<int>(node->level) - 2;
+
+        for (auto& part: parts) {
+            part = full_speed ? advance(part) : centre(part);
+        }
+
+        // ...and regrouped into four quadrants that advance by the rest.
+        result = join(advance(join(parts[0], parts[1], parts[3], parts[4])), advance(join(parts[1], parts[2], parts[4], parts[5])),
+              advance(join(parts[3], parts[4], parts[6], parts[7])), advance(join(parts[4], parts[5], parts[7], parts[8])));
+    }
+
+    node->result = result;
+    node->result_step = step;
+
+    return result;
+}
+
+HashLifeEngine::Node* HashLifeEngine::advance_leaves(Node* node) {
+    const auto& [nw, ne, sw, se] = node->children;
+
+    auto rows = assemble(nw->bits, ne->bits, sw->bits, se->bits);
+
+    // Errors from the missing outer neighbours creep in one cell per generation, the centre is still exact after 4.
+    const unsigned int generations = 1u << std::min(step_exponent, 2u);
+
+    const bool life = rule == rules::life;
+    const auto table = bit_kernel::make_table<std::uint32_t>(rule);
+
+    for (unsigned int i = 0; i < generations; ++i) {
+        std::array<std::uint32_t, 16> next{};
+
+        for (std::size_t y = 0; y < rows.size(); ++y) {
+            const std::uint32_t a = y > 0 ? rows[y - 1] : 0;
+            const std::uint32_t b = rows[y];
+            const std::uint32_t c = y + 1 < rows.size() ? rows[y + 1] : 0;
+
+            next[y] = (life ? bit_kernel::next_state(a << 1, a, a >> 1, b << 1, b, b >> 1, c << 1, c, c >> 1)
+                            : bit_kernel::next_state(table, a << 1, a, a >> 1, b << 1, b, b >> 1, c << 1, c, c >> 1))
+                    & 0xffff;
+        }
+
+        rows = next;
+    }
+
+    return leaf(centre_of(rows));
+}
+
+
+HashLifeEngine::Node* HashLifeEngine::build(std::span<const std::uint8_t> cells, unsigned int level, std::int64_t x, std::int64_t y) {
+    if (x >= res.x || y >= res.y) {
+        return empty(level);
+    }
+
+    if (level == leaf_level) {
+        std::uint64_t bits = 0;
+
+        for (std::int64_t j = 0; j < 8 && y + j < res.y; ++j) {
+            for (std::int64_t i = 0; i < 8 && x + i < res.x; ++i) {
+                bits |= std::uint64_t{cells[(y + j) * res.x + x + i] != 0} << (8 * j + i);
+            }
+        }
+
+        return leaf(bits);
+    }
+
+    const std::int64_t half = std::int64_t{1} << (level - 1);
+
+    return join(build(cells, level - 1, x, y), build(cells, level - 1, x + half, y), build(cells, level - 1, x, y + half),
+          build(cells, level - 1, x + half, y + half));
+}
+
+void HashLifeEngine::draw(const Node* node, std::int64_t x, std::int64_t y, std::span<std::uint8_t> cells) const {
+    const std::int64_t size = std::int64_t{1} << node->level;
+
+    if (node->population == 0 || x >= res.x || y >= res.y || x + size <= 0 || y + size <= 0) {
+        return;
+    }
+
+    if (node->level == leaf_level) {
+        for (std::uint64_t bits = node->bits; bits != 0; bits &= bits - 1) {
+            const int bit = std::countr_zero(bits);
+
+            const std::int64_t cell_x = x + bit % 8;
+            const std::int64_t cell_y = y + bit / 8;
+
+            if (cell_x >= 0 && cell_x < res.x && cell_y >= 0 && cell_y < res.y) {
+                cells[cell_y * res.x + cell_x] = 1;
+            }
+        }
+
+        return;
+    }
+
+    const std::int64_t half = size / 2;
+
+    draw(node->children[0], x, y, cells);
+    draw(node->children[1], x + half, y, cells);
+    draw(node->children[2], x, y + half, cells);
+    draw(node->children[3], x + half, y + half, cells);
+}
+
+
+std::int64_t HashLifeEngine::distance(const Node* node, Side side, std::unordered_map<const Node*, std::int64_t>& memo) const {
+    if (node->level == leaf_level) {
+        std::uint64_t columns = node->bits;
+        columns |= columns >> 32;
+        columns |= columns >> 16;
+        columns |= columns >> 8;
+        columns &= 0xff;
+
+        switch (side) {
+            case Side::West: return std::countr_zero(columns);
+            case Side::East: return 8 - std::bit_width(columns);
+            case Side::North: return std::countr_zero(node->bits) / 8;
+            case Side::South: return std::countl_zero(node->bits) / 8;
+        }
+    }
+
+    if (const auto found = memo.find(node); found != memo.end()) {
+        return found->second;
+    }
+
+    // Children on the near side of the node, then those on the far side.
+    static constexpr std::array<std::array<std::size_t, 4>, 4> order{{{0, 2, 1, 3}, {1, 3, 0, 2}, {0, 1, 2, 3}, {2, 3, 0, 1}}};
+    const auto& children = order[static_cast<std::size_t>(side)];
+
+    auto best = std::numeric_limits<std::int64_t>::max();
+
+    for (std::size_t i = 0; i < 4; ++i) {
+        if (i == 2 && best != std::numeric_limits<std::int64_t>::max()) {
+            break;
+        }
+
+        const Node* child = node->children[children[i]];
+
+        if (child->population != 0) {
+            const std::int64_t offset = i < 2 ? 0 : std::int64_t{1} << (node->level - 1);
+            best = std::min(best, offset + distance(child, side, memo));
+        }
+    }
+
+    memo.emplace(node, best);
+    return best;
+}
+
+
+bool HashLifeEngine::is_centred(const Node* node) const {
+    if (node->level <= leaf_level + 1) {
+        return false;
+    }
+
+    const auto& [nw, ne, sw, se] = node->children;
+
+    return nw->population == nw->children[3]->population && ne->population == ne->children[2]->population
+        && sw->population == sw->children[1]->population && se->population == se->children[0]->population;
+}
+
+std::int64_t HashLifeEngine::get_origin() const {
+    return -(std::int64_t{1} << (root->level - 1));
+}
+
+
+
+HashLifeEngine::Node* HashLifeEngine::allocate() {
+    if (free_list == nullptr) {
+        blocks.push_back(std::make_unique<Node[]>(block_size));
+
+        for (std::size_t i = 0; i < block_size; ++i) {
+            blocks.back()[i].next = free_list;
+            free_list = &blocks.back()[i];
+        }
+    }
+
+    Node* node = free_list;
+    free_list = node->next;
+
+    *node = Node{};
+    node->result_step = -1;
+
+    return node;
+}
+
+HashLifeEngine::Node* HashLifeEngine::insert(Node* node, std::size_t hash) {
+    auto& bucket = buckets[hash & (buckets.size() - 1)];
+
+    node->next = bucket;
+    bucket = node;
+
+    if (++node_count > buckets.size()) {
+        rehash();
+    }
+
+    return node;
+}
+
+void HashLifeEngine::rehash() {
+    std::vector<Node*> grown(buckets.size() * 2, nullptr);
+
+    for (Node* head: buckets) {
+        while (head != nullptr) {
+            Node* node = std::exchange(head, head->next);
+
+            const std::size_t hash = node->level == leaf_level ? hash_leaf(node->bits) : hash_children(
+                                           node->children[0], node->children[1], node->children[2], node->children[3]);
+
+            auto& bucket = grown[hash & (grown.size() - 1)];
+            node->next = bucket;
+            bucket = node;
+        }
+    }
+
+    buckets = std::move(grown);
+}
+
+
+void HashLifeEngine::collect() {
+    // Mark and sweep, memoized results are kept alive too unless that leaves the arena too full.
+    for (bool keep_results: {true, false}) {
+        auto mark = [&](auto& self, Node* node) -> void {
+            if (node == nullptr || node->marked) {
+                return;
+            }
+
+            node->marked = true;
+
+            for (Node* child: node->children) {
+                self(self, child);
+            }
+
+            if (keep_results) {
+                self(self, node->result);
+            }
+        };
+
+        if (!keep_results) {
+            for (Node* head: buckets) {
+                for (Node* node = head; node != nullptr; node = node->next) {
+                    node->result = nullptr;
+                }
+            }
+        }
+
+        mark(mark, root);
+
+        for (Node* node: empties) {
+            mark(mark, node);
+        }
+
+        for (Node*& head: buckets) {
+            Node** link = &head;
+
+            while (*link != nullptr) {
+                Node* node = *link;
+
+                if (node->marked) {
+                    node->marked = false;
+                    link = &node->next;
+                } else {
+                    *link = node->next;
+
+                    node->next = free_list;
+                    free_list = node;
+                    --node_count;
+                }
+            }
+        }
+
+        if (node_count <= node_limit / 2) {
+            return;
+        }
+    }
+}
+
+
+std::uint64_t HashLifeEngine::get_memory_bytes() const {
+    return blocks.size() * block_size * sizeof(Node) + (buckets.size() + empties.size()) * sizeof(Node*);
+}
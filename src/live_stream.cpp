@@ -0,0 +1,639 @@
+#include "live_stream.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "bit_board.hpp"
+
+
+
+namespace live {
+
+namespace {
+
+static_assert(std::endian::native == std::endian::little, "Streams are little endian.");
+
+
+// Frames larger than that are taken for garbage rather than allocated.
+constexpr std::uint64_t max_words = std::uint64_t{1} << 32;
+
+
+std::uint64_t count_words(Resolution res) {
+    return (std::uint64_t{res.x} + 63) / 64 * res.y;
+}
+
+
+void put_varint(std::vector<std::uint8_t>& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+std::uint64_t get_varint(std::span<const std::uint8_t> bytes, std::size_t& position) {
+    std::uint64_t value = 0;
+
+    for (unsigned int shift = 0; shift < 64; shift += 7) {
+        if (position == bytes.size()) {
+            break;
+        }
+
+        const std::uint8_t byte = bytes[position++];
+        value |= std::uint64_t{byte & 0x7fu} << shift;
+
+        if (byte < 0x80) {
+            return value;
+        }
+    }
+
+    throw std::invalid_argument("Malformed stream frame.");
+}
+
+
+// The planes of a Generations board from the state of every cell.
+void pack_states(const checkpoint::Snapshot& snapshot, std::vector<std::uint64_t>& out) {
+    const std::size_t words = (std::size_t{snapshot.res.x} + 63) / 64;
+    const std::size_t plane_words = words * snapshot.res.y;
+
+    out.assign(plane_words * get_planes(snapshot.rule.states), 0);
+
+    for (std::size_t y = 0; y < snapshot.res.y; ++y) {
+        const std::uint8_t* row = &snapshot.states[y * snapshot.res.x];
+
+        for (std::size_t x = 0; x < snapshot.res.x; ++x) {
+            const std::size_t word = y * words + x / 64;
+            const std::uint64_t bit = std::uint64_t{1} << (x % 64);
+
+            if (row[x] == 1) {
+                out[word] |= bit;
+            }
+
+            for (unsigned int dying = row[x] > 1 ? row[x] - 1u : 0u, plane = 1; dying != 0; dying >>= 1, ++plane) {
+                out[plane * plane_words + word] |= (dying & 1) != 0 ? bit : 0;
+            }
+        }
+    }
+}
+
+
+// Rows of the snapshot without their ghost cells, see checkpoint.hpp.
+void pack(const checkpoint::Snapshot& snapshot, std::vector<std::uint64_t>& out) {
+    if (!snapshot.states.empty()) {
+        pack_states(snapshot, out);
+        return;
+    }
+
+    const std::size_t words = (std::size_t{snapshot.res.x} + 63) / 64;
+    const std::uint64_t tail_mask = snapshot.res.x % 64 == 0 ? ~std::uint64_t{0} : (std::uint64_t{1} << (snapshot.res.x % 64)) - 1;
+
+    out.resize(words * snapshot.res.y);
+
+    for (const auto& band: snapshot.bands) {
+        const auto& board = *band.board;
+
+        for (std::size_t y = 0; y < board.get_resolution().y; ++y) {
+            const std::uint64_t* row = board.row(y + 1);
+            std::uint64_t* to = &out[(band.y + y) * words];
+
+            for (std::size_t i = 0; i < words; ++i) {
+                to[i] = row[i] >> 1 | row[i + 1] << 63;
+            }
+
+            to[words - 1] &= tail_mask;
+        }
+    }
+}
+
+
+std::shared_ptr<const std::vector<std::uint8_t>> make_frame(
+      FrameType type, Resolution res, std::uint32_t states, std::uint64_t generation, std::span<const std::uint64_t> words) {
+
+    const auto payload = encode(words);
+
+    const Header header{
+          .magic = magic,
+          .type = type,
+          .width = res.x,
+          .height = res.y,
+          .states = states,
+          .generation = generation,
+          .payload_bytes = payload.size(),
+    };
+
+    auto frame = std::make_shared<std::vector<std::uint8_t>>(sizeof(header) + payload.size());
+
+    std::memcpy(frame->data(), &header, sizeof(header));
+    std::copy(payload.begin(), payload.end(), frame->begin() + sizeof(header));
+
+    return frame;
+}
+
+
+void set_non_blocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+} // namespace
+
+
+
+std::vector<std::uint8_t> encode(std::span<const std::uint64_t> words) {
+    std::vector<std::uint8_t> out;
+    std::size_t i = 0;
+
+    while (i < words.size()) {
+        const std::size_t zeros_begin = i;
+
+        while (i < words.size() && words[i] == 0) {
+            ++i;
+        }
+
+        // A lone zero word costs less inside the run than as a run of its own.
+        const std::size_t begin = i;
+
+        while (i < words.size() && (words[i] != 0 || (i + 1 < words.size() && words[i + 1] != 0))) {
+            ++i;
+        }
+
+        put_varint(out, begin - zeros_begin);
+        put_varint(out, i - begin);
+
+        const auto* bytes = reinterpret_cast<const std::uint8_t*>(words.data() + begin);
+        out.insert(out.end(), bytes, bytes + (i - begin) * sizeof(std::uint64_t));
+    }
+
+    return out;
+}
+
+void decode(std::span<const std::uint8_t> bytes, std::span<std::uint64_t> out) {
+    std::size_t position = 0;
+    std::size_t i = 0;
+
+    while (i < out.size()) {
+        const std::uint64_t zeros = get_varint(bytes, position);
+        const std::uint64_t literals = get_varint(bytes, position);
+
+        if (zeros > out.size() - i || literals > out.size() - i - zeros
+              || literals * sizeof(std::uint64_t) > bytes.size() - position) {
+            throw std::invalid_argument("Malformed stream frame.");
+        }
+
+        std::fill_n(out.data() + i, zeros, 0);
+        i += zeros;
+
+        std::memcpy(out.data() + i, bytes.data() + position, literals * sizeof(std::uint64_t));
+        i += literals;
+        position += literals * sizeof(std::uint64_t);
+    }
+
+    if (position != bytes.size()) {
+        throw std::invalid_argument("Malformed stream frame.");
+    }
+}
+
+
+
+// Frames are queued as they are encoded, shared between the viewers they go to. The first `sent` bytes of the oldest one are gone.
+struct Server::Viewer {
+    int socket;
+
+    std::deque<std::shared_ptr<const std::vector<std::uint8_t>>> queue{};
+    std::size_t sent = 0;
+
+    bool needs_keyframe = true;
+    bool closed = false;
+};
+
+
+Server::Server(Options options): options{std::move(options)} {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV;
+
+    addrinfo* addresses = nullptr;
+
+    if (getaddrinfo(this->options.address.c_str(), std::to_string(this->options.port).c_str(), &hints, &addresses) != 0) {
+        throw std::runtime_error("Could not resolve the stream address.");
+    }
+
+    listener = ::socket(addresses->ai_family, addresses->ai_socktype, addresses->ai_protocol);
+
+    const int reuse = 1;
+    const bool listening = listener >= 0 && setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == 0
+                        && bind(listener, addresses->ai_addr, addresses->ai_addrlen) == 0 && listen(listener, 16) == 0;
+
+    freeaddrinfo(addresses);
+
+    if (!listening || pipe(wake.data()) != 0) {
+        if (listener >= 0) {
+            close(listener);
+        }
+
+        throw std::runtime_error("Could not listen for viewers.");
+    }
+
+    sockaddr_storage bound{};
+    socklen_t length = sizeof(bound);
+    getsockname(listener, reinterpret_cast<sockaddr*>(&bound), &length);
+
+    port = ntohs(bound.ss_family == AF_INET6 ? reinterpret_cast<const sockaddr_in6&>(bound).sin6_port
+                                             : reinterpret_cast<const sockaddr_in&>(bound).sin_port);
+
+    set_non_blocking(listener);
+    set_non_blocking(wake[0]);
+    set_non_blocking(wake[1]);
+
+    thread = std::jthread{[this] { work(); }};
+}
+
+Server::~Server() {
+    {
+        std::scoped_lock lock{mutex};
+        stopping = true;
+    }
+
+    [[maybe_unused]] const auto written = write(wake[1], "", 1);
+    thread.join();
+
+    for (const auto& viewer: viewers) {
+        close(viewer.socket);
+    }
+
+    close(listener);
+    close(wake[0]);
+    close(wake[1]);
+}
+
+
+bool Server::has_viewers() const {
+    std::scoped_lock lock{mutex};
+    return statistics.viewers != 0;
+}
+
+void Server::publish(checkpoint::Snapshot snapshot) {
+    {
+        std::scoped_lock lock{mutex};
+
+        statistics.frames_replaced += pending ? 1 : 0;
+        ++statistics.frames_published;
+
+        pending = std::move(snapshot);
+    }
+
+    [[maybe_unused]] const auto written = write(wake[1], "", 1);
+}
+
+Server::Statistics Server::get_statistics() const {
+    std::scoped_lock lock{mutex};
+    return statistics;
+}
+
+
+void Server::work() {
+    std::vector<pollfd> fds;
+
+    while (true) {
+        fds.assign({{wake[0], POLLIN, 0}, {listener, POLLIN, 0}});
+
+        for (const auto& viewer: viewers) {
+            fds.push_back({viewer.socket, static_cast<short>(POLLIN | (viewer.queue.empty() ? 0 : POLLOUT)), 0});
+        }
+
+        if (poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR) {
+            return;
+        }
+
+        std::uint8_t drained[64];
+
+        while (read(wake[0], drained, sizeof(drained)) > 0) {
+        }
+
+        {
+            std::scoped_lock lock{mutex};
+
+            if (stopping) {
+                return;
+            }
+        }
+
+        // Viewers have nothing to say, what they send is dropped and only tells whether they hung up.
+        for (std::size_t i = 0; i < viewers.size(); ++i) {
+            auto& viewer = viewers[i];
+            const short events = fds[i + 2].revents;
+
+            if ((events & POLLIN) != 0 && recv(viewer.socket, drained, sizeof(drained), 0) <= 0) {
+                viewer.closed = true;
+            }
+
+            if ((events & (POLLERR | POLLHUP | POLLNVAL)) != 0) {
+                viewer.closed = true;
+            }
+
+            if ((events & POLLOUT) != 0 && !viewer.closed) {
+                flush(viewer);
+            }
+        }
+
+        if ((fds[1].revents & POLLIN) != 0) {
+            accept_viewers();
+        }
+
+        send_frame();
+
+        std::erase_if(viewers, [](const Viewer& viewer) {
+            if (viewer.closed) {
+                close(viewer.socket);
+            }
+
+            return viewer.closed;
+        });
+
+        std::scoped_lock lock{mutex};
+        statistics.viewers = viewers.size();
+    }
+}
+
+
+void Server::accept_viewers() {
+    while (true) {
+        const int socket = accept(listener, nullptr, nullptr);
+
+        if (socket < 0) {
+            return;
+        }
+
+        const int no_delay = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+        set_non_blocking(socket);
+
+        viewers.push_back({.socket = socket});
+    }
+}
+
+
+void Server::send_frame() {
+    std::optional<checkpoint::Snapshot> snapshot;
+
+    {
+        std::scoped_lock lock{mutex};
+        snapshot = std::exchange(pending, std::nullopt);
+    }
+
+    if (!snapshot) {
+        return;
+    }
+
+    pack(*snapshot, current);
+
+    const Resolution frame_res = snapshot->res;
+    const std::uint32_t frame_states = snapshot->states.empty() ? 2 : snapshot->rule.states;
+    const std::uint64_t generation = snapshot->generation;
+
+    // Let go of the boards, engines can step into them again.
+    snapshot.reset();
+
+    const bool keyframes = frame_res.x != res.x || frame_res.y != res.y || frame_states != states || previous.empty()
+                        || (options.keyframe_interval != 0 && frames % options.keyframe_interval == 0);
+
+    std::shared_ptr<const std::vector<std::uint8_t>> keyframe;
+    std::shared_ptr<const std::vector<std::uint8_t>> delta;
+
+    Statistics sent;
+
+    for (auto& viewer: viewers) {
+        if (viewer.closed) {
+            continue;
+        }
+
+        if (viewer.queue.size() >= options.max_queued_frames) {
+            viewer.needs_keyframe = true;
+            ++sent.frames_skipped;
+            continue;
+        }
+
+        if (keyframes || viewer.needs_keyframe) {
+            if (!keyframe) {
+                keyframe = make_frame(FrameType::Keyframe, frame_res, frame_states, generation, current);
+                sent.keyframe_bytes += keyframe->size();
+            }
+
+            viewer.queue.push_back(keyframe);
+        } else {
+            if (!delta) {
+                std::transform(current.begin(), current.end(), previous.begin(), previous.begin(), std::bit_xor{});
+
+                delta = make_frame(FrameType::Delta, frame_res, frame_states, generation, previous);
+                sent.delta_bytes += delta->size();
+            }
+
+            viewer.queue.push_back(delta);
+        }
+
+        viewer.needs_keyframe = false;
+        ++sent.frames_sent;
+
+        flush(viewer);
+    }
+
+    std::swap(previous, current);
+    res = frame_res;
+    states = frame_states;
+    ++frames;
+
+    std::scoped_lock lock{mutex};
+    statistics.frames_sent += sent.frames_sent;
+    statistics.frames_skipped += sent.frames_skipped;
+    statistics.keyframe_bytes += sent.keyframe_bytes;
+    statistics.delta_bytes += sent.delta_bytes;
+}
+
+
+void Server::flush(Viewer& viewer) {
+    while (!viewer.queue.empty()) {
+        const auto& frame = *viewer.queue.front();
+        const ssize_t written = send(viewer.socket, frame.data() + viewer.sent, frame.size() - viewer.sent, MSG_NOSIGNAL);
+
+        if (written < 0) {
+            viewer.closed = errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR;
+            return;
+        }
+
+        viewer.sent += static_cast<std::size_t>(written);
+
+        if (viewer.sent == frame.size()) {
+            viewer.queue.pop_front();
+            viewer.sent = 0;
+        }
+    }
+}
+
+
+
+Client::Client(const std::string& host, std::uint16_t port) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* addresses = nullptr;
+
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) {
+        throw std::runtime_error("Could not resolve the stream address.");
+    }
+
+    for (const addrinfo* address = addresses; address != nullptr && connection < 0; address = address->ai_next) {
+        connection = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+
+        if (connection >= 0 && connect(connection, address->ai_addr, address->ai_addrlen) != 0) {
+            close(connection);
+            connection = -1;
+        }
+    }
+
+    freeaddrinfo(addresses);
+
+    if (connection < 0) {
+        throw std::runtime_error("Could not connect to the stream.");
+    }
+}
+
+Client::~Client() {
+    close(connection);
+}
+
+
+bool Client::receive() {
+    if (!read(&header, sizeof(header))) {
+        return false;
+    }
+
+    const Resolution res{header.width, header.height};
+
+    // Cells are bytes, as on engines.
+    if (header.states < 2 || header.states > 256) {
+        throw std::invalid_argument("Malformed stream frame.");
+    }
+
+    const std::uint64_t count = count_words(res) * get_planes(header.states);
+
+    if (header.magic != magic || (header.type != FrameType::Keyframe && header.type != FrameType::Delta) || count > max_words
+          || header.payload_bytes > count * sizeof(std::uint64_t) + 2 * 10 * (count + 1)) {
+        throw std::invalid_argument("Malformed stream frame.");
+    }
+
+    payload.resize(header.payload_bytes);
+
+    if (!read(payload.data(), payload.size())) {
+        throw std::invalid_argument("Stream ended inside a frame.");
+    }
+
+    if (header.type == FrameType::Keyframe) {
+        words.resize(count);
+        decode(payload, words);
+
+        return true;
+    }
+
+    if (words.size() != count) {
+        throw std::invalid_argument("Stream frame does not follow a keyframe.");
+    }
+
+    delta.resize(count);
+    decode(payload, delta);
+
+    std::transform(words.begin(), words.end(), delta.begin(), words.begin(), std::bit_xor{});
+
+    return true;
+}
+
+
+std::span<const std::uint64_t> Client::get_words() const {
+    return std::span{words}.first(std::min<std::size_t>(words.size(), count_words(get_resolution())));
+}
+
+
+std::uint64_t Client::get_population() const {
+    std::uint64_t population = 0;
+
+    for (const auto word: get_words()) {
+        population += static_cast<std::uint64_t>(std::popcount(word));
+    }
+
+    return population;
+}
+
+
+void Client::get_cells(std::span<std::uint8_t> cells) const {
+    const Resolution res = get_resolution();
+
+    if (cells.size() != std::size_t{res.x} * res.y) {
+        throw std::invalid_argument("Cell buffer does not match the stream resolution.");
+    }
+
+    const std::size_t row_words = (std::size_t{res.x} + 63) / 64;
+    const std::size_t plane_words = row_words * res.y;
+    const std::size_t planes = plane_words == 0 ? 0 : words.size() / plane_words;
+
+    for (std::size_t y = 0; y < res.y; ++y) {
+        for (std::size_t x = 0; x < res.x; ++x) {
+            const std::size_t word = y * row_words + x / 64;
+            std::uint8_t dying = 0;
+
+            for (std::size_t plane = 1; plane < planes; ++plane) {
+                dying |= static_cast<std::uint8_t>((words[plane * plane_words + word] >> (x % 64) & 1) << (plane - 1));
+            }
+
+            const bool alive = planes != 0 && (words[word] >> (x % 64) & 1) != 0;
+            cells[y * res.x + x] = dying != 0 ? static_cast<std::uint8_t>(dying + 1) : alive ? 1 : 0;
+        }
+    }
+}
+
+
+bool Client::read(void* data, std::size_t bytes) {
+    auto* to = static_cast<std::uint8_t*>(data);
+    std::size_t done = 0;
+
+    while (done < bytes) {
+        const ssize_t received = recv(connection, to + done, bytes - done, 0);
+
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (received < 0) {
+            throw std::runtime_error("Could not read the stream.");
+        }
+
+        if (received == 0) {
+            if (done == 0) {
+                return false;
+            }
+
+            throw std::invalid_argument("Stream ended inside a frame.");
+        }
+
+        done += static_cast<std::size_t>(received);
+    }
+
+    return true;
+}
+
+
+} // namespace live
@@ -1,12 +1,26 @@
+#include <algorithm>
 #include <array>
 #include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <charconv>
+#include <cmath>
 #include <cstdlib>
 #include <exception>
+#include <filesystem>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <random>
+#include <stdexcept>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 #include <glad/gl.h>
 
@@ -19,8 +33,20 @@
 
 #include <glm/glm.hpp>
 
+#include "checkpoint.hpp"
+#include "cycle_detector.hpp"
+#include "density_pyramid.hpp"
+#include "distributed_engine.hpp"
+#include "gl_engine.hpp"
+#include "gl_soup_batch.hpp"
 #include "glu.hpp"
+#include "gpu_trace.hpp"
+#include "live_stream.hpp"
+#include "pattern.hpp"
+#include "scheduler.hpp"
 #include "simulation.hpp"
+#include "soup_search.hpp"
+#include "trace.hpp"
 
 
 
@@ -31,7 +57,13 @@ static constexpr std::size_t window_width = 1440;
 static constexpr std::size_t window_height = 1440;
 static constexpr std::string_view window_name = "Slime Simulation";
 
-static constexpr Texture::Resolution res{512, 512};
+static constexpr Resolution default_resolution{512, 512};
+
+static constexpr std::string_view usage =
+      "usage: slime [--size WIDTHxHEIGHT] [--shader-cache DIRECTORY] [--stream [ADDRESS:]PORT [--stream-every N]] [pattern]\n";
+
+// Program binaries, see glu::Shader. An empty --shader-cache turns the cache off.
+static constexpr std::string_view default_shader_cache = "shaders/.cache";
 
 
 namespace detail {
@@ -103,92 +135,822 @@ void process_inputs(GLFWwindow& window) {
 
 
 
-void randomize(Texture& tex, float density) {
-    std::mt19937 rng{std::random_device{}()};
+std::uint64_t make_seed() {
+    std::random_device device;
+    return std::uint64_t{device()} << 32 | device();
+}
+
+
+// "WIDTHxHEIGHT", or a single number for a square board.
+Resolution parse_resolution(std::string_view text) {
+    const auto parse = [&](std::string_view number) {
+        unsigned int value = 0;
+        const auto [end, error] = std::from_chars(number.data(), number.data() + number.size(), value);
+
+        if (error != std::errc{} || end != number.data() + number.size() || value == 0) {
+            throw std::invalid_argument("Invalid board size: " + std::string{text});
+        }
+
+        return value;
+    };
+
+    const auto x = text.find('x');
+
+    if (x == std::string_view::npos) {
+        const auto size = parse(text);
+        return {size, size};
+    }
+
+    return {parse(text.substr(0, x)), parse(text.substr(x + 1))};
+}
+
+
+// "[ADDRESS:]PORT" to stream to, see include/live_stream.hpp. Without an address only viewers on this host can connect.
+live::Server::Options parse_stream_address(std::string_view text) {
+    live::Server::Options stream;
+    const auto colon = text.rfind(':');
+
+    if (colon != std::string_view::npos) {
+        auto address = text.substr(0, colon);
+
+        // IPv6 addresses come in brackets, "[::]:9000".
+        if (address.size() >= 2 && address.front() == '[' && address.back() == ']') {
+            address = address.substr(1, address.size() - 2);
+        }
+
+        stream.address = address;
+        text = text.substr(colon + 1);
+    }
+
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), stream.port);
+
+    if (error != std::errc{} || end != text.data() + text.size()) {
+        throw std::invalid_argument("Invalid stream port: " + std::string{text});
+    }
+
+    return stream;
+}
+
+
+struct Options {
+    Resolution resolution = default_resolution;
+    std::string_view shader_cache = default_shader_cache;
+    std::optional<std::string_view> pattern;
+
+    std::optional<live::Server::Options> stream;
+
+    // Publishes a frame once at least that many generations went by since the last one.
+    std::uint64_t stream_every = 1;
+};
+
+Options parse_options(std::span<char*> args) {
+    Options options;
+
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        const std::string_view arg = args[i];
+
+        if (arg == "--size") {
+            if (i + 1 == args.size()) {
+                throw std::invalid_argument("Missing value for --size");
+            }
+
+            options.resolution = parse_resolution(args[++i]);
+        } else if (arg == "--shader-cache") {
+            if (i + 1 == args.size()) {
+                throw std::invalid_argument("Missing value for --shader-cache");
+            }
+
+            options.shader_cache = args[++i];
+        } else if (arg == "--stream") {
+            if (i + 1 == args.size()) {
+                throw std::invalid_argument("Missing value for --stream");
+            }
+
+            options.stream = parse_stream_address(args[++i]);
+        } else if (arg == "--stream-every") {
+            if (i + 1 == args.size()) {
+                throw std::invalid_argument("Missing value for --stream-every");
+            }
+
+            const std::string_view every = args[++i];
+            const auto [end, error] = std::from_chars(every.data(), every.data() + every.size(), options.stream_every);
+
+            if (error != std::errc{} || end != every.data() + every.size() || options.stream_every == 0) {
+                throw std::invalid_argument("Invalid generation count: " + std::string{every});
+            }
+        } else if (arg.starts_with("--") || options.pattern) {
+            throw std::invalid_argument("Unexpected argument: " + std::string{arg});
+        } else {
+            options.pattern = arg;
+        }
+    }
+
+    return options;
+}
+
+
+// Centred on the board, the rule of the file (if it names one) replaces the current one.
+void load_pattern(Simulation& simulation, const std::filesystem::path& path) {
+    const auto pattern = pattern::load(path);
+
+    if (pattern.rule) {
+        simulation.set_rule(*pattern.rule);
+    }
+
+    const auto res = simulation.get_resolution();
+
+    std::vector<std::uint8_t> cells(std::size_t{res.x} * res.y);
+    pattern::place(pattern.cells, cells, res);
+
+    simulation.set_cells(cells);
+}
+
+void save_pattern(const Simulation& simulation, const std::filesystem::path& path) {
+    const auto res = simulation.get_resolution();
+
+    std::vector<std::uint8_t> cells(std::size_t{res.x} * res.y);
+    simulation.get_cells(cells);
+
+    BitBoard board{res};
+    board.load_cells(cells);
+
+    pattern::save(path, board, simulation.params.rule);
+}
+
+
+// The spans of a frame a few frames back, by when its GPU spans have been collected: a row per track, nested spans under the span
+// they are in. Hovering a span shows its time.
+void draw_timeline() {
+    constexpr std::size_t frames_back = 3;
+    constexpr float row_height = 18;
+    constexpr float label_width = 70;
+
+    const auto events = trace::get_events(4096);
+
+    std::vector<const trace::Event*> frames;
+
+    for (const auto& event: events) {
+        if (event.name == "Frame") {
+            frames.push_back(&event);
+        }
+    }
+
+    if (frames.size() <= frames_back) {
+        ImGui::TextUnformatted("No frames traced yet.");
+        return;
+    }
+
+    const auto& frame = *frames[frames.size() - 1 - frames_back];
+    const std::uint64_t begin = frame.begin;
+    const std::uint64_t end = frame.begin + frame.duration;
 
-    std::uniform_real_distribution<float> dist(0, 1);
+    ImGui::Text("Frame: %.3f ms", static_cast<double>(frame.duration) / 1e6);
 
-    std::array<std::uint8_t, res.x * res.y> data;
+    // By track, the GPU last, then outer spans before the spans they hold.
+    std::vector<const trace::Event*> shown;
 
-    for (auto& n: data) {
-        n = dist(rng) < density ? 1 : 0;
+    for (const auto& event: events) {
+        if (event.begin < end && event.begin + event.duration > begin) {
+            shown.push_back(&event);
+        }
     }
 
-    tex.set_image<std::uint8_t>(data, res, Texture::InternalFormat::R8ui);
+    std::sort(shown.begin(), shown.end(), [](const auto* a, const auto* b) {
+        return std::tuple{a->track, a->begin, b->duration} < std::tuple{b->track, b->begin, a->duration};
+    });
+
+    auto* draw_list = ImGui::GetWindowDrawList();
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const float width = std::max(ImGui::GetContentRegionAvail().x - label_width, 1.0f);
+
+    const auto get_x = [&](std::uint64_t time) {
+        const auto clamped = std::clamp(time, begin, end);
+        return origin.x + label_width + static_cast<float>(clamped - begin) / static_cast<float>(end - begin) * width;
+    };
+
+    float top = origin.y;
+    std::size_t rows = 0;
+
+    // Ends of the spans the current one is in.
+    std::vector<std::uint64_t> open;
+
+    for (std::size_t i = 0; i < shown.size(); ++i) {
+        const auto& event = *shown[i];
+
+        if (i == 0 || event.track != shown[i - 1]->track) {
+            top += static_cast<float>(rows) * row_height;
+            rows = 0;
+            open.clear();
+
+            const auto label = event.track == trace::gpu_track ? std::string{"GPU"} : "Thread " + std::to_string(event.track);
+            draw_list->AddText({origin.x, top}, IM_COL32(255, 255, 255, 255), label.c_str());
+        }
+
+        while (!open.empty() && open.back() <= event.begin) {
+            open.pop_back();
+        }
+
+        const float y = top + static_cast<float>(open.size()) * row_height;
+        open.push_back(event.begin + event.duration);
+        rows = std::max(rows, open.size());
+
+        const ImVec2 min{get_x(event.begin), y};
+        const ImVec2 max{std::max(get_x(event.begin + event.duration), min.x + 1), y + row_height - 2};
+
+        const auto hash = std::hash<std::string_view>{}(event.name);
+        const ImU32 colour = IM_COL32(60 + hash % 120, 60 + hash / 120 % 120, 140, 255);
+
+        draw_list->AddRectFilled(min, max, colour);
+        draw_list->PushClipRect(min, max, true);
+        draw_list->AddText({min.x + 2, min.y}, IM_COL32(255, 255, 255, 255), event.name.data(), event.name.data() + event.name.size());
+        draw_list->PopClipRect();
+
+        if (ImGui::IsMouseHoveringRect(min, max)) {
+            ImGui::SetTooltip(
+                  "%.*s: %.3f ms", static_cast<int>(event.name.size()), event.name.data(), static_cast<double>(event.duration) / 1e6);
+        }
+    }
+
+    top += static_cast<float>(rows) * row_height;
+    ImGui::Dummy({label_width + width, top - origin.y});
 }
 
 
 
-int main() {
+int main(int argc, char* argv[]) {
     using namespace glu;
     using namespace std::chrono_literals;
 
+    Options options;
+
+    try {
+        options = parse_options({argv + 1, static_cast<std::size_t>(argc - 1)});
+    } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << '\n' << usage;
+        return EXIT_FAILURE;
+    }
+
     auto window = init_opengl();
 
+    Shader::set_cache_directory(options.shader_cache);
+
+
+    Simulation::register_backend(Simulation::Backend::Gl, [](Resolution res, const auto& params) {
+        return std::make_unique<GlEngine>(res, params.topology, params.rule);
+    });
+
 
     Shader vs{Shader::Type::Vertex, "shaders/shader.vert.glsl"};
     Shader fs{Shader::Type::Fragment, "shaders/shader.frag.glsl"};
-    Shader cs{Shader::Type::Compute, "shaders/shader.comp.glsl"};
 
     Pipeline render_pipeline;
     render_pipeline.attach(vs);
     render_pipeline.attach(fs);
 
-    Pipeline compute_pipeline;
-    compute_pipeline.attach(cs);
+    Quad quad;
+    Simulation simulation{options.resolution, {.backend = Simulation::Backend::Gl}};
+    auto& settings = simulation.params;
+
+    // Holds the board when it lives on the CPU, with the same ghost border as the GL engine textures. Both are sized again with the
+    // board, as is the density pyramid drawn from zoomed out.
+    Texture display_texture({1, 1}, Texture::InternalFormat::R8ui);
+    std::vector<std::uint8_t> display_cells;
+    std::optional<DensityPyramid> pyramid;
+
+    // The cell at the centre of the window and how many cells wide a pixel is, the wheel zooms about the cursor and dragging pans.
+    const glm::vec2 window_size{static_cast<float>(window_width), static_cast<float>(window_height)};
+    glm::vec2 view_centre{};
+    float cells_per_pixel = 1;
+
+    auto fit_view = [&] {
+        const auto res = simulation.get_resolution();
+
+        view_centre = glm::vec2{static_cast<float>(res.x), static_cast<float>(res.y)} / 2.0f;
+        cells_per_pixel = std::max(static_cast<float>(res.x) / window_size.x, static_cast<float>(res.y) / window_size.y);
+    };
+
+    auto fit_display = [&] {
+        const auto res = simulation.get_resolution();
+
+        display_texture = Texture({res.x + 2, res.y + 2}, Texture::InternalFormat::R8ui);
+        display_cells.assign(std::size_t{res.x} * res.y, 0);
+
+        pyramid.emplace(res);
+        fit_view();
+    };
+
+    fit_display();
+
+    // Board size being edited, applied with the button.
+    std::array<int, 2> board_size{static_cast<int>(options.resolution.x), static_cast<int>(options.resolution.y)};
+
+    // B/S rule being edited, applied on enter.
+    std::array<char, 64> rule_text{};
+    auto show_rule = [&] {
+        const auto text = settings.rule.to_string();
+        text.copy(rule_text.data(), rule_text.size() - 1);
+        rule_text[std::min(text.size(), rule_text.size() - 1)] = '\0';
+    };
+
+    auto set_rule = [&](const Rule& rule) {
+        try {
+            simulation.set_rule(rule);
+        } catch (const std::invalid_argument& e) {
+            std::cerr << e.what() << '\n';
+        }
+
+        show_rule();
+    };
 
-    Texture input_texture(res, Texture::InternalFormat::R8ui);
-    Texture output_texture(res, Texture::InternalFormat::R8ui);
+    set_rule(settings.rule);
 
 
-    Quad quad;
-    Simulation::Parameters settings;
+    // Pattern file to load or save, the format follows the extension. The one given on the command line replaces the random soup.
+    std::array<char, 256> pattern_path{};
+    options.pattern.value_or("pattern.rle").copy(pattern_path.data(), pattern_path.size() - 1);
+
+    auto load = [&] {
+        try {
+            load_pattern(simulation, pattern_path.data());
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+        }
 
+        show_rule();
+    };
 
-    randomize(input_texture, settings.randomize_density);
+    // Random boards are drawn from a seed, the same board on every backend, shown so it can be drawn again.
+    std::uint64_t seed = make_seed();
 
+    if (options.pattern) {
+        load();
+    } else {
+        simulation.randomize(seed, settings.randomize_density);
+    }
+
+    // Checkpoints are written in the background, stepping goes on meanwhile.
+    std::array<char, 256> checkpoint_path{};
+    std::string_view{"slime.ckpt"}.copy(checkpoint_path.data(), checkpoint_path.size() - 1);
+
+    checkpoint::Writer checkpoint_writer;
+
+    // Viewers elsewhere get the board as it runs, see include/live_stream.hpp. Frames are only taken while someone is watching.
+    std::optional<live::Server> stream;
+    std::optional<std::uint64_t> streamed_generation;
+    std::size_t stream_viewers = 0;
 
-    using clock_t = std::chrono::high_resolution_clock;
+    if (options.stream) {
+        try {
+            stream.emplace(*options.stream);
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << '\n';
+        }
+    }
 
-    auto elapsed = 0ns;
-    int iteration = 0;
+    // Spans of every frame, on the CPU and the GPU, cheap enough to leave on. The timeline shows a frame, the export the last few
+    // thousand spans.
+    bool tracing = true;
+    bool show_timeline = false;
+    trace::set_enabled(tracing);
+
+    std::array<char, 256> trace_path{};
+    std::string_view{"slime.trace.json"}.copy(trace_path.data(), trace_path.size() - 1);
+
+
+    // Generations are stepped at their own rate, or as many as fit in a frame, whatever the frame rate.
+    Scheduler scheduler{Scheduler::Mode::FixedRate, 60};
+    bool running = true;
+
+    // Hashes the board every frame while on, which the GL engine has to read back for.
+    CycleDetector detector;
+    std::optional<CycleDetector::Cycle> cycle;
+    bool detect_cycles = false;
+    bool stop_on_cycle = true;
+
+    auto forget_cycle = [&] {
+        detector.clear();
+        cycle.reset();
+    };
+
+    // Shown in the interface. The GL engine reads them back a frame or two late rather than have the frame wait for the GPU, they are
+    // kept until newer ones land.
+    Engine::Statistics statistics;
+
+    using clock_t = Scheduler::clock_t;
+
+    // Census of the current rule, run to completion when asked for, the window waits for it.
+    int soup_count = 10000;
+    bool soups_on_gpu = false;
+    std::optional<soup::Census> census;
+    double soups_per_second = 0;
+
+    auto search_soups = [&] {
+        const soup::Options options{.count = static_cast<std::uint64_t>(soup_count)};
+        const auto begin = clock_t::now();
+
+        try {
+            if (soups_on_gpu) {
+                soup::GlSoupBatch batch{settings.rule};
+                census = soup::search(batch, options);
+            } else {
+                census = soup::search(settings.rule, options);
+            }
+        } catch (const std::invalid_argument& e) {
+            std::cerr << e.what() << '\n';
+            census.reset();
+            return;
+        }
+
+        const std::chrono::duration<double> elapsed = clock_t::now() - begin;
+        soups_per_second = static_cast<double>(census->soups) / elapsed.count();
+    };
 
     auto frame_begin = clock_t::now();
 
     while (glfwWindowShouldClose(window.get()) == 0) {
+        const trace::Span frame_span{"Frame"};
 
         const auto frame_end = clock_t::now();
-
-        [[maybe_unused]] const auto dt = std::chrono::duration_cast<std::chrono::nanoseconds>(frame_end - frame_begin);
+        const auto dt = frame_end - frame_begin;
         frame_begin = frame_end;
 
-        elapsed += dt;
-
         glfwPollEvents();
         process_inputs(*window);
 
+        trace::collect_gpu();
+
+        // Shaders edited on disk are compiled again, those that do not compile keep running the code they had.
+        for (const auto& error: Shader::reload_changed()) {
+            std::cerr << error << '\n';
+        }
+
+
+        // Update cells, the whole batch at once. It is done by the time it returns, so the frame shows its last generation.
+        std::uint64_t stepped = 0;
+
+        {
+            const trace::Span span{"Step"};
+            stepped = running ? scheduler.update(simulation, dt) : 0;
+        }
+
+        if (detect_cycles && stepped != 0 && !cycle) {
+            cycle = detector.observe(simulation);
+
+            // Frames step several generations at a time, what repeated is a multiple of the period.
+            if (cycle) {
+                cycle->period = CycleDetector::find_period(simulation, cycle->period);
+                running = !stop_on_cycle;
+            }
+        }
+
+        // Viewers that just joined need a frame even while the simulation is paused.
+        if (stream) {
+            const auto viewers = stream->get_statistics().viewers;
+            const auto generation = simulation.get_generation();
+
+            const bool due = !streamed_generation || generation < *streamed_generation
+                          || generation - *streamed_generation >= options.stream_every;
+
+            if (viewers != 0 && (due || viewers > stream_viewers)) {
+                const trace::Span span{"Stream"};
+
+                stream->publish(checkpoint::take(simulation));
+                streamed_generation = generation;
+            }
+
+            stream_viewers = viewers;
+        }
+
+        fs.set_uniform("iteration", static_cast<int>(simulation.get_generation()));
+
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
+        // Unless the mouse is over the settings. Window coordinates grow downwards, cells upwards.
+        if (const auto& io = ImGui::GetIO(); !io.WantCaptureMouse) {
+            if (io.MouseWheel != 0) {
+                const auto res = simulation.get_resolution();
+
+                // From 64 pixels a cell to the whole board a quarter of the window.
+                const float widest = 4 * std::max(static_cast<float>(res.x) / window_size.x, static_cast<float>(res.y) / window_size.y);
+                const float next = std::clamp(cells_per_pixel * std::pow(1.25f, -io.MouseWheel), 1.0f / 64, std::max(widest, 1.0f));
+
+                // The cell under the cursor stays there.
+                const glm::vec2 cursor{io.MousePos.x - window_size.x / 2, window_size.y / 2 - io.MousePos.y};
+
+                view_centre += cursor * (cells_per_pixel - next);
+                cells_per_pixel = next;
+            }
+
+            if (ImGui::IsMouseDragging(ImGuiMouseButton_Left)) {
+                view_centre -= glm::vec2{io.MouseDelta.x, -io.MouseDelta.y} * cells_per_pixel;
+            }
+        }
+
+        // Reduced on the GPU by the GL engine, only a few bytes are read back.
+        if (const auto* gl_engine = dynamic_cast<const GlEngine*>(&simulation.get_engine())) {
+            gl_engine->request_statistics(simulation.get_generation());
+
+            if (const auto landed = gl_engine->poll_statistics()) {
+                statistics = landed->statistics;
+            }
+        } else {
+            statistics = simulation.get_statistics();
+        }
+
         // Imgui
         ImGui::Begin("Slime!!!");
         {
+            const trace::Span span{"Interface"};
+
             ImGui::Text("FPS: %f", ImGui::GetIO().Framerate);
+            ImGui::Text("Generation: %llu", static_cast<unsigned long long>(simulation.get_generation()));
+            ImGui::Text("Population: %llu", static_cast<unsigned long long>(statistics.population));
+
+            if (statistics.changes) {
+                ImGui::Text("Births: %llu, deaths: %llu", static_cast<unsigned long long>(statistics.changes->births),
+                      static_cast<unsigned long long>(statistics.changes->deaths));
+            }
+
+            if (const auto& box = statistics.bounding_box) {
+                ImGui::Text("Bounding box: (%lld, %lld) to (%lld, %lld)", static_cast<long long>(box->x_min),
+                      static_cast<long long>(box->y_min), static_cast<long long>(box->x_max), static_cast<long long>(box->y_max));
+            }
+
+            ImGui::Checkbox("Run", &running);
+
+            if (ImGui::BeginCombo("Pacing", get_name(scheduler.get_mode()).data())) {
+                for (const auto mode: Scheduler::modes) {
+                    if (ImGui::Selectable(get_name(mode).data(), mode == scheduler.get_mode())) {
+                        scheduler.set_mode(mode);
+                    }
+                }
+
+                ImGui::EndCombo();
+            }
+
+            if (scheduler.get_mode() == Scheduler::Mode::FixedRate) {
+                auto rate = static_cast<float>(scheduler.get_rate());
+
+                if (ImGui::SliderFloat("Generations per second", &rate, 1, 1e6f, "%.0f",
+                          ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_AlwaysClamp)) {
+                    scheduler.set_rate(rate);
+                }
+            }
+
+            ImGui::Text("Stepping %.0f generations/s, up to %llu per frame%s", scheduler.get_measured_rate(),
+                  static_cast<unsigned long long>(scheduler.get_batch_limit()), scheduler.is_behind() ? ", falling behind" : "");
+
+            if (ImGui::Checkbox("Detect still lifes and oscillators", &detect_cycles)) {
+                forget_cycle();
+            }
+
+            if (detect_cycles) {
+                ImGui::Checkbox("Stop when the board repeats", &stop_on_cycle);
+
+                if (cycle && cycle->period == 1) {
+                    ImGui::Text("Still life since generation %llu", static_cast<unsigned long long>(cycle->since));
+                } else if (cycle) {
+                    ImGui::Text("Period %llu oscillator since generation %llu", static_cast<unsigned long long>(cycle->period),
+                          static_cast<unsigned long long>(cycle->since));
+                }
+            }
+
 
-            ImGui::SliderInt("Iterations per second", &settings.iterations_per_second, 1, 500);
+            if (ImGui::BeginCombo("Backend", get_name(settings.backend).data())) {
+                for (const auto backend: Simulation::backends) {
+                    if (Simulation::has_backend(backend) && ImGui::Selectable(get_name(backend).data(), backend == settings.backend)) {
+                        try {
+                            simulation.set_backend(backend);
+                        } catch (const std::invalid_argument& e) {
+                            std::cerr << e.what() << '\n';
+                        }
+                    }
+                }
+
+                ImGui::EndCombo();
+            }
+
+            if (ImGui::BeginCombo("Topology", get_name(settings.topology).data())) {
+                for (const auto topology: topologies) {
+                    if (ImGui::Selectable(get_name(topology).data(), topology == settings.topology)) {
+                        try {
+                            simulation.set_topology(topology);
+                        } catch (const std::invalid_argument& e) {
+                            std::cerr << e.what() << '\n';
+                        }
+                    }
+                }
+
+                ImGui::EndCombo();
+            }
+
+            const auto preset =
+                  std::find_if(named_rules.begin(), named_rules.end(), [&](const auto& named) { return named.rule == settings.rule; });
+
+            if (ImGui::BeginCombo("Rule presets", preset != named_rules.end() ? preset->name.data() : "Custom")) {
+                for (const auto& [name, rule]: named_rules) {
+                    if (ImGui::Selectable(name.data(), rule == settings.rule)) {
+                        set_rule(rule);
+                    }
+                }
+
+                ImGui::EndCombo();
+            }
+
+            if (ImGui::InputText("Rule", rule_text.data(), rule_text.size(), ImGuiInputTextFlags_EnterReturnsTrue)) {
+                try {
+                    set_rule(Rule::parse(rule_text.data()));
+                } catch (const std::invalid_argument& e) {
+                    std::cerr << e.what() << '\n';
+                    set_rule(settings.rule);
+                }
+            }
+
+            if (settings.backend == Simulation::Backend::Tiled || settings.backend == Simulation::Backend::Distributed) {
+                const char* label = settings.backend == Simulation::Backend::Tiled ? "Threads (0 = all)" : "Processes (0 = all)";
+                int threads = static_cast<int>(settings.threads);
+
+                if (ImGui::SliderInt(label, &threads, 0, static_cast<int>(std::thread::hardware_concurrency()))) {
+                    simulation.set_threads(static_cast<unsigned int>(threads));
+                }
+            }
+
+            if (const auto* distributed = dynamic_cast<const DistributedEngine*>(&simulation.get_engine())) {
+                const auto halo = distributed->get_halo_statistics();
+                const double generations = static_cast<double>(std::max<std::uint64_t>(halo.generations, 1));
+
+                ImGui::Text("Halo exchange: %.1f us, step: %.1f us per generation", halo.exchange_seconds * 1e6 / generations,
+                      halo.step_seconds * 1e6 / generations);
+            }
+
+            ImGui::Separator();
+
+            ImGui::Text("Zoom: %.3g cells per pixel", static_cast<double>(cells_per_pixel));
+            ImGui::SameLine();
+
+            if (ImGui::Button("Fit board")) {
+                fit_view();
+            }
+
+            // The board keeps its cells, centred, cut off where it shrinks.
+            ImGui::InputInt2("Board size", board_size.data());
+
+            if (ImGui::Button("Resize")) {
+                try {
+                    simulation.resize({static_cast<unsigned int>(std::max(board_size[0], 0)),
+                          static_cast<unsigned int>(std::max(board_size[1], 0))});
+                    fit_display();
+                    forget_cycle();
+                    scheduler.reset();
+                } catch (const std::exception& e) {
+                    std::cerr << e.what() << '\n';
+                }
+
+                const auto res = simulation.get_resolution();
+                board_size = {static_cast<int>(res.x), static_cast<int>(res.y)};
+            }
 
             ImGui::Separator();
 
             ImGui::SliderFloat("Randomize density", &settings.randomize_density, 0, 1);
 
+            ImGui::InputScalar("Seed", ImGuiDataType_U64, &seed);
+
             if (ImGui::Button("Randomize!")) {
-                randomize(input_texture, settings.randomize_density);
+                seed = make_seed();
+                simulation.randomize(seed, settings.randomize_density);
+                forget_cycle();
+            }
+
+            ImGui::SameLine();
+
+            if (ImGui::Button("Redraw seed")) {
+                simulation.randomize(seed, settings.randomize_density);
+                forget_cycle();
+            }
+
+            ImGui::Separator();
+
+            ImGui::InputText("Pattern file", pattern_path.data(), pattern_path.size());
+
+            if (ImGui::Button("Load")) {
+                load();
+                forget_cycle();
+            }
+
+            ImGui::SameLine();
+
+            if (ImGui::Button("Save")) {
+                try {
+                    save_pattern(simulation, pattern_path.data());
+                } catch (const std::exception& e) {
+                    std::cerr << e.what() << '\n';
+                }
+            }
+
+            ImGui::Separator();
+
+            ImGui::InputText("Checkpoint file", checkpoint_path.data(), checkpoint_path.size());
+
+            if (ImGui::Button("Checkpoint")) {
+                checkpoint_writer.write(checkpoint_path.data(), checkpoint::take(simulation));
+            }
+
+            ImGui::SameLine();
+
+            if (ImGui::Button("Resume")) {
+                try {
+                    checkpoint_writer.wait();
+                    checkpoint::restore(simulation, checkpoint_path.data());
+                } catch (const std::exception& e) {
+                    std::cerr << e.what() << '\n';
+                }
+
+                show_rule();
+                forget_cycle();
+            }
+
+            if (checkpoint_writer.is_busy()) {
+                ImGui::SameLine();
+                ImGui::Text("Writing...");
+            }
+
+            if (const auto error = checkpoint_writer.take_error()) {
+                std::cerr << *error << '\n';
+            }
+
+            if (stream) {
+                const auto statistics = stream->get_statistics();
+
+                ImGui::Separator();
+
+                ImGui::Text("Streaming on port %u to %zu viewers", static_cast<unsigned int>(stream->get_port()), statistics.viewers);
+                ImGui::Text("%llu frames sent, %llu skipped by slow viewers, %llu replaced",
+                      static_cast<unsigned long long>(statistics.frames_sent), static_cast<unsigned long long>(statistics.frames_skipped),
+                      static_cast<unsigned long long>(statistics.frames_replaced));
+                ImGui::Text("%.1f MB in keyframes, %.1f MB in deltas", static_cast<double>(statistics.keyframe_bytes) / 1e6,
+                      static_cast<double>(statistics.delta_bytes) / 1e6);
+            }
+
+            ImGui::Separator();
+
+            ImGui::InputInt("Soups", &soup_count);
+            soup_count = std::max(soup_count, 1);
+
+            ImGui::Checkbox("On the GPU", &soups_on_gpu);
+
+            if (ImGui::Button("Search soups")) {
+                search_soups();
+            }
+
+            if (census) {
+                ImGui::Text("%llu soups at %.0f soups/s, %llu unsettled", static_cast<unsigned long long>(census->soups), soups_per_second,
+                      static_cast<unsigned long long>(census->unsettled));
+
+                // The most common objects first.
+                std::vector<std::pair<std::uint64_t, const std::string*>> objects;
+
+                for (const auto& [code, count]: census->objects) {
+                    objects.emplace_back(count, &code);
+                }
+
+                std::sort(objects.begin(), objects.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+                for (std::size_t i = 0; i < std::min<std::size_t>(objects.size(), 10); ++i) {
+                    ImGui::Text("%10llu %s", static_cast<unsigned long long>(objects[i].first), objects[i].second->c_str());
+                }
+            }
+
+            ImGui::Separator();
+
+            if (ImGui::Checkbox("Trace frames", &tracing)) {
+                trace::set_enabled(tracing);
+            }
+
+            ImGui::SameLine();
+            ImGui::Checkbox("Timeline", &show_timeline);
+
+            ImGui::InputText("Trace file", trace_path.data(), trace_path.size());
+
+            if (ImGui::Button("Export trace")) {
+                try {
+                    trace::write_chrome_trace(trace_path.data(), trace::get_events());
+                } catch (const std::exception& e) {
+                    std::cerr << e.what() << '\n';
+                }
             }
         }
         ImGui::End();
 
+        if (show_timeline) {
+            ImGui::Begin("Timeline", &show_timeline);
+            draw_timeline();
+            ImGui::End();
+        }
+
 
 
         glClear(GL_COLOR_BUFFER_BIT);
@@ -201,48 +963,67 @@ int main() {
         //
 
 
-        // Draw the texture
-        input_texture.bind_to_image_unit(0, Texture::AccessType::Read);
-        quad.draw(render_pipeline);
+        // Draw the texture, zoomed in from the cells themselves, further out from the pyramid. It only reduces the tiles the GL engine
+        // flagged as changed since, and not at all while zoomed in.
+        {
+            const trace::Span span{"Render"};
+            const trace::GpuSpan gpu_span{"Render"};
+
+            const bool zoomed_out = cells_per_pixel >= 2;
 
+            if (const auto* gl_engine = dynamic_cast<const GlEngine*>(&simulation.get_engine())) {
+                gl_engine->get_texture().bind_to_image_unit(0, Texture::AccessType::Read);
+                fs.set_uniform("border", static_cast<int>(gl_engine->get_border()));
 
-        // Update cells
+                if (zoomed_out) {
+                    pyramid->update(gl_engine->get_texture(), gl_engine->get_border(), gl_engine->get_dirty_texture());
+                }
+            } else {
+                const auto res = simulation.get_resolution();
 
-        if (elapsed.count() >= 1.0f / settings.iterations_per_second) {
-            while (elapsed.count() >= 1.0f / settings.iterations_per_second) {
+                {
+                    const trace::Span upload_span{"Upload"};
+                    const trace::GpuSpan gpu_upload_span{"Upload"};
 
-                ++iteration;
-                fs.set_uniform("iteration", iteration);
+                    simulation.get_cells(display_cells);
+                    display_texture.set_sub_image<std::uint8_t>(display_cells, 1, 1, {res.x, res.y});
+                }
 
-                elapsed -= 1000ms / settings.iterations_per_second;
+                display_texture.bind_to_image_unit(0, Texture::AccessType::Read);
+                fs.set_uniform("border", 1);
 
-                input_texture.bind_to_image_unit(0, Texture::AccessType::Read);
-                output_texture.bind_to_image_unit(1, Texture::AccessType::Write);
+                if (zoomed_out) {
+                    pyramid->update(display_texture, 1);
+                }
+            }
 
+            const auto padded = pyramid->get_padded_size();
 
-                compute_pipeline.activate();
-                glDispatchCompute(res.x / 32, res.y / 32, 1);
-                compute_pipeline.deactivate();
+            pyramid->get_texture().bind_to_texture_unit(0);
+            fs.set_uniform("padded_size", glm::vec2{static_cast<float>(padded.x), static_cast<float>(padded.y)});
+            fs.set_uniform("max_lod", static_cast<float>(pyramid->get_texture().get_levels() - 1));
 
-                // Swap input and output textures...
-                std::swap(input_texture, output_texture);
-                //
-                //
-                //
-                //
-                //
-                //
-                //
-                //
-                // /RENDERING!!
-            }
+            fs.set_uniform("origin", view_centre - window_size / 2.0f * cells_per_pixel);
+            fs.set_uniform("cells_per_pixel", cells_per_pixel);
+            fs.set_uniform("states", static_cast<unsigned int>(settings.rule.states));
+
+            quad.draw(render_pipeline);
         }
 
 
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            const trace::Span span{"ImGui"};
+            const trace::GpuSpan gpu_span{"ImGui"};
+
+            ImGui::Render();
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
+
         // glFlush();
-        glfwSwapBuffers(window.get());
+        {
+            const trace::Span span{"Swap"};
+            glfwSwapBuffers(window.get());
+        }
     }
 
 
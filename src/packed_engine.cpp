@@ -0,0 +1,73 @@
+#include "packed_engine.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+
+
+PackedEngine::PackedEngine(Resolution res, Topology topology, const Rule& rule, bit_kernel::Isa isa):
+      Engine{res},
+      topology{topology},
+      rule{rule},
+      isa{isa},
+      kernel{bit_kernel::select(rule, isa)},
+      front{std::make_shared<BitBoard>(res)},
+      back{std::make_shared<BitBoard>(res)} {
+
+    if (!rule.is_life_like()) {
+        throw std::invalid_argument("Bit-packed engines only run two state, range 1 rules.");
+    }
+}
+
+
+void PackedEngine::step(std::uint64_t generations) {
+    for (std::uint64_t i = 0; i < generations; ++i) {
+        BitBoard::make_unshared(back, spares);
+
+        kernel(*front, *back, 1, res.y + 1, rule);
+        back->fill_halo(topology);
+
+        std::swap(front, back);
+    }
+}
+
+
+void PackedEngine::get_cells(std::span<std::uint8_t> cells) const {
+    front->store_cells(cells);
+}
+
+void PackedEngine::set_cells(std::span<const std::uint8_t> cells) {
+    BitBoard::make_unshared(front, spares);
+
+    front->load_cells(cells);
+    front->fill_halo(topology);
+}
+
+
+std::vector<Engine::Band> PackedEngine::get_bands() const {
+    return {{0, front}};
+}
+
+void PackedEngine::set_board(std::shared_ptr<BitBoard> board) {
+    const auto board_res = board->get_resolution();
+
+    if (board_res.x != res.x || board_res.y != res.y) {
+        throw std::invalid_argument("Board does not match the engine resolution.");
+    }
+
+    front = std::move(board);
+
+    front->clear_halo();
+    front->fill_halo(topology);
+}
+
+
+std::uint64_t PackedEngine::get_memory_bytes() const {
+    std::uint64_t bytes = front->get_memory_bytes() + back->get_memory_bytes();
+
+    for (const auto& spare: spares) {
+        bytes += spare->get_memory_bytes();
+    }
+
+    return bytes;
+}
@@ -0,0 +1,1278 @@
+#include "pattern.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+
+namespace {
+
+constexpr std::size_t chunk_size = std::size_t{1} << 20;
+
+// Longest run and widest pattern read, well past any board that fits in memory.
+constexpr std::uint64_t max_run = std::uint64_t{1} << 32;
+constexpr std::uint64_t max_size = std::numeric_limits<unsigned int>::max() - 2;
+
+// RLE lines are kept under 70 characters.
+constexpr std::size_t rle_line_length = 70;
+
+
+std::string_view trim(std::string_view text) {
+    const auto begin = text.find_first_not_of(" \t\r");
+
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+
+    return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+}
+
+std::string_view trim_end(std::string_view text) {
+    return text.substr(0, text.find_last_not_of(" \t\r") + 1);
+}
+
+template<typename T>
+T parse_number(std::string_view text) {
+    text = trim(text);
+
+    T value{};
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+
+    if (text.empty() || error != std::errc{} || end != text.data() + text.size()) {
+        throw std::invalid_argument("Pattern coordinates and sizes must be integers.");
+    }
+
+    return value;
+}
+
+Resolution check_size(std::uint64_t width, std::uint64_t height) {
+    if (width > max_size || height > max_size) {
+        throw std::invalid_argument("Pattern is too large to expand.");
+    }
+
+    return {static_cast<unsigned int>(width), static_cast<unsigned int>(height)};
+}
+
+
+
+// Reads a stream a chunk at a time. Parsers walk [next, end) themselves and call refill() when they reach the end of it. The chunk is
+// surrounded by zero bytes, parsers may read up to `padding` characters past `end` and `front` before `next`.
+class Reader {
+  public:
+    static constexpr std::size_t front = 8;
+    static constexpr std::size_t padding = 64;
+
+
+    explicit Reader(std::istream& stream): stream{stream}, chunk(front + chunk_size + padding, 0) {}
+
+
+    bool refill() {
+        auto* begin = chunk.data() + front;
+
+        stream.read(begin, static_cast<std::streamsize>(chunk_size));
+
+        next = begin;
+        end = begin + stream.gcount();
+
+        std::fill_n(begin + stream.gcount(), padding, 0);
+
+        return next != end;
+    }
+
+    // Without the line ending, false at the end of the stream.
+    bool get_line(std::string& line) {
+        line.clear();
+
+        bool read = false;
+
+        while (next != end || refill()) {
+            read = true;
+
+            const auto* newline = std::find(next, end, '\n');
+            line.append(next, newline);
+
+            if (newline != end) {
+                next = newline + 1;
+                break;
+            }
+
+            next = end;
+        }
+
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        return read;
+    }
+
+
+    const char* next = nullptr;
+    const char* end = nullptr;
+
+  private:
+    std::istream& stream;
+    std::vector<char> chunk;
+};
+
+
+// Buffers output and hands it to the stream a chunk at a time.
+class Writer {
+  public:
+    explicit Writer(std::ostream& stream): stream{stream} { buffer.reserve(chunk_size + 64); }
+    ~Writer() { flush(); }
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+
+    void put(char c) {
+        buffer += c;
+        check();
+    }
+
+    void put(std::string_view text) {
+        buffer += text;
+        check();
+    }
+
+    void put(std::int64_t number) {
+        std::array<char, 24> digits;
+        const auto end = std::to_chars(digits.begin(), digits.end(), number).ptr;
+
+        put(std::string_view{digits.begin(), end});
+    }
+
+    void flush() {
+        stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+
+
+  private:
+    void check() {
+        if (buffer.size() >= chunk_size) {
+            flush();
+        }
+    }
+
+
+    std::ostream& stream;
+    std::string buffer;
+};
+
+
+
+// Sets `length` bits of a row from bit `begin` on.
+void set_run(std::uint64_t* row, std::uint64_t begin, std::uint64_t length) {
+    const auto end = begin + length;
+
+    const auto first = begin / 64;
+    const auto last = (end - 1) / 64;
+
+    const auto head = ~std::uint64_t{0} << (begin % 64);
+    const auto tail = ~std::uint64_t{0} >> (63 - (end - 1) % 64);
+
+    if (first == last) {
+        row[first] |= head & tail;
+        return;
+    }
+
+    row[first] |= head;
+    std::fill(row + first + 1, row + last, ~std::uint64_t{0});
+    row[last] |= tail;
+}
+
+// Ors the low 8 bits of `bits` into a row from bit `begin` on, bits left of the row are dropped.
+void or_byte(std::uint64_t* row, std::int64_t begin, std::uint64_t bits) {
+    if (begin < 0) {
+        bits >>= -begin;
+        begin = 0;
+    }
+
+    const auto shift = static_cast<std::uint64_t>(begin) % 64;
+    auto* word = row + begin / 64;
+
+    word[0] |= bits << shift;
+
+    if (shift > 56) {
+        word[1] |= bits >> (64 - shift);
+    }
+}
+
+// The 8 cells of row y from column x on, columns past the board read as dead.
+std::uint64_t get_byte(const BitBoard& cells, std::size_t x, std::size_t y) {
+    const auto* row = cells.row(y + 1);
+
+    const auto bit = x + 1;
+    const auto shift = bit % 64;
+
+    auto bits = row[bit / 64] >> shift;
+
+    if (shift > 56) {
+        bits |= row[bit / 64 + 1] << (64 - shift);
+    }
+
+    const auto width = cells.get_resolution().x;
+
+    return x + 8 > width ? bits & ((std::uint64_t{1} << (width - x)) - 1) : bits & 0xff;
+}
+
+// Calls f(begin, end) for each run of live cells in row y, as columns.
+template<typename F>
+void for_each_run(const BitBoard& cells, std::size_t y, F&& f) {
+    const auto* row = cells.row(y + 1);
+    const std::uint64_t last_bit = cells.get_resolution().x + 1;
+
+    std::uint64_t bit = 1;
+
+    while (bit < last_bit) {
+        auto word = row[bit / 64] & (~std::uint64_t{0} << (bit % 64));
+
+        while (word == 0) {
+            bit = (bit / 64 + 1) * 64;
+
+            if (bit >= last_bit) {
+                return;
+            }
+
+            word = row[bit / 64];
+        }
+
+        bit = bit / 64 * 64 + static_cast<std::uint64_t>(std::countr_zero(word));
+
+        if (bit >= last_bit) {
+            return;
+        }
+
+        auto stop = bit;
+        auto gaps = ~row[stop / 64] & (~std::uint64_t{0} << (stop % 64));
+
+        while (gaps == 0 && stop < last_bit) {
+            stop = (stop / 64 + 1) * 64;
+            gaps = ~row[stop / 64];
+        }
+
+        stop = std::min(stop / 64 * 64 + static_cast<std::uint64_t>(std::countr_zero(gaps)), last_bit);
+
+        f(bit - 1, stop - 1);
+        bit = stop;
+    }
+}
+
+
+
+// Life 1.06 and plaintext files do not give their size up front, they are read twice: once to measure them and once to fill the board.
+// Streams that cannot seek back are copied to memory first.
+template<typename Measure, typename Fill>
+pattern::Pattern read_twice(std::istream& stream, Measure measure, Fill fill) {
+    std::stringstream copy;
+
+    auto* input = &stream;
+    auto start = stream.tellg();
+
+    if (start == std::istream::pos_type(-1)) {
+        copy << stream.rdbuf();
+        input = &copy;
+        start = 0;
+    }
+
+    const Resolution size = measure(*input);
+
+    input->clear();
+    input->seekg(start);
+
+    pattern::Pattern pattern{BitBoard{size}, std::nullopt};
+    fill(*input, pattern.cells);
+
+    return pattern;
+}
+
+
+
+// Golly appends the bounded grid to the rule ("B3/S23:T100,100"), which is ignored.
+Rule parse_rule(std::string_view text) {
+    return Rule::parse(trim(text.substr(0, text.find(':'))));
+}
+
+
+// Tags of the RLE runs of cells.
+enum class RleTag : std::uint8_t { Other, Dead, Alive };
+
+constexpr auto rle_tags = [] {
+    std::array<RleTag, 256> tags{};
+
+    // Multi-state RLE: "." is dead, "A" alive and the dying states of Generations rules go from "B" on.
+    for (unsigned char c = 'B'; c <= 'X'; ++c) {
+        tags[c] = RleTag::Dead;
+    }
+
+    tags['b'] = RleTag::Dead;
+    tags['.'] = RleTag::Dead;
+    tags['o'] = RleTag::Alive;
+    tags['A'] = RleTag::Alive;
+
+    return tags;
+}();
+
+
+constexpr std::uint64_t bytes = 0x0101010101010101ULL;
+
+// One bit per character of the 64 from `chars` on, set for digits.
+std::uint64_t find_digits(const char* chars) {
+    std::uint64_t digits = 0;
+
+    for (std::size_t i = 0; i < 8; ++i) {
+        std::uint64_t word;
+        std::memcpy(&word, chars + 8 * i, sizeof(word));
+
+        // 0x80 in every byte from '0' to '9', then gathered into the top byte.
+        const auto low = word & (0x7f * bytes);
+        const auto found = (low + (0x80 - '0') * bytes) & ~(low + (0x80 - '9' - 1) * bytes) & ~word & (0x80 * bytes);
+
+        digits |= (((found >> 7) * 0x0102040810204080ULL) >> 56) << (8 * i);
+    }
+
+    return digits;
+}
+
+// The number written by the `length` (0 to 8) digits that end just before `end`, 0 for none.
+std::uint64_t parse_digits(const char* end, std::size_t length) {
+    std::uint64_t chars;
+    std::memcpy(&chars, end - 8, sizeof(chars));
+
+    // Leading zeros in place of what comes before the digits, then pairs, quads and the whole number.
+    const auto before = ~std::uint64_t{0} >> (4 * length) >> (4 * length);
+
+    auto value = chars & (0x0f * bytes) & ~before;
+    value = (value * 10 + (value >> 8)) & 0x00ff00ff00ff00ffULL;
+    value = (value * 100 + (value >> 16)) & 0x0000ffff0000ffffULL;
+    value = (value * 10000 + (value >> 32)) & 0xffffffffULL;
+
+    return value;
+}
+
+
+// Run lengths of no more than two digits (nearly all of them in soups) from the two characters in front of their tag, 1 without digits.
+// The character before a run's first digit is always another tag, whitespace or the zero padding of the reader.
+constexpr auto short_runs = [] {
+    std::array<std::uint8_t, 128 * 128> runs{};
+
+    auto is_digit = [](unsigned int c) { return c >= '0' && c <= '9'; };
+
+    for (unsigned int tens = 0; tens < 128; ++tens) {
+        for (unsigned int ones = 0; ones < 128; ++ones) {
+            const auto run = !is_digit(ones) ? 1 : !is_digit(tens) ? ones - '0' : (tens - '0') * 10 + ones - '0';
+            runs[tens * 128 + ones] = static_cast<std::uint8_t>(run);
+        }
+    }
+
+    return runs;
+}();
+
+// The length of a run from the `length` (0 to 8) digits ending just before its tag at `end`, no branching on the number of digits
+// unless there are more than two.
+std::uint64_t parse_run(const char* end, std::size_t length) {
+    if (length > 2) [[unlikely]] {
+        return parse_digits(end, length);
+    }
+
+    return short_runs[(static_cast<unsigned char>(end[-2]) & 0x7f) * 128 + (static_cast<unsigned char>(end[-1]) & 0x7f)];
+}
+
+
+// Sets the `run` cells from bit `bit` on, a run of up to 56 cells only touches the two words it may straddle.
+void add_live_run(std::uint64_t* row, std::uint64_t bit, std::uint64_t run) {
+    if (run > 56) [[unlikely]] {
+        set_run(row, bit, run);
+        return;
+    }
+
+    const auto mask = (std::uint64_t{1} << run) - 1;
+
+    row[bit / 64] |= mask << (bit % 64);
+    row[bit / 64 + 1] |= mask >> 1 >> (63 - bit % 64);
+}
+
+
+// Tokens (a run length and its tag) are found 64 characters at a time from a mask of the digits: every other character is a tag, and
+// the walk from one tag to the next is the only serial work. Run lengths are read from the characters in front of their tag, without
+// branching on how many digits there are up to two: random soups leave the branch predictor nothing to learn from them. Tags are
+// predictable, live and dead runs alternate within a row.
+//
+// Anything else (long numbers, line breaks within a token, tokens across chunks, multi-state prefixes, the end) goes through the
+// character at a time path.
+class RleDecoder {
+  public:
+    explicit RleDecoder(BitBoard& cells): cells{cells} {}
+
+
+    // Decodes from `next` to `end`, a chunk of a Reader with its padding around it. Returns where it stopped: `end`,
+    // or just after the '!' that ends the pattern.
+    const char* decode(const char* next, const char* end) {
+        while (next != end && !done) {
+            if (count == 0 && !prefixed) {
+                next = decode_tokens(next, end);
+
+                if (next == end) {
+                    break;
+                }
+            }
+
+            // At least one character, then the rest of its token.
+            do {
+                decode_char(static_cast<unsigned char>(*next++));
+            } while ((count != 0 || prefixed) && next != end && !done);
+        }
+
+        return next;
+    }
+
+    bool is_done() const { return done; }
+
+
+  private:
+    // Runs on copies of the position: stores to the board could alias the members, which would then be read back for every token.
+    const char* decode_tokens(const char* next, const char* end) {
+        const auto [width, height] = cells.get_resolution();
+
+        auto x = this->x;
+        auto y = this->y;
+
+        // The row being decoded, and the end of the cells that may be set in it (0 past the last row).
+        auto* row = y < height ? cells.row(y + 1) : nullptr;
+        std::uint64_t limit = y < height ? width : 0;
+
+        bool slow = false;
+
+        while (next != end && !slow) {
+            const auto left = static_cast<std::size_t>(end - next);
+            auto tags = ~find_digits(next) & (left >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << left) - 1);
+
+            std::size_t start = 0;
+
+            while (tags != 0) {
+                const auto tag = static_cast<std::size_t>(std::countr_zero(tags));
+                const auto length = tag - start;
+
+                const auto c = static_cast<unsigned char>(next[tag]);
+                const auto type = rle_tags[c];
+
+                if (length > 8) {
+                    slow = true;
+                    break;
+                }
+
+                const auto run = parse_run(next + tag, length);
+
+                if (type == RleTag::Alive) {
+                    if (x + run > limit) {
+                        throw std::invalid_argument("RLE pattern does not fit in the size of its header.");
+                    }
+
+                    add_live_run(row, x + 1, run);
+                    x += run;
+                } else if (type == RleTag::Dead) {
+                    x += run;
+                } else if (c == '$') {
+                    x = 0;
+                    y += run;
+
+                    row = y < height ? cells.row(y + 1) : nullptr;
+                    limit = y < height ? width : 0;
+                } else if (length > 0 || (c != '\n' && c != '\r' && c != ' ' && c != '\t')) {
+                    slow = true;
+                    break;
+                }
+
+                start = tag + 1;
+                tags &= tags - 1;
+            }
+
+            // No tag at all in 64 characters is a long number, or one running to the end of the chunk.
+            slow = slow || start == 0;
+            next += start;
+        }
+
+        this->x = x;
+        this->y = y;
+
+        return next;
+    }
+
+    void decode_char(unsigned char c) {
+        if (c >= '0' && c <= '9') {
+            count = count * 10 + (c - '0');
+
+            if (count > max_run) {
+                throw std::invalid_argument("RLE run is too long.");
+            }
+
+            return;
+        }
+
+        const auto run = std::max<std::uint64_t>(count, 1);
+
+        switch (rle_tags[c]) {
+            case RleTag::Alive:
+                if (!prefixed) {
+                    const auto [width, height] = cells.get_resolution();
+
+                    if (x + run > width || y >= height) {
+                        throw std::invalid_argument("RLE pattern does not fit in the size of its header.");
+                    }
+
+                    add_live_run(cells.row(y + 1), x + 1, run);
+                }
+
+                x += run;
+                break;
+
+            case RleTag::Dead: x += run; break;
+
+            default:
+                switch (c) {
+                    case '$':
+                        x = 0;
+                        y += run;
+                        break;
+
+                    case '!': done = true; break;
+
+                    case ' ':
+                    case '\t':
+                    case '\r':
+                    case '\n': return;
+
+                    default:
+                        if (c < 'p' || c > 'y') {
+                            throw std::invalid_argument("RLE pattern contains an unknown cell state.");
+                        }
+
+                        prefixed = true;
+                        return;
+                }
+        }
+
+        count = 0;
+        prefixed = false;
+    }
+
+
+    BitBoard& cells;
+
+    std::uint64_t x = 0;
+    std::uint64_t y = 0;
+    std::uint64_t count = 0;
+
+    // Multi-state RLE writes states from 25 on as a prefix letter and a state letter, which is not "A" alive.
+    bool prefixed = false;
+
+    bool done = false;
+};
+
+
+pattern::Pattern read_rle(std::istream& stream) {
+    Reader reader{stream};
+    std::string line;
+
+    std::optional<Rule> rule;
+    std::optional<Resolution> size;
+
+    while (!size && reader.get_line(line)) {
+        const auto text = trim(line);
+
+        // "#r" is the rule line of older files, other comments ("#C", "#N", "#O", "#P"...) are skipped.
+        if (text.starts_with("#r")) {
+            rule = parse_rule(text.substr(2));
+            continue;
+        }
+
+        if (text.empty() || text.starts_with('#')) {
+            continue;
+        }
+
+        // "x = 3, y = 3, rule = B3/S23", the rule goes to the end of the line as Larger than Life rules contain commas.
+        std::uint64_t width = 0;
+        std::uint64_t height = 0;
+
+        for (auto fields = text; !fields.empty();) {
+            const auto equals = fields.find('=');
+
+            if (equals == std::string_view::npos) {
+                throw std::invalid_argument("RLE pattern must start with an \"x = ..., y = ...\" header.");
+            }
+
+            const auto key = trim(fields.substr(0, equals));
+            fields.remove_prefix(equals + 1);
+
+            if (key == "rule") {
+                rule = parse_rule(fields);
+                break;
+            }
+
+            const auto comma = std::min(fields.find(','), fields.size());
+
+            if (key == "x") {
+                width = parse_number<std::uint64_t>(fields.substr(0, comma));
+            } else if (key == "y") {
+                height = parse_number<std::uint64_t>(fields.substr(0, comma));
+            }
+
+            fields.remove_prefix(std::min(comma + 1, fields.size()));
+        }
+
+        size = check_size(width, height);
+    }
+
+    if (!size) {
+        throw std::invalid_argument("RLE pattern must start with an \"x = ..., y = ...\" header.");
+    }
+
+    pattern::Pattern pattern{BitBoard{*size}, rule};
+    RleDecoder decoder{pattern.cells};
+
+    while (!decoder.is_done() && (reader.next != reader.end || reader.refill())) {
+        reader.next = decoder.decode(reader.next, reader.end);
+    }
+
+    return pattern;
+}
+
+
+void write_rle(std::ostream& stream, const BitBoard& cells, const Rule& rule) {
+    const auto [width, height] = cells.get_resolution();
+
+    Writer writer{stream};
+
+    writer.put("x = ");
+    writer.put(std::int64_t{width});
+    writer.put(", y = ");
+    writer.put(std::int64_t{height});
+    writer.put(", rule = ");
+    writer.put(rule.to_string());
+    writer.put('\n');
+
+    std::size_t line_length = 0;
+
+    auto put_run = [&](std::uint64_t count, char tag) {
+        std::array<char, 24> token;
+        auto* end = token.begin();
+
+        if (count > 1) {
+            end = std::to_chars(token.begin(), token.end() - 1, count).ptr;
+        }
+
+        *end++ = tag;
+
+        const auto length = static_cast<std::size_t>(end - token.begin());
+
+        if (line_length + length > rle_line_length) {
+            writer.put('\n');
+            line_length = 0;
+        }
+
+        writer.put(std::string_view{token.begin(), end});
+        line_length += length;
+    };
+
+    // Row ends are held back until the next live cell, so trailing dead cells and rows are never written.
+    std::uint64_t row_ends = 0;
+
+    for (std::size_t y = 0; y < height; ++y) {
+        std::uint64_t x = 0;
+
+        for_each_run(cells, y, [&](std::uint64_t begin, std::uint64_t end) {
+            if (row_ends > 0) {
+                put_run(row_ends, '$');
+                row_ends = 0;
+            }
+
+            if (begin > x) {
+                put_run(begin - x, 'b');
+            }
+
+            put_run(end - begin, 'o');
+            x = end;
+        });
+
+        ++row_ends;
+    }
+
+    writer.put("!\n");
+}
+
+
+
+// Calls f(x, y) for each cell of a Life 1.06 file.
+template<typename F>
+void for_each_life106_cell(std::istream& stream, F&& f) {
+    Reader reader{stream};
+    std::string line;
+
+    if (!reader.get_line(line) || !trim(line).starts_with("#Life 1.06")) {
+        throw std::invalid_argument("Life 1.06 pattern must start with \"#Life 1.06\".");
+    }
+
+    while (reader.get_line(line)) {
+        const auto text = trim(line);
+
+        if (text.empty() || text.starts_with('#')) {
+            continue;
+        }
+
+        const auto space = text.find_first_of(" \t");
+
+        if (space == std::string_view::npos) {
+            throw std::invalid_argument("Life 1.06 lines must hold an x and a y coordinate.");
+        }
+
+        f(parse_number<std::int64_t>(text.substr(0, space)), parse_number<std::int64_t>(text.substr(space)));
+    }
+}
+
+
+pattern::Pattern read_life106(std::istream& stream) {
+    auto x_min = std::numeric_limits<std::int64_t>::max();
+    auto y_min = std::numeric_limits<std::int64_t>::max();
+    auto x_max = std::numeric_limits<std::int64_t>::min();
+    auto y_max = std::numeric_limits<std::int64_t>::min();
+
+    auto measure = [&](std::istream& input) {
+        for_each_life106_cell(input, [&](std::int64_t x, std::int64_t y) {
+            x_min = std::min(x_min, x);
+            y_min = std::min(y_min, y);
+            x_max = std::max(x_max, x);
+            y_max = std::max(y_max, y);
+        });
+
+        if (x_min > x_max) {
+            return Resolution{0, 0};
+        }
+
+        return check_size(static_cast<std::uint64_t>(x_max - x_min) + 1, static_cast<std::uint64_t>(y_max - y_min) + 1);
+    };
+
+    auto fill = [&](std::istream& input, BitBoard& cells) {
+        for_each_life106_cell(input, [&](std::int64_t x, std::int64_t y) {
+            cells.set(static_cast<unsigned int>(x - x_min), static_cast<unsigned int>(y - y_min), true);
+        });
+    };
+
+    return read_twice(stream, measure, fill);
+}
+
+
+void write_life106(std::ostream& stream, const BitBoard& cells) {
+    Writer writer{stream};
+
+    writer.put("#Life 1.06\n");
+
+    for (std::size_t y = 0; y < cells.get_resolution().y; ++y) {
+        for_each_run(cells, y, [&](std::uint64_t begin, std::uint64_t end) {
+            for (auto x = begin; x < end; ++x) {
+                writer.put(static_cast<std::int64_t>(x));
+                writer.put(' ');
+                writer.put(static_cast<std::int64_t>(y));
+                writer.put('\n');
+            }
+        });
+    }
+}
+
+
+
+// Calls f(row) for each row of a plaintext file, '!' lines are comments.
+template<typename F>
+void for_each_plaintext_row(std::istream& stream, F&& f) {
+    Reader reader{stream};
+    std::string line;
+
+    while (reader.get_line(line)) {
+        if (!line.starts_with('!')) {
+            f(std::string_view{line});
+        }
+    }
+}
+
+
+pattern::Pattern read_plaintext(std::istream& stream) {
+    auto measure = [](std::istream& input) {
+        std::uint64_t width = 0;
+        std::uint64_t height = 0;
+
+        for_each_plaintext_row(input, [&](std::string_view row) {
+            width = std::max<std::uint64_t>(width, trim_end(row).size());
+            ++height;
+        });
+
+        return check_size(width, height);
+    };
+
+    auto fill = [](std::istream& input, BitBoard& cells) {
+        unsigned int y = 0;
+
+        for_each_plaintext_row(input, [&](std::string_view row) {
+            row = trim_end(row);
+
+            for (unsigned int x = 0; x < row.size(); ++x) {
+                if (row[x] == 'O' || row[x] == '*') {
+                    cells.set(x, y, true);
+                } else if (row[x] != '.') {
+                    throw std::invalid_argument("Plaintext cells must be '.' or 'O'.");
+                }
+            }
+
+            ++y;
+        });
+    };
+
+    return read_twice(stream, measure, fill);
+}
+
+
+void write_plaintext(std::ostream& stream, const BitBoard& cells) {
+    const auto [width, height] = cells.get_resolution();
+
+    Writer writer{stream};
+    std::string line;
+
+    for (std::size_t y = 0; y < height; ++y) {
+        line.assign(width, '.');
+
+        for_each_run(cells, y, [&](std::uint64_t begin, std::uint64_t end) {
+            std::fill(line.begin() + static_cast<std::ptrdiff_t>(begin), line.begin() + static_cast<std::ptrdiff_t>(end), 'O');
+        });
+
+        writer.put(line);
+        writer.put('\n');
+    }
+}
+
+
+
+// Macrocell nodes are 8x8 leaves (level 3) or four children of the level below, 0 is the empty node of any level.
+struct MacrocellNode {
+    unsigned int level = 0;
+
+    // North west, north east, south west, south east.
+    std::array<std::uint32_t, 4> children{};
+
+    // Bit 8 y + x.
+    std::uint64_t leaf = 0;
+
+    // Relative to the node's top left corner.
+    std::optional<BoundingBox> box;
+};
+
+constexpr unsigned int macrocell_leaf_level = 3;
+constexpr unsigned int macrocell_max_level = 62;
+
+
+std::optional<BoundingBox> merge(std::optional<BoundingBox> box, std::optional<BoundingBox> other, std::int64_t x, std::int64_t y) {
+    if (!other) {
+        return box;
+    }
+
+    const BoundingBox moved{other->x_min + x, other->y_min + y, other->x_max + x, other->y_max + y};
+
+    if (!box) {
+        return moved;
+    }
+
+    return BoundingBox{std::min(box->x_min, moved.x_min), std::min(box->y_min, moved.y_min), std::max(box->x_max, moved.x_max),
+          std::max(box->y_max, moved.y_max)};
+}
+
+
+MacrocellNode parse_macrocell_leaf(std::string_view text) {
+    MacrocellNode node;
+    node.level = macrocell_leaf_level;
+
+    unsigned int x = 0;
+    unsigned int y = 0;
+
+    for (const char c: text) {
+        if (c == '$') {
+            x = 0;
+            ++y;
+            continue;
+        }
+
+        if ((c != '.' && c != '*') || x >= 8 || y >= 8) {
+            throw std::invalid_argument("Macrocell leaves are 8 rows of '.' and '*' ended by '$'.");
+        }
+
+        if (c == '*') {
+            node.leaf |= std::uint64_t{1} << (8 * y + x);
+            node.box = merge(node.box, BoundingBox{x, y, x, y}, 0, 0);
+        }
+
+        ++x;
+    }
+
+    return node;
+}
+
+MacrocellNode parse_macrocell_node(std::string_view text, const std::vector<MacrocellNode>& nodes) {
+    std::array<std::uint64_t, 5> fields{};
+
+    for (auto& field: fields) {
+        text = trim(text);
+
+        const auto space = std::min(text.find(' '), text.size());
+        field = parse_number<std::uint64_t>(text.substr(0, space));
+
+        text.remove_prefix(space);
+    }
+
+    const auto level = fields[0];
+
+    if (level <= macrocell_leaf_level) {
+        throw std::invalid_argument("Multi-state macrocell patterns are not supported.");
+    }
+
+    if (level > macrocell_max_level) {
+        throw std::invalid_argument("Pattern is too large to expand.");
+    }
+
+    MacrocellNode node;
+    node.level = static_cast<unsigned int>(level);
+
+    const auto half = std::int64_t{1} << (level - 1);
+
+    for (std::size_t i = 0; i < 4; ++i) {
+        const auto child = fields[i + 1];
+
+        if (child >= nodes.size() || (child != 0 && nodes[child].level != level - 1)) {
+            throw std::invalid_argument("Macrocell nodes must refer to earlier nodes one level below.");
+        }
+
+        node.children[i] = static_cast<std::uint32_t>(child);
+        node.box = merge(node.box, nodes[child].box, half * static_cast<std::int64_t>(i % 2), half * static_cast<std::int64_t>(i / 2));
+    }
+
+    return node;
+}
+
+
+void draw_macrocell(const std::vector<MacrocellNode>& nodes, std::uint32_t index, std::int64_t x, std::int64_t y, BitBoard& cells) {
+    const auto& node = nodes[index];
+
+    if (!node.box) {
+        return;
+    }
+
+    if (node.level == macrocell_leaf_level) {
+        for (std::int64_t row = 0; row < 8; ++row) {
+            if (const auto bits = (node.leaf >> (8 * row)) & 0xff; bits != 0) {
+                or_byte(cells.row(static_cast<std::size_t>(y + row + 1)), x + 1, bits);
+            }
+        }
+
+        return;
+    }
+
+    const auto half = std::int64_t{1} << (node.level - 1);
+
+    for (std::int64_t i = 0; i < 4; ++i) {
+        draw_macrocell(nodes, node.children[static_cast<std::size_t>(i)], x + half * (i % 2), y + half * (i / 2), cells);
+    }
+}
+
+
+pattern::Pattern read_macrocell(std::istream& stream) {
+    Reader reader{stream};
+    std::string line;
+
+    if (!reader.get_line(line) || !line.starts_with("[M2]")) {
+        throw std::invalid_argument("Macrocell pattern must start with \"[M2]\".");
+    }
+
+    std::optional<Rule> rule;
+
+    // Index 0 is the empty node.
+    std::vector<MacrocellNode> nodes(1);
+
+    while (reader.get_line(line)) {
+        const auto text = trim(line);
+
+        if (text.starts_with("#R")) {
+            rule = parse_rule(text.substr(2));
+        } else if (text.empty() || text.starts_with('#')) {
+            continue;
+        } else if (text.front() >= '0' && text.front() <= '9') {
+            nodes.push_back(parse_macrocell_node(text, nodes));
+        } else {
+            nodes.push_back(parse_macrocell_leaf(text));
+        }
+    }
+
+    // The last node is the root.
+    const auto& box = nodes.back().box;
+
+    if (!box) {
+        return {BitBoard{{0, 0}}, rule};
+    }
+
+    const auto size =
+          check_size(static_cast<std::uint64_t>(box->x_max - box->x_min) + 1, static_cast<std::uint64_t>(box->y_max - box->y_min) + 1);
+
+    pattern::Pattern pattern{BitBoard{size}, rule};
+
+    draw_macrocell(nodes, static_cast<std::uint32_t>(nodes.size() - 1), -box->x_min, -box->y_min, pattern.cells);
+
+    return pattern;
+}
+
+
+struct MacrocellKeyHash {
+    std::size_t operator()(const std::array<std::uint32_t, 5>& key) const {
+        std::uint64_t hash = 0;
+
+        for (const auto value: key) {
+            hash = (hash ^ value) * 0x9e3779b97f4a7c15ULL;
+        }
+
+        return static_cast<std::size_t>(hash ^ (hash >> 32));
+    }
+};
+
+
+// Writes the board as a quadtree with identical nodes shared, children before their parents as the format requires.
+class MacrocellWriter {
+  public:
+    MacrocellWriter(std::ostream& stream, const BitBoard& cells): writer{stream}, cells{cells} {}
+
+
+    void write(const Rule& rule) {
+        writer.put("[M2] (slime)\n#R ");
+        writer.put(rule.to_string());
+        writer.put('\n');
+
+        const auto [width, height] = cells.get_resolution();
+
+        auto level = macrocell_leaf_level;
+
+        while ((std::uint64_t{1} << level) < std::max(width, height)) {
+            ++level;
+        }
+
+        // An empty pattern still needs a root.
+        if (add(level, 0, 0) == 0) {
+            writer.put("$\n");
+        }
+    }
+
+
+  private:
+    std::uint32_t add(unsigned int level, std::uint64_t x, std::uint64_t y) {
+        const auto [width, height] = cells.get_resolution();
+
+        if (x >= width || y >= height) {
+            return 0;
+        }
+
+        if (level == macrocell_leaf_level) {
+            return add_leaf(x, y);
+        }
+
+        const auto half = std::uint64_t{1} << (level - 1);
+
+        const std::array<std::uint32_t, 5> key{
+              level, add(level - 1, x, y), add(level - 1, x + half, y), add(level - 1, x, y + half), add(level - 1, x + half, y + half)};
+
+        if (key[1] == 0 && key[2] == 0 && key[3] == 0 && key[4] == 0) {
+            return 0;
+        }
+
+        const auto [node, added] = nodes.try_emplace(key, count + 1);
+
+        if (added) {
+            ++count;
+
+            for (std::size_t i = 0; i < key.size(); ++i) {
+                writer.put(static_cast<std::int64_t>(key[i]));
+                writer.put(i + 1 < key.size() ? ' ' : '\n');
+            }
+        }
+
+        return node->second;
+    }
+
+    std::uint32_t add_leaf(std::uint64_t x, std::uint64_t y) {
+        std::uint64_t leaf = 0;
+
+        for (std::uint64_t row = 0; row < 8 && y + row < cells.get_resolution().y; ++row) {
+            leaf |= get_byte(cells, x, y + row) << (8 * row);
+        }
+
+        if (leaf == 0) {
+            return 0;
+        }
+
+        const auto [node, added] = leaves.try_emplace(leaf, count + 1);
+
+        if (added) {
+            ++count;
+
+            // Each row up to its last live cell, rows after the last live one are left out.
+            for (unsigned int row = 0; row < 8 && (leaf >> (8 * row)) != 0; ++row) {
+                const auto bits = (leaf >> (8 * row)) & 0xff;
+
+                for (unsigned int column = 0; (bits >> column) != 0; ++column) {
+                    writer.put((bits >> column & 1) != 0 ? '*' : '.');
+                }
+
+                writer.put('$');
+            }
+
+            writer.put('\n');
+        }
+
+        return node->second;
+    }
+
+
+    Writer writer;
+    const BitBoard& cells;
+
+    std::uint32_t count = 0;
+
+    std::unordered_map<std::uint64_t, std::uint32_t> leaves;
+    std::unordered_map<std::array<std::uint32_t, 5>, std::uint32_t, MacrocellKeyHash> nodes;
+};
+
+} // namespace
+
+
+
+namespace pattern {
+
+
+std::optional<Format> get_format(const std::filesystem::path& path) {
+    auto extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    if (extension == ".rle") {
+        return Format::Rle;
+    }
+
+    if (extension == ".lif" || extension == ".life") {
+        return Format::Life106;
+    }
+
+    if (extension == ".cells") {
+        return Format::Plaintext;
+    }
+
+    if (extension == ".mc") {
+        return Format::Macrocell;
+    }
+
+    return std::nullopt;
+}
+
+
+Pattern read(std::istream& stream, Format format) {
+    switch (format) {
+        case Format::Rle: return read_rle(stream);
+        case Format::Life106: return read_life106(stream);
+        case Format::Plaintext: return read_plaintext(stream);
+        case Format::Macrocell: return read_macrocell(stream);
+    }
+
+    throw std::invalid_argument("Unknown pattern format.");
+}
+
+void write(std::ostream& stream, const BitBoard& cells, Format format, const Rule& rule) {
+    switch (format) {
+        case Format::Rle: write_rle(stream, cells, rule); break;
+        case Format::Life106: write_life106(stream, cells); break;
+        case Format::Plaintext: write_plaintext(stream, cells); break;
+        case Format::Macrocell: MacrocellWriter{stream, cells}.write(rule); break;
+    }
+}
+
+
+Pattern load(const std::filesystem::path& path) {
+    const auto format = get_format(path);
+
+    if (!format) {
+        throw std::invalid_argument("Pattern files must be .rle, .lif, .life, .cells or .mc.");
+    }
+
+    std::ifstream file{path, std::ios::binary};
+
+    if (!file) {
+        throw std::runtime_error("Could not open pattern file.");
+    }
+
+    return read(file, *format);
+}
+
+void save(const std::filesystem::path& path, const BitBoard& cells, const Rule& rule) {
+    const auto format = get_format(path);
+
+    if (!format) {
+        throw std::invalid_argument("Pattern files must be .rle, .lif, .life, .cells or .mc.");
+    }
+
+    std::ofstream file{path, std::ios::binary};
+
+    if (!file) {
+        throw std::runtime_error("Could not open pattern file.");
+    }
+
+    write(file, cells, *format, rule);
+
+    if (!file.flush()) {
+        throw std::runtime_error("Could not write pattern file.");
+    }
+}
+
+
+void place(const BitBoard& pattern, std::span<std::uint8_t> cells, Resolution res) {
+    if (cells.size() != std::size_t{res.x} * res.y) {
+        throw std::invalid_argument("Cell buffer does not match the board resolution.");
+    }
+
+    std::fill(cells.begin(), cells.end(), 0);
+
+    const auto size = pattern.get_resolution();
+
+    const auto offset_x = (std::int64_t{res.x} - std::int64_t{size.x}) / 2;
+    const auto offset_y = (std::int64_t{res.y} - std::int64_t{size.y}) / 2;
+
+    for (std::size_t y = 0; y < size.y; ++y) {
+        const auto board_y = offset_y + static_cast<std::int64_t>(y);
+
+        if (board_y < 0 || board_y >= res.y) {
+            continue;
+        }
+
+        auto* row = &cells[static_cast<std::size_t>(board_y) * res.x];
+
+        for_each_run(pattern, y, [&](std::uint64_t begin, std::uint64_t end) {
+            const auto first = std::clamp<std::int64_t>(offset_x + static_cast<std::int64_t>(begin), 0, res.x);
+            const auto last = std::clamp<std::int64_t>(offset_x + static_cast<std::int64_t>(end), 0, res.x);
+
+            std::fill(row + first, row + last, 1);
+        });
+    }
+}
+
+
+} // namespace pattern
@@ -18,6 +18,50 @@ Buffer::~Buffer() {
 }
 
 
+std::span<const std::byte> Buffer::allocate_mapped(std::size_t size) {
+    constexpr GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glNamedBufferStorage(id, static_cast<GLsizeiptr>(size), nullptr, flags);
+
+    return {static_cast<const std::byte*>(glMapNamedBufferRange(id, 0, static_cast<GLsizeiptr>(size), flags)), size};
+}
+
+
+Fence::~Fence() {
+    reset();
+}
+
+Fence& Fence::operator=(Fence&& other) noexcept {
+    reset();
+    sync = std::exchange(other.sync, nullptr);
+
+    return *this;
+}
+
+
+void Fence::insert() {
+    reset();
+    sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void Fence::reset() {
+    if (sync != nullptr) {
+        glDeleteSync(sync);
+        sync = nullptr;
+    }
+}
+
+
+bool Fence::is_signaled() const {
+    if (sync == nullptr) {
+        return true;
+    }
+
+    const GLenum status = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+
 VAO::VAO() {
     glCreateVertexArrays(1, &id);
 }
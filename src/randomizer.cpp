@@ -0,0 +1,210 @@
+#include "randomizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+#include "thread_pool.hpp"
+
+
+
+// The helpers below are always inlined into the target specific functions, their vector arguments never cross an ABI boundary.
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+
+
+namespace randomizer {
+
+
+namespace {
+
+// Philox blocks of a 64 column chunk, one per 4 columns.
+constexpr std::size_t blocks = 16;
+
+constexpr std::size_t rows_per_task = 64;
+
+
+#if defined(__x86_64__) || defined(__i386__)
+using u64x4 = std::uint64_t __attribute__((vector_size(32)));
+using u64x8 = std::uint64_t __attribute__((vector_size(64)));
+#endif
+
+
+// The 16 blocks of columns [64 * chunk, 64 * chunk + 64) of row y side by side, the same draws as philox(). Each word of a counter
+// sits in the low half of a 64-bit lane: masking both factors to 32 bits makes the product a single 32 x 32 -> 64 bit multiply per
+// vector, the high halves of the lanes are never read otherwise.
+template<typename V>
+[[gnu::always_inline]] inline std::uint64_t draw_chunk(std::uint64_t seed, std::uint32_t threshold, std::uint32_t chunk, std::uint32_t y) {
+    constexpr std::size_t lanes = sizeof(V) / sizeof(std::uint64_t);
+    constexpr std::size_t groups = blocks / lanes;
+    constexpr std::uint64_t low = 0xffffffff;
+
+    std::array<std::uint64_t, blocks> words;
+
+    for (std::size_t i = 0; i < blocks; ++i) {
+        words[i] = std::uint64_t{chunk} * blocks + i;
+    }
+
+    std::array<V, groups> c0;
+    std::array<V, groups> c1;
+    std::array<V, groups> c2;
+    std::array<V, groups> c3;
+
+    for (std::size_t g = 0; g < groups; ++g) {
+        std::memcpy(&c0[g], &words[g * lanes], sizeof(V));
+        c1[g] = V{} + y;
+        c2[g] = V{};
+        c3[g] = V{};
+    }
+
+    V m0 = V{} + 0xd2511f53;
+    V m1 = V{} + 0xcd9e8d57;
+
+    // Left as constants, GCC breaks the multiplies down into shifts and adds, several times slower than vpmuludq on AVX2.
+    if constexpr (lanes > 1) {
+        asm("" : "+x"(m0), "+x"(m1));
+    }
+
+    std::uint64_t k0 = seed & low;
+    std::uint64_t k1 = seed >> 32;
+
+    for (int round = 0; round < 10; ++round) {
+        for (std::size_t g = 0; g < groups; ++g) {
+            const V p0 = (c0[g] & low) * (m0 & low);
+            const V p1 = (c2[g] & low) * (m1 & low);
+
+            c0[g] = (p1 >> 32) ^ c1[g] ^ k0;
+            c1[g] = p1;
+            c2[g] = (p0 >> 32) ^ c3[g] ^ k1;
+            c3[g] = p0;
+        }
+
+        k0 = (k0 + 0x9e3779b9) & low;
+        k1 = (k1 + 0xbb67ae85) & low;
+    }
+
+    // Draw j of block i is bit 4 * i + j of the chunk, set in its own lane first and the lanes or-ed together last.
+    V bits{};
+
+    for (std::size_t g = 0; g < groups; ++g) {
+        std::array<V, 4> draws{c0[g], c1[g], c2[g], c3[g]};
+
+        for (std::size_t j = 0; j < 4; ++j) {
+            std::array<std::uint64_t, lanes> positions;
+
+            for (std::size_t lane = 0; lane < lanes; ++lane) {
+                positions[lane] = std::uint64_t{1} << (4 * (g * lanes + lane) + j);
+            }
+
+            V position;
+            std::memcpy(&position, positions.data(), sizeof(V));
+
+            bits |= (draws[j] & low) >> (32 - threshold_bits) < threshold ? position : V{};
+        }
+    }
+
+    std::array<std::uint64_t, lanes> words_of_bits;
+    std::memcpy(words_of_bits.data(), &bits, sizeof(V));
+
+    std::uint64_t word = 0;
+
+    for (const auto each: words_of_bits) {
+        word |= each;
+    }
+
+    return word;
+}
+
+
+// Board rows [begin, end), drawn as the rows first_row on. Column x is bit x + 1 of a row, so each chunk straddles two words.
+template<typename V>
+[[gnu::always_inline]] inline void fill_rows_with(BitBoard& board, std::uint32_t first_row, std::uint64_t seed, std::uint32_t threshold,
+      std::size_t begin, std::size_t end) {
+
+    const auto res = board.get_resolution();
+    const std::size_t chunks = (std::size_t{res.x} + 63) / 64;
+
+    for (std::size_t y = begin; y < end; ++y) {
+        std::uint64_t* row = board.row(y + 1);
+        std::uint64_t carry = 0;
+
+        for (std::size_t word = 0; word < board.get_words_per_row(); ++word) {
+            const std::uint64_t chunk = word < chunks ? draw_chunk<V>(seed, threshold, static_cast<std::uint32_t>(word),
+                                                              static_cast<std::uint32_t>(first_row + y))
+                                                      : 0;
+
+            row[word] = chunk << 1 | carry;
+            carry = chunk >> 63;
+        }
+    }
+}
+
+
+using FillRows = void (*)(BitBoard&, std::uint32_t, std::uint64_t, std::uint32_t, std::size_t, std::size_t);
+
+void fill_rows_scalar(
+      BitBoard& board, std::uint32_t first_row, std::uint64_t seed, std::uint32_t threshold, std::size_t begin, std::size_t end) {
+    fill_rows_with<std::uint64_t>(board, first_row, seed, threshold, begin, end);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) void fill_rows_avx2(
+      BitBoard& board, std::uint32_t first_row, std::uint64_t seed, std::uint32_t threshold, std::size_t begin, std::size_t end) {
+    fill_rows_with<u64x4>(board, first_row, seed, threshold, begin, end);
+}
+
+__attribute__((target("avx512f"))) void fill_rows_avx512(
+      BitBoard& board, std::uint32_t first_row, std::uint64_t seed, std::uint32_t threshold, std::size_t begin, std::size_t end) {
+    fill_rows_with<u64x8>(board, first_row, seed, threshold, begin, end);
+}
+#endif
+
+FillRows select(bit_kernel::Isa isa) {
+    switch (isa) {
+#if defined(__x86_64__) || defined(__i386__)
+        case bit_kernel::Isa::Avx512: return &fill_rows_avx512;
+        case bit_kernel::Isa::Avx2: return &fill_rows_avx2;
+#endif
+        default: return &fill_rows_scalar;
+    }
+}
+
+} // namespace
+
+
+
+std::uint32_t get_threshold(float density) {
+    if (!(density >= 0 && density <= 1)) {
+        throw std::invalid_argument("Densities must be between 0 and 1.");
+    }
+
+    return static_cast<std::uint32_t>(std::lround(static_cast<double>(density) * (1 << threshold_bits)));
+}
+
+
+void fill(BitBoard& board, std::uint64_t seed, float density, unsigned int threads, bit_kernel::Isa isa) {
+    fill_band(board, 0, seed, density, threads, isa);
+}
+
+void fill_band(BitBoard& board, std::uint32_t first_row, std::uint64_t seed, float density, unsigned int threads, bit_kernel::Isa isa) {
+    const std::uint32_t threshold = get_threshold(density);
+    const FillRows fill_rows = select(isa);
+
+    const std::size_t rows = board.get_resolution().y;
+    const std::size_t tasks = (rows + rows_per_task - 1) / rows_per_task;
+
+    ThreadPool pool{threads};
+
+    pool.parallel_for(tasks, [&](std::size_t task) {
+        fill_rows(board, first_row, seed, threshold, task * rows_per_task, std::min(rows, (task + 1) * rows_per_task));
+    });
+
+    board.clear_halo();
+}
+
+
+} // namespace randomizer
@@ -0,0 +1,274 @@
+#include "rule.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+#include <utility>
+
+
+
+namespace {
+
+constexpr std::uint32_t max_states = 256;
+constexpr std::uint32_t max_range = 500;
+
+
+// Neighbour counts as a bit mask, "" is a valid empty set.
+std::uint16_t parse_counts(std::string_view digits) {
+    std::uint16_t bits = 0;
+
+    for (const char digit: digits) {
+        if (digit < '0' || digit > '8') {
+            throw std::invalid_argument("Rule neighbour counts must be digits from 0 to 8.");
+        }
+
+        bits |= static_cast<std::uint16_t>(1 << (digit - '0'));
+    }
+
+    return bits;
+}
+
+std::string format_counts(std::uint16_t bits) {
+    std::string digits;
+
+    for (int count = 0; count <= 8; ++count) {
+        if ((bits >> count & 1) != 0) {
+            digits += static_cast<char>('0' + count);
+        }
+    }
+
+    return digits;
+}
+
+
+std::uint32_t parse_number(std::string_view text) {
+    std::uint32_t value = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+
+    if (text.empty() || error != std::errc{} || end != text.data() + text.size()) {
+        throw std::invalid_argument("Rule numbers must be unsigned integers.");
+    }
+
+    return value;
+}
+
+std::uint16_t parse_states(std::string_view text) {
+    const auto states = parse_number(text);
+
+    // Golly writes 2 states as C0 or C2.
+    if (states == 0) {
+        return 2;
+    }
+
+    if (states < 2 || states > max_states) {
+        throw std::invalid_argument("Rules have 2 to 256 states.");
+    }
+
+    return static_cast<std::uint16_t>(states);
+}
+
+char prefix(std::string_view part) {
+    return part.empty() ? '\0' : static_cast<char>(std::toupper(static_cast<unsigned char>(part.front())));
+}
+
+
+// "R5,C0,M1,S34..58,B34..45,NM"
+Rule parse_larger_than_life(std::string_view text) {
+    Rule rule{.birth = 0, .survival = 0};
+    bool has_range = false;
+    bool has_birth = false;
+    bool has_survival = false;
+
+    auto parse_interval = [](std::string_view interval) {
+        const auto dots = interval.find("..");
+
+        if (dots == std::string_view::npos) {
+            const auto count = parse_number(interval);
+            return Rule::Interval{count, count};
+        }
+
+        return Rule::Interval{parse_number(interval.substr(0, dots)), parse_number(interval.substr(dots + 2))};
+    };
+
+    while (!text.empty()) {
+        const auto comma = text.find(',');
+        const auto token = text.substr(0, comma);
+        text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+
+        const auto value = token.substr(std::min<std::size_t>(1, token.size()));
+
+        switch (prefix(token)) {
+            case 'R': {
+                const auto range = parse_number(value);
+
+                // Checked before narrowing, R65537 must not wrap around to 1.
+                if (range < 1 || range > max_range) {
+                    throw std::invalid_argument("Larger than Life ranges go from 1 to 500.");
+                }
+
+                rule.range = static_cast<std::uint16_t>(range);
+                has_range = true;
+                break;
+            }
+
+            case 'C': rule.states = parse_states(value); break;
+            case 'M': rule.include_centre = parse_number(value) != 0; break;
+
+            case 'S':
+                rule.survival_counts = parse_interval(value);
+                has_survival = true;
+                break;
+
+            case 'B':
+                rule.birth_counts = parse_interval(value);
+                has_birth = true;
+                break;
+
+            case 'N':
+                if (value != "M" && value != "m") {
+                    throw std::invalid_argument("Only Moore (NM) Larger than Life neighbourhoods are supported.");
+                }
+                break;
+
+            default: throw std::invalid_argument("Unknown Larger than Life rule field.");
+        }
+    }
+
+    if (!has_range || !has_birth || !has_survival) {
+        throw std::invalid_argument("Larger than Life rules need R, B and S fields.");
+    }
+
+    rule.validate();
+
+    // Range 1 is an ordinary rule, written with the masks so that it compares equal to its B/S spelling and runs on every engine.
+    if (rule.range == 1) {
+        for (std::uint32_t count = 0; count <= 8; ++count) {
+            const auto with_centre = count + (rule.include_centre ? 1 : 0);
+
+            rule.birth |= static_cast<std::uint16_t>(rule.birth_counts.contains(count) ? 1 << count : 0);
+            rule.survival |= static_cast<std::uint16_t>(rule.survival_counts.contains(with_centre) ? 1 << count : 0);
+        }
+
+        rule.include_centre = false;
+        rule.birth_counts = {};
+        rule.survival_counts = {};
+    }
+
+    return rule;
+}
+
+} // namespace
+
+
+
+Rule Rule::parse(std::string_view text) {
+    if (prefix(text) == 'R' && text.find(',') != std::string_view::npos) {
+        return parse_larger_than_life(text);
+    }
+
+    std::array<std::string_view, 3> parts{};
+    std::size_t count = 0;
+
+    for (std::size_t begin = 0;;) {
+        const auto slash = text.find('/', begin);
+
+        if (count == parts.size()) {
+            throw std::invalid_argument("Rule must be written as B.../S..., S/B or either with a state count.");
+        }
+
+        parts[count++] = text.substr(begin, slash == std::string_view::npos ? std::string_view::npos : slash - begin);
+
+        if (slash == std::string_view::npos) {
+            break;
+        }
+
+        begin = slash + 1;
+    }
+
+    if (count < 2) {
+        throw std::invalid_argument("Rule must be written as B.../S..., S/B or either with a state count.");
+    }
+
+    Rule rule;
+
+    if (count == 3) {
+        rule.states = parse_states(prefix(parts[2]) == 'C' ? parts[2].substr(1) : parts[2]);
+    }
+
+    auto first = parts[0];
+    auto second = parts[1];
+
+    // S/B without letters.
+    if (prefix(first) != 'B' && prefix(first) != 'S' && prefix(second) != 'B' && prefix(second) != 'S') {
+        rule.birth = parse_counts(second);
+        rule.survival = parse_counts(first);
+
+        return rule;
+    }
+
+    if (prefix(first) == 'S' && prefix(second) == 'B') {
+        std::swap(first, second);
+    }
+
+    if (prefix(first) != 'B' || prefix(second) != 'S') {
+        throw std::invalid_argument("Rule must be written as B.../S..., S/B or either with a state count.");
+    }
+
+    rule.birth = parse_counts(first.substr(1));
+    rule.survival = parse_counts(second.substr(1));
+
+    return rule;
+}
+
+
+void Rule::validate() const {
+    if (states < 2 || states > max_states) {
+        throw std::invalid_argument("Rules have 2 to 256 states.");
+    }
+
+    if (range < 1 || range > max_range) {
+        throw std::invalid_argument("Larger than Life ranges go from 1 to 500.");
+    }
+
+    if (birth > 0x1ff || survival > 0x1ff) {
+        throw std::invalid_argument("Rule neighbour counts must be digits from 0 to 8.");
+    }
+
+    if (birth_counts.min > birth_counts.max || survival_counts.min > survival_counts.max) {
+        throw std::invalid_argument("Larger than Life count intervals must not end below their start.");
+    }
+}
+
+
+std::string Rule::to_string() const {
+    if (range > 1) {
+        auto interval = [](const Interval& counts) { return std::to_string(counts.min) + ".." + std::to_string(counts.max); };
+
+        std::string text = "R";
+
+        text += std::to_string(range);
+        text += ",C";
+        text += std::to_string(states == 2 ? 0 : states);
+        text += include_centre ? ",M1,S" : ",M0,S";
+        text += interval(survival_counts);
+        text += ",B";
+        text += interval(birth_counts);
+        text += ",NM";
+
+        return text;
+    }
+
+    std::string text = "B";
+
+    text += format_counts(birth);
+    text += "/S";
+    text += format_counts(survival);
+
+    if (states > 2) {
+        text += "/C";
+        text += std::to_string(states);
+    }
+
+    return text;
+}
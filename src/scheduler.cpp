@@ -0,0 +1,99 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+
+Scheduler::Scheduler(Mode mode, double rate, clock_t::duration budget): mode{mode}, rate{1}, budget{budget} {
+    set_rate(rate);
+    set_budget(budget);
+}
+
+
+std::uint64_t Scheduler::update(Simulation& simulation, clock_t::duration elapsed) {
+    const std::chrono::duration<double> seconds = elapsed;
+
+    std::uint64_t generations = batch_limit;
+    behind = false;
+
+    if (mode == Mode::FixedRate) {
+        accumulated += seconds;
+
+        const double due = std::floor(accumulated.count() * rate);
+
+        if (due > static_cast<double>(batch_limit)) {
+            // Catching up would only make the next frame longer still.
+            behind = true;
+            accumulated = {};
+        } else {
+            generations = static_cast<std::uint64_t>(due);
+            accumulated -= std::chrono::duration<double>{static_cast<double>(generations) / rate};
+        }
+    }
+
+    if (generations != 0) {
+        const auto begin = clock_t::now();
+
+        simulation.step(generations);
+        simulation.finish();
+
+        record_batch(generations, clock_t::now() - begin);
+    }
+
+    window += seconds;
+    window_generations += generations;
+
+    if (window >= std::chrono::milliseconds{500}) {
+        measured_rate = static_cast<double>(window_generations) / window.count();
+
+        window = {};
+        window_generations = 0;
+    }
+
+    return generations;
+}
+
+
+void Scheduler::reset() {
+    accumulated = {};
+    behind = false;
+}
+
+
+void Scheduler::set_mode(Mode new_mode) {
+    mode = new_mode;
+    reset();
+}
+
+void Scheduler::set_rate(double generations_per_second) {
+    if (!(generations_per_second > 0 && generations_per_second <= max_rate)) {
+        throw std::invalid_argument("Rates must be positive and at most Scheduler::max_rate.");
+    }
+
+    rate = generations_per_second;
+}
+
+void Scheduler::set_budget(clock_t::duration new_budget) {
+    if (new_budget <= clock_t::duration::zero()) {
+        throw std::invalid_argument("Frame budgets must be positive.");
+    }
+
+    budget = new_budget;
+}
+
+
+// Batches cost a fixed overhead on top of their generations (dispatches, waiting for the GPU), so small ones overestimate the cost of a
+// generation. Scaling the last batch to the budget still converges on the largest batch that fits, and only batches that used the whole
+// limit grow it, at most twofold, so one lucky frame cannot blow the next one.
+void Scheduler::record_batch(std::uint64_t generations, std::chrono::duration<double> took) {
+    const std::chrono::duration<double> limit = budget;
+    const double fits = took.count() > 0 ? static_cast<double>(generations) * (limit / took) : static_cast<double>(max_batch);
+
+    if (took > limit) {
+        batch_limit = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(fits));
+    } else if (generations >= batch_limit) {
+        batch_limit = static_cast<std::uint64_t>(std::min({fits, 2 * static_cast<double>(generations), static_cast<double>(max_batch)}));
+    }
+}
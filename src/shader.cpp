@@ -1,8 +1,17 @@
 #include "shader.hpp"
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
-#include <iostream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
 #include <string_view>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -35,94 +44,347 @@ constexpr auto get_bit(Shader::Type type) {
     }
 }
 
-} // namespace
 
+// Every shader alive, for reload_changed().
+std::vector<Shader*> shaders;
 
+std::filesystem::path cache_directory;
 
-Shader::Shader(Type type, const std::filesystem::path& path): type{type} {
+constexpr std::string_view cache_magic = "SLIMEPRG";
 
-    if (!std::filesystem::exists(path)) {
-        throw std::runtime_error("Could not open file.");
-    }
 
-    std::ifstream file{path};
+std::string get_log(unsigned int object, bool program) {
+    GLint size = 0;
+    (program ? glGetProgramiv : glGetShaderiv)(object, GL_INFO_LOG_LENGTH, &size);
 
-    std::string file_content(std::istreambuf_iterator(file), std::istreambuf_iterator<char>{});
+    std::string log(static_cast<std::size_t>(std::max(size, 1)), '\0');
+    (program ? glGetProgramInfoLog : glGetShaderInfoLog)(object, static_cast<GLsizei>(log.size()), &size, log.data());
+    log.resize(static_cast<std::size_t>(size));
+
+    return log;
+}
 
-    const char* raw_file = file_content.c_str();
 
-    id = glCreateShaderProgramv(get_type_flag(type), 1, &raw_file);
+// Compiles and links `source` into `program`, as glCreateShaderProgramv() would but with the binary retrievable. Nothing is linked
+// when the source does not compile, so the program keeps its last executable.
+void build(unsigned int program, Shader::Type type, const std::string& source, const std::filesystem::path& path) {
+    const unsigned int shader = glCreateShader(get_type_flag(type));
+    const char* raw_source = source.c_str();
 
+    glShaderSource(shader, 1, &raw_source, nullptr);
+    glCompileShader(shader);
 
     int success = 0;
-    glGetProgramiv(id, GL_LINK_STATUS, &success);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+
+    if (success == GL_FALSE) {
+        const auto log = get_log(shader, false);
+        glDeleteShader(shader);
+
+        throw std::runtime_error("Could not compile " + path.string() + ":\n" + log);
+    }
+
+    glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+    glDetachShader(program, shader);
+    glDeleteShader(shader);
+
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
 
     if (success == GL_FALSE) {
+        throw std::runtime_error("Could not link " + path.string() + ":\n" + get_log(program, true));
+    }
+}
+
+
+// FNV-1a.
+std::uint64_t hash(std::uint64_t seed, std::string_view text) {
+    for (const char c: text) {
+        seed = (seed ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+    }
+
+    return seed;
+}
+
+std::string_view get_string(GLenum name) {
+    const auto* text = reinterpret_cast<const char*>(glGetString(name));
+    return text != nullptr ? text : "";
+}
+
+// None without a cache, or if the driver has no binary formats.
+std::optional<std::filesystem::path> get_cache_file(Shader::Type type, std::string_view source) {
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+    if (cache_directory.empty() || formats == 0) {
+        return std::nullopt;
+    }
+
+    std::uint64_t key = 0xcbf29ce484222325;
+
+    for (const auto name: {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        key = hash(key, get_string(name));
+        key = hash(key, "\n");
+    }
+
+    key = hash(key, std::to_string(static_cast<int>(type)));
+    key = hash(key, source);
 
-        GLint log_size = 0;
-        glGetProgramiv(id, GL_INFO_LOG_LENGTH, &log_size);
+    std::array<char, 17> name{};
+    std::to_chars(name.data(), name.data() + 16, key, 16);
+
+    return cache_directory / (std::string{name.data()} + ".bin");
+}
 
-        std::vector<char> log_data;
-        log_data.reserve(log_size);
 
-        glGetProgramInfoLog(id, log_size, &log_size, &log_data[0]);
-        std::string_view log(&log_data[0], log_size);
+// A cache file holds the magic, the binary format and the binary.
+bool load_binary(unsigned int program, const std::filesystem::path& file_path) {
+    std::ifstream file{file_path, std::ios::binary};
+    std::string contents(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>{});
 
-        std::cerr << "Could not compile shader: " << log << '\n';
-        std::exit(EXIT_FAILURE);
+    const std::size_t header = cache_magic.size() + sizeof(GLenum);
+
+    if (contents.size() <= header || !contents.starts_with(cache_magic)) {
+        return false;
     }
+
+    GLenum format = 0;
+    std::memcpy(&format, contents.data() + cache_magic.size(), sizeof(format));
+
+    glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    glProgramBinary(program, format, contents.data() + header, static_cast<GLsizei>(contents.size() - header));
+
+    int success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+    return success == GL_TRUE;
+}
+
+// Written aside and renamed, so a cache file is whole or missing.
+void save_binary(unsigned int program, const std::filesystem::path& file_path) {
+    GLint size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+
+    if (size <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(static_cast<std::size_t>(size));
+    GLenum format = 0;
+    glGetProgramBinary(program, size, &size, &format, binary.data());
+
+    auto temporary = file_path;
+    temporary += ".tmp";
+
+    {
+        std::ofstream file{temporary, std::ios::binary};
+
+        file.write(cache_magic.data(), static_cast<std::streamsize>(cache_magic.size()));
+        file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+        file.write(binary.data(), size);
+
+        if (!file) {
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, file_path, error);
+}
+
+} // namespace
+
+
+
+Shader::Shader(Type type, const std::filesystem::path& path): Shader{type, path, {}} {}
+
+Shader::Shader(Type type, const std::filesystem::path& path, std::string_view preamble):
+      type{type}, id{glCreateProgram()}, path{path}, preamble{preamble} {
+
+    try {
+        load();
+    } catch (...) {
+        glDeleteProgram(id);
+        throw;
+    }
+
+    shaders.push_back(this);
 }
 
 
 Shader::~Shader() {
+    std::erase(shaders, this);
+
     if (id != 0) {
         glDeleteProgram(id);
     }
 }
 
-Shader::Shader(Shader&& other): type{other.type}, id{std::exchange(other.id, 0)} {}
+Shader::Shader(Shader&& other):
+      type{other.type},
+      id{std::exchange(other.id, 0)},
+      path{std::move(other.path)},
+      preamble{std::move(other.preamble)},
+      modified{other.modified},
+      uniforms{std::move(other.uniforms)} {
+
+    shaders.push_back(this);
+}
 
+// The program replaced is deleted with `other`.
 Shader& Shader::operator=(Shader&& other) {
-    type = other.type;
-    id = std::exchange(other.id, 0);
+    std::swap(type, other.type);
+    std::swap(id, other.id);
+    std::swap(path, other.path);
+    std::swap(preamble, other.preamble);
+    std::swap(modified, other.modified);
+    std::swap(uniforms, other.uniforms);
 
     return *this;
 }
 
 
+void Shader::load() {
+    std::error_code error;
+    const auto time = std::filesystem::last_write_time(path, error);
+
+    std::ifstream file{path};
+
+    if (error || !file) {
+        throw std::runtime_error("Could not open file.");
+    }
+
+    modified = time;
+
+    std::string source(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>{});
+
+    if (!preamble.empty()) {
+        const auto version_end = source.find('\n');
+        source.insert(version_end == std::string::npos ? source.size() : version_end + 1, preamble);
+    }
+
+    const auto cached = get_cache_file(type, source);
+
+    if (cached && load_binary(id, *cached)) {
+        return;
+    }
+
+    build(id, type, source, path);
+
+    if (cached) {
+        save_binary(id, *cached);
+    }
+}
+
+
+void Shader::reload() {
+    load();
+
+    for (const auto& [name, value]: uniforms) {
+        apply(name, value);
+    }
+}
+
+std::vector<std::string> Shader::reload_changed() {
+    std::vector<std::string> errors;
+
+    for (auto* shader: shaders) {
+        std::error_code error;
+        const auto time = std::filesystem::last_write_time(shader->path, error);
+
+        if (shader->id == 0 || error || time == shader->modified) {
+            continue;
+        }
+
+        try {
+            shader->reload();
+        } catch (const std::runtime_error& e) {
+            errors.emplace_back(e.what());
+        }
+
+        shader->modified = time;
+    }
+
+    return errors;
+}
+
+
+void Shader::set_cache_directory(std::filesystem::path directory) {
+    if (!directory.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+    }
+
+    cache_directory = std::move(directory);
+}
+
+
 void Shader::set_uniform(std::string_view name, bool value) const {
-    const auto location = glGetUniformLocation(id, name.data());
-    glProgramUniform1i(id, location, GLint{value});
+    set(name, value);
 }
 
 void Shader::set_uniform(std::string_view name, int value) const {
-    const auto location = glGetUniformLocation(id, name.data());
-    glProgramUniform1i(id, location, value);
+    set(name, value);
 }
 
 void Shader::set_uniform(std::string_view name, unsigned int value) const {
-    const auto location = glGetUniformLocation(id, name.data());
-    glProgramUniform1ui(id, location, value);
+    set(name, value);
 }
 
 void Shader::set_uniform(std::string_view name, float value) const {
-    const auto location = glGetUniformLocation(id, name.data());
-    glProgramUniform1f(id, location, value);
+    set(name, value);
 }
 
 void Shader::set_uniform(std::string_view name, const glm::vec2& value) const {
-    const auto location = glGetUniformLocation(id, name.data());
-    glProgramUniform2fv(id, location, 1, glm::value_ptr(value));
+    set(name, value);
 }
 
 void Shader::set_uniform(std::string_view name, const glm::vec3& value) const {
-    const auto location = glGetUniformLocation(id, name.data());
-    glProgramUniform3fv(id, location, 1, glm::value_ptr(value));
+    set(name, value);
 }
 
 void Shader::set_uniform(std::string_view name, const glm::mat4& value) const {
-    const auto location = glGetUniformLocation(id, name.data());
-    glProgramUniformMatrix4fv(id, location, 1, GL_FALSE, glm::value_ptr(value));
+    set(name, value);
+}
+
+
+void Shader::set(std::string_view name, const Value& value) const {
+    auto uniform = std::find_if(uniforms.begin(), uniforms.end(), [&](const auto& each) { return each.first == name; });
+
+    if (uniform == uniforms.end()) {
+        uniform = uniforms.emplace(uniforms.end(), name, value);
+    } else {
+        uniform->second = value;
+    }
+
+    apply(uniform->first, value);
+}
+
+void Shader::apply(const std::string& name, const Value& value) const {
+    const auto location = glGetUniformLocation(id, name.c_str());
+
+    std::visit(
+          [&]<typename T>(const T& each) {
+              if constexpr (std::is_same_v<T, bool>) {
+                  glProgramUniform1i(id, location, GLint{each});
+              } else if constexpr (std::is_same_v<T, int>) {
+                  glProgramUniform1i(id, location, each);
+              } else if constexpr (std::is_same_v<T, unsigned int>) {
+                  glProgramUniform1ui(id, location, each);
+              } else if constexpr (std::is_same_v<T, float>) {
+                  glProgramUniform1f(id, location, each);
+              } else if constexpr (std::is_same_v<T, glm::vec2>) {
+                  glProgramUniform2fv(id, location, 1, glm::value_ptr(each));
+              } else if constexpr (std::is_same_v<T, glm::vec3>) {
+                  glProgramUniform3fv(id, location, 1, glm::value_ptr(each));
+              } else {
+                  glProgramUniformMatrix4fv(id, location, 1, GL_FALSE, glm::value_ptr(each));
+              }
+          },
+          value);
 }
 
 
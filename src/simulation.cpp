@@ -0,0 +1,230 @@
+#include "simulation.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "cpu_engine.hpp"
+#include "distributed_engine.hpp"
+#include "hashlife_engine.hpp"
+#include "packed_engine.hpp"
+#include "sparse_engine.hpp"
+#include "tiled_engine.hpp"
+
+
+
+namespace {
+
+void check_unbounded(const Simulation::Parameters& params) {
+    if (params.topology != Topology::DeadBorder) {
+        throw std::invalid_argument("Unbounded backends have no edges to wrap around.");
+    }
+}
+
+
+std::map<Simulation::Backend, Simulation::EngineFactory>& get_factories() {
+    using Parameters = Simulation::Parameters;
+
+    static std::map<Simulation::Backend, Simulation::EngineFactory> factories{
+          {Simulation::Backend::Cpu,
+                [](Resolution res, const Parameters& params) {
+                    return std::make_unique<CpuEngine>(res, params.topology, params.rule);
+                }},
+          {Simulation::Backend::Packed,
+                [](Resolution res, const Parameters& params) {
+                    return std::make_unique<PackedEngine>(res, params.topology, params.rule);
+                }},
+          {Simulation::Backend::Tiled,
+                [](Resolution res, const Parameters& params) {
+                    return std::make_unique<TiledEngine>(res, params.threads, params.topology, params.rule);
+                }},
+          {Simulation::Backend::Distributed,
+                [](Resolution res, const Parameters& params) {
+                    return std::make_unique<DistributedEngine>(res, params.threads, params.topology, params.rule);
+                }},
+          {Simulation::Backend::HashLife,
+                [](Resolution res, const Parameters& params) {
+                    check_unbounded(params);
+                    return std::make_unique<HashLifeEngine>(res, params.rule);
+                }},
+          {Simulation::Backend::Sparse,
+                [](Resolution res, const Parameters& params) {
+                    check_unbounded(params);
+                    return std::make_unique<SparseEngine>(res, params.rule);
+                }},
+    };
+
+    return factories;
+}
+
+} // namespace
+
+
+
+Simulation::Simulation(Resolution res, Parameters params): res{res} {
+    replace_engine(params);
+}
+
+
+void Simulation::register_backend(Backend backend, EngineFactory factory) {
+    get_factories()[backend] = std::move(factory);
+}
+
+bool Simulation::has_backend(Backend backend) {
+    return get_factories().contains(backend);
+}
+
+
+void Simulation::set_backend(Backend backend) {
+    if (backend != params.backend) {
+        auto next = params;
+        next.backend = backend;
+
+        replace_engine(next);
+    }
+}
+
+void Simulation::set_threads(unsigned int threads) {
+    if (threads != params.threads) {
+        auto next = params;
+        next.threads = threads;
+
+        replace_engine(next);
+    }
+}
+
+void Simulation::set_topology(Topology topology) {
+    if (topology != params.topology) {
+        auto next = params;
+        next.topology = topology;
+
+        replace_engine(next);
+    }
+}
+
+
+void Simulation::set_rule(const Rule& rule) {
+    if (rule != params.rule) {
+        auto next = params;
+        next.rule = rule;
+
+        replace_engine(next);
+    }
+}
+
+
+void Simulation::set_state(std::shared_ptr<BitBoard> board, const Rule& rule, Topology topology, std::uint64_t next_generation,
+      std::span<const std::uint8_t> states) {
+    auto next = params;
+    next.rule = rule;
+    next.topology = topology;
+
+    if (states.empty()) {
+        replace_engine(next, std::move(board));
+    } else {
+        replace_engine(next, nullptr, states);
+    }
+
+    generation = next_generation;
+}
+
+
+void Simulation::resize(Resolution next_res) {
+    if (next_res.x == 0 || next_res.y == 0) {
+        throw std::invalid_argument("Boards are at least one cell wide and high.");
+    }
+
+    // Where the old board's origin lands on the new one.
+    const std::int64_t dx = (std::int64_t{next_res.x} - res.x) / 2;
+    const std::int64_t dy = (std::int64_t{next_res.y} - res.y) / 2;
+
+    const std::int64_t x_begin = std::max<std::int64_t>(0, -dx);
+    const std::int64_t x_end = std::min<std::int64_t>(res.x, next_res.x - dx);
+
+    std::shared_ptr<BitBoard> board;
+    std::vector<std::uint8_t> next_cells;
+
+    // Bands count dying cells as alive, Generations boards are copied cell by cell.
+    if (params.rule.states > 2) {
+        std::vector<std::uint8_t> cells(std::size_t{res.x} * res.y);
+        engine->get_cells(cells);
+
+        next_cells.resize(std::size_t{next_res.x} * next_res.y);
+
+        const std::int64_t y_begin = std::max<std::int64_t>(0, -dy);
+        const std::int64_t y_end = std::min<std::int64_t>(res.y, next_res.y - dy);
+
+        for (std::int64_t y = y_begin; x_begin < x_end && y < y_end; ++y) {
+            std::copy_n(&cells[static_cast<std::size_t>(y * res.x + x_begin)], x_end - x_begin,
+                  &next_cells[static_cast<std::size_t>((y + dy) * next_res.x + x_begin + dx)]);
+        }
+    } else {
+        board = std::make_shared<BitBoard>(next_res);
+
+        for (const auto& band: engine->get_bands()) {
+            const std::int64_t y_begin = std::max<std::int64_t>(band.y, -dy);
+            const std::int64_t y_end = std::min<std::int64_t>(band.y + band.board->get_resolution().y, next_res.y - dy);
+
+            if (x_begin >= x_end || y_begin >= y_end) {
+                continue;
+            }
+
+            board->copy_from(*band.board, static_cast<unsigned int>(x_begin), static_cast<unsigned int>(y_begin - band.y),
+                  static_cast<unsigned int>(x_begin + dx), static_cast<unsigned int>(y_begin + dy),
+                  {static_cast<unsigned int>(x_end - x_begin), static_cast<unsigned int>(y_end - y_begin)});
+        }
+    }
+
+    const Resolution previous = std::exchange(res, next_res);
+
+    try {
+        replace_engine(params, std::move(board), next_cells);
+    } catch (...) {
+        res = previous;
+        throw;
+    }
+}
+
+
+void Simulation::replace_engine(const Parameters& next_params, std::shared_ptr<BitBoard> board, std::span<const std::uint8_t> cells) {
+    const auto factory = get_factories().find(next_params.backend);
+
+    if (factory == get_factories().end()) {
+        throw std::invalid_argument("Simulation backend is not available.");
+    }
+
+    auto next = factory->second(res, next_params);
+
+    if (board != nullptr) {
+        next->set_board(std::move(board));
+    } else if (!cells.empty()) {
+        next->set_cells(cells);
+    } else if (engine != nullptr) {
+        std::vector<std::uint8_t> cells(std::size_t{res.x} * res.y);
+
+        engine->get_cells(cells);
+        next->set_cells(cells);
+    }
+
+    engine = std::move(next);
+    params = next_params;
+}
+
+
+void Simulation::step(std::uint64_t generations) {
+    engine->step(generations);
+    generation += generations;
+}
+
+
+void Simulation::get_cells(std::span<std::uint8_t> cells) const {
+    engine->get_cells(cells);
+}
+
+void Simulation::set_cells(std::span<const std::uint8_t> cells) {
+    engine->set_cells(cells);
+}
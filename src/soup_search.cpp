@@ -0,0 +1,680 @@
+#include "soup_search.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include "thread_pool.hpp"
+
+
+
+namespace soup {
+
+
+namespace {
+
+using Table = bit_kernel::RuleTable<std::uint64_t>;
+
+void check_rule(const Rule& rule) {
+    if (!rule.is_life_like() || (rule.birth & 1) != 0) {
+        throw std::invalid_argument("Soup searches only run two state, range 1 rules without B0.");
+    }
+}
+
+
+constexpr std::uint64_t margin_columns = ((std::uint64_t{1} << margin) - 1) | (~std::uint64_t{0} << (board_size - margin));
+
+
+std::uint64_t splitmix64(std::uint64_t& state) {
+    std::uint64_t z = state += 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+    return z ^ (z >> 31);
+}
+
+
+bool is_empty(const Board& board) {
+    return std::all_of(board.begin(), board.end(), [](std::uint64_t row) { return row == 0; });
+}
+
+std::uint64_t get_population(const Board& board) {
+    std::uint64_t population = 0;
+
+    for (const auto row: board) {
+        population += static_cast<std::uint64_t>(std::popcount(row));
+    }
+
+    return population;
+}
+
+
+// One generation with a dead border, only around the rows that have live cells.
+Board step(const Board& board, const Table& table) {
+    Board next{};
+
+    const auto first = std::find_if(board.begin(), board.end(), [](std::uint64_t row) { return row != 0; });
+
+    if (first == board.end()) {
+        return next;
+    }
+
+    const auto last = std::find_if(board.rbegin(), board.rend(), [](std::uint64_t row) { return row != 0; });
+
+    const std::size_t begin = static_cast<std::size_t>(first - board.begin());
+    const std::size_t end = board_size - static_cast<std::size_t>(last - board.rbegin());
+
+    for (std::size_t y = begin == 0 ? 0 : begin - 1; y < std::min<std::size_t>(end + 1, board_size); ++y) {
+        const std::uint64_t a = y > 0 ? board[y - 1] : 0;
+        const std::uint64_t b = board[y];
+        const std::uint64_t c = y + 1 < board_size ? board[y + 1] : 0;
+
+        next[y] = bit_kernel::next_state(table, a << 1, a, a >> 1, b << 1, b, b >> 1, c << 1, c, c >> 1);
+    }
+
+    return next;
+}
+
+
+struct Box {
+    unsigned int x_min;
+    unsigned int y_min;
+    unsigned int x_end;
+    unsigned int y_end;
+};
+
+// Of a board that is not empty.
+Box get_bounds(const Board& board) {
+    Box box{board_size, board_size, 0, 0};
+    std::uint64_t columns = 0;
+
+    for (unsigned int y = 0; y < board_size; ++y) {
+        if (board[y] != 0) {
+            columns |= board[y];
+            box.y_min = std::min(box.y_min, y);
+            box.y_end = y + 1;
+        }
+    }
+
+    box.x_min = static_cast<unsigned int>(std::countr_zero(columns));
+    box.x_end = static_cast<unsigned int>(std::bit_width(columns));
+
+    return box;
+}
+
+// Cells moved right and down, those pushed off the board are lost.
+Board translate(const Board& board, int dx, int dy) {
+    Board moved{};
+
+    for (int y = 0; y < static_cast<int>(board_size); ++y) {
+        const int to = y + dy;
+
+        if (to < 0 || to >= static_cast<int>(board_size) || board[y] == 0 || dx <= -64 || dx >= 64) {
+            continue;
+        }
+
+        moved[to] = dx >= 0 ? board[y] << dx : board[y] >> -dx;
+    }
+
+    return moved;
+}
+
+// Moved into the top left corner, patterns compare equal when they differ by a translation.
+Board normalise(const Board& board) {
+    const auto box = get_bounds(board);
+    return translate(board, -static_cast<int>(box.x_min), -static_cast<int>(box.y_min));
+}
+
+
+// Rows [begin, end) grown by a cell in every direction, into the rows around them.
+void dilate(const Board& board, Board& grown, std::size_t begin, std::size_t end) {
+    for (std::size_t y = begin == 0 ? 0 : begin - 1; y < std::min<std::size_t>(end + 1, board_size); ++y) {
+        std::uint64_t rows = board[y];
+        rows |= y > 0 ? board[y - 1] : 0;
+        rows |= y + 1 < board_size ? board[y + 1] : 0;
+
+        grown[y] = rows | (rows << 1) | (rows >> 1);
+    }
+}
+
+// Groups of cells chained together by cells at most `reach` apart (1 is 8-connected). Each grows from one of its cells until it stops
+// gaining any, only the rows it spans and `reach` more either side are looked at.
+std::vector<Board> get_components(const Board& cells, unsigned int reach) {
+    std::vector<Board> components;
+    Board left = cells;
+
+    for (std::size_t y = 0; y < board_size; ++y) {
+        while (left[y] != 0) {
+            Board component{};
+            component[y] = left[y] & -left[y];
+
+            std::size_t begin = y;
+            std::size_t end = y + 1;
+
+            for (;;) {
+                Board grown = component;
+
+                for (unsigned int i = 0; i < reach; ++i) {
+                    const Board from = grown;
+                    dilate(from, grown, begin > i ? begin - i : 0, std::min<std::size_t>(end + i, board_size));
+                }
+
+                const std::size_t grown_begin = begin > reach ? begin - reach : 0;
+                const std::size_t grown_end = std::min<std::size_t>(end + reach, board_size);
+                bool changed = false;
+
+                for (std::size_t row = grown_begin; row < grown_end; ++row) {
+                    grown[row] &= left[row];
+                    changed |= grown[row] != component[row];
+                }
+
+                if (!changed) {
+                    break;
+                }
+
+                component = grown;
+
+                begin = grown_begin;
+                end = grown_end;
+
+                while (component[begin] == 0) {
+                    ++begin;
+                }
+
+                while (component[end - 1] == 0) {
+                    --end;
+                }
+            }
+
+            for (std::size_t row = begin; row < end; ++row) {
+                left[row] &= ~component[row];
+            }
+
+            components.push_back(component);
+        }
+    }
+
+    return components;
+}
+
+
+bool touches_margin(const Board& board) {
+    for (std::size_t y = 0; y < board_size; ++y) {
+        const bool margin_row = y < margin || y >= board_size - margin;
+
+        if ((board[y] & (margin_row ? ~std::uint64_t{0} : margin_columns)) != 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+// Extended Wechsler format: strips of five rows top to bottom separated by z, each a digit (0-9, a-v) per column with the top row as
+// the least significant bit. Runs of empty columns shorten to w (2), x (3) and y followed by a digit (4 + the digit), trailing ones are
+// left out.
+constexpr std::string_view digits = "0123456789abcdefghijklmnopqrstuv";
+
+std::string encode(std::vector<std::pair<int, int>> cells) {
+    int x_min = cells.front().first;
+    int y_min = cells.front().second;
+    int x_max = x_min;
+    int y_max = y_min;
+
+    for (const auto& [x, y]: cells) {
+        x_min = std::min(x_min, x);
+        y_min = std::min(y_min, y);
+        x_max = std::max(x_max, x);
+        y_max = std::max(y_max, y);
+    }
+
+    const auto width = static_cast<std::size_t>(x_max - x_min + 1);
+    std::string code;
+
+    for (int strip = 0; strip * 5 <= y_max - y_min; ++strip) {
+        std::vector<unsigned int> columns(width, 0);
+
+        for (const auto& [x, y]: cells) {
+            const int row = y - y_min - strip * 5;
+
+            if (row >= 0 && row < 5) {
+                columns[static_cast<std::size_t>(x - x_min)] |= 1u << row;
+            }
+        }
+
+        while (!columns.empty() && columns.back() == 0) {
+            columns.pop_back();
+        }
+
+        code += strip > 0 ? "z" : "";
+
+        for (std::size_t i = 0; i < columns.size();) {
+            if (columns[i] != 0) {
+                code += digits[columns[i++]];
+                continue;
+            }
+
+            std::size_t zeros = 0;
+
+            while (columns[i + zeros] == 0) {
+                ++zeros;
+            }
+
+            i += zeros;
+
+            for (; zeros >= 4; zeros -= std::min<std::size_t>(zeros, 39)) {
+                code += 'y';
+                code += digits[std::min<std::size_t>(zeros, 39) - 4];
+            }
+
+            code += zeros == 3 ? "x" : zeros == 2 ? "w" : zeros == 1 ? "0" : "";
+        }
+    }
+
+    return code;
+}
+
+// Shortest code of the board under the eight symmetries of the square, the first in order among those as short.
+std::string get_canonical_code(const Board& board) {
+    std::vector<std::pair<int, int>> cells;
+
+    for (int y = 0; y < static_cast<int>(board_size); ++y) {
+        for (std::uint64_t row = board[y]; row != 0; row &= row - 1) {
+            cells.emplace_back(std::countr_zero(row), y);
+        }
+    }
+
+    std::string best;
+
+    for (unsigned int symmetry = 0; symmetry < 8; ++symmetry) {
+        auto transformed = cells;
+
+        for (auto& [x, y]: transformed) {
+            if ((symmetry & 4) != 0) {
+                std::swap(x, y);
+            }
+
+            x = (symmetry & 1) != 0 ? -x : x;
+            y = (symmetry & 2) != 0 ? -y : y;
+        }
+
+        auto code = encode(std::move(transformed));
+
+        if (best.empty() || code.size() < best.size() || (code.size() == best.size() && code < best)) {
+            best = std::move(code);
+        }
+    }
+
+    return best;
+}
+
+
+struct BoardHash {
+    std::size_t operator()(const Board& board) const {
+        std::uint64_t hash = 0;
+
+        for (const auto row: board) {
+            hash = std::rotl(hash ^ row, 23) * 0x9e3779b97f4a7c15ULL;
+        }
+
+        return static_cast<std::size_t>(hash ^ (hash >> 32));
+    }
+};
+
+
+// Names objects, remembering the shapes it has named before: soups leave the same few objects behind over and over.
+class Identifier {
+  public:
+    explicit Identifier(const Rule& rule): table{bit_kernel::make_table<std::uint64_t>(rule)} {}
+
+
+    std::optional<std::string> identify(const Board& object) {
+        if (is_empty(object)) {
+            return std::nullopt;
+        }
+
+        const Board shape = normalise(object);
+
+        if (const auto found = known.find(shape); found != known.end()) {
+            return found->second;
+        }
+
+        if (known.size() >= max_known) {
+            known.clear();
+        }
+
+        return known.emplace(shape, run(shape)).first->second;
+    }
+
+
+    std::vector<std::string> classify(const Board& board) {
+        // Every cell any phase has, so each oscillator is one piece even if some of its phases are not.
+        Board envelope = board;
+        Board phase = board;
+
+        for (std::uint64_t generation = 0; generation < settle_period; ++generation) {
+            phase = step(phase, table);
+
+            if (phase == board) {
+                break;
+            }
+
+            for (std::size_t y = 0; y < board_size; ++y) {
+                envelope[y] |= phase[y];
+            }
+        }
+
+        std::vector<std::string> objects;
+        Board unknown{};
+
+        for (const auto& component: get_components(envelope, 1)) {
+            Board object;
+
+            for (std::size_t y = 0; y < board_size; ++y) {
+                object[y] = board[y] & component[y];
+            }
+
+            if (auto code = identify(object)) {
+                objects.push_back(std::move(*code));
+                continue;
+            }
+
+            for (std::size_t y = 0; y < board_size; ++y) {
+                unknown[y] |= object[y];
+            }
+        }
+
+        // Pieces that only keep each other going. What is still unknown against the border may have lost its cells to it.
+        for (const auto& cluster: get_components(unknown, 2)) {
+            const auto box = get_bounds(cluster);
+            const bool border = box.x_min == 0 || box.y_min == 0 || box.x_end == board_size || box.y_end == board_size;
+
+            objects.push_back(identify(cluster).value_or(border ? "zz_BORDER" : "zz_UNKNOWN"));
+        }
+
+        return objects;
+    }
+
+
+    // Counts and erases spaceships that reached the margin. Whether any were.
+    bool remove_spaceships(Board& board, Census& census) {
+        if (!touches_margin(board)) {
+            return false;
+        }
+
+        bool removed = false;
+
+        // Reach 2, the parts of a spaceship may be a cell apart.
+        for (const auto& component: get_components(board, 2)) {
+            if (!touches_margin(component)) {
+                continue;
+            }
+
+            const auto code = identify(component);
+
+            if (!code || !code->starts_with("xq")) {
+                continue;
+            }
+
+            ++census.objects[*code];
+
+            for (std::size_t y = 0; y < board_size; ++y) {
+                board[y] &= ~component[y];
+            }
+
+            removed = true;
+        }
+
+        return removed;
+    }
+
+
+  private:
+    static constexpr std::size_t max_known = std::size_t{1} << 16;
+
+    Table table;
+    std::unordered_map<Board, std::optional<std::string>, BoardHash> known;
+
+
+    std::optional<std::string> run(const Board& shape) const {
+        // Centred, so it has room to move and oscillate.
+        const auto box = get_bounds(shape);
+        Board phase = translate(shape, static_cast<int>(board_size - box.x_end) / 2, static_cast<int>(board_size - box.y_end) / 2);
+
+        const Box start_box = get_bounds(phase);
+        std::vector<Board> phases{phase};
+
+        for (std::uint64_t period = 1; period <= settle_period; ++period) {
+            phase = step(phase, table);
+
+            if (is_empty(phase)) {
+                return std::nullopt;
+            }
+
+            // Only a phase the same size can be the same shape.
+            const Box moved = get_bounds(phase);
+            const bool same_size = moved.x_end - moved.x_min == start_box.x_end - start_box.x_min
+                                && moved.y_end - moved.y_min == start_box.y_end - start_box.y_min;
+
+            if (!same_size || normalise(phase) != shape) {
+                phases.push_back(phase);
+                continue;
+            }
+
+            const bool still = moved.x_min == start_box.x_min && moved.y_min == start_box.y_min;
+            std::string best;
+
+            for (const auto& each: phases) {
+                auto code = get_canonical_code(each);
+
+                if (best.empty() || code.size() < best.size() || (code.size() == best.size() && code < best)) {
+                    best = std::move(code);
+                }
+            }
+
+            const std::string prefix = !still ? "xq" + std::to_string(period)
+                                     : period == 1 ? "xs" + std::to_string(get_population(shape))
+                                                   : "xp" + std::to_string(period);
+
+            return prefix + "_" + best;
+        }
+
+        return std::nullopt;
+    }
+};
+
+} // namespace
+
+
+
+Board make_soup(std::uint64_t seed, std::uint64_t index) {
+    std::uint64_t state = seed;
+    state = splitmix64(state) ^ index;
+
+    Board board{};
+    constexpr unsigned int offset = (board_size - soup_size) / 2;
+
+    for (unsigned int y = 0; y < soup_size; y += 4) {
+        const std::uint64_t bits = splitmix64(state);
+
+        for (unsigned int i = 0; i < 4; ++i) {
+            board[offset + y + i] = ((bits >> (16 * i)) & 0xffff) << offset;
+        }
+    }
+
+    return board;
+}
+
+
+std::optional<std::string> identify(const Board& object, const Rule& rule) {
+    return Identifier{rule}.identify(object);
+}
+
+std::vector<std::string> classify(const Board& board, const Rule& rule) {
+    return Identifier{rule}.classify(board);
+}
+
+
+
+Batch::Batch(const Rule& rule): rule{rule} {
+    check_rule(rule);
+}
+
+
+LaneBatch::LaneBatch(const Rule& rule, std::size_t lanes, bit_kernel::Isa isa):
+      Batch{rule},
+      lanes{lanes},
+      kernel{bit_kernel::select_lanes(rule, isa)},
+      front((board_size + 2) * lanes, 0),
+      back((board_size + 2) * lanes, 0) {
+
+    if (lanes == 0) {
+        throw std::invalid_argument("Batches hold at least one board.");
+    }
+}
+
+
+void LaneBatch::set_board(std::size_t index, const Board& board) {
+    for (std::size_t y = 0; y < board_size; ++y) {
+        front[(y + 1) * lanes + index] = board[y];
+    }
+}
+
+void LaneBatch::get_boards(std::span<Board> boards) const {
+    for (std::size_t index = 0; index < std::min(lanes, boards.size()); ++index) {
+        for (std::size_t y = 0; y < board_size; ++y) {
+            boards[index][y] = front[(y + 1) * lanes + index];
+        }
+    }
+}
+
+
+void LaneBatch::step(std::uint64_t generations) {
+    for (std::uint64_t i = 0; i < generations; ++i) {
+        kernel(front.data(), back.data(), lanes, board_size, rule);
+        std::swap(front, back);
+    }
+}
+
+
+
+void Census::merge(const Census& other) {
+    soups += other.soups;
+    unsettled += other.unsettled;
+    generations += other.generations;
+
+    for (const auto& [code, count]: other.objects) {
+        objects[code] += count;
+    }
+}
+
+
+Census search(Batch& batch, const Options& options) {
+    struct Lane {
+        bool busy = false;
+        std::uint64_t generation = 0;
+
+        // As of the last check.
+        Board previous{};
+    };
+
+    Identifier identifier{batch.get_rule()};
+
+    std::vector<Lane> lanes(batch.get_size());
+    std::vector<Board> boards(batch.get_size());
+
+    Census census;
+
+    std::uint64_t next = options.first;
+    const std::uint64_t end = options.first + options.count;
+
+    auto start_next = [&](std::size_t index) {
+        auto& lane = lanes[index];
+
+        lane.busy = next < end;
+        lane.generation = 0;
+        lane.previous = lane.busy ? make_soup(options.seed, next++) : Board{};
+
+        batch.set_board(index, lane.previous);
+    };
+
+    for (std::size_t index = 0; index < lanes.size(); ++index) {
+        start_next(index);
+    }
+
+    while (std::any_of(lanes.begin(), lanes.end(), [](const Lane& lane) { return lane.busy; })) {
+        batch.step(settle_period);
+        batch.get_boards(boards);
+
+        for (std::size_t index = 0; index < lanes.size(); ++index) {
+            auto& lane = lanes[index];
+            auto& board = boards[index];
+
+            if (!lane.busy) {
+                continue;
+            }
+
+            lane.generation += settle_period;
+            census.generations += settle_period;
+
+            const bool removed = identifier.remove_spaceships(board, census);
+
+            if (board == lane.previous) {
+                for (auto& code: identifier.classify(board)) {
+                    ++census.objects[std::move(code)];
+                }
+
+                ++census.soups;
+                start_next(index);
+            } else if (lane.generation >= options.max_generations) {
+                ++census.soups;
+                ++census.unsettled;
+                start_next(index);
+            } else {
+                lane.previous = board;
+
+                if (removed) {
+                    batch.set_board(index, board);
+                }
+            }
+        }
+    }
+
+    return census;
+}
+
+
+Census search(const Rule& rule, const Options& options) {
+    constexpr std::uint64_t soups_per_task = 16 * LaneBatch::default_lanes;
+
+    check_rule(rule);
+
+    ThreadPool pool{options.threads};
+
+    const std::uint64_t tasks = (options.count + soups_per_task - 1) / soups_per_task;
+    std::vector<Census> censuses(tasks);
+
+    pool.parallel_for(tasks, [&](std::size_t task) {
+        auto task_options = options;
+        task_options.first = options.first + task * soups_per_task;
+        task_options.count = std::min(soups_per_task, options.count - task * soups_per_task);
+
+        LaneBatch batch{rule};
+        censuses[task] = search(batch, task_options);
+    });
+
+    Census census;
+
+    for (const auto& each: censuses) {
+        census.merge(each);
+    }
+
+    return census;
+}
+
+
+} // namespace soup
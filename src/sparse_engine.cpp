@@ -0,0 +1,327 @@
+#include "sparse_engine.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+#include "bit_board.hpp"
+#include "bit_kernel.hpp"
+
+
+
+namespace {
+
+constexpr std::uint64_t west_column = 1;
+constexpr std::uint64_t east_column = std::uint64_t{1} << (SparseEngine::tile_size - 1);
+
+std::int32_t tile_of(std::int64_t cell) {
+    return static_cast<std::int32_t>(cell >= 0 ? cell / SparseEngine::tile_size : (cell + 1) / SparseEngine::tile_size - 1);
+}
+
+} // namespace
+
+
+
+SparseEngine::SparseEngine(Resolution res, const Rule& rule): Engine{res}, rule{rule} {
+    if (!rule.is_life_like() || (rule.birth & 1) != 0) {
+        throw std::invalid_argument("The sparse engine only runs Life-like rules without B0.");
+    }
+}
+
+
+void SparseEngine::step(std::uint64_t generations) {
+    for (std::uint64_t i = 0; i < generations; ++i) {
+        step_once();
+    }
+}
+
+
+void SparseEngine::step_once() {
+    active.clear();
+
+    // Everything around a change may change next, missing neighbours are only needed where live cells touch them.
+    for (Tile* tile: changed) {
+        activate(tile);
+
+        std::uint64_t columns = 0;
+
+        for (const auto row: tile->cells) {
+            columns |= row;
+        }
+
+        const bool north = tile->cells.front() != 0;
+        const bool south = tile->cells.back() != 0;
+        const bool west = (columns & west_column) != 0;
+        const bool east = (columns & east_column) != 0;
+
+        const std::array<bool, 9> touches{
+              (tile->cells.front() & west_column) != 0, north, (tile->cells.front() & east_column) != 0,
+              west, false, east,
+              (tile->cells.back() & west_column) != 0, south, (tile->cells.back() & east_column) != 0,
+        };
+
+        for (std::int32_t dy = -1; dy <= 1; ++dy) {
+            for (std::int32_t dx = -1; dx <= 1; ++dx) {
+                Tile* neighbour = find(tile->x + dx, tile->y + dy);
+
+                if (neighbour == nullptr && touches[(dy + 1) * 3 + dx + 1]) {
+                    neighbour = create(tile->x + dx, tile->y + dy);
+                }
+
+                if (neighbour != nullptr) {
+                    activate(neighbour);
+                }
+            }
+        }
+    }
+
+    for (Tile* tile: active) {
+        compute(*tile);
+    }
+
+    // Only active tiles can change, so they are the only ones the next generation needs to look at.
+    changed.clear();
+
+    for (Tile* tile: active) {
+        tile->active = false;
+
+        if (tile->next != tile->cells) {
+            changed.push_back(tile);
+
+            tile->cells = tile->next;
+            tile->hashed = false;
+
+            tile->population = 0;
+
+            for (const auto row: tile->cells) {
+                tile->population += static_cast<std::uint64_t>(std::popcount(row));
+            }
+        } else if (tile->population == 0) {
+            release(tile);
+        }
+    }
+}
+
+
+void SparseEngine::activate(Tile* tile) {
+    if (!tile->active) {
+        tile->active = true;
+        active.push_back(tile);
+    }
+}
+
+
+void SparseEngine::compute(Tile& tile) const {
+    constexpr std::size_t rows = tile_size + 2;
+
+    // Rows -1 to tile_size of this tile's column, and of the columns to either side.
+    std::array<std::uint64_t, rows> centre{};
+    std::array<std::uint64_t, rows> west{};
+    std::array<std::uint64_t, rows> east{};
+
+    for (std::int32_t dx = -1; dx <= 1; ++dx) {
+        auto& column = dx < 0 ? west : dx > 0 ? east : centre;
+
+        if (const Tile* above = find(tile.x + dx, tile.y - 1)) {
+            column.front() = above->cells.back();
+        }
+
+        if (const Tile* middle = dx == 0 ? &tile : find(tile.x + dx, tile.y)) {
+            std::copy(middle->cells.begin(), middle->cells.end(), column.begin() + 1);
+        }
+
+        if (const Tile* below = find(tile.x + dx, tile.y + 1)) {
+            column.back() = below->cells.front();
+        }
+    }
+
+    auto shift_west = [&](std::size_t row) { return (centre[row] << 1) | (west[row] >> (tile_size - 1)); };
+    auto shift_east = [&](std::size_t row) { return (centre[row] >> 1) | (east[row] << (tile_size - 1)); };
+
+    if (rule == rules::life) {
+        for (std::size_t y = 0; y < tile_size; ++y) {
+            tile.next[y] = bit_kernel::next_state(shift_west(y), centre[y], shift_east(y), shift_west(y + 1), centre[y + 1],
+                  shift_east(y + 1), shift_west(y + 2), centre[y + 2], shift_east(y + 2));
+        }
+    } else {
+        const auto table = bit_kernel::make_table<std::uint64_t>(rule);
+
+        for (std::size_t y = 0; y < tile_size; ++y) {
+            tile.next[y] = bit_kernel::next_state(table, shift_west(y), centre[y], shift_east(y), shift_west(y + 1), centre[y + 1],
+                  shift_east(y + 1), shift_west(y + 2), centre[y + 2], shift_east(y + 2));
+        }
+    }
+}
+
+
+
+std::uint64_t SparseEngine::key(std::int32_t x, std::int32_t y) {
+    return (std::uint64_t{static_cast<std::uint32_t>(x)} << 32) | static_cast<std::uint32_t>(y);
+}
+
+SparseEngine::Tile* SparseEngine::find(std::int32_t x, std::int32_t y) const {
+    const auto found = tiles.find(key(x, y));
+
+    return found == tiles.end() ? nullptr : found->second;
+}
+
+SparseEngine::Tile* SparseEngine::create(std::int32_t x, std::int32_t y) {
+    if (pool.empty()) {
+        storage.push_back(std::make_unique<Tile>());
+        pool.push_back(storage.back().get());
+    }
+
+    Tile* tile = pool.back();
+    pool.pop_back();
+
+    *tile = Tile{
+          .x = x, .y = y, .cells = {}, .next = {}, .population = 0, .hash = 0, .active = false, .hashed = false};
+    tiles.emplace(key(x, y), tile);
+
+    return tile;
+}
+
+void SparseEngine::release(Tile* tile) {
+    tiles.erase(key(tile->x, tile->y));
+    pool.push_back(tile);
+}
+
+
+
+void SparseEngine::get_cells(std::span<std::uint8_t> cells) const {
+    if (cells.size() != std::size_t{res.x} * res.y) {
+        throw std::invalid_argument("Cell buffer does not match the board resolution.");
+    }
+
+    std::fill(cells.begin(), cells.end(), 0);
+
+    for (const auto& [position, tile]: tiles) {
+        for (std::int64_t y = 0; y < tile_size; ++y) {
+            const std::int64_t cell_y = std::int64_t{tile->y} * tile_size + y;
+
+            if (cell_y < 0 || cell_y >= res.y) {
+                continue;
+            }
+
+            for (std::uint64_t row = tile->cells[y]; row != 0; row &= row - 1) {
+                const std::int64_t cell_x = std::int64_t{tile->x} * tile_size + std::countr_zero(row);
+
+                if (cell_x >= 0 && cell_x < res.x) {
+                    cells[cell_y * res.x + cell_x] = 1;
+                }
+            }
+        }
+    }
+}
+
+void SparseEngine::set_cells(std::span<const std::uint8_t> cells) {
+    if (cells.size() != std::size_t{res.x} * res.y) {
+        throw std::invalid_argument("Cell buffer does not match the board resolution.");
+    }
+
+    while (!tiles.empty()) {
+        release(tiles.begin()->second);
+    }
+
+    changed.clear();
+
+    for (std::int64_t y = 0; y < res.y; ++y) {
+        for (std::int64_t x = 0; x < res.x; ++x) {
+            if (cells[y * res.x + x] == 0) {
+                continue;
+            }
+
+            Tile* tile = find(tile_of(x), tile_of(y));
+
+            if (tile == nullptr) {
+                tile = create(tile_of(x), tile_of(y));
+                changed.push_back(tile);
+            }
+
+            tile->cells[y % tile_size] |= std::uint64_t{1} << (x % tile_size);
+            ++tile->population;
+        }
+    }
+}
+
+
+std::uint64_t SparseEngine::get_population() const {
+    std::uint64_t population = 0;
+
+    for (const auto& [position, tile]: tiles) {
+        population += tile->population;
+    }
+
+    return population;
+}
+
+std::optional<BoundingBox> SparseEngine::get_bounding_box() const {
+    std::optional<BoundingBox> box;
+
+    for (const auto& [position, tile]: tiles) {
+        if (tile->population == 0) {
+            continue;
+        }
+
+        std::uint64_t columns = 0;
+        std::int64_t first_row = -1;
+        std::int64_t last_row = 0;
+
+        for (std::int64_t y = 0; y < tile_size; ++y) {
+            if (tile->cells[y] != 0) {
+                columns |= tile->cells[y];
+                first_row = first_row < 0 ? y : first_row;
+                last_row = y;
+            }
+        }
+
+        const std::int64_t x = std::int64_t{tile->x} * tile_size;
+        const std::int64_t y = std::int64_t{tile->y} * tile_size;
+
+        const BoundingBox tile_box{
+              x + std::countr_zero(columns), y + first_row, x + static_cast<std::int64_t>(std::bit_width(columns)) - 1, y + last_row};
+
+        if (!box) {
+            box = tile_box;
+        }
+
+        box->x_min = std::min(box->x_min, tile_box.x_min);
+        box->y_min = std::min(box->y_min, tile_box.y_min);
+        box->x_max = std::max(box->x_max, tile_box.x_max);
+        box->y_max = std::max(box->y_max, tile_box.y_max);
+    }
+
+    return box;
+}
+
+
+std::uint64_t SparseEngine::get_hash() const {
+    std::uint64_t hash = 0;
+
+    for (const auto& [position, tile]: tiles) {
+        if (!tile->hashed) {
+            const std::uint64_t column = std::uint64_t{static_cast<std::uint32_t>(tile->x)} << 32;
+            const auto first_row = static_cast<std::uint64_t>(std::int64_t{tile->y} * tile_size);
+
+            tile->hash = 0;
+
+            for (std::size_t y = 0; y < tile_size; ++y) {
+                tile->hash += BitBoard::hash_word(tile->cells[y], column ^ (first_row + y));
+            }
+
+            tile->hashed = true;
+        }
+
+        hash += tile->hash;
+    }
+
+    return hash;
+}
+
+
+std::uint64_t SparseEngine::get_memory_bytes() const {
+    // A node of the map holds its key, value and the link to the next node.
+    const std::uint64_t map_bytes = tiles.bucket_count() * sizeof(void*) + tiles.size() * (sizeof(std::uint64_t) + 2 * sizeof(Tile*));
+
+    return storage.size() * sizeof(Tile) + map_bytes + (pool.capacity() + changed.capacity() + active.capacity()) * sizeof(Tile*);
+}
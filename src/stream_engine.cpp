@@ -0,0 +1,635 @@
+#include "stream_engine.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "arena.hpp"
+#include "randomizer.hpp"
+
+
+
+namespace {
+
+static_assert(std::endian::native == std::endian::little, "Board files are little endian.");
+
+
+constexpr std::array<char, 8> magic{'S', 'L', 'I', 'M', 'E', 'O', 'O', 'C'};
+constexpr std::uint32_t version = 1;
+
+
+struct Header {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t reserved;
+
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint64_t generation;
+    std::uint64_t population;
+};
+
+static_assert(sizeof(Header) == 40 && sizeof(Header) <= StreamEngine::data_offset);
+
+
+constexpr std::size_t rows_per_task = 16;
+
+
+// Words of a row in the file.
+std::size_t get_file_words(Resolution res) {
+    return (std::size_t{res.x} + 63) / 64;
+}
+
+std::uint64_t get_row_offset(Resolution res, std::uint64_t row) {
+    return StreamEngine::data_offset + row * get_file_words(res) * sizeof(std::uint64_t);
+}
+
+
+void read_all(int fd, void* data, std::size_t size, std::uint64_t offset) {
+    auto* bytes = static_cast<std::byte*>(data);
+
+    while (size > 0) {
+        const auto done = ::pread(fd, bytes, size, static_cast<off_t>(offset));
+
+        if (done < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (done <= 0) {
+            throw std::runtime_error("Could not read the board file.");
+        }
+
+        bytes += done;
+        size -= static_cast<std::size_t>(done);
+        offset += static_cast<std::uint64_t>(done);
+    }
+}
+
+void write_all(int fd, const void* data, std::size_t size, std::uint64_t offset) {
+    const auto* bytes = static_cast<const std::byte*>(data);
+
+    while (size > 0) {
+        const auto done = ::pwrite(fd, bytes, size, static_cast<off_t>(offset));
+
+        if (done < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (done <= 0) {
+            throw std::runtime_error("Could not write the board file.");
+        }
+
+        bytes += done;
+        size -= static_cast<std::size_t>(done);
+        offset += static_cast<std::uint64_t>(done);
+    }
+}
+
+
+void write_header(int fd, Resolution res, std::uint64_t generation, std::uint64_t population) {
+    const Header header{
+          .magic = magic,
+          .version = version,
+          .reserved = 0,
+          .width = res.x,
+          .height = res.y,
+          .generation = generation,
+          .population = population,
+    };
+
+    write_all(fd, &header, sizeof(header), 0);
+}
+
+
+// Column x is bit x of a file row and bit x + 1 of a board row, past the ghost column.
+void load_row(const std::uint64_t* in, std::size_t file_words, std::uint64_t* out, std::size_t board_words) {
+    std::uint64_t carry = 0;
+
+    for (std::size_t i = 0; i < board_words; ++i) {
+        const std::uint64_t word = i < file_words ? in[i] : 0;
+
+        out[i] = word << 1 | carry;
+        carry = word >> 63;
+    }
+}
+
+// Returns the live cells of the row. The ghost cells are left out, reading one word past the board row is always valid.
+std::uint64_t store_row(const std::uint64_t* in, std::size_t file_words, std::uint64_t last_mask, std::uint64_t* out) {
+    std::uint64_t population = 0;
+
+    for (std::size_t i = 0; i < file_words; ++i) {
+        out[i] = in[i] >> 1 | in[i + 1] << 63;
+
+        if (i + 1 == file_words) {
+            out[i] &= last_mask;
+        }
+
+        population += static_cast<std::uint64_t>(std::popcount(out[i]));
+    }
+
+    return population;
+}
+
+std::uint64_t get_last_mask(Resolution res) {
+    return res.x % 64 == 0 ? ~std::uint64_t{0} : (std::uint64_t{1} << (res.x % 64)) - 1;
+}
+
+
+// A buffer with the read or write in flight on it, waited for before the buffer goes even if stepping throws.
+struct Slot {
+    ~Slot() {
+        if (request.valid()) {
+            request.wait();
+        }
+    }
+
+    arena::Vector<std::uint64_t> buffer;
+    std::future<void> request;
+};
+
+} // namespace
+
+
+
+// Reads and writes of the board file on a thread of their own, in the order they are asked for.
+class StreamEngine::Io {
+  public:
+    explicit Io(int fd): fd{fd}, thread{[this] { work(); }} {}
+
+    // Requests still queued are done first.
+    ~Io() {
+        {
+            std::scoped_lock lock{mutex};
+            stopping = true;
+        }
+
+        wake.notify_all();
+    }
+
+    Io(const Io&) = delete;
+    Io& operator=(const Io&) = delete;
+
+
+    std::future<void> read(std::uint64_t offset, void* data, std::size_t size) {
+        return push({.offset = offset, .target = data, .source = nullptr, .size = size, .done = {}});
+    }
+
+    std::future<void> write(std::uint64_t offset, const void* data, std::size_t size) {
+        return push({.offset = offset, .target = nullptr, .source = data, .size = size, .done = {}});
+    }
+
+
+    IoStatistics get_statistics() const {
+        std::scoped_lock lock{mutex};
+        return statistics;
+    }
+
+
+  private:
+    // Reads into target, or writes source.
+    struct Request {
+        std::uint64_t offset;
+        void* target;
+        const void* source;
+        std::size_t size;
+
+        std::promise<void> done;
+    };
+
+
+    std::future<void> push(Request request) {
+        auto done = request.done.get_future();
+
+        {
+            std::scoped_lock lock{mutex};
+            requests.push_back(std::move(request));
+        }
+
+        wake.notify_one();
+        return done;
+    }
+
+    void work() {
+        std::unique_lock lock{mutex};
+
+        while (true) {
+            wake.wait(lock, [this] { return !requests.empty() || stopping; });
+
+            if (requests.empty()) {
+                return;
+            }
+
+            auto request = std::move(requests.front());
+            requests.pop_front();
+
+            lock.unlock();
+
+            const auto begin = std::chrono::steady_clock::now();
+
+            try {
+                if (request.source != nullptr) {
+                    write_all(fd, request.source, request.size, request.offset);
+                } else {
+                    read_all(fd, request.target, request.size, request.offset);
+                }
+
+                request.done.set_value();
+            } catch (...) {
+                request.done.set_exception(std::current_exception());
+            }
+
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+            lock.lock();
+
+            (request.source != nullptr ? statistics.bytes_written : statistics.bytes_read) += request.size;
+            statistics.busy_seconds += elapsed.count();
+        }
+    }
+
+
+    int fd;
+
+    std::deque<Request> requests;
+    bool stopping = false;
+    IoStatistics statistics;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+
+    std::jthread thread;
+};
+
+
+
+void StreamEngine::create(const std::filesystem::path& path, Resolution res, std::uint64_t seed, float density, unsigned int threads) {
+    randomizer::get_threshold(density);
+
+    write_board(path, res, [&](std::uint32_t first_row, BitBoard& band) {
+        randomizer::fill_band(band, first_row, seed, density, threads);
+    });
+}
+
+void StreamEngine::create(const std::filesystem::path& path, const BitBoard& board) {
+    const auto res = board.get_resolution();
+
+    write_board(path, res, [&](std::uint32_t first_row, BitBoard& band) {
+        for (std::size_t y = 0; y < band.get_resolution().y; ++y) {
+            BitBoard::copy_row(board, first_row + y + 1, band, y + 1, false);
+        }
+    });
+}
+
+
+void StreamEngine::write_board(
+      const std::filesystem::path& path, Resolution res, const std::function<void(std::uint32_t, BitBoard&)>& draw) {
+
+    if (res.x == 0 || res.y == 0) {
+        throw std::invalid_argument("Boards are at least one cell wide and high.");
+    }
+
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (fd < 0) {
+        throw std::runtime_error("Could not open the board file.");
+    }
+
+    const std::size_t words = get_file_words(res);
+    const std::size_t stripe_rows = Options{}.stripe_rows;
+    const std::uint64_t last_mask = get_last_mask(res);
+
+    std::uint64_t population = 0;
+
+    try {
+        Io io{fd};
+        std::array<Slot, 2> slots;
+
+        for (std::uint64_t first_row = 0, stripe = 0; first_row < res.y; first_row += stripe_rows, ++stripe) {
+            const auto rows = static_cast<unsigned int>(std::min<std::uint64_t>(stripe_rows, res.y - first_row));
+
+            BitBoard band{{res.x, rows}};
+            draw(static_cast<std::uint32_t>(first_row), band);
+
+            auto& slot = slots[stripe % slots.size()];
+
+            if (slot.request.valid()) {
+                slot.request.get();
+            }
+
+            slot.buffer.resize(rows * words);
+
+            for (std::size_t y = 0; y < rows; ++y) {
+                population += store_row(band.row(y + 1), words, last_mask, &slot.buffer[y * words]);
+            }
+
+            slot.request = io.write(get_row_offset(res, first_row), slot.buffer.data(), slot.buffer.size() * sizeof(std::uint64_t));
+        }
+
+        for (auto& slot: slots) {
+            if (slot.request.valid()) {
+                slot.request.get();
+            }
+        }
+
+        write_header(fd, res, 0, population);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+
+    if (::close(fd) != 0) {
+        throw std::runtime_error("Could not write the board file.");
+    }
+}
+
+
+
+StreamEngine::StreamEngine(const std::filesystem::path& path, Options options):
+      options{options}, kernel{bit_kernel::select(options.rule, options.isa)}, pool{options.threads} {
+
+    if (!options.rule.is_life_like()) {
+        throw std::invalid_argument("Bit-packed engines only run two state, range 1 rules.");
+    }
+
+    if (options.stripe_rows == 0 || options.depth == 0 || options.prefetch == 0) {
+        throw std::invalid_argument("Stripes, passes and prefetching are at least one row, generation and stripe.");
+    }
+
+    fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+
+    if (fd < 0) {
+        throw std::runtime_error("Could not open the board file.");
+    }
+
+    try {
+        struct stat status{};
+
+        if (::fstat(fd, &status) != 0) {
+            throw std::runtime_error("Could not read the board file.");
+        }
+
+        const auto size = static_cast<std::uint64_t>(status.st_size);
+        Header header{};
+
+        if (size >= sizeof(header)) {
+            read_all(fd, &header, sizeof(header), 0);
+        }
+
+        if (header.magic != magic || header.version != version) {
+            throw std::invalid_argument("Not a board file.");
+        }
+
+        if (header.width == 0 || header.height == 0) {
+            throw std::invalid_argument("Board file is malformed.");
+        }
+
+        res = {header.width, header.height};
+        generation = header.generation;
+        population = header.population;
+
+        if (size < get_row_offset(res, res.y)) {
+            throw std::invalid_argument("Board file is truncated.");
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    io = std::make_unique<Io>(fd);
+}
+
+StreamEngine::~StreamEngine() {
+    io.reset();
+    ::close(fd);
+}
+
+
+void StreamEngine::step(std::uint64_t generations) {
+    const auto begin = std::chrono::steady_clock::now();
+
+    while (generations > 0) {
+        const auto depth = static_cast<std::uint32_t>(std::min<std::uint64_t>(generations, options.depth));
+
+        pass(depth);
+        generations -= depth;
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    seconds += elapsed.count();
+}
+
+
+// Window row b of chunk k holds board row b + k * stripe_rows - depth - 3 (b counting the ghost row of the window BitBoard): the chunk of
+// generation g is the rows [k * stripe_rows - g, + stripe_rows) at window rows [depth - g + 3, + stripe_rows), right after the two rows
+// above it carried over from the chunk before. Each generation is computed from the window of the one before, between two boards.
+void StreamEngine::pass(std::uint32_t depth) {
+    const std::size_t words = get_file_words(res);
+    const std::size_t stripe_rows = options.stripe_rows;
+    const std::size_t height = res.y;
+
+    const std::size_t stripes = (height + stripe_rows - 1) / stripe_rows;
+    const std::size_t chunks = (height + depth + stripe_rows - 1) / stripe_rows;
+    const std::size_t tasks = (stripe_rows + rows_per_task - 1) / rows_per_task;
+    const std::uint64_t last_mask = get_last_mask(res);
+
+    BitBoard front{{res.x, static_cast<unsigned int>(stripe_rows + depth + 2)}};
+    BitBoard back{front.get_resolution()};
+
+    // Rows 2g and 2g + 1 are the last two rows of generation g in the chunk before.
+    BitBoard carried{{res.x, 2 * depth}};
+
+    const std::size_t board_words = front.get_words_per_row();
+
+    std::vector<Slot> reads(options.prefetch);
+    std::vector<Slot> writes(options.prefetch);
+
+    for (auto& slot: reads) {
+        slot.buffer.resize(stripe_rows * words);
+    }
+
+    for (auto& slot: writes) {
+        slot.buffer.resize(stripe_rows * words);
+    }
+
+    const auto read = [&](std::size_t stripe) {
+        if (stripe >= stripes) {
+            return;
+        }
+
+        auto& slot = reads[stripe % reads.size()];
+        const std::size_t rows = std::min(stripe_rows, height - stripe * stripe_rows);
+
+        slot.request = io->read(get_row_offset(res, stripe * stripe_rows), slot.buffer.data(), rows * words * sizeof(std::uint64_t));
+    };
+
+    const auto wait = [&](Slot& slot) {
+        if (!slot.request.valid()) {
+            return;
+        }
+
+        const auto begin = std::chrono::steady_clock::now();
+        slot.request.get();
+
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        waiting_seconds += elapsed.count();
+    };
+
+    for (std::size_t stripe = 0; stripe < options.prefetch; ++stripe) {
+        read(stripe);
+    }
+
+    std::vector<std::uint64_t> populations(tasks);
+    std::uint64_t next_population = 0;
+
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+        const auto first_row = static_cast<std::int64_t>(chunk * stripe_rows) - depth - 3;
+
+        // Window rows [begin, end) that lie on the board.
+        const auto clip = [&](std::size_t begin, std::size_t end) {
+            const auto low = std::clamp<std::int64_t>(-first_row, static_cast<std::int64_t>(begin), static_cast<std::int64_t>(end));
+            const auto high = std::clamp<std::int64_t>(static_cast<std::int64_t>(height) - first_row, low, static_cast<std::int64_t>(end));
+
+            return std::pair{static_cast<std::size_t>(low), static_cast<std::size_t>(high)};
+        };
+
+        // Generation 0 is read from the file.
+        BitBoard::copy_row(carried, 1, front, depth + 1, false);
+        BitBoard::copy_row(carried, 2, front, depth + 2, false);
+
+        if (chunk < stripes) {
+            auto& slot = reads[chunk % reads.size()];
+            wait(slot);
+
+            const std::size_t rows = std::min(stripe_rows, height - chunk * stripe_rows);
+
+            pool.parallel_for(tasks, [&](std::size_t task) {
+                for (std::size_t y = task * rows_per_task; y < std::min(stripe_rows, (task + 1) * rows_per_task); ++y) {
+                    if (y < rows) {
+                        load_row(&slot.buffer[y * words], words, front.row(depth + 3 + y), board_words);
+                    } else {
+                        std::fill_n(front.row(depth + 3 + y), board_words, 0);
+                    }
+                }
+            });
+
+            read(chunk + reads.size());
+        } else {
+            for (std::size_t y = 0; y < stripe_rows; ++y) {
+                std::fill_n(front.row(depth + 3 + y), board_words, 0);
+            }
+        }
+
+        for (std::size_t g = 1; g <= depth; ++g) {
+            const std::size_t begin = depth - g + 3;
+
+            if (g < depth) {
+                BitBoard::copy_row(carried, 2 * g + 1, back, begin - 2, false);
+                BitBoard::copy_row(carried, 2 * g + 2, back, begin - 1, false);
+            }
+
+            pool.parallel_for(tasks, [&](std::size_t task) {
+                const std::size_t task_begin = begin + task * rows_per_task;
+                const std::size_t task_end = std::min(begin + stripe_rows, task_begin + rows_per_task);
+
+                // Cells off the board stay dead.
+                const auto [low, high] = clip(task_begin, task_end);
+
+                for (std::size_t y = task_begin; y < task_end; ++y) {
+                    if (y < low || y >= high) {
+                        std::fill_n(back.row(y), board_words, 0);
+                    }
+                }
+
+                if (low < high) {
+                    kernel(front, back, low, high, options.rule);
+                }
+            });
+
+            BitBoard::copy_row(front, begin + stripe_rows - 1, carried, 2 * g - 1, false);
+            BitBoard::copy_row(front, begin + stripe_rows, carried, 2 * g, false);
+
+            std::swap(front, back);
+        }
+
+        // The chunk of the last generation, at window rows [3, 3 + stripe_rows), goes back to the file.
+        const auto [low, high] = clip(3, 3 + stripe_rows);
+
+        if (low == high) {
+            continue;
+        }
+
+        auto& slot = writes[chunk % writes.size()];
+        wait(slot);
+
+        pool.parallel_for(tasks, [&](std::size_t task) {
+            populations[task] = 0;
+
+            for (std::size_t y = low + task * rows_per_task; y < std::min(high, low + (task + 1) * rows_per_task); ++y) {
+                populations[task] += store_row(front.row(y), words, last_mask, &slot.buffer[(y - low) * words]);
+            }
+        });
+
+        for (const auto count: populations) {
+            next_population += count;
+        }
+
+        slot.request = io->write(get_row_offset(res, static_cast<std::uint64_t>(first_row + static_cast<std::int64_t>(low))),
+              slot.buffer.data(), (high - low) * words * sizeof(std::uint64_t));
+    }
+
+    for (auto& slot: writes) {
+        wait(slot);
+    }
+
+    generation += depth;
+    population = next_population;
+
+    write_header(fd, res, generation, population);
+}
+
+
+void StreamEngine::read_band(std::uint32_t first_row, BitBoard& band) const {
+    const auto band_res = band.get_resolution();
+
+    if (band_res.x != res.x || std::uint64_t{first_row} + band_res.y > res.y) {
+        throw std::invalid_argument("Band does not fit in the board.");
+    }
+
+    const std::size_t words = get_file_words(res);
+    std::vector<std::uint64_t> buffer(std::size_t{band_res.y} * words);
+
+    read_all(fd, buffer.data(), buffer.size() * sizeof(std::uint64_t), get_row_offset(res, first_row));
+
+    for (std::size_t y = 0; y < band_res.y; ++y) {
+        load_row(&buffer[y * words], words, band.row(y + 1), band.get_words_per_row());
+    }
+
+    band.clear_halo();
+}
+
+
+StreamEngine::IoStatistics StreamEngine::get_io_statistics() const {
+    auto statistics = io->get_statistics();
+
+    statistics.waiting_seconds = waiting_seconds;
+    statistics.seconds = seconds;
+
+    return statistics;
+}
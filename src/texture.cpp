@@ -1,5 +1,7 @@
 #include "texture.hpp"
 
+#include <stdexcept>
+
 #include <glad/gl.h>
 
 
@@ -7,22 +9,22 @@ namespace glu {
 
 
 
-Texture::Texture(Resolution res, InternalFormat internal_format): internal_format{internal_format} {
+Texture::Texture(Resolution res, InternalFormat internal_format, unsigned int levels):
+      res{res}, levels{levels}, internal_format{internal_format} {
+
+    if (levels == 0) {
+        throw std::invalid_argument("Textures need at least one level.");
+    }
 
     glCreateTextures(GL_TEXTURE_2D, 1, &id);
 
     glTextureParameteri(id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTextureParameteri(id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
-
-    glBindTexture(GL_TEXTURE_2D, id);
+    glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, get_internal_flag(internal_format), res.x, res.y, 0, get_flag(internal_format),
-          get_data_type(internal_format), nullptr);
-
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glTextureStorage2D(
+          id, static_cast<int>(levels), get_internal_flag(internal_format), static_cast<int>(res.x), static_cast<int>(res.y));
 }
 
 
@@ -33,8 +35,29 @@ Texture::~Texture() {
 }
 
 
-void Texture::bind_to_image_unit(unsigned int unit, AccessType access) const {
-    glBindImageTexture(unit, id, 0, GL_FALSE, 0, get_flag(access), get_internal_flag(internal_format));
+void Texture::clear() {
+    for (unsigned int level = 0; level < levels; ++level) {
+        glClearTexImage(id, static_cast<int>(level), get_flag(internal_format), get_data_type(internal_format), nullptr);
+    }
+}
+
+
+void Texture::copy_to_buffer(const Buffer& buffer, std::size_t offset, int x, int y, Resolution size) const {
+    const std::size_t bytes = std::size_t{size.x} * size.y * get_texel_size(internal_format);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.get_id());
+
+    // With a pack buffer bound the pointer is an offset into it.
+    glGetTextureSubImage(id, 0, x, y, 0, size.x, size.y, 1, get_flag(internal_format), get_data_type(internal_format),
+          static_cast<GLsizei>(bytes), reinterpret_cast<void*>(offset));
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+
+void Texture::bind_to_image_unit(unsigned int unit, AccessType access, unsigned int level) const {
+    glBindImageTexture(unit, id, static_cast<int>(level), GL_FALSE, 0, get_flag(access), get_internal_flag(internal_format));
 }
 
 void Texture::bind_to_texture_unit(unsigned int unit) const {
@@ -42,4 +65,99 @@ void Texture::bind_to_texture_unit(unsigned int unit) const {
 }
 
 
-} // namespace glu
\ No newline at end of file
+TextureArray::TextureArray(Texture::Resolution res, unsigned int layers, Texture::InternalFormat internal_format):
+      res{res}, layers{layers}, internal_format{internal_format} {
+
+    if (layers == 0) {
+        throw std::invalid_argument("Texture arrays need at least one layer.");
+    }
+
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &id);
+
+    // Integer formats cannot be filtered.
+    glTextureParameteri(id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+    glTextureStorage3D(id, 1, get_internal_flag(internal_format), res.x, res.y, layers);
+}
+
+
+TextureArray::~TextureArray() {
+    if (id != 0) {
+        glDeleteTextures(1, &id);
+    }
+}
+
+
+void TextureArray::clear() {
+    glClearTexImage(id, 0, get_flag(internal_format), get_data_type(internal_format), nullptr);
+}
+
+
+void TextureArray::bind_to_image_unit(unsigned int unit, Texture::AccessType access) const {
+    glBindImageTexture(unit, id, 0, GL_TRUE, 0, get_flag(access), get_internal_flag(internal_format));
+}
+
+
+ReadbackRing::ReadbackRing(Texture::Resolution size, Texture::InternalFormat format, std::size_t slots):
+      size{size}, format{format}, slot_bytes{std::size_t{size.x} * size.y * get_texel_size(format)}, slots(slots) {
+
+    if (slots == 0) {
+        throw std::invalid_argument("A readback ring needs at least one slot.");
+    }
+
+    mapping = buffer.allocate_mapped(slot_bytes * slots);
+
+    if (mapping.data() == nullptr) {
+        throw std::runtime_error("Could not map the readback buffer.");
+    }
+}
+
+
+bool ReadbackRing::request(const Texture& texture, int x, int y, std::uint64_t tag) {
+    if (texture.get_internal_format() != format) {
+        throw std::invalid_argument("Texture format does not match the readback ring.");
+    }
+
+    if (pending == slots.size()) {
+        return false;
+    }
+
+    // Image stores from compute shaders must land before the copy reads them.
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+
+    texture.copy_to_buffer(buffer, next * slot_bytes, x, y, size);
+
+    auto& slot = slots[next];
+    slot.fence.insert();
+    slot.tag = tag;
+
+    next = (next + 1) % slots.size();
+    ++pending;
+
+    return true;
+}
+
+
+std::optional<ReadbackRing::Frame> ReadbackRing::poll() {
+    if (pending == 0) {
+        return std::nullopt;
+    }
+
+    const std::size_t oldest = (next + slots.size() - pending) % slots.size();
+    auto& slot = slots[oldest];
+
+    if (!slot.fence.is_signaled()) {
+        return std::nullopt;
+    }
+
+    slot.fence.reset();
+    --pending;
+
+    return Frame{slot.tag, mapping.subspan(oldest * slot_bytes, slot_bytes)};
+}
+
+
+} // namespace glu
@@ -0,0 +1,144 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+
+
+ThreadPool::ThreadPool(unsigned int threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned int i = 0; i < threads; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+
+    for (unsigned int i = 1; i < threads; ++i) {
+        this->threads.emplace_back([this, i] { work(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::scoped_lock lock{mutex};
+        stopping = true;
+    }
+
+    wake.notify_all();
+
+    // Join before the members the workers wait on are destroyed.
+    threads.clear();
+}
+
+
+void ThreadPool::parallel_for(std::size_t count, const std::function<void(std::size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+
+    const std::size_t workers = queues.size();
+
+    {
+        std::scoped_lock lock{mutex};
+
+        job = &task;
+        remaining = count;
+
+        for (std::size_t i = 0; i < workers; ++i) {
+            std::scoped_lock queue_lock{queues[i]->mutex};
+
+            queues[i]->begin = count * i / workers;
+            queues[i]->end = count * (i + 1) / workers;
+        }
+
+        ++epoch;
+    }
+
+    wake.notify_all();
+
+    drain(0);
+
+    std::unique_lock lock{mutex};
+    done.wait(lock, [this] { return remaining == 0; });
+}
+
+
+bool ThreadPool::pop(std::size_t worker, std::size_t& index) {
+    auto& queue = *queues[worker];
+    std::scoped_lock lock{queue.mutex};
+
+    if (queue.begin == queue.end) {
+        return false;
+    }
+
+    index = queue.begin++;
+    return true;
+}
+
+bool ThreadPool::steal(std::size_t worker, std::size_t& index) {
+    const std::size_t workers = queues.size();
+
+    auto& own = *queues[worker];
+
+    for (std::size_t i = 1; i < workers; ++i) {
+        auto& victim = *queues[(worker + i) % workers];
+
+        std::scoped_lock lock{own.mutex, victim.mutex};
+
+        // A new loop may have been started since we last looked.
+        if (own.begin != own.end) {
+            index = own.begin++;
+            return true;
+        }
+
+        if (victim.begin == victim.end) {
+            continue;
+        }
+
+        // Take the back half, the victim keeps walking its front.
+        const std::size_t split = victim.begin + (victim.end - victim.begin) / 2;
+
+        own.begin = split + 1;
+        own.end = victim.end;
+        victim.end = split;
+
+        index = split;
+        return true;
+    }
+
+    return false;
+}
+
+
+void ThreadPool::drain(std::size_t worker) {
+    std::size_t index = 0;
+
+    while (pop(worker, index) || steal(worker, index)) {
+        // The job can only change once every index has been run, so it is current while we hold one.
+        (*job)(index);
+
+        if (remaining.fetch_sub(1) == 1) {
+            std::scoped_lock lock{mutex};
+            done.notify_all();
+        }
+    }
+}
+
+void ThreadPool::work(std::size_t worker) {
+    std::uint64_t seen = 0;
+
+    while (true) {
+        {
+            std::unique_lock lock{mutex};
+            wake.wait(lock, [&] { return stopping || epoch != seen; });
+
+            if (stopping) {
+                return;
+            }
+
+            seen = epoch;
+        }
+
+        drain(worker);
+    }
+}
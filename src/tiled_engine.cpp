@@ -0,0 +1,230 @@
+#include "tiled_engine.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+
+
+TiledEngine::TiledEngine(Resolution res, unsigned int threads, Topology topology, const Rule& rule, bit_kernel::Isa isa):
+      Engine{res},
+      topology{topology},
+      rule{rule},
+      isa{isa},
+      kernel{bit_kernel::select(rule, isa)},
+      edges(2 * std::size_t{res.y}, 0),
+      next_edges(2 * std::size_t{res.y}, 0),
+      pool{threads} {
+
+    if (!rule.is_life_like()) {
+        throw std::invalid_argument("Bit-packed engines only run two state, range 1 rules.");
+    }
+
+    const std::size_t row_bytes = (res.x + 2 + 63) / 64 * sizeof(std::uint64_t);
+
+    // Enough rows to fill the cache budget, but at least a few tiles per thread to steal from.
+    std::size_t rows = std::max<std::size_t>(1, tile_bytes / (2 * row_bytes));
+    rows = std::min(rows, std::max<std::size_t>(8, res.y / (4 * pool.get_thread_count())));
+
+    for (unsigned int y = 0; y < res.y; y += static_cast<unsigned int>(rows)) {
+        const auto height = static_cast<unsigned int>(std::min<std::size_t>(rows, res.y - y));
+
+        const Resolution tile_res{res.x, height};
+
+        tiles.push_back({y, std::make_shared<BitBoard>(tile_res), std::make_shared<BitBoard>(tile_res), {}, 0, true});
+    }
+}
+
+
+void TiledEngine::step(std::uint64_t generations) {
+    for (std::uint64_t i = 0; i < generations; ++i) {
+        pool.parallel_for(tiles.size(), [this](std::size_t index) { step_tile(index); });
+
+        for (auto& tile: tiles) {
+            std::swap(tile.front, tile.back);
+        }
+
+        std::swap(edges, next_edges);
+
+        fill_halo();
+    }
+}
+
+
+void TiledEngine::step_tile(std::size_t index) {
+    auto& tile = tiles[index];
+
+    BitBoard::make_unshared(tile.back, tile.spares);
+
+    kernel(*tile.front, *tile.back, 1, tile.front->get_resolution().y + 1, rule);
+
+    tile.hashed = false;
+
+    if (topology != Topology::DeadBorder) {
+        record_edges(tile, *tile.back, next_edges);
+    }
+}
+
+
+void TiledEngine::fill_halo() {
+    if (topology != Topology::DeadBorder) {
+        pool.parallel_for(tiles.size(), [this](std::size_t index) { fill_ghost_columns(index); });
+    }
+
+    pool.parallel_for(tiles.size(), [this](std::size_t index) { fill_ghost_rows(index); });
+}
+
+
+void TiledEngine::fill_ghost_columns(std::size_t index) {
+    auto& tile = tiles[index];
+
+    const std::int64_t height = tile.front->get_resolution().y;
+
+    for (std::int64_t y = 0; y < height; ++y) {
+        for (const std::int64_t x: {std::int64_t{-1}, std::int64_t{res.x}}) {
+            const auto [source_x, source_y] = *wrap(topology, res, x, tile.y + y);
+            tile.front->set_ghost(x, y, edges[2 * source_y + (source_x == 0 ? 0 : 1)] != 0);
+        }
+    }
+}
+
+
+void TiledEngine::fill_ghost_rows(std::size_t index) {
+    auto& tile = tiles[index];
+
+    const std::size_t height = tile.front->get_resolution().y;
+
+    // Ghost columns are all filled by now, and strips only write their own ghost rows.
+    if (index > 0) {
+        const auto& above = *tiles[index - 1].front;
+        BitBoard::copy_row(above, above.get_resolution().y, *tile.front, 0, false);
+    } else if (topology != Topology::DeadBorder) {
+        const auto [board, row] = find_row(wrap(topology, res, 0, -1)->second);
+        BitBoard::copy_row(*board, row, *tile.front, 0, mirrors_rows(topology));
+    }
+
+    if (index + 1 < tiles.size()) {
+        BitBoard::copy_row(*tiles[index + 1].front, 1, *tile.front, height + 1, false);
+    } else if (topology != Topology::DeadBorder) {
+        const auto [board, row] = find_row(wrap(topology, res, 0, res.y)->second);
+        BitBoard::copy_row(*board, row, *tile.front, height + 1, mirrors_rows(topology));
+    }
+}
+
+
+void TiledEngine::record_edges(const Tile& tile, const BitBoard& board, std::vector<std::uint8_t>& into) const {
+    const unsigned int height = board.get_resolution().y;
+
+    for (unsigned int y = 0; y < height; ++y) {
+        into[2 * (std::size_t{tile.y} + y)] = board.get(0, y);
+        into[2 * (std::size_t{tile.y} + y) + 1] = board.get(res.x - 1, y);
+    }
+}
+
+std::pair<const BitBoard*, std::size_t> TiledEngine::find_row(std::int64_t y) const {
+    const auto tile =
+          std::prev(std::upper_bound(tiles.begin(), tiles.end(), y, [](std::int64_t row, const Tile& tile) { return row < tile.y; }));
+
+    return {tile->front.get(), static_cast<std::size_t>(y - tile->y + 1)};
+}
+
+
+void TiledEngine::get_cells(std::span<std::uint8_t> cells) const {
+    if (cells.size() != std::size_t{res.x} * res.y) {
+        throw std::invalid_argument("Cell buffer does not match the board resolution.");
+    }
+
+    for (const auto& tile: tiles) {
+        const auto tile_res = tile.front->get_resolution();
+
+        tile.front->store_cells(cells.subspan(std::size_t{tile.y} * res.x, std::size_t{tile_res.y} * res.x));
+    }
+}
+
+void TiledEngine::set_cells(std::span<const std::uint8_t> cells) {
+    if (cells.size() != std::size_t{res.x} * res.y) {
+        throw std::invalid_argument("Cell buffer does not match the board resolution.");
+    }
+
+    for (auto& tile: tiles) {
+        const auto tile_res = tile.front->get_resolution();
+
+        BitBoard::make_unshared(tile.front, tile.spares);
+
+        tile.front->load_cells(cells.subspan(std::size_t{tile.y} * res.x, std::size_t{tile_res.y} * res.x));
+        tile.hashed = false;
+
+        record_edges(tile, *tile.front, edges);
+    }
+
+    fill_halo();
+}
+
+
+std::vector<Engine::Band> TiledEngine::get_bands() const {
+    std::vector<Band> bands;
+    bands.reserve(tiles.size());
+
+    for (const auto& tile: tiles) {
+        bands.push_back({tile.y, tile.front});
+    }
+
+    return bands;
+}
+
+void TiledEngine::set_board(std::shared_ptr<BitBoard> board) {
+    const auto board_res = board->get_resolution();
+
+    if (board_res.x != res.x || board_res.y != res.y) {
+        throw std::invalid_argument("Board does not match the engine resolution.");
+    }
+
+    for (auto& tile: tiles) {
+        const unsigned int height = tile.front->get_resolution().y;
+
+        BitBoard::make_unshared(tile.front, tile.spares);
+
+        for (unsigned int y = 1; y <= height; ++y) {
+            BitBoard::copy_row(*board, tile.y + y, *tile.front, y, false);
+        }
+
+        tile.front->clear_halo();
+        tile.hashed = false;
+
+        record_edges(tile, *tile.front, edges);
+    }
+
+    fill_halo();
+}
+
+
+std::uint64_t TiledEngine::get_hash() const {
+    std::uint64_t hash = 0;
+
+    for (const auto& tile: tiles) {
+        if (!tile.hashed) {
+            tile.hash = tile.front->hash(tile.y);
+            tile.hashed = true;
+        }
+
+        hash += tile.hash;
+    }
+
+    return hash;
+}
+
+
+std::uint64_t TiledEngine::get_memory_bytes() const {
+    std::uint64_t bytes = edges.size() + next_edges.size();
+
+    for (const auto& tile: tiles) {
+        bytes += tile.front->get_memory_bytes() + tile.back->get_memory_bytes();
+
+        for (const auto& spare: tile.spares) {
+            bytes += spare->get_memory_bytes();
+        }
+    }
+
+    return bytes;
+}
@@ -0,0 +1,153 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+
+
+namespace trace {
+
+
+namespace {
+
+using clock_t = std::chrono::steady_clock;
+
+const clock_t::time_point epoch = clock_t::now();
+
+std::atomic<bool> enabled{false};
+std::atomic<std::uint32_t> next_track{0};
+
+std::mutex mutex;
+
+// Allocated with the first event, `next` is where it goes and `size` how many are kept.
+std::vector<Event> ring;
+std::size_t next = 0;
+std::size_t size = 0;
+
+
+std::string quote(std::string_view text) {
+    std::string quoted = "\"";
+
+    for (const char c: text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+
+        quoted += c;
+    }
+
+    return quoted + '"';
+}
+
+} // namespace
+
+
+
+void set_enabled(bool on) {
+    enabled.store(on, std::memory_order_relaxed);
+}
+
+bool is_enabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+
+std::uint64_t now() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t::now() - epoch).count());
+}
+
+std::uint32_t get_track() {
+    thread_local const std::uint32_t track = next_track.fetch_add(1, std::memory_order_relaxed);
+    return track;
+}
+
+
+void record(const Event& event) {
+    if (!is_enabled()) {
+        return;
+    }
+
+    const std::lock_guard lock{mutex};
+
+    if (ring.empty()) {
+        ring.resize(capacity);
+    }
+
+    ring[next] = event;
+    next = (next + 1) % capacity;
+    size = std::min(size + 1, capacity);
+}
+
+
+std::vector<Event> get_events(std::size_t count) {
+    const std::lock_guard lock{mutex};
+
+    count = std::min(count, size);
+
+    std::vector<Event> events;
+    events.reserve(count);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        events.push_back(ring[(next + capacity - count + i) % capacity]);
+    }
+
+    return events;
+}
+
+void clear() {
+    const std::lock_guard lock{mutex};
+
+    next = 0;
+    size = 0;
+}
+
+
+void write_chrome_trace(const std::filesystem::path& path, std::span<const Event> events) {
+    std::ofstream out{path};
+
+    out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+    std::set<std::uint32_t> tracks;
+    bool first = true;
+
+    for (const auto& event: events) {
+        out << (first ? "\n" : ",\n") << "  {\"name\": " << quote(event.name) << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << event.track
+            << ", \"ts\": " << static_cast<double>(event.begin) / 1e3 << ", \"dur\": " << static_cast<double>(event.duration) / 1e3 << "}";
+
+        tracks.insert(event.track);
+        first = false;
+    }
+
+    for (const auto track: tracks) {
+        const std::string name = track == gpu_track ? "GPU" : "Thread " + std::to_string(track);
+
+        out << (first ? "\n" : ",\n") << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << track
+            << ", \"args\": {\"name\": " << quote(name) << "}}";
+
+        first = false;
+    }
+
+    out << "\n]}\n";
+
+    if (!out) {
+        throw std::runtime_error("Could not write trace.");
+    }
+}
+
+
+Span::~Span() {
+    if (recording) {
+        const auto end = now();
+        record({.name = name, .begin = begin, .duration = end - begin, .track = get_track()});
+    }
+}
+
+
+} // namespace trace
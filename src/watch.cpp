@@ -0,0 +1,117 @@
+// Watches a live stream (see include/live_stream.hpp) and prints a line of JSON per frame as it arrives: its generation, whether it was a
+// keyframe, its size on the wire and the population of the board it leaves the viewer with.
+//
+//   slime_watch [--host HOST] [--frames N] PORT
+//
+// HOST defaults to the loopback address, --frames N stops after N frames instead of when the stream ends.
+
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "live_stream.hpp"
+
+
+
+namespace {
+
+constexpr std::string_view usage = "usage: slime_watch [--host HOST] [--frames N] PORT\n";
+
+
+struct Options {
+    std::string host = "127.0.0.1";
+    std::uint16_t port = 0;
+
+    // Until the stream ends if not given.
+    std::optional<std::uint64_t> frames;
+};
+
+
+template<typename T>
+T parse_number(std::string_view text) {
+    T value{};
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+
+    if (error != std::errc{} || end != text.data() + text.size()) {
+        throw std::invalid_argument("Invalid number: " + std::string{text});
+    }
+
+    return value;
+}
+
+
+Options parse_options(std::span<char*> args) {
+    Options options;
+    bool has_port = false;
+
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        const std::string_view option = args[i];
+
+        if (option == "--host" || option == "--frames") {
+            if (i + 1 == args.size()) {
+                throw std::invalid_argument("Missing value for " + std::string{option});
+            }
+
+            const std::string_view value = args[++i];
+
+            if (option == "--host") {
+                options.host = value;
+            } else {
+                options.frames = parse_number<std::uint64_t>(value);
+            }
+        } else if (option.starts_with("--") || has_port) {
+            throw std::invalid_argument("Unexpected argument: " + std::string{option});
+        } else {
+            options.port = parse_number<std::uint16_t>(option);
+            has_port = true;
+        }
+    }
+
+    if (!has_port) {
+        throw std::invalid_argument("Missing port");
+    }
+
+    return options;
+}
+
+} // namespace
+
+
+
+int main(int argc, char* argv[]) {
+    Options options;
+
+    try {
+        options = parse_options({argv + 1, static_cast<std::size_t>(argc - 1)});
+    } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << '\n' << usage;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        live::Client client{options.host, options.port};
+
+        for (std::uint64_t frame = 0; !options.frames || frame < *options.frames; ++frame) {
+            if (!client.receive()) {
+                break;
+            }
+
+            const auto& header = client.get_header();
+
+            std::cout << "{\"generation\": " << header.generation
+                      << ", \"keyframe\": " << (header.type == live::FrameType::Keyframe ? "true" : "false")
+                      << ", \"width\": " << header.width << ", \"height\": " << header.height
+                      << ", \"bytes\": " << sizeof(header) + header.payload_bytes << ", \"population\": " << client.get_population()
+                      << "}" << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,524 @@
+// Tests of the headless simulation, run by ctest:
+//
+//   - every CPU backend against the CPU one, the out-of-core engine included, for every topology and a rule of each family, and that
+//     the backends reject exactly the rules and topologies they cannot run
+//   - checkpoints written and loaded back, compressed or not, and restored into a simulation, Generations boards included
+//   - live streams encoded and decoded, and their frames received over a loopback connection, Generations boards included
+//   - patterns written and read back in every format, and malformed pattern files rejected
+//
+// Prints every check that failed and exits with 1 if any did.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bit_board.hpp"
+#include "checkpoint.hpp"
+#include "live_stream.hpp"
+#include "pattern.hpp"
+#include "rule.hpp"
+#include "simulation.hpp"
+#include "stream_engine.hpp"
+#include "topology.hpp"
+
+
+
+namespace {
+
+// Life-like, with B0, on the generic bit-packed kernel and on it telling count 8 from count 0, Generations and Larger than Life, the
+// centre left out of the last one.
+constexpr std::array rule_families{
+      "B3/S23", "B36/S23", "B2/S", "B0123478/S34678", "B36/S235", "B3/S238", "B2/S/C3", "B2/S345/C4", "R5,C0,M1,S34..58,B34..45,NM",
+      "R2,C3,M0,S4..7,B4..6,NM",
+};
+
+// Steps between the boards compared, so engines that jump several generations at once (HashLife) do so too.
+constexpr std::array<std::uint64_t, 3> steps{1, 9, 30};
+
+
+int failures = 0;
+
+void check(bool passed, std::string_view what) {
+    if (!passed) {
+        std::cerr << "FAIL: " << what << '\n';
+        ++failures;
+    }
+}
+
+
+std::string describe(Simulation::Backend backend, Topology topology, std::string_view rule, Resolution res) {
+    return std::string{get_name(backend)} + ", " + std::string{get_name(topology)} + ", " + std::string{rule} + ", "
+         + std::to_string(res.x) + "x" + std::to_string(res.y);
+}
+
+
+bool is_bounded(Simulation::Backend backend) {
+    return backend != Simulation::Backend::HashLife && backend != Simulation::Backend::Sparse;
+}
+
+bool is_supported(Simulation::Backend backend, Topology topology, const Rule& rule) {
+    switch (backend) {
+        case Simulation::Backend::Cpu: return true;
+        case Simulation::Backend::Packed:
+        case Simulation::Backend::Tiled: return rule.is_life_like();
+        case Simulation::Backend::Distributed: return rule.is_life_like() && topology != Topology::ProjectivePlane;
+        case Simulation::Backend::HashLife:
+        case Simulation::Backend::Sparse: return rule.is_life_like() && (rule.birth & 1) == 0 && topology == Topology::DeadBorder;
+        case Simulation::Backend::Gl: return false;
+    }
+
+    return false;
+}
+
+
+// Live cells at random within [x_begin, x_end) x [y_begin, y_end).
+std::vector<std::uint8_t> make_soup(Resolution res, std::uint64_t seed, std::uint32_t x_begin, std::uint32_t y_begin, std::uint32_t x_end,
+      std::uint32_t y_end) {
+    std::mt19937_64 random{seed};
+    std::vector<std::uint8_t> cells(std::size_t{res.x} * res.y);
+
+    for (std::uint32_t y = y_begin; y < y_end; ++y) {
+        for (std::uint32_t x = x_begin; x < x_end; ++x) {
+            cells[std::size_t{y} * res.x + x] = random() % 8 < 3 ? 1 : 0;
+        }
+    }
+
+    return cells;
+}
+
+bool is_same_box(const std::optional<BoundingBox>& a, const std::optional<BoundingBox>& b) {
+    if (!a || !b) {
+        return !a && !b;
+    }
+
+    return a->x_min == b->x_min && a->y_min == b->y_min && a->x_max == b->x_max && a->y_max == b->y_max;
+}
+
+std::vector<std::uint8_t> get_cells(const Simulation& simulation) {
+    const Resolution res = simulation.get_resolution();
+    std::vector<std::uint8_t> cells(std::size_t{res.x} * res.y);
+
+    simulation.get_cells(cells);
+
+    return cells;
+}
+
+
+
+// Bounded backends start from a soup over the whole board, so the edges wrap around it. Unbounded ones run on a plane the board is only a
+// window of, their soup stays far enough from the edges that nothing reaches them before the last generation compared.
+void test_backend(Simulation::Backend backend, Topology topology, std::string_view notation, Resolution res) {
+    const Rule rule = Rule::parse(notation);
+    const std::string name = describe(backend, topology, notation, res);
+
+    std::optional<Simulation> simulation;
+
+    try {
+        simulation.emplace(res, Simulation::Parameters{.backend = backend, .topology = topology, .rule = rule, .threads = 2});
+    } catch (const std::invalid_argument&) {
+        check(!is_supported(backend, topology, rule), name + ": rejected");
+        return;
+    }
+
+    check(is_supported(backend, topology, rule), name + ": accepted");
+
+    const std::uint32_t margin = is_bounded(backend) ? 0 : 40;
+    const auto soup = make_soup(res, res.x * 31 + res.y, margin, margin, res.x - margin, res.y - margin);
+
+    Simulation reference{res, {.backend = Simulation::Backend::Cpu, .topology = topology, .rule = rule}};
+
+    reference.set_cells(soup);
+    simulation->set_cells(soup);
+
+    for (const auto generations: steps) {
+        reference.step(generations);
+        simulation->step(generations);
+
+        const std::string at = name + ", generation " + std::to_string(reference.get_generation());
+
+        check(get_cells(*simulation) == get_cells(reference), at + ": cells");
+        check(simulation->get_population() == reference.get_population(), at + ": population");
+        check(is_same_box(simulation->get_bounding_box(), reference.get_bounding_box()), at + ": bounding box");
+
+        if (is_bounded(backend)) {
+            check(simulation->get_hash() == reference.get_hash(), at + ": hash");
+        }
+    }
+}
+
+// The out-of-core engine is not a simulation backend, its board stays in a file with a dead border. Short stripes and passes, so boards
+// span several of both and the last pass is shorter.
+void test_out_of_core(std::string_view notation, Resolution res) {
+    const Rule rule = Rule::parse(notation);
+    const std::string name = "Out of core, " + std::string{notation} + ", " + std::to_string(res.x) + "x" + std::to_string(res.y);
+    const auto path = std::filesystem::temp_directory_path() / "slime_tests.board";
+
+    const auto soup = make_soup(res, res.x * 31 + res.y, 0, 0, res.x, res.y);
+
+    BitBoard board{res};
+    board.load_cells(soup);
+
+    StreamEngine::create(path, board);
+
+    std::optional<StreamEngine> engine;
+
+    try {
+        engine.emplace(path, StreamEngine::Options{.rule = rule, .stripe_rows = 16, .depth = 4, .threads = 2});
+    } catch (const std::invalid_argument&) {
+        check(!rule.is_life_like(), name + ": rejected");
+        std::filesystem::remove(path);
+        return;
+    }
+
+    check(rule.is_life_like(), name + ": accepted");
+
+    Simulation reference{res, {.rule = rule}};
+    reference.set_cells(soup);
+
+    for (const auto generations: steps) {
+        reference.step(generations);
+        engine->step(generations);
+
+        const std::string at = name + ", generation " + std::to_string(reference.get_generation());
+
+        std::vector<std::uint8_t> cells(soup.size());
+        engine->read_band(0, board);
+        board.store_cells(cells);
+
+        check(cells == get_cells(reference), at + ": cells");
+        check(engine->get_population() == reference.get_population(), at + ": population");
+    }
+
+    engine.reset();
+    std::filesystem::remove(path);
+}
+
+
+void test_backends() {
+    for (const auto backend: Simulation::backends) {
+        if (backend == Simulation::Backend::Cpu || !Simulation::has_backend(backend)) {
+            continue;
+        }
+
+        const auto sizes = is_bounded(backend) ? std::vector<Resolution>{{150, 97}, {67, 70}} : std::vector<Resolution>{{160, 128}};
+
+        for (const auto topology: topologies) {
+            for (const auto notation: rule_families) {
+                for (const auto res: sizes) {
+                    test_backend(backend, topology, notation, res);
+                }
+            }
+        }
+    }
+
+    for (const auto notation: rule_families) {
+        test_out_of_core(notation, {150, 97});
+    }
+}
+
+
+
+// A few generations into a soup, so Generations boards have dying cells.
+void start(Simulation& simulation) {
+    const Resolution res = simulation.get_resolution();
+
+    simulation.set_cells(make_soup(res, 7, 0, 0, res.x, res.y));
+    simulation.step(5);
+}
+
+
+void test_checkpoint(Simulation::Backend backend, std::string_view notation, Topology topology, Resolution res, bool compress) {
+    const std::string name = describe(backend, topology, notation, res) + (compress ? ", compressed" : ", uncompressed");
+    const auto path = std::filesystem::temp_directory_path() / "slime_tests.ckp";
+
+    Simulation simulation{res, {.backend = backend, .topology = topology, .rule = Rule::parse(notation)}};
+    start(simulation);
+
+    const auto snapshot = checkpoint::take(simulation);
+
+    check(snapshot.states.empty() == (simulation.params.rule.states == 2), name + ": snapshot states");
+
+    checkpoint::write(path, snapshot, compress);
+
+    const auto loaded = checkpoint::load(path);
+
+    check(loaded.rule == simulation.params.rule, name + ": rule");
+    check(loaded.topology == topology, name + ": topology");
+    check(loaded.generation == simulation.get_generation(), name + ": generation");
+    check(loaded.board != nullptr && loaded.board->get_resolution().x == res.x && loaded.board->get_resolution().y == res.y,
+          name + ": board");
+
+    // Restored into a simulation that runs another rule on another topology, so all of it has to come from the file.
+    Simulation restored{res, {.backend = backend, .topology = Topology::DeadBorder, .rule = Rule::parse("B36/S23")}};
+    checkpoint::restore(restored, path);
+
+    std::filesystem::remove(path);
+
+    check(restored.params.rule == simulation.params.rule, name + ": restored rule");
+    check(restored.params.topology == topology, name + ": restored topology");
+    check(restored.get_generation() == simulation.get_generation(), name + ": restored generation");
+    check(get_cells(restored) == get_cells(simulation), name + ": restored cells");
+
+    // The dying cells have to be where they were for the boards to go on the same.
+    simulation.step(20);
+    restored.step(20);
+
+    check(get_cells(restored) == get_cells(simulation), name + ": restored cells 20 generations on");
+}
+
+void test_checkpoints() {
+    for (const bool compress: {true, false}) {
+        test_checkpoint(Simulation::Backend::Cpu, "B3/S23", Topology::Torus, {130, 70}, compress);
+        test_checkpoint(Simulation::Backend::Packed, "B36/S23", Topology::KleinBottle, {1100, 140}, compress);
+        test_checkpoint(Simulation::Backend::Cpu, "B2/S/C3", Topology::DeadBorder, {130, 70}, compress);
+        test_checkpoint(Simulation::Backend::Cpu, "B2/S345/C40", Topology::ProjectivePlane, {1100, 140}, compress);
+    }
+
+    // An empty Generations board has no dying cell, compressed files leave their states out.
+    const auto path = std::filesystem::temp_directory_path() / "slime_tests.ckp";
+    const Simulation empty{{70, 70}, {.rule = Rule::parse("B2/S/C3")}};
+
+    checkpoint::write(path, checkpoint::take(empty), true);
+    check(checkpoint::load(path).states.empty(), "Empty Generations board: states left out");
+
+    // The rule of the header overwritten with ones Rule::parse() rejects: 1 state, range 0 and 600, a count of 9, S9..0.
+    const std::array<std::pair<std::size_t, std::uint32_t>, 5> corruptions{{{36, 1}, {38, 0}, {38, 600}, {34, 1 << 9}, {52, 9}}};
+
+    for (const auto& [offset, value]: corruptions) {
+        checkpoint::write(path, checkpoint::take(empty), false);
+
+        {
+            std::fstream file{path, std::ios::binary | std::ios::in | std::ios::out};
+            file.seekp(static_cast<std::streamoff>(offset));
+            file.write(reinterpret_cast<const char*>(&value), offset == 52 ? 4 : 2);
+        }
+
+        bool rejected = false;
+
+        try {
+            checkpoint::load(path);
+        } catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+
+        check(rejected, "Checkpoint with a corrupt rule rejected, offset " + std::to_string(offset));
+    }
+
+    std::filesystem::remove(path);
+}
+
+
+
+void test_encoding() {
+    std::mt19937_64 random{5};
+
+    for (const std::size_t size: {0, 1, 63, 1000}) {
+        std::vector<std::uint64_t> words(size);
+
+        for (auto& word: words) {
+            word = random() % 4 == 0 ? random() : 0;
+        }
+
+        std::vector<std::uint64_t> decoded(size, ~std::uint64_t{0});
+        live::decode(live::encode(words), decoded);
+
+        check(decoded == words, "Encoding of " + std::to_string(size) + " words");
+    }
+
+    bool rejected = false;
+
+    try {
+        std::vector<std::uint64_t> decoded(4);
+        live::decode(std::vector<std::uint8_t>{5, 200}, decoded);
+    } catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+
+    check(rejected, "Truncated encoding rejected");
+}
+
+
+// The client reads each frame before the next is published, so none is replaced or skipped: a keyframe, then deltas.
+void test_live_stream(std::string_view notation, Resolution res) {
+    const std::string name = std::string{"Stream of "} + std::string{notation} + ", " + std::to_string(res.x) + "x" + std::to_string(res.y);
+
+    Simulation simulation{res, {.topology = Topology::Torus, .rule = Rule::parse(notation)}};
+    start(simulation);
+
+    std::optional<live::Server> server{std::in_place, live::Server::Options{}};
+    live::Client client{"127.0.0.1", server->get_port()};
+
+    while (!server->has_viewers()) {
+        std::this_thread::yield();
+    }
+
+    for (int frame = 0; frame < 4; ++frame) {
+        const std::string at = name + ", frame " + std::to_string(frame);
+
+        server->publish(checkpoint::take(simulation));
+
+        if (!client.receive()) {
+            check(false, at + ": received");
+            return;
+        }
+
+        const auto& header = client.get_header();
+
+        check(header.type == (frame == 0 ? live::FrameType::Keyframe : live::FrameType::Delta), at + ": frame type");
+        check(header.states == simulation.params.rule.states, at + ": states");
+        check(client.get_generation() == simulation.get_generation(), at + ": generation");
+        check(client.get_population() == simulation.get_population(), at + ": population");
+
+        std::vector<std::uint8_t> cells(std::size_t{res.x} * res.y);
+        client.get_cells(cells);
+
+        check(cells == get_cells(simulation), at + ": cells");
+
+        simulation.step(3);
+    }
+
+    server.reset();
+
+    check(!client.receive(), name + ": closed");
+}
+
+void test_live_streams() {
+    test_encoding();
+
+    test_live_stream("B3/S23", {200, 150});
+    test_live_stream("B2/S/C3", {200, 150});
+    test_live_stream("B2/S345/C40", {70, 65});
+}
+
+
+
+// Live cells in the corners, so the bounding box the readers size the board to is the whole board.
+BitBoard make_pattern(Resolution res, std::uint64_t seed) {
+    std::mt19937_64 random{seed};
+    BitBoard cells{res};
+
+    for (unsigned int y = 0; y < res.y; ++y) {
+        for (unsigned int x = 0; x < res.x; ++x) {
+            cells.set(x, y, random() % 3 == 0);
+        }
+    }
+
+    cells.set(0, 0, true);
+    cells.set(res.x - 1, res.y - 1, true);
+
+    return cells;
+}
+
+bool is_same_pattern(const BitBoard& a, const BitBoard& b) {
+    if (a.get_resolution().x != b.get_resolution().x || a.get_resolution().y != b.get_resolution().y) {
+        return false;
+    }
+
+    for (unsigned int y = 0; y < a.get_resolution().y; ++y) {
+        for (unsigned int x = 0; x < a.get_resolution().x; ++x) {
+            if (a.get(x, y) != b.get(x, y)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void test_pattern(pattern::Format format, std::string_view notation, Resolution res) {
+    const std::string name = std::string{get_name(format)} + " pattern, " + std::string{notation} + ", " + std::to_string(res.x) + "x"
+          + std::to_string(res.y);
+
+    const Rule rule = Rule::parse(notation);
+    const BitBoard cells = make_pattern(res, res.x * 31 + res.y);
+
+    std::stringstream file;
+    pattern::write(file, cells, format, rule);
+
+    const auto read = pattern::read(file, format);
+
+    check(is_same_pattern(read.cells, cells), name + ": cells");
+
+    // Only RLE and macrocell files name their rule.
+    if (format == pattern::Format::Rle || format == pattern::Format::Macrocell) {
+        check(read.rule == rule, name + ": rule");
+    }
+}
+
+void test_malformed_pattern(pattern::Format format, std::string_view text) {
+    bool rejected = false;
+
+    try {
+        std::istringstream file{std::string{text}};
+        pattern::read(file, format);
+    } catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+
+    check(rejected, std::string{get_name(format)} + " pattern rejected: " + std::string{text});
+}
+
+void test_patterns() {
+    for (const auto format: pattern::formats) {
+        test_pattern(format, "B3/S23", {1, 1});
+        test_pattern(format, "B36/S23", {150, 97});
+        test_pattern(format, "B3/S23", {64, 64});
+    }
+
+    test_pattern(pattern::Format::Rle, "B2/S/C3", {70, 65});
+    test_pattern(pattern::Format::Rle, "R5,C0,M1,S34..58,B34..45,NM", {70, 65});
+
+    test_malformed_pattern(pattern::Format::Rle, "3o$obo!");
+    test_malformed_pattern(pattern::Format::Rle, "x = a, y = 1\no!");
+    test_malformed_pattern(pattern::Format::Rle, "x = 2, y = 1\n3o!");
+    test_malformed_pattern(pattern::Format::Rle, "x = 2, y = 1, rule = B9/S23\n2o!");
+    test_malformed_pattern(pattern::Format::Life106, "#Life 1.05\n0 0\n");
+    test_malformed_pattern(pattern::Format::Life106, "#Life 1.06\n0\n");
+    test_malformed_pattern(pattern::Format::Life106, "#Life 1.06\n0 zero\n");
+    test_malformed_pattern(pattern::Format::Plaintext, "!Name: glider\n.O.\n..X\n");
+    test_malformed_pattern(pattern::Format::Macrocell, "[M3]\n");
+    test_malformed_pattern(pattern::Format::Macrocell, "[M2]\n.*$*.$\n1 2 3 4 5\n");
+    test_malformed_pattern(pattern::Format::Macrocell, "[M2]\n.*x$\n");
+}
+
+} // namespace
+
+
+
+int main() {
+    const std::array<std::pair<std::string_view, void (*)()>, 4> tests{{
+          {"backends", test_backends},
+          {"checkpoints", test_checkpoints},
+          {"live streams", test_live_streams},
+          {"patterns", test_patterns},
+    }};
+
+    for (const auto& [name, test]: tests) {
+        try {
+            test();
+        } catch (const std::exception& e) {
+            check(false, std::string{name} + ": " + e.what());
+        }
+    }
+
+    if (failures != 0) {
+        std::cerr << failures << " checks failed.\n";
+        return 1;
+    }
+
+    std::cout << "All checks passed.\n";
+}